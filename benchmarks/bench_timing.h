@@ -0,0 +1,46 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+// Timing shared by the benchmarks
+namespace daw {
+	namespace spreadsheet {
+		namespace bench {
+			/// @brief Run function runs times
+			/// @return the fastest run, in seconds
+			template<typename Function>
+			double best_of( Function function, int runs = 5 ) {
+				auto best = std::chrono::duration<double>::max( );
+				for( int run = 0; run < runs; ++run ) {
+					auto const start = std::chrono::steady_clock::now( );
+					function( );
+					best = std::min<std::chrono::duration<double>>( best, std::chrono::steady_clock::now( ) - start );
+				}
+				return best.count( );
+			}
+		}	// namespace bench
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,122 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_timing.h"
+#include "big_num_t.h"
+
+// Operators and range sums on typical cell values, held as value_t as big_num_t did
+// before it kept small values inline, and as big_num_t.  The optional argument is the
+// number of values
+namespace {
+	namespace bench = daw::spreadsheet::bench;
+	using daw::spreadsheet::number::big_num_t;
+	using value_t = big_num_t::value_t;
+
+	/// Prices and quantities with up to four decimal places
+	std::vector<big_num_t> make_values( size_t count ) {
+		std::mt19937_64 engine{ 42 };
+		std::vector<big_num_t> result;
+		result.reserve( count );
+		for( size_t n = 0; n < count; ++n ) {
+			auto const mantissa = static_cast<int64_t>( engine( ) % 20000001 ) - 10000000;
+			result.push_back( big_num_t::from_scaled( mantissa == 0 ? 1 : mantissa, static_cast<uint8_t>( engine( ) % 5 ) ) );
+		}
+		return result;
+	}
+
+	/// Applies op to neighbouring values, storing each result so the work is kept
+	template<typename T, typename Op>
+	double time_operator( std::vector<T> const & values, std::vector<T> & results, Op op ) {
+		results.resize( values.size( ) );
+		return bench::best_of( [&]( ) {
+			for( size_t n = 1; n < values.size( ); ++n ) {
+				results[n] = op( values[n - 1], values[n] );
+			}
+		} );
+	}
+
+	void report( char const * name, size_t count, double before, double after ) {
+		std::cout << std::setw( 6 ) << std::left << name << std::right << std::fixed << std::setprecision( 1 )
+				<< std::setw( 10 ) << static_cast<double>( count ) / before / 1e6 << " M/s value_t "
+				<< std::setw( 10 ) << static_cast<double>( count ) / after / 1e6 << " M/s big_num_t "
+				<< std::setprecision( 2 ) << std::setw( 7 ) << before / after << "x\n";
+	}
+}	// namespace anonymous
+
+int main( int argc, char ** argv ) {
+	size_t const count = argc > 1 ? static_cast<size_t>( std::strtoull( argv[1], nullptr, 10 ) ) : 1000000;
+	auto const values = make_values( count );
+	std::vector<value_t> big_values;
+	big_values.reserve( count );
+	for( auto const & value: values ) {
+		big_values.push_back( value.big_value( ) );
+	}
+	std::cout << count << " values\n";
+
+	std::vector<value_t> big_results;
+	std::vector<big_num_t> results;
+	auto const add_before = time_operator( big_values, big_results, []( value_t const & a, value_t const & b ) { return a + b; } );
+	auto const add_after = time_operator( values, results, []( big_num_t const & a, big_num_t const & b ) { return a + b; } );
+	report( "+", count, add_before, add_after );
+
+	auto const subtract_before = time_operator( big_values, big_results, []( value_t const & a, value_t const & b ) { return a - b; } );
+	auto const subtract_after = time_operator( values, results, []( big_num_t const & a, big_num_t const & b ) { return a - b; } );
+	report( "-", count, subtract_before, subtract_after );
+
+	auto const multiply_before = time_operator( big_values, big_results, []( value_t const & a, value_t const & b ) { return a * b; } );
+	auto const multiply_after = time_operator( values, results, []( big_num_t const & a, big_num_t const & b ) { return a * b; } );
+	report( "*", count, multiply_before, multiply_after );
+
+	// Most quotients do not have a finite decimal expansion and are promoted
+	auto const divide_before = time_operator( big_values, big_results, []( value_t const & a, value_t const & b ) { return a / b; } );
+	auto const divide_after = time_operator( values, results, []( big_num_t const & a, big_num_t const & b ) { return a / b; } );
+	report( "/", count, divide_before, divide_after );
+
+	auto const less_before = time_operator( big_values, big_results, []( value_t const & a, value_t const & b ) { return value_t{ a < b ? 1 : 0 }; } );
+	auto const less_after = time_operator( values, results, []( big_num_t const & a, big_num_t const & b ) { return big_num_t{ a < b ? 1 : 0 }; } );
+	report( "<", count, less_before, less_after );
+
+	value_t big_total;
+	big_num_t total;
+	auto const sum_before = bench::best_of( [&]( ) {
+		big_total = 0;
+		for( auto const & value: big_values ) {
+			big_total += value;
+		}
+	} );
+	auto const sum_after = bench::best_of( [&]( ) {
+		total = big_num_t{ };
+		for( auto const & value: values ) {
+			total += value;
+		}
+	} );
+	report( "SUM", count, sum_before, sum_after );
+	std::cout << "  = " << big_total.str( ) << " and " << to_string( total ) << '\n';
+	return EXIT_SUCCESS;
+}
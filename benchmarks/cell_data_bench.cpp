@@ -0,0 +1,124 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <daw/nodepp/base_event_emitter.h>
+
+#include "cell_data.h"
+#include "counting_new.h"
+#include "event_table.h"
+#include "impl_cell_value.h"
+#include "impl_column.h"
+
+// Bytes per cell and construction time of cells as cell_value objects, each a
+// table_item with an emitter, id and listener table, against plain cell_data, plus
+// encoding and decoding a column through the column's own JSON mapping.  The optional
+// argument is the number of cells
+namespace {
+	using namespace daw::spreadsheet;
+	using expected_value_t = impl::cell_value::expected_value_t;
+
+	std::vector<std::string> make_texts( size_t count ) {
+		std::vector<std::string> result;
+		result.reserve( count );
+		for( size_t n = 0; n < count; ++n ) {
+			result.push_back( std::to_string( n % 100000 ) + "." + std::to_string( n % 97 ) );
+		}
+		return result;
+	}
+
+	/// Builds count cells with make( text ) into a vector, reporting the time taken and the
+	/// bytes held per cell, counting the vector
+	template<typename Cell, typename Make>
+	void construct( char const * name, std::vector<std::string> const & texts, Make make ) {
+		auto const before = bench::counts( ).live_bytes;
+		auto const start = std::chrono::steady_clock::now( );
+		{
+			std::vector<Cell> cells;
+			cells.reserve( texts.size( ) );
+			for( auto const & text: texts ) {
+				cells.push_back( make( text ) );
+			}
+			std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now( ) - start;
+			auto const bytes = bench::counts( ).live_bytes - before;
+			std::cout << std::setw( 40 ) << std::left << name << std::right << std::fixed
+					<< std::setprecision( 1 ) << std::setw( 8 ) << static_cast<double>( bytes ) / static_cast<double>( texts.size( ) ) << " bytes/cell "
+					<< std::setw( 8 ) << elapsed.count( ) * 1e3 << " ms\n";
+		}
+	}
+
+	template<typename Function>
+	double milliseconds( Function function ) {
+		auto const start = std::chrono::steady_clock::now( );
+		function( );
+		std::chrono::duration<double, std::milli> const elapsed = std::chrono::steady_clock::now( ) - start;
+		return elapsed.count( );
+	}
+}	// namespace anonymous
+
+int main( int argc, char ** argv ) {
+	size_t const count = argc > 1 ? static_cast<size_t>( std::strtoull( argv[1], nullptr, 10 ) ) : 1000000;
+	auto const texts = make_texts( count );
+	std::cout << count << " cells, sizeof cell_value " << sizeof( impl::cell_value ) << " B, cell_data " << sizeof( impl::cell_data ) << " B\n";
+
+	construct<impl::cell_value>( "cell_value, own emitter and event table", texts, []( std::string const & text ) {
+		return impl::cell_value{ daw::nodepp::base::create_event_emitter( ), expected_value_t::Number, text };
+	} );
+	auto const emitter = daw::nodepp::base::create_event_emitter( );
+	auto const events = create_event_table( );
+	construct<impl::cell_value>( "cell_value, shared emitter and table", texts, [&]( std::string const & text ) {
+		return impl::cell_value{ emitter, expected_value_t::Number, text, nullptr, events };
+	} );
+	construct<impl::cell_data>( "cell_data", texts, []( std::string const & text ) {
+		return impl::cell_data{ expected_value_t::Number, text };
+	} );
+
+	impl::column column{ emitter, events };
+	auto const before = bench::counts( ).live_bytes;
+	for( auto const & text: texts ) {
+		column.push_back( expected_value_t::Number, text );
+	}
+	std::cout << "column_store holds the column at " << std::fixed << std::setprecision( 1 )
+			<< static_cast<double>( bench::counts( ).live_bytes - before ) / static_cast<double>( count ) << " bytes/cell\n";
+
+	std::string json;
+	auto const encode_ms = milliseconds( [&]( ) {
+		json = column.encode( );
+	} );
+	impl::column decoded{ emitter, events };
+	auto const decode_ms = milliseconds( [&]( ) {
+		decoded.decode( json );
+	} );
+	std::cout << "column encode " << encode_ms << " ms, decode " << decode_ms << " ms, " << json.size( ) / 1024 << " KiB\n";
+	if( decoded.size( ) != column.size( ) ) {
+		std::cerr << "decoded " << decoded.size( ) << " of " << column.size( ) << " cells\n";
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
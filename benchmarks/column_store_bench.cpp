@@ -0,0 +1,120 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_timing.h"
+#include "column_store.h"
+#include "counting_new.h"
+#include "impl_cell_value.h"
+#include "value_classifier.h"
+
+// Bytes per cell and the time to sum a column's numbers when the column is a
+// std::vector<cell_value>, as impl::column was, and when it is a column_store.  The
+// optional argument is the number of rows
+namespace {
+	using namespace daw::spreadsheet;
+	using expected_value_t = impl::cell_value::expected_value_t;
+
+	struct row_data {
+		expected_value_t value_type;
+		std::string text;
+	};	// row_data
+
+	/// Mostly numbers, with short and long text mixed in
+	std::vector<row_data> make_rows( size_t rows ) {
+		std::mt19937 engine{ 42 };
+		std::vector<row_data> result;
+		result.reserve( rows );
+		for( size_t row = 0; row < rows; ++row ) {
+			auto const pick = engine( ) % 10;
+			if( pick < 8 ) {
+				auto const value = static_cast<int64_t>( engine( ) % 2000001 ) - 1000000;
+				result.push_back( row_data{ expected_value_t::Number, std::to_string( value ) + "." + std::to_string( engine( ) % 100 ) } );
+			} else if( pick == 8 ) {
+				result.push_back( row_data{ expected_value_t::Text, "item " + std::to_string( engine( ) % 50 ) } );
+			} else {
+				result.push_back( row_data{ expected_value_t::Text, "a longer description of row " + std::to_string( row ) } );
+			}
+		}
+		return result;
+	}
+
+	void report( char const * name, size_t rows, size_t bytes, double seconds, impl::cell_value::number_t const & total ) {
+		std::cout << std::setw( 24 ) << std::left << name << std::right << std::fixed
+				<< std::setprecision( 1 ) << std::setw( 8 ) << static_cast<double>( bytes ) / static_cast<double>( rows ) << " bytes/cell "
+				<< std::setprecision( 2 ) << std::setw( 9 ) << static_cast<double>( rows ) / seconds / 1e6 << " M cells/s scanned  = " << to_string( total ) << '\n';
+	}
+}	// namespace anonymous
+
+int main( int argc, char ** argv ) {
+	size_t const rows = argc > 1 ? static_cast<size_t>( std::strtoull( argv[1], nullptr, 10 ) ) : 1000000;
+	auto const data = make_rows( rows );
+	std::cout << rows << " rows\n";
+	{
+		auto const before = bench::counts( ).live_bytes;
+		std::vector<impl::cell_value> cells;
+		cells.reserve( rows );
+		for( auto const & row: data ) {
+			cells.emplace_back( daw::nodepp::base::create_event_emitter( ), row.value_type, row.text );
+		}
+		auto const bytes = bench::counts( ).live_bytes - before;
+		// Each number is parsed from its text when read
+		impl::cell_value::number_t total{ };
+		auto const seconds = bench::best_of( [&]( ) {
+			total = impl::cell_value::number_t{ };
+			for( auto const & cell: cells ) {
+				if( cell.value_type( ) == expected_value_t::Number ) {
+					auto const value = classify_value( cell.string_value( ) );
+					if( value.type == expected_value_t::Number ) {
+						total += to_number( value );
+					}
+				}
+			}
+		} );
+		report( "vector<cell_value>", rows, bytes, seconds, total );
+	}
+	{
+		auto const before = bench::counts( ).live_bytes;
+		impl::column_store store;
+		store.reserve( rows );
+		for( auto const & row: data ) {
+			store.push_back( row.value_type, row.text );
+		}
+		// Counts the shared string_pool too, which memory_usage( ) leaves out
+		auto const bytes = bench::counts( ).live_bytes - before;
+		impl::cell_value::number_t total{ };
+		auto const seconds = bench::best_of( [&]( ) {
+			total = impl::cell_value::number_t{ };
+			store.for_each_number( [&total]( size_t, impl::cell_value::number_t const & value ) {
+				total += value;
+			} );
+		} );
+		report( "column_store", rows, bytes, seconds, total );
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new and delete to count allocations and the bytes they
+// hold.  Include from exactly one translation unit of a benchmark
+namespace daw {
+	namespace spreadsheet {
+		namespace bench {
+			struct allocation_counts {
+				size_t allocations;
+				size_t live_bytes;
+			};	// allocation_counts
+
+			inline allocation_counts & counts( ) noexcept {
+				static allocation_counts s_counts{ 0, 0 };
+				return s_counts;
+			}
+
+			namespace impl {
+				// Each block is prefixed with its size so delete can subtract it
+				constexpr size_t header_size = alignof( std::max_align_t );
+
+				inline void * allocate( size_t size ) {
+					auto const block = static_cast<char *>( std::malloc( size + header_size ) );
+					if( !block ) {
+						throw std::bad_alloc{ };
+					}
+					*reinterpret_cast<size_t *>( block ) = size;
+					++counts( ).allocations;
+					counts( ).live_bytes += size;
+					return block + header_size;
+				}
+
+				inline void deallocate( void * ptr ) noexcept {
+					if( !ptr ) {
+						return;
+					}
+					auto const block = static_cast<char *>( ptr ) - header_size;
+					counts( ).live_bytes -= *reinterpret_cast<size_t *>( block );
+					std::free( block );
+				}
+			}	// namespace impl
+		}	// namespace bench
+	}	// namespace spreadsheet
+}	// namespace daw
+
+void * operator new( size_t size ) {
+	return daw::spreadsheet::bench::impl::allocate( size );
+}
+
+void * operator new[]( size_t size ) {
+	return daw::spreadsheet::bench::impl::allocate( size );
+}
+
+void operator delete( void * ptr ) noexcept {
+	daw::spreadsheet::bench::impl::deallocate( ptr );
+}
+
+void operator delete[]( void * ptr ) noexcept {
+	daw::spreadsheet::bench::impl::deallocate( ptr );
+}
+
+void operator delete( void * ptr, size_t ) noexcept {
+	daw::spreadsheet::bench::impl::deallocate( ptr );
+}
+
+void operator delete[]( void * ptr, size_t ) noexcept {
+	daw::spreadsheet::bench::impl::deallocate( ptr );
+}
@@ -0,0 +1,125 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "counting_new.h"
+#include "sheetrock_parser.h"
+
+// Calls to operator new per parsed formula, and parse time, for the optional_poly
+// expression tree against a flat_ast arena reused between formulas.  The optional
+// argument is the number of times the corpus is parsed
+namespace {
+	using namespace daw::spreadsheet;
+	namespace sheetrock = daw::parser::sheetrock;
+
+	std::vector<std::string> const & corpus( ) {
+		static std::vector<std::string> const s_corpus = {
+				"=1",
+				"=A1",
+				"=A1+B1",
+				"=A1*2+B1/4-C1",
+				"=SUM(A1:A100)",
+				"=AVERAGE(A1:A10)*(1+B2%)",
+				"=IF(A1>10,SUM(B1:B10),MAX(C1,C2,C3))",
+				"=-(A1^2+B1^2)^0.5",
+				"=VLOOKUP(A2,D1:F500,3,0)",
+				"=IF(AND(A1>0,B1<100),\"in range\",\"out of range\")",
+				"=ABS(A1-B1)/MAX(ABS(A1),ABS(B1),1)",
+				"=SUM(A1:A10)+SUM(B1:B10)+SUM(C1:C10)+SUM(D1:D10)",
+				"=((((A1+1)*2)-3)/4)^5",
+				"=MATCH(\"total\",A1:A1000,0)+OR(NOT(C3),D4=1)"
+		};
+		return s_corpus;
+	}
+
+	struct result_t {
+		double allocations_per_formula;
+		double seconds;
+	};	// result_t
+
+	template<typename Parse>
+	result_t measure( size_t repeats, Parse parse ) {
+		auto const formulas = repeats * corpus( ).size( );
+		auto const allocations = bench::counts( ).allocations;
+		auto const start = std::chrono::steady_clock::now( );
+		for( size_t n = 0; n < repeats; ++n ) {
+			for( auto const & text: corpus( ) ) {
+				parse( text );
+			}
+		}
+		std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now( ) - start;
+		return result_t{ static_cast<double>( bench::counts( ).allocations - allocations ) / static_cast<double>( formulas ), elapsed.count( ) };
+	}
+
+	void report( char const * name, size_t formulas, result_t const & result ) {
+		std::cout << std::setw( 14 ) << std::left << name << std::right << std::fixed
+				<< std::setprecision( 2 ) << std::setw( 8 ) << result.allocations_per_formula << " allocations/formula "
+				<< std::setprecision( 1 ) << std::setw( 8 ) << static_cast<double>( formulas ) / result.seconds / 1e3 << " k formulas/s\n";
+	}
+}	// namespace anonymous
+
+int main( int argc, char ** argv ) {
+	size_t const repeats = argc > 1 ? static_cast<size_t>( std::strtoull( argv[1], nullptr, 10 ) ) : 20000;
+	auto const formulas = repeats * corpus( ).size( );
+	std::cout << corpus( ).size( ) << " formulas parsed " << repeats << " times\n";
+
+	// Each formula's tree is destroyed before the next is parsed
+	size_t failures = 0;
+	auto const tree = measure( repeats, [&failures]( std::string const & text ) {
+		if( !sheetrock::parse_formula( text ) ) {
+			++failures;
+		}
+	} );
+	report( "optional_poly", formulas, tree );
+
+	// The arena keeps its storage between formulas, as when a batch is compiled
+	sheetrock::flat_ast arena;
+	auto const flat = measure( repeats, [&]( std::string const & text ) {
+		arena.clear( );
+		if( !sheetrock::parse_formula( text, arena ) ) {
+			++failures;
+		}
+	} );
+	report( "flat_ast", formulas, flat );
+
+	// A new arena per formula shows the cost of the arena's own first allocations
+	auto const fresh = measure( repeats, [&failures]( std::string const & text ) {
+		sheetrock::flat_ast single;
+		if( !sheetrock::parse_formula( text, single ) ) {
+			++failures;
+		}
+	} );
+	report( "flat_ast fresh", formulas, fresh );
+
+	if( failures != 0 ) {
+		std::cerr << failures << " formulas did not parse\n";
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
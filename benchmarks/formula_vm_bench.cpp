@@ -0,0 +1,189 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_timing.h"
+#include "formula_cache.h"
+#include "formula_vm.h"
+#include "sheetrock_parser.h"
+
+// Evaluating a filled down sheet the way it was done before formula_vm, parsing each
+// cell's text and walking the expression tree, against one compile_formula of the
+// first cell evaluated for every row.  The optional argument is the number of rows
+namespace {
+	using namespace daw::spreadsheet;
+	namespace ast = daw::parser::sheetrock::ast;
+
+	/// Column A holds numbers, B and C hold the formulas being timed
+	struct number_sheet {
+		std::vector<formula_value> values;
+
+		formula_value value( cell_address address ) const {
+			if( address.column != 0 || address.row >= values.size( ) ) {
+				return formula_value{ };
+			}
+			return values[address.row];
+		}
+
+		template<typename Function>
+		void for_each_value( cell_range range, Function function ) const {
+			if( range.first.column != 0 ) {
+				return;
+			}
+			auto const last = std::min<size_t>( range.last.row, values.size( ) - 1 );
+			for( size_t row = range.first.row; row <= last; ++row ) {
+				function( values[row] );
+			}
+		}
+	};	// number_sheet
+
+	op_code binary_op_code( int32_t op ) {
+		switch( op ) {
+		case '+': return op_code::add;
+		case '-': return op_code::subtract;
+		case '*': return op_code::multiply;
+		case '/': return op_code::divide;
+		case '%': return op_code::modulus;
+		case '^': return op_code::power;
+		case '&': return op_code::logical_and;
+		case '|': return op_code::logical_or;
+		case '<': return op_code::less;
+		case '>': return op_code::greater;
+		default: return op_code::equal;
+		}
+	}
+
+	formula_value walk( ast::expression const & node, number_sheet const & sheet );
+
+	formula_value walk_function( ast::function const & fn, number_sheet const & sheet ) {
+		std::string name = fn.name ? (*fn.name).value : std::string{ };
+		std::transform( name.begin( ), name.end( ), name.begin( ), []( char c ) {
+			return static_cast<char>( std::toupper( static_cast<unsigned char>( c ) ) );
+		} );
+		if( name == "IF" ) {
+			auto error = formula_error::none;
+			auto const condition = impl::is_true( walk( *fn.arguments[0], sheet ), error );
+			if( error != formula_error::none ) {
+				return formula_value::from_error( error );
+			}
+			return walk( *fn.arguments[condition ? 1 : 2], sheet );
+		}
+		auto function = formula_function::sum;
+		if( name == "AVERAGE" ) {
+			function = formula_function::average;
+		} else if( name == "MIN" ) {
+			function = formula_function::min;
+		} else if( name == "MAX" ) {
+			function = formula_function::max;
+		} else if( name != "SUM" ) {
+			return formula_value::from_error( formula_error::name );
+		}
+		impl::aggregate_state state{ function };
+		for( auto const & argument: fn.arguments ) {
+			if( auto rng = dynamic_cast<ast::range const *>( &*argument ) ) {
+				sheet.for_each_value( cell_range{ (*rng->first).address, (*rng->last).address }, [&state]( formula_value const & value ) {
+					state.add( value, true );
+				} );
+			} else {
+				state.add( walk( *argument, sheet ), false );
+			}
+		}
+		return state.finish( );
+	}
+
+	formula_value walk( ast::expression const & node, number_sheet const & sheet ) {
+		if( auto bin = dynamic_cast<ast::binary_operator const *>( &node ) ) {
+			return impl::apply_binary( binary_op_code( bin->op_char( ) ), walk( *bin->lhs, sheet ), walk( *bin->rhs, sheet ) );
+		} else if( auto un = dynamic_cast<ast::unary_operator const *>( &node ) ) {
+			return impl::apply_unary( un->op == '%' ? op_code::percent : op_code::negate, walk( *un->rhs, sheet ) );
+		} else if( auto num = dynamic_cast<ast::number const *>( &node ) ) {
+			daw::spreadsheet::number::big_num_t value{ };
+			daw::spreadsheet::number::from_chars( num->value.data( ), num->value.data( ) + num->value.size( ), value );
+			return formula_value::from_number( std::move( value ) );
+		} else if( auto c = dynamic_cast<ast::cell const *>( &node ) ) {
+			return sheet.value( c->address );
+		} else if( auto fn = dynamic_cast<ast::function const *>( &node ) ) {
+			return walk_function( *fn, sheet );
+		}
+		return formula_value::from_error( formula_error::value );
+	}
+
+	/// The formula of column, filled down to row
+	std::string fill_down( size_t column, size_t row ) {
+		auto const a = "A" + std::to_string( row + 1 );
+		if( column == 1 ) {
+			return "=" + a + "*2+" + a + "/4-(" + a + "^2)%7";
+		}
+		return "=SUM(" + a + ":A" + std::to_string( row + 10 ) + ")/10+IF(" + a + ">500," + a + ",MAX(" + a + ",1))";
+	}
+}	// namespace anonymous
+
+int main( int argc, char ** argv ) {
+	size_t const rows = argc > 1 ? static_cast<size_t>( std::strtoull( argv[1], nullptr, 10 ) ) : 100000;
+	number_sheet sheet;
+	sheet.values.reserve( rows );
+	for( size_t row = 0; row < rows; ++row ) {
+		sheet.values.push_back( formula_value::from_number( static_cast<intmax_t>( (row * 7919) % 1000 ) ) );
+	}
+
+	std::cout << rows << " rows\n";
+	for( size_t column = 1; column <= 2; ++column ) {
+		std::vector<std::string> texts;
+		texts.reserve( rows );
+		for( size_t row = 0; row < rows; ++row ) {
+			texts.push_back( fill_down( column, row ) );
+		}
+
+		daw::spreadsheet::number::big_num_t walked_total{ };
+		auto const walked = bench::best_of( [&]( ) {
+			walked_total = daw::spreadsheet::number::big_num_t{ };
+			for( auto const & text: texts ) {
+				auto const parsed = daw::parser::sheetrock::parse_formula( text );
+				walked_total += walk( *parsed.expression, sheet ).number;
+			}
+		} );
+
+		daw::parser::sheetrock::flat_ast arena;
+		auto const parsed = daw::parser::sheetrock::parse_formula( texts.front( ), arena );
+		compiled_formula const formula{ compile_formula( arena, parsed.root ), cell_address{ 0, static_cast<cell_address::index_t>( column ) } };
+		daw::spreadsheet::number::big_num_t vm_total{ };
+		auto const vm = bench::best_of( [&]( ) {
+			vm_total = daw::spreadsheet::number::big_num_t{ };
+			for( size_t row = 0; row < rows; ++row ) {
+				vm_total += formula.evaluate( cell_address{ static_cast<cell_address::index_t>( row ), static_cast<cell_address::index_t>( column ) }, sheet ).number;
+			}
+		} );
+
+		std::cout << texts.front( ) << '\n' << std::fixed << std::setprecision( 1 )
+				<< "  parse and walk " << std::setw( 8 ) << static_cast<double>( rows ) / walked / 1e3 << " k cells/s  = " << to_string( walked_total ) << '\n'
+				<< "  compiled once  " << std::setw( 8 ) << static_cast<double>( rows ) / vm / 1e3 << " k cells/s  = " << to_string( vm_total ) << '\n'
+				<< "  speedup " << std::setprecision( 2 ) << walked / vm << "x\n";
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "bench_timing.h"
+#include "column_store.h"
+#include "range_aggregate.h"
+
+// Throughput of the range_aggregate kernels at each SIMD level the CPU supports, in
+// GB/s of lane values read.  The optional argument is the number of rows
+namespace {
+	using namespace daw::spreadsheet;
+
+	char const * level_name( simd_level level ) {
+		switch( level ) {
+		case simd_level::avx2: return "avx2";
+		case simd_level::sse42: return "sse4.2";
+		case simd_level::scalar:
+		default: return "scalar";
+		}
+	}
+
+	impl::column_store make_column( size_t rows ) {
+		std::mt19937 engine{ 42 };
+		impl::column_store result;
+		result.reserve( rows );
+		for( size_t row = 0; row < rows; ++row ) {
+			auto const value = static_cast<int64_t>( engine( ) % 2000001 ) - 1000000;
+			result.push_back( impl::column_store::expected_value_t::Number, std::to_string( value ) + "." + std::to_string( engine( ) % 100 ) );
+		}
+		return result;
+	}
+
+	/// Best of several runs, in seconds
+	double time_aggregate( impl::column_store const & store, formula_function function, size_t first_row, size_t row_count, formula_value & result ) {
+		return bench::best_of( [&]( ) {
+			result = aggregate_value( store, function, first_row, row_count );
+		}, 7 );
+	}
+}	// namespace anonymous
+
+int main( int argc, char ** argv ) {
+	size_t const rows = argc > 1 ? static_cast<size_t>( std::strtoull( argv[1], nullptr, 10 ) ) : 4000000;
+	auto const store = make_column( rows );
+	struct {
+		char const * name;
+		formula_function function;
+	} const functions[] = { { "SUM", formula_function::sum }, { "MIN", formula_function::min }, { "MAX", formula_function::max } };
+
+	std::cout << rows << " rows\n";
+	for( auto level: { simd_level::scalar, simd_level::sse42, simd_level::avx2 } ) {
+		if( level > supported_simd_level( ) ) {
+			continue;
+		}
+		set_simd_level( level );
+		for( auto const & function: functions ) {
+			// Starting one row in leaves every block but the first unmasked
+			formula_value result;
+			auto const seconds = time_aggregate( store, function.function, 1, rows, result );
+			auto const gigabytes = static_cast<double>( (rows - 1) * sizeof( int64_t ) ) / 1e9;
+			std::cout << std::setw( 7 ) << level_name( level ) << ' ' << function.name << ' ' << std::fixed << std::setprecision( 2 ) << gigabytes / seconds << " GB/s  = " << to_string( result.number ) << '\n';
+		}
+	}
+	set_simd_level( supported_simd_level( ) );
+	return EXIT_SUCCESS;
+}
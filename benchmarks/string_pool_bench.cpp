@@ -0,0 +1,143 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_timing.h"
+#include "column_store.h"
+#include "counting_new.h"
+#include "string_pool.h"
+
+// Memory, build, copy and equality scan times of text columns held as a std::string per
+// cell, as cell_value held them, and as column_stores sharing a string_pool.  The
+// repetitive dataset has a status, a country, a filled down formula and a constant note
+// per row, the unique one the same shape with every text distinct.  The optional argument
+// is the number of rows
+namespace {
+	using namespace daw::spreadsheet;
+	using expected_value_t = impl::column_store::expected_value_t;
+	using table_t = std::vector<std::vector<std::string>>;
+
+	size_t const column_count = 4;
+
+	table_t make_repetitive( size_t rows ) {
+		static char const * const s_statuses[] = { "awaiting payment", "payment received", "shipped to customer", "delivered", "returned by customer", "cancelled" };
+		static char const * const s_countries[] = { "New Zealand", "United Kingdom", "United States", "Australia", "Germany", "France", "Japan", "Canada", "Netherlands", "South Africa" };
+		std::mt19937 engine{ 42 };
+		table_t result( column_count );
+		for( auto & column: result ) {
+			column.reserve( rows );
+		}
+		for( size_t row = 0; row < rows; ++row ) {
+			result[0].emplace_back( s_statuses[engine( ) % 6] );
+			result[1].emplace_back( s_countries[engine( ) % 10] );
+			result[2].emplace_back( "=$F$1*1.15+$G$1" );
+			result[3].emplace_back( "imported from the 2016 order system" );
+		}
+		return result;
+	}
+
+	table_t make_unique( size_t rows ) {
+		table_t result( column_count );
+		for( auto & column: result ) {
+			column.reserve( rows );
+		}
+		for( size_t row = 0; row < rows; ++row ) {
+			auto const id = std::to_string( row );
+			result[0].push_back( "status " + id );
+			result[1].push_back( "country " + id );
+			result[2].push_back( "=$F$1*1.15+G" + id );
+			result[3].push_back( "order note " + id );
+		}
+		return result;
+	}
+
+	template<typename Columns, typename Build>
+	void measure( char const * name, Build build, void ( *scan )( Columns const &, size_t & ) ) {
+		auto const before = bench::counts( ).live_bytes;
+		auto const built = bench::best_of( [&]( ) {
+			build( );
+		}, 1 );
+		auto const columns = build( );
+		auto const bytes = bench::counts( ).live_bytes - before;
+		auto const copied = bench::best_of( [&]( ) {
+			auto const copy = columns;
+		} );
+		size_t equal = 0;
+		auto const scanned = bench::best_of( [&]( ) {
+			scan( columns, equal );
+		} );
+		std::cout << std::setw( 20 ) << std::left << name << std::right << std::fixed << std::setprecision( 1 )
+				<< std::setw( 8 ) << static_cast<double>( bytes ) / 1e6 << " MB " << std::setw( 8 ) << built * 1e3 << " ms build "
+				<< std::setw( 8 ) << copied * 1e3 << " ms copy " << std::setw( 8 ) << scanned * 1e3 << " ms equality scan  " << equal << " equal\n";
+	}
+
+	// Compares the status column with itself shifted by a row, as a duplicate check would
+	void scan_strings( table_t const & columns, size_t & equal ) {
+		equal = 0;
+		auto const & column = columns[0];
+		for( size_t row = 1; row < column.size( ); ++row ) {
+			equal += column[row] == column[row - 1] ? 1 : 0;
+		}
+	}
+
+	void scan_stores( std::vector<impl::column_store> const & columns, size_t & equal ) {
+		equal = 0;
+		auto const & column = columns[0];
+		for( size_t row = 1; row < column.size( ); ++row ) {
+			equal += column.same_text( row, column, row - 1 ) ? 1 : 0;
+		}
+	}
+
+	void run( char const * dataset, table_t const & table ) {
+		std::cout << dataset << ", " << table[0].size( ) << " rows x " << column_count << " columns\n";
+		measure<table_t>( "std::string per cell", [&]( ) {
+			return table;
+		}, scan_strings );
+		measure<std::vector<impl::column_store>>( "column_store", [&]( ) {
+			auto const pool = std::make_shared<string_pool>( );
+			std::vector<impl::column_store> result;
+			for( auto const & column: table ) {
+				result.emplace_back( pool );
+				auto & store = result.back( );
+				store.reserve( column.size( ) );
+				for( auto const & text: column ) {
+					store.push_back( expected_value_t::Text, text );
+				}
+			}
+			return result;
+		}, scan_stores );
+	}
+}	// namespace anonymous
+
+int main( int argc, char ** argv ) {
+	size_t const rows = argc > 1 ? static_cast<size_t>( std::strtoull( argv[1], nullptr, 10 ) ) : 1000000;
+	run( "repetitive", make_repetitive( rows ) );
+	run( "unique", make_unique( rows ) );
+	return EXIT_SUCCESS;
+}
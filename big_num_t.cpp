@@ -20,46 +20,337 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <utility>
+
 #include "big_num_t.h"
 
 namespace daw {
 	namespace spreadsheet {
 		namespace number {
+			namespace {
+				using value_t = big_num_t::value_t;
+
+				constexpr std::array<int64_t, big_num_t::max_scale + 1> const s_powers_of_ten = {{
+						1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL, 1000000000LL,
+						10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL, 100000000000000LL,
+						1000000000000000LL, 10000000000000000LL, 100000000000000000LL, 1000000000000000000LL
+				}};
+
+				/// 10^-scale as value_t.  Built from text so they are exact in base 10
+				value_t const & inverse_power_of_ten( uint8_t scale ) {
+					static auto const s_inverse = []( ) {
+						std::array<value_t, big_num_t::max_scale + 1> result;
+						for( size_t n = 0; n < result.size( ); ++n ) {
+							result[n] = value_t{ ( "1e-" + std::to_string( n ) ).c_str( ) };
+						}
+						return result;
+					}( );
+					return s_inverse[scale];
+				}
+
+				bool checked_multiply( int64_t lhs, int64_t rhs, int64_t & result ) noexcept {
+					return !__builtin_mul_overflow( lhs, rhs, &result );
+				}
+
+				bool checked_add( int64_t lhs, int64_t rhs, int64_t & result ) noexcept {
+					return !__builtin_add_overflow( lhs, rhs, &result );
+				}
+
+				bool checked_subtract( int64_t lhs, int64_t rhs, int64_t & result ) noexcept {
+					return !__builtin_sub_overflow( lhs, rhs, &result );
+				}
+
+				uint64_t magnitude( int64_t value ) noexcept {
+					return value < 0 ? static_cast<uint64_t>( 0 ) - static_cast<uint64_t>( value ) : static_cast<uint64_t>( value );
+				}
+
+				uint64_t gcd( uint64_t a, uint64_t b ) noexcept {
+					while( b != 0 ) {
+						auto const t = a % b;
+						a = b;
+						b = t;
+					}
+					return a;
+				}
+
+				/// Bring both inline values to the larger scale
+				bool align( big_num_t const & lhs, big_num_t const & rhs, int64_t & a, int64_t & b, uint8_t & scale ) noexcept {
+					a = lhs.mantissa( );
+					b = rhs.mantissa( );
+					if( lhs.scale( ) < rhs.scale( ) ) {
+						scale = rhs.scale( );
+						return checked_multiply( a, s_powers_of_ten[scale - lhs.scale( )], a );
+					}
+					scale = lhs.scale( );
+					return checked_multiply( b, s_powers_of_ten[scale - rhs.scale( )], b );
+				}
+
+				/// @return a value_t reference to value, using buffer when value is inline
+				value_t const & as_big( big_num_t const & value, value_t & buffer ) {
+					buffer = value.big_value( );
+					return buffer;
+				}
+
+				bool is_digit( char c ) noexcept {
+					return c >= '0' && c <= '9';
+				}
+			}	// namespace anonymous
+
+			big_num_t::big_num_t( ) noexcept:
+					m_mantissa{ 0 },
+					m_scale{ 0 },
+					m_big{ } { }
+
+			big_num_t::big_num_t( char const * str ):
+					big_num_t{ } {
+
+				assign_string( str, str + std::strlen( str ) );
+			}
+
+			big_num_t::big_num_t( std::string const & str ):
+					big_num_t{ } {
+
+				assign_string( str.data( ), str.data( ) + str.size( ) );
+			}
+
+			big_num_t::big_num_t( double value ):
+					big_num_t{ } {
+
+				assign_big( value_t{ value } );
+			}
+
+			big_num_t::big_num_t( value_t value ):
+					big_num_t{ } {
+
+				assign_big( std::move( value ) );
+			}
+
 			big_num_t::~big_num_t( ) { };
 
+			big_num_t::big_num_t( big_num_t const & other ):
+					m_mantissa{ other.m_mantissa },
+					m_scale{ other.m_scale },
+					m_big{ other.m_big ? std::make_unique<value_t>( *other.m_big ) : nullptr } { }
+
+			big_num_t::big_num_t( big_num_t && other ) noexcept:
+					m_mantissa{ std::exchange( other.m_mantissa, 0 ) },
+					m_scale{ std::exchange( other.m_scale, 0 ) },
+					m_big{ std::move( other.m_big ) } { }
+
+			big_num_t & big_num_t::operator=( big_num_t const & rhs ) {
+				if( this != &rhs ) {
+					big_num_t tmp{ rhs };
+					using std::swap;
+					swap( *this, tmp );
+				}
+				return *this;
+			}
+
+			big_num_t & big_num_t::operator=( big_num_t && rhs ) noexcept {
+				if( this != &rhs ) {
+					big_num_t tmp{ std::move( rhs ) };
+					using std::swap;
+					swap( *this, tmp );
+				}
+				return *this;
+			}
+
+			big_num_t big_num_t::from_scaled( int64_t mantissa, uint8_t scale ) {
+				big_num_t result{ };
+				if( scale <= max_scale ) {
+					result.m_mantissa = mantissa;
+					result.m_scale = scale;
+					result.normalize( );
+				} else {
+					result.assign_big( value_t{ mantissa } * value_t{ ( "1e-" + std::to_string( scale ) ).c_str( ) } );
+				}
+				return result;
+			}
+
 			void big_num_t::swap( big_num_t & rhs ) noexcept {
 				using std::swap;
-				swap( this->value, rhs.value );
+				swap( m_mantissa, rhs.m_mantissa );
+				swap( m_scale, rhs.m_scale );
+				m_big.swap( rhs.m_big );
+			}
+
+			void big_num_t::assign_integer( int64_t value ) noexcept {
+				m_mantissa = value;
+				m_scale = 0;
+				m_big.reset( );
+			}
+
+			void big_num_t::assign_unsigned( uint64_t value ) {
+				if( value <= static_cast<uint64_t>( std::numeric_limits<int64_t>::max( ) ) ) {
+					assign_integer( static_cast<int64_t>( value ) );
+				} else {
+					assign_big( value_t{ value } );
+				}
+			}
+
+			// Text that from_chars does not consume completely is left to value_t, which
+			// throws for anything that is not a number
+			void big_num_t::assign_string( char const * first, char const * last ) {
+				auto const result = from_chars( first, last, *this );
+				if( result.ec != std::errc{ } || result.ptr != last ) {
+					assign_big( value_t{ std::string{ first, last } } );
+				}
+			}
+
+			void big_num_t::assign_big( value_t value ) {
+				// Integers in range are kept inline
+				static value_t const s_min{ std::numeric_limits<int64_t>::min( ) };
+				static value_t const s_max{ std::numeric_limits<int64_t>::max( ) };
+				if( value >= s_min && value <= s_max && boost::multiprecision::trunc( value ) == value ) {
+					assign_integer( value.convert_to<int64_t>( ) );
+					return;
+				}
+				m_mantissa = 0;
+				m_scale = 0;
+				m_big = std::make_unique<value_t>( std::move( value ) );
+			}
+
+			void big_num_t::normalize( ) noexcept {
+				if( m_mantissa == 0 ) {
+					m_scale = 0;
+					return;
+				}
+				while( m_scale > 0 && m_mantissa % 10 == 0 ) {
+					m_mantissa /= 10;
+					--m_scale;
+				}
 			}
 
-			big_num_t::operator value_t&( ) {
-				return value;
+			bool big_num_t::is_small( ) const noexcept {
+				return !m_big;
 			}
 
-			big_num_t::operator value_t const &( ) const {
-				return value;
+			int64_t big_num_t::mantissa( ) const noexcept {
+				return m_mantissa;
+			}
+
+			uint8_t big_num_t::scale( ) const noexcept {
+				return m_scale;
+			}
+
+			big_num_t::value_t big_num_t::big_value( ) const {
+				if( m_big ) {
+					return *m_big;
+				}
+				value_t result{ m_mantissa };
+				if( m_scale != 0 ) {
+					result *= inverse_power_of_ten( m_scale );
+				}
+				return result;
 			}
 
 			big_num_t & big_num_t::operator+=( big_num_t const & rhs ) {
-				value += rhs.value;
+				int64_t a;
+				int64_t b;
+				uint8_t scale;
+				if( is_small( ) && rhs.is_small( ) && align( *this, rhs, a, b, scale ) && checked_add( a, b, a ) ) {
+					m_mantissa = a;
+					m_scale = scale;
+					normalize( );
+					return *this;
+				}
+				value_t buffer;
+				assign_big( big_value( ) + as_big( rhs, buffer ) );
 				return *this;
 			}
 
 			big_num_t & big_num_t::operator-=( big_num_t const & rhs ) {
-				value -= rhs.value;
+				int64_t a;
+				int64_t b;
+				uint8_t scale;
+				if( is_small( ) && rhs.is_small( ) && align( *this, rhs, a, b, scale ) && checked_subtract( a, b, a ) ) {
+					m_mantissa = a;
+					m_scale = scale;
+					normalize( );
+					return *this;
+				}
+				value_t buffer;
+				assign_big( big_value( ) - as_big( rhs, buffer ) );
 				return *this;
 			}
 
 			big_num_t & big_num_t::operator*=( big_num_t const & rhs ) {
-				value *= rhs.value;
+				if( is_small( ) && rhs.is_small( ) ) {
+					int64_t product;
+					if( checked_multiply( m_mantissa, rhs.m_mantissa, product ) ) {
+						auto scale = m_scale + rhs.m_scale;
+						for( ; scale > max_scale && product % 10 == 0; --scale ) {
+							product /= 10;
+						}
+						if( scale <= max_scale ) {
+							m_mantissa = product;
+							m_scale = static_cast<uint8_t>( scale );
+							normalize( );
+							return *this;
+						}
+					}
+				}
+				value_t buffer;
+				assign_big( big_value( ) * as_big( rhs, buffer ) );
 				return *this;
 			}
 
+			// Only quotients with a finite decimal expansion that fits are computed inline,
+			// e.g. 1/4 but not 1/3
 			big_num_t & big_num_t::operator/=( big_num_t const & rhs ) {
-				value /= rhs.value;
+				auto const min_value = std::numeric_limits<int64_t>::min( );
+				if( is_small( ) && rhs.is_small( ) && rhs.m_mantissa != 0 && m_mantissa != min_value && rhs.m_mantissa != min_value ) {
+					auto denominator = magnitude( rhs.m_mantissa ) / gcd( magnitude( m_mantissa ), magnitude( rhs.m_mantissa ) );
+					while( denominator % 2 == 0 ) {
+						denominator /= 2;
+					}
+					while( denominator % 5 == 0 ) {
+						denominator /= 5;
+					}
+					if( denominator == 1 ) {
+						// result = m_mantissa * 10^(rhs.scale + scale - m_scale) / rhs.m_mantissa
+						for( int scale = 0; scale <= max_scale; ++scale ) {
+							auto const shift = rhs.m_scale + scale - m_scale;
+							int64_t numerator = m_mantissa;
+							int64_t divisor = rhs.m_mantissa;
+							bool const fits = shift >= 0 ? checked_multiply( numerator, s_powers_of_ten[static_cast<size_t>( shift )], numerator ) : checked_multiply( divisor, s_powers_of_ten[static_cast<size_t>( -shift )], divisor );
+							if( !fits ) {
+								break;
+							}
+							if( numerator % divisor == 0 ) {
+								m_mantissa = numerator / divisor;
+								m_scale = static_cast<uint8_t>( scale );
+								normalize( );
+								return *this;
+							}
+						}
+					}
+				}
+				value_t buffer;
+				assign_big( big_value( ) / as_big( rhs, buffer ) );
 				return *this;
 			}
 
+			int big_num_t::compare( big_num_t const & rhs ) const {
+				int64_t a;
+				int64_t b;
+				uint8_t scale;
+				if( is_small( ) && rhs.is_small( ) && align( *this, rhs, a, b, scale ) ) {
+					return a < b ? -1 : (b < a ? 1 : 0);
+				}
+				value_t lhs_buffer;
+				value_t rhs_buffer;
+				auto const & lhs_value = m_big ? *m_big : as_big( *this, lhs_buffer );
+				auto const & rhs_value = rhs.m_big ? *rhs.m_big : as_big( rhs, rhs_buffer );
+				return lhs_value < rhs_value ? -1 : (rhs_value < lhs_value ? 1 : 0);
+			}
+
 			void swap( big_num_t & lhs, big_num_t & rhs ) noexcept {
 				lhs.swap( rhs );
 			}
@@ -81,47 +372,248 @@ namespace daw {
 			}
 
 			bool operator==( big_num_t const & lhs, big_num_t const & rhs ) {
-				return lhs.value == rhs.value;
+				return lhs.compare( rhs ) == 0;
 			}
 
 			bool operator!=( big_num_t const & lhs, big_num_t const & rhs ) {
-				return lhs.value != rhs.value;
+				return lhs.compare( rhs ) != 0;
 			}
 
 			bool operator<( big_num_t const & lhs, big_num_t const & rhs ) {
-				return lhs.value < rhs.value;
+				return lhs.compare( rhs ) < 0;
 			}
 
 			bool operator>( big_num_t const & lhs, big_num_t const & rhs ) {
-				return lhs.value > rhs.value;
+				return lhs.compare( rhs ) > 0;
 			}
 
 			bool operator<=( big_num_t const & lhs, big_num_t const & rhs ) {
-				return lhs.value <= rhs.value;
+				return lhs.compare( rhs ) <= 0;
 			}
 
 			bool operator>=( big_num_t const & lhs, big_num_t const & rhs ) {
-				return lhs.value >= rhs.value;
+				return lhs.compare( rhs ) >= 0;
+			}
+
+			namespace {
+				/// Writes the decimal digits of value and returns their count
+				size_t write_digits( uint64_t value, char * out ) noexcept {
+					char buffer[20];
+					size_t count = 0;
+					do {
+						buffer[count++] = static_cast<char>( '0' + value % 10 );
+						value /= 10;
+					} while( value != 0 );
+					for( size_t n = 0; n < count; ++n ) {
+						out[n] = buffer[count - 1 - n];
+					}
+					return count;
+				}
 
+				/// value_t's general notation for an inline value
+				size_t format_small( big_num_t const & value, char * out ) noexcept {
+					char digits[20];
+					auto const digit_count = write_digits( magnitude( value.mantissa( ) ), digits );
+					auto const exponent = static_cast<int>( digit_count ) - 1 - value.scale( );
+					auto pos = out;
+					if( value.mantissa( ) < 0 ) {
+						*pos++ = '-';
+					}
+					if( exponent < -4 ) {
+						*pos++ = digits[0];
+						if( digit_count > 1 ) {
+							*pos++ = '.';
+							pos = std::copy( digits + 1, digits + digit_count, pos );
+						}
+						*pos++ = 'e';
+						*pos++ = '-';
+						if( -exponent < 10 ) {
+							*pos++ = '0';
+						}
+						pos += write_digits( static_cast<uint64_t>( -exponent ), pos );
+					} else if( value.scale( ) == 0 ) {
+						pos = std::copy( digits, digits + digit_count, pos );
+					} else {
+						auto const integer_digits = static_cast<int>( digit_count ) - value.scale( );
+						if( integer_digits <= 0 ) {
+							*pos++ = '0';
+							*pos++ = '.';
+							pos = std::fill_n( pos, -integer_digits, '0' );
+							pos = std::copy( digits, digits + digit_count, pos );
+						} else {
+							pos = std::copy( digits, digits + integer_digits, pos );
+							*pos++ = '.';
+							pos = std::copy( digits + integer_digits, digits + digit_count, pos );
+						}
+					}
+					return static_cast<size_t>( pos - out );
+				}
+
+				// value_t keeps guard digits past digits10 that are rounding noise, 1/3 reads
+				// back equal only at max_digits10 as 0.3...3344472732.  Rounding to digits10
+				// and dropping trailing zeros gives the shortest text holding every digit the
+				// type is precise to
+				std::string format_big( value_t const & value ) {
+					return value.str( std::numeric_limits<value_t>::digits10, std::ios_base::fmtflags{ } );
+				}
+			}	// namespace anonymous
+
+			to_chars_result to_chars( char * first, char * last, big_num_t const & value ) {
+				auto const size = static_cast<size_t>( last - first );
+				if( value.is_small( ) ) {
+					if( size >= max_small_chars ) {
+						return { first + format_small( value, first ), std::errc{ } };
+					}
+					char buffer[max_small_chars];
+					auto const count = format_small( value, buffer );
+					if( count > size ) {
+						return { last, std::errc::value_too_large };
+					}
+					return { std::copy( buffer, buffer + count, first ), std::errc{ } };
+				}
+				auto const text = format_big( value.big_value( ) );
+				if( text.size( ) > size ) {
+					return { last, std::errc::value_too_large };
+				}
+				return { std::copy( text.begin( ), text.end( ), first ), std::errc{ } };
+			}
+
+			from_chars_result from_chars( char const * first, char const * last, big_num_t & value ) {
+				// [+-]digits[.digits][(e|E)[+-]digits]
+				auto p = first;
+				bool const negative = p != last && *p == '-';
+				if( p != last && (negative || *p == '+') ) {
+					++p;
+				}
+				int64_t mantissa = 0;
+				int significant_digits = 0;
+				int fraction_digits = 0;
+				bool has_digits = false;
+				bool fits = true;
+				auto const add_digit = [&]( char c ) {
+					has_digits = true;
+					if( mantissa == 0 && c == '0' ) {
+						return;
+					}
+					if( ++significant_digits > big_num_t::max_scale ) {
+						fits = false;
+						return;
+					}
+					mantissa = mantissa * 10 + (c - '0');
+				};
+				for( ; p != last && is_digit( *p ); ++p ) {
+					add_digit( *p );
+				}
+				if( p != last && *p == '.' ) {
+					for( ++p; p != last && is_digit( *p ); ++p ) {
+						add_digit( *p );
+						++fraction_digits;
+					}
+				}
+				if( !has_digits ) {
+					return { first, std::errc::invalid_argument };
+				}
+				int exponent = 0;
+				if( p != last && (*p == 'e' || *p == 'E') ) {
+					// The exponent is only part of the number when it has digits
+					auto e = std::next( p );
+					bool const negative_exponent = e != last && *e == '-';
+					if( e != last && (negative_exponent || *e == '+') ) {
+						++e;
+					}
+					if( e != last && is_digit( *e ) ) {
+						int exponent_digits = 0;
+						for( ; e != last && is_digit( *e ); ++e ) {
+							if( ++exponent_digits > 4 ) {
+								fits = false;
+							} else {
+								exponent = exponent * 10 + (*e - '0');
+							}
+						}
+						exponent = negative_exponent ? -exponent : exponent;
+						p = e;
+					}
+				}
+				if( significant_digits == 0 ) {
+					// Zero whatever the exponent
+					value = big_num_t{ };
+					return { p, std::errc{ } };
+				}
+				int scale = fraction_digits - exponent;
+				if( fits ) {
+					for( ; scale < 0 && fits; ++scale ) {
+						fits = checked_multiply( mantissa, 10, mantissa );
+					}
+					for( ; scale > big_num_t::max_scale && mantissa % 10 == 0; --scale ) {
+						mantissa /= 10;
+					}
+					if( fits && scale <= big_num_t::max_scale ) {
+						value = big_num_t::from_scaled( negative ? -mantissa : mantissa, static_cast<uint8_t>( scale ) );
+						return { p, std::errc{ } };
+					}
+				}
+				// Exponents past value_t's range either throw, overflow to infinity or
+				// underflow to zero
+				try {
+					value_t big{ std::string{ first, p } };
+					if( !boost::multiprecision::isfinite( big ) || big == 0 ) {
+						return { first, std::errc::result_out_of_range };
+					}
+					value = big_num_t{ std::move( big ) };
+				} catch( std::exception const & ) {
+					return { first, std::errc::result_out_of_range };
+				}
+				return { p, std::errc{ } };
+			}
+
+			void append_to( std::string & out, big_num_t const & value ) {
+				if( value.is_small( ) ) {
+					char buffer[max_small_chars];
+					out.append( buffer, format_small( value, buffer ) );
+				} else {
+					out.append( format_big( value.big_value( ) ) );
+				}
 			}
 
 			std::ostream & operator<<( std::ostream & os, big_num_t const & rhs ) {
-				os.precision( std::numeric_limits<decltype(rhs.value)>::max_digits10 );
-				os << rhs.value;
+				char buffer[max_small_chars];
+				if( rhs.is_small( ) ) {
+					os.write( buffer, static_cast<std::streamsize>( format_small( rhs, buffer ) ) );
+				} else {
+					os << format_big( rhs.big_value( ) );
+				}
 				return os;
 			}
 
 			std::istream & operator>>( std::istream & is, big_num_t & rhs ) {
-				is >> rhs.value;
+				std::istream::sentry const sentry{ is };
+				if( !sentry ) {
+					return is;
+				}
+				// Take the characters that can be part of a number and parse them in one go
+				std::string text;
+				auto const can_be_number = []( int c ) {
+					return (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E';
+				};
+				while( can_be_number( is.peek( ) ) ) {
+					text.push_back( static_cast<char>( is.get( ) ) );
+				}
+				if( is.eof( ) ) {
+					is.clear( std::ios_base::eofbit );
+				}
+				auto const result = from_chars( text.data( ), text.data( ) + text.size( ), rhs );
+				if( result.ec != std::errc{ } || result.ptr != text.data( ) + text.size( ) ) {
+					is.setstate( std::ios_base::failbit );
+				}
 				return is;
 			}
 
 			std::string to_string( big_num_t const & value ) {
-				std::stringstream ss;
-				ss << value;
-				return ss.str( );
+				std::string result;
+				result.reserve( max_small_chars );
+				append_to( result, value );
+				return result;
 			}
 		}	// namespace number
 	}	// namespace spreadsheet
 }	// namespace daw
-
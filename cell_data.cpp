@@ -0,0 +1,82 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <utility>
+
+#include "cell_data.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			/// A row of a column_store, encoded like a cell_data without copying its text
+			struct cell_ref {
+				impl::cell_data::expected_value_t value_type;
+				boost::string_ref string_value;
+			};	// cell_ref
+		}	// namespace anonymous
+
+		template<>
+		struct json_schema<cell_ref> {
+			static constexpr auto members( ) {
+				return std::make_tuple(
+					json_field( "value_type", &cell_ref::value_type ),
+					json_field( "string_value", &cell_ref::string_value ) );
+			}
+		};	// json_schema<cell_ref>
+
+		namespace impl {
+			cell_data::cell_data( ):
+					value_type{ expected_value_t::General },
+					string_value{ } { }
+
+			cell_data::cell_data( expected_value_t type, std::string text ):
+					value_type{ type },
+					string_value{ std::move( text ) } { }
+
+			bool cell_data::empty( ) const noexcept {
+				return string_value.empty( );
+			}
+
+			void append_json( std::string & out, cell_data::expected_value_t value_type, boost::string_ref string_value ) {
+				encode_json( out, cell_ref{ value_type, string_value } );
+			}
+
+			std::string encode( cell_data const & value ) {
+				return to_json( value );
+			}
+
+			void decode( json_reader & reader, cell_data & value ) {
+				value.value_type = cell_data::expected_value_t::General;
+				value.string_value.clear( );
+				decode_json( reader, value );
+			}
+
+			cell_data decode_cell( boost::string_ref json_text ) {
+				json_reader reader{ json_text };
+				cell_data result;
+				decode( reader, result );
+				return result;
+			}
+		}	// namespace impl
+	}	// namespace spreadsheet
+}	// namespace daw
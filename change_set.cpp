@@ -0,0 +1,140 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <tuple>
+
+#include "change_set.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			using index_t = cell_address::index_t;
+
+			/// Rows [first_row, last_row] of a single column
+			struct span_t {
+				index_t column;
+				index_t first_row;
+				index_t last_row;
+			};	// span_t
+
+			/// @brief Split ranges into per column spans and merge the spans of each column
+			/// that overlap or touch
+			std::vector<span_t> column_spans( std::vector<cell_range> const & ranges ) {
+				std::vector<span_t> spans;
+				spans.reserve( ranges.size( ) );
+				for( auto const & range: ranges ) {
+					for( auto column = range.first.column; ; ++column ) {
+						spans.push_back( span_t{ column, range.first.row, range.last.row } );
+						if( column == range.last.column ) {
+							break;
+						}
+					}
+				}
+				std::sort( spans.begin( ), spans.end( ), []( span_t const & lhs, span_t const & rhs ) {
+					return std::tie( lhs.column, lhs.first_row ) < std::tie( rhs.column, rhs.first_row );
+				} );
+				size_t count = 0;
+				for( auto const & span: spans ) {
+					if( count > 0 ) {
+						auto & previous = spans[count - 1];
+						// Compared in 64 bits as last_row + 1 can wrap
+						if( previous.column == span.column && static_cast<uint64_t>( span.first_row ) <= static_cast<uint64_t>( previous.last_row ) + 1 ) {
+							previous.last_row = std::max( previous.last_row, span.last_row );
+							continue;
+						}
+					}
+					spans[count++] = span;
+				}
+				spans.resize( count );
+				return spans;
+			}
+		}	// namespace anonymous
+
+		change_set::change_set( ):
+				ranges{ },
+				ids{ } { }
+
+		void change_set::add( cell_address const & cell ) {
+			ranges.emplace_back( cell, cell );
+		}
+
+		void change_set::add( cell_range const & range ) {
+			ranges.push_back( range );
+		}
+
+		void change_set::add_id( id_t id ) {
+			ids.push_back( id );
+		}
+
+		void change_set::coalesce( ) {
+			std::sort( ids.begin( ), ids.end( ) );
+			ids.erase( std::unique( ids.begin( ), ids.end( ) ), ids.end( ) );
+			if( ranges.size( ) < 2 ) {
+				return;
+			}
+			auto spans = column_spans( ranges );
+			// Spans covering the same rows in neighbouring columns join into one rectangle
+			std::sort( spans.begin( ), spans.end( ), []( span_t const & lhs, span_t const & rhs ) {
+				return std::tie( lhs.first_row, lhs.last_row, lhs.column ) < std::tie( rhs.first_row, rhs.last_row, rhs.column );
+			} );
+			ranges.clear( );
+			for( auto const & span: spans ) {
+				if( !ranges.empty( ) ) {
+					auto & previous = ranges.back( );
+					if( previous.first.row == span.first_row && previous.last.row == span.last_row && static_cast<uint64_t>( previous.last.column ) + 1 == span.column ) {
+						previous.last.column = span.column;
+						continue;
+					}
+				}
+				ranges.emplace_back( cell_address{ span.first_row, span.column }, cell_address{ span.last_row, span.column } );
+			}
+			std::sort( ranges.begin( ), ranges.end( ), []( cell_range const & lhs, cell_range const & rhs ) {
+				return lhs.first < rhs.first;
+			} );
+		}
+
+		bool change_set::contains( cell_address const & cell ) const noexcept {
+			return std::any_of( ranges.begin( ), ranges.end( ), [&cell]( cell_range const & range ) {
+				return range.contains( cell );
+			} );
+		}
+
+		uint64_t change_set::cell_count( ) const noexcept {
+			uint64_t result = 0;
+			for( auto const & range: ranges ) {
+				result += range.size( );
+			}
+			return result;
+		}
+
+		bool change_set::empty( ) const noexcept {
+			return ranges.empty( ) && ids.empty( );
+		}
+
+		void change_set::clear( ) noexcept {
+			ranges.clear( );
+			ids.clear( );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,595 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "column_store.h"
+#include "value_classifier.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace impl {
+			namespace {
+				constexpr size_t bits_per_word = 64;
+
+				bool get_bit( std::vector<uint64_t> const & bits, size_t pos ) noexcept {
+					return ((bits[pos / bits_per_word] >> (pos % bits_per_word)) & 1u) != 0;
+				}
+
+				void put_bit( std::vector<uint64_t> & bits, size_t pos, bool value ) noexcept {
+					auto const mask = static_cast<uint64_t>(1) << (pos % bits_per_word);
+					if( value ) {
+						bits[pos / bits_per_word] |= mask;
+					} else {
+						bits[pos / bits_per_word] &= ~mask;
+					}
+				}
+
+				size_t words_for( size_t bit_count ) noexcept {
+					return (bit_count + bits_per_word - 1) / bits_per_word;
+				}
+
+				void resize_bits( std::vector<uint64_t> & bits, size_t bit_count ) {
+					bits.resize( words_for( bit_count ), 0 );
+					if( bit_count % bits_per_word != 0 && !bits.empty( ) ) {
+						// Clear any bits left over from truncated rows
+						bits.back( ) &= (static_cast<uint64_t>(1) << (bit_count % bits_per_word)) - 1;
+					}
+				}
+
+				int64_t power_of_ten( uint8_t exponent ) noexcept {
+					int64_t result = 1;
+					while( exponent-- > 0 ) {
+						result *= 10;
+					}
+					return result;
+				}
+
+				uint64_t magnitude( int64_t value ) noexcept {
+					return value < 0 ? static_cast<uint64_t>( 0 ) - static_cast<uint64_t>( value ) : static_cast<uint64_t>( value );
+				}
+
+				constexpr size_t inline_text_capacity = 7;
+				constexpr unsigned char inline_text_flag = 0x80;
+
+				unsigned char text_tag( uint64_t const & word ) noexcept {
+					return reinterpret_cast<unsigned char const *>( &word )[inline_text_capacity];
+				}
+
+				string_pool::handle_t pooled_handle( uint64_t const & word ) noexcept {
+					if( (text_tag( word ) & inline_text_flag) != 0 ) {
+						return string_pool::empty_handle;
+					}
+					string_pool::handle_t result;
+					std::memcpy( &result, &word, sizeof( result ) );
+					return result;
+				}
+
+				uint64_t pooled_word( string_pool::handle_t handle ) noexcept {
+					uint64_t result = 0;
+					std::memcpy( &result, &handle, sizeof( handle ) );
+					return result;
+				}
+
+				uint64_t inline_word( boost::string_ref text ) noexcept {
+					uint64_t result = 0;
+					std::memcpy( &result, text.data( ), text.size( ) );
+					reinterpret_cast<unsigned char *>( &result )[inline_text_capacity] = static_cast<unsigned char>( inline_text_flag | text.size( ) );
+					return result;
+				}
+
+				boost::posix_time::ptime const & epoch( ) {
+					static boost::posix_time::ptime const s_epoch{ boost::gregorian::date{ 1970, 1, 1 } };
+					return s_epoch;
+				}
+			}	// namespace anonymous
+
+			cell_view::cell_view( column_store const & store, size_t row ) noexcept:
+					m_store{ &store },
+					m_row{ row } { }
+
+			size_t cell_view::row( ) const noexcept {
+				return m_row;
+			}
+
+			cell_value::expected_value_t cell_view::value_type( ) const {
+				return m_store->value_type( m_row );
+			}
+
+			boost::string_ref cell_view::string_value( ) const {
+				return m_store->string_value( m_row );
+			}
+
+			bool cell_view::empty( ) const {
+				return string_value( ).empty( );
+			}
+
+			bool cell_view::has_value( ) const {
+				return m_store->has_value( m_row );
+			}
+
+			cell_value::cell_variant_t cell_view::to_variant( ) const {
+				return m_store->to_variant( m_row );
+			}
+
+			column_store::column_store( ):
+					m_types{ },
+					m_text{ },
+					m_slots{ },
+					m_valid{ },
+					m_pool{ },
+					m_numbers{ },
+					m_timestamps{ },
+					m_durations{ },
+					m_booleans{ },
+					m_boolean_count{ 0 },
+					m_dead_slots{ 0 },
+					m_lane{ },
+					m_lane_mask{ },
+					m_number_mask{ },
+					m_lane_scale{ 0 },
+					m_lane_bound{ 0 } { }
+
+			column_store::column_store( std::shared_ptr<string_pool> pool ):
+					column_store{ } {
+
+				m_pool = std::move( pool );
+			}
+
+			column_store::~column_store( ) {
+				if( m_pool ) {
+					m_pool->release( m_text.begin( ), m_text.end( ), pooled_handle );
+				}
+			}
+
+			column_store::column_store( column_store const & other ):
+					m_types{ other.m_types },
+					m_text{ other.m_text },
+					m_slots{ other.m_slots },
+					m_valid{ other.m_valid },
+					m_pool{ other.m_pool },
+					m_numbers{ other.m_numbers },
+					m_timestamps{ other.m_timestamps },
+					m_durations{ other.m_durations },
+					m_booleans{ other.m_booleans },
+					m_boolean_count{ other.m_boolean_count },
+					m_dead_slots{ other.m_dead_slots },
+					m_lane{ other.m_lane },
+					m_lane_mask{ other.m_lane_mask },
+					m_number_mask{ other.m_number_mask },
+					m_lane_scale{ other.m_lane_scale },
+					m_lane_bound{ other.m_lane_bound } {
+
+				if( m_pool ) {
+					m_pool->retain( m_text.begin( ), m_text.end( ), pooled_handle );
+				}
+			}
+
+			column_store::column_store( column_store && other ) noexcept:
+					column_store{ } {
+
+				swap( other );
+			}
+
+			column_store & column_store::operator=( column_store const & rhs ) {
+				if( this != &rhs ) {
+					column_store tmp{ rhs };
+					swap( tmp );
+				}
+				return *this;
+			}
+
+			column_store & column_store::operator=( column_store && rhs ) noexcept {
+				swap( rhs );
+				return *this;
+			}
+
+			void column_store::swap( column_store & rhs ) noexcept {
+				using std::swap;
+				m_types.swap( rhs.m_types );
+				m_text.swap( rhs.m_text );
+				m_slots.swap( rhs.m_slots );
+				m_valid.swap( rhs.m_valid );
+				m_pool.swap( rhs.m_pool );
+				m_numbers.swap( rhs.m_numbers );
+				m_timestamps.swap( rhs.m_timestamps );
+				m_durations.swap( rhs.m_durations );
+				m_booleans.swap( rhs.m_booleans );
+				swap( m_boolean_count, rhs.m_boolean_count );
+				swap( m_dead_slots, rhs.m_dead_slots );
+				m_lane.swap( rhs.m_lane );
+				m_lane_mask.swap( rhs.m_lane_mask );
+				m_number_mask.swap( rhs.m_number_mask );
+				swap( m_lane_scale, rhs.m_lane_scale );
+				swap( m_lane_bound, rhs.m_lane_bound );
+			}
+
+			void swap( column_store & lhs, column_store & rhs ) noexcept {
+				lhs.swap( rhs );
+			}
+
+			size_t column_store::size( ) const noexcept {
+				return m_types.size( );
+			}
+
+			bool column_store::empty( ) const noexcept {
+				return m_types.empty( );
+			}
+
+			void column_store::reserve( size_t rows ) {
+				m_types.reserve( rows );
+				m_text.reserve( rows );
+				m_slots.reserve( rows );
+				m_valid.reserve( words_for( rows ) );
+				m_lane.reserve( rows );
+				m_lane_mask.reserve( words_for( rows ) );
+				m_number_mask.reserve( words_for( rows ) );
+			}
+
+			void column_store::resize( size_t rows ) {
+				if( rows < size( ) ) {
+					if( m_pool ) {
+						m_pool->release( m_text.begin( ) + static_cast<std::ptrdiff_t>( rows ), m_text.end( ), pooled_handle );
+					}
+					for( size_t row = rows; row < size( ); ++row ) {
+						if( has_value( row ) ) {
+							++m_dead_slots;
+						}
+					}
+				}
+				m_types.resize( rows, static_cast<uint8_t>( expected_value_t::General ) );
+				m_text.resize( rows, 0 );
+				m_slots.resize( rows, 0 );
+				m_lane.resize( rows, 0 );
+				resize_bits( m_valid, rows );
+				resize_bits( m_lane_mask, rows );
+				resize_bits( m_number_mask, rows );
+			}
+
+			void column_store::clear( ) {
+				column_store tmp{ m_pool };
+				swap( tmp );
+			}
+
+			uint64_t column_store::append_text( boost::string_ref text ) {
+				if( text.size( ) <= inline_text_capacity ) {
+					return text.empty( ) ? 0 : inline_word( text );
+				}
+				if( !m_pool ) {
+					m_pool = std::make_shared<string_pool>( );
+				}
+				return pooled_word( m_pool->intern( text ) );
+			}
+
+			std::shared_ptr<string_pool> const & column_store::pool( ) const noexcept {
+				return m_pool;
+			}
+
+			void column_store::use_pool( std::shared_ptr<string_pool> pool ) {
+				if( pool == m_pool ) {
+					return;
+				}
+				std::vector<uint64_t> text{ m_text };
+				for( size_t row = 0; row < m_text.size( ); ++row ) {
+					if( pooled_handle( text[row] ) != string_pool::empty_handle ) {
+						text[row] = pooled_word( pool->intern( string_value( row ) ) );
+					}
+				}
+				if( m_pool ) {
+					m_pool->release( m_text.begin( ), m_text.end( ), pooled_handle );
+				}
+				m_text.swap( text );
+				m_pool = std::move( pool );
+			}
+
+			void column_store::set_valid( size_t row, bool is_valid ) {
+				put_bit( m_valid, row, is_valid );
+			}
+
+			void column_store::update_lane( size_t row ) {
+				bool const is_number = has_value( row ) && m_types[row] == static_cast<uint8_t>( expected_value_t::Number );
+				put_bit( m_number_mask, row, is_number );
+				put_bit( m_lane_mask, row, false );
+				m_lane[row] = 0;
+				if( !is_number ) {
+					return;
+				}
+				auto const & value = m_numbers[m_slots[row]];
+				if( !value.is_small( ) || (value.scale( ) > m_lane_scale && !rescale_lane( value.scale( ) )) ) {
+					return;
+				}
+				int64_t mantissa;
+				if( __builtin_mul_overflow( value.mantissa( ), power_of_ten( m_lane_scale - value.scale( ) ), &mantissa ) ) {
+					return;
+				}
+				m_lane[row] = mantissa;
+				m_lane_bound = std::max( m_lane_bound, magnitude( mantissa ) );
+				put_bit( m_lane_mask, row, true );
+			}
+
+			// Values that overflow at the new scale leave the lane
+			bool column_store::rescale_lane( uint8_t scale ) {
+				if( scale > max_lane_scale ) {
+					return false;
+				}
+				auto const factor = power_of_ten( scale - m_lane_scale );
+				m_lane_bound = 0;
+				for( size_t row = 0; row < m_lane.size( ); ++row ) {
+					if( m_lane[row] == 0 ) {
+						continue;
+					}
+					if( __builtin_mul_overflow( m_lane[row], factor, &m_lane[row] ) ) {
+						m_lane[row] = 0;
+						put_bit( m_lane_mask, row, false );
+					} else {
+						m_lane_bound = std::max( m_lane_bound, magnitude( m_lane[row] ) );
+					}
+				}
+				m_lane_scale = scale;
+				return true;
+			}
+
+			numeric_lane column_store::lane( ) const noexcept {
+				return numeric_lane{ m_lane.data( ), m_lane_mask.data( ), m_number_mask.data( ), m_lane.size( ), m_lane_scale, m_lane_bound };
+			}
+
+			bool column_store::store_typed( size_t row, expected_value_t value_type, boost::string_ref text ) {
+				// When the row already holds a value of the same type its slot is reused
+				bool const reuse = has_value( row ) && m_types[row] == static_cast<uint8_t>( value_type );
+				auto const classified = classify_value( text );
+				if( classified.type != value_type ) {
+					return false;
+				}
+				switch( value_type ) {
+				case expected_value_t::Number: {
+						auto value = to_number( classified );
+						if( reuse ) {
+							m_numbers[m_slots[row]] = std::move( value );
+						} else {
+							m_slots[row] = static_cast<uint32_t>( m_numbers.size( ) );
+							m_numbers.push_back( std::move( value ) );
+						}
+						return true;
+					}
+				case expected_value_t::Timestamp:
+					if( reuse ) {
+						m_timestamps[m_slots[row]] = classified.ticks;
+					} else {
+						m_slots[row] = static_cast<uint32_t>( m_timestamps.size( ) );
+						m_timestamps.push_back( classified.ticks );
+					}
+					return true;
+				case expected_value_t::Time:
+					if( reuse ) {
+						m_durations[m_slots[row]] = classified.ticks;
+					} else {
+						m_slots[row] = static_cast<uint32_t>( m_durations.size( ) );
+						m_durations.push_back( classified.ticks );
+					}
+					return true;
+				case expected_value_t::Boolean: {
+						auto const value = classified.boolean;
+						if( !reuse ) {
+							m_slots[row] = static_cast<uint32_t>( m_boolean_count++ );
+							m_booleans.resize( words_for( m_boolean_count ), 0 );
+						}
+						put_bit( m_booleans, m_slots[row], value );
+						return true;
+					}
+				case expected_value_t::General:
+				case expected_value_t::Text:
+				case expected_value_t::Error:
+				default:
+					return false;
+				}
+			}
+
+			bool column_store::is_inline( boost::string_ref text ) noexcept {
+				return text.size( ) <= inline_text_capacity;
+			}
+
+			void column_store::push_back( expected_value_t value_type, boost::string_ref text ) {
+				push_word( value_type, text, append_text( text ) );
+			}
+
+			void column_store::push_back( expected_value_t value_type, boost::string_ref text, string_pool::handle_t handle ) {
+				assert( is_inline( text ) ? handle == string_pool::empty_handle : (m_pool && m_pool->text( handle ) == text) );
+				push_word( value_type, text, is_inline( text ) ? append_text( text ) : pooled_word( handle ) );
+			}
+
+			void column_store::push_word( expected_value_t value_type, boost::string_ref text, uint64_t word ) {
+				auto const row = size( );
+				m_text.push_back( word );
+				m_types.push_back( static_cast<uint8_t>( expected_value_t::General ) );
+				m_slots.push_back( 0 );
+				m_lane.push_back( 0 );
+				m_valid.resize( words_for( row + 1 ), 0 );
+				m_lane_mask.resize( m_valid.size( ), 0 );
+				m_number_mask.resize( m_valid.size( ), 0 );
+				auto const is_valid = store_typed( row, value_type, text );
+				m_types[row] = static_cast<uint8_t>( value_type );
+				set_valid( row, is_valid );
+				update_lane( row );
+			}
+
+			void column_store::set( size_t row, expected_value_t value_type, boost::string_ref text ) {
+				assert( row < size( ) );
+				bool const had_value = has_value( row );
+				bool const same_type = m_types[row] == static_cast<uint8_t>( value_type );
+
+				// Intern before releasing, text may refer to the row's current text
+				auto const old_text = m_text[row];
+				m_text[row] = append_text( text );
+				if( m_pool ) {
+					m_pool->release( pooled_handle( old_text ) );
+				}
+				auto const is_valid = store_typed( row, value_type, text );
+				if( had_value && (!same_type || !is_valid) ) {
+					++m_dead_slots;
+				}
+				m_types[row] = static_cast<uint8_t>( value_type );
+				set_valid( row, is_valid );
+				update_lane( row );
+
+				if( m_dead_slots > size( ) / 2 ) {
+					compact( );
+				}
+			}
+
+			void column_store::set_value( size_t row, boost::string_ref text ) {
+				set( row, value_type( row ), text );
+			}
+
+			column_store::expected_value_t column_store::value_type( size_t row ) const {
+				assert( row < size( ) );
+				return static_cast<expected_value_t>( m_types[row] );
+			}
+
+			boost::string_ref column_store::string_value( size_t row ) const {
+				assert( row < size( ) );
+				auto const & word = m_text[row];
+				auto const tag = text_tag( word );
+				if( (tag & inline_text_flag) != 0 ) {
+					return boost::string_ref{ reinterpret_cast<char const *>( &word ), static_cast<size_t>( tag & ~inline_text_flag ) };
+				}
+				auto const handle = pooled_handle( word );
+				if( handle == string_pool::empty_handle ) {
+					return boost::string_ref{ };
+				}
+				return m_pool->text( handle );
+			}
+
+			bool column_store::same_text( size_t row, column_store const & other, size_t other_row ) const {
+				assert( row < size( ) && other_row < other.size( ) );
+				// Short text is always inline and long text always pooled, so within one pool
+				// the words are equal exactly when the texts are
+				if( m_pool == other.m_pool ) {
+					return m_text[row] == other.m_text[other_row];
+				}
+				return string_value( row ) == other.string_value( other_row );
+			}
+
+			bool column_store::has_value( size_t row ) const {
+				assert( row < size( ) );
+				return get_bit( m_valid, row );
+			}
+
+			column_store::number_t const & column_store::number( size_t row ) const {
+				assert( has_value( row ) && value_type( row ) == expected_value_t::Number );
+				return m_numbers[m_slots[row]];
+			}
+
+			column_store::timestamp_t column_store::timestamp( size_t row ) const {
+				assert( has_value( row ) && value_type( row ) == expected_value_t::Timestamp );
+				return epoch( ) + boost::posix_time::time_duration{ 0, 0, 0, m_timestamps[m_slots[row]] };
+			}
+
+			column_store::duration_t column_store::duration( size_t row ) const {
+				assert( has_value( row ) && value_type( row ) == expected_value_t::Time );
+				return boost::posix_time::time_duration{ 0, 0, 0, m_durations[m_slots[row]] };
+			}
+
+			column_store::bool_t column_store::boolean( size_t row ) const {
+				assert( has_value( row ) && value_type( row ) == expected_value_t::Boolean );
+				return get_bit( m_booleans, m_slots[row] );
+			}
+
+			column_store::cell_variant_t column_store::to_variant( size_t row ) const {
+				if( has_value( row ) ) {
+					switch( value_type( row ) ) {
+					case expected_value_t::Number: return cell_variant_t{ }.store( number( row ) );
+					case expected_value_t::Timestamp: return cell_variant_t{ }.store( timestamp( row ) );
+					case expected_value_t::Time: return cell_variant_t{ }.store( duration( row ) );
+					case expected_value_t::Boolean: return cell_variant_t{ }.store( boolean( row ) );
+					default: break;
+					}
+				}
+				return cell_variant_t{ }.store( string_value( row ).to_string( ) );
+			}
+
+			cell_view column_store::operator[]( size_t row ) const {
+				assert( row < size( ) );
+				return cell_view{ *this, row };
+			}
+
+			void column_store::compact( ) {
+				column_store tmp{ m_pool };
+				tmp.reserve( size( ) );
+				for( size_t row = 0; row < size( ); ++row ) {
+					tmp.push_back( value_type( row ), string_value( row ) );
+				}
+				swap( tmp );
+			}
+
+			void column_store::permute( std::vector<uint32_t> const & order ) {
+				assert( order.size( ) == size( ) );
+				auto const rows = size( );
+				std::vector<uint8_t> types( rows );
+				std::vector<uint64_t> text( rows );
+				std::vector<uint32_t> slots( rows );
+				std::vector<int64_t> lane( rows );
+				std::vector<uint64_t> valid( words_for( rows ), 0 );
+				std::vector<uint64_t> lane_mask( valid.size( ), 0 );
+				std::vector<uint64_t> number_mask( valid.size( ), 0 );
+				for( size_t row = 0; row < rows; ++row ) {
+					auto const from = order[row];
+					assert( from < rows );
+					types[row] = m_types[from];
+					text[row] = m_text[from];
+					slots[row] = m_slots[from];
+					lane[row] = m_lane[from];
+					put_bit( valid, row, get_bit( m_valid, from ) );
+					put_bit( lane_mask, row, get_bit( m_lane_mask, from ) );
+					put_bit( number_mask, row, get_bit( m_number_mask, from ) );
+				}
+				m_types.swap( types );
+				m_text.swap( text );
+				m_slots.swap( slots );
+				m_lane.swap( lane );
+				m_valid.swap( valid );
+				m_lane_mask.swap( lane_mask );
+				m_number_mask.swap( number_mask );
+			}
+
+			size_t column_store::memory_usage( ) const noexcept {
+				return sizeof( *this )
+					+ m_types.capacity( ) * sizeof( uint8_t )
+					+ m_text.capacity( ) * sizeof( uint64_t )
+					+ m_slots.capacity( ) * sizeof( uint32_t )
+					+ m_valid.capacity( ) * sizeof( uint64_t )
+					+ m_numbers.capacity( ) * sizeof( number_t )
+					+ m_timestamps.capacity( ) * sizeof( tick_t )
+					+ m_durations.capacity( ) * sizeof( tick_t )
+					+ m_booleans.capacity( ) * sizeof( uint64_t )
+					+ m_lane.capacity( ) * sizeof( int64_t )
+					+ m_lane_mask.capacity( ) * sizeof( uint64_t )
+					+ m_number_mask.capacity( ) * sizeof( uint64_t );
+			}
+		}	// namespace impl
+	}	// namespace spreadsheet
+}	// namespace daw
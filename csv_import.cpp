@@ -0,0 +1,323 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+
+#include "csv_import.h"
+#include "mapped_file.h"
+#include "sheet.h"
+#include "value_classifier.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			using expected_value_t = impl::cell_value::expected_value_t;
+
+			uint8_t type_bit( expected_value_t value_type ) noexcept {
+				return static_cast<uint8_t>( 1u << static_cast<unsigned>( value_type ) );
+			}
+
+			/// The records of one chunk of input.  Fields refer into the input, or into
+			/// unescaped for quoted fields that contained doubled quotes
+			struct parsed_chunk {
+				std::vector<boost::string_ref> fields;
+				std::vector<size_t> record_offsets;	// First field of each record and one past the last
+				std::deque<std::string> unescaped;
+				std::vector<uint8_t> seen_types;	// Bit per expected_value_t of each column
+				size_t width;
+
+				parsed_chunk( ):
+						fields{ },
+						record_offsets{ },
+						unescaped{ },
+						seen_types{ },
+						width{ 0 } { }
+
+				size_t record_count( ) const noexcept {
+					return record_offsets.empty( ) ? 0 : record_offsets.size( ) - 1;
+				}
+
+				boost::string_ref field( size_t record, size_t column ) const noexcept {
+					auto const first = record_offsets[record] + column;
+					if( first >= record_offsets[record + 1] ) {
+						return boost::string_ref{ };
+					}
+					return fields[first];
+				}
+			};	// parsed_chunk
+
+			/// @brief Offsets of record boundaries near every chunk_size bytes.  The quotes of
+			/// each chunk are counted in parallel, their parity says whether a chunk starts
+			/// inside a quoted field and the boundary is the first newline outside of one.
+			std::vector<size_t> split_records( boost::string_ref text, char quote, size_t chunk_size, thread_pool & pool ) {
+				auto const block_count = std::max<size_t>( (text.size( ) + chunk_size - 1) / chunk_size, 1 );
+				std::vector<uint8_t> odd_quotes( block_count, 0 );
+				pool.parallel_for( block_count, 1, [&]( size_t n ) {
+					auto const first = text.data( ) + n * chunk_size;
+					auto const last = text.data( ) + std::min( (n + 1) * chunk_size, text.size( ) );
+					odd_quotes[n] = static_cast<uint8_t>( std::count( first, last, quote ) & 1 );
+				} );
+
+				std::vector<size_t> result{ 0 };
+				bool in_quotes = false;
+				for( size_t n = 1; n < block_count; ++n ) {
+					in_quotes ^= odd_quotes[n - 1] != 0;
+					auto quoted = in_quotes;
+					auto pos = n * chunk_size;
+					while( pos < text.size( ) && (quoted || text[pos] != '\n') ) {
+						quoted ^= text[pos] == quote;
+						++pos;
+					}
+					if( pos < text.size( ) && pos + 1 > result.back( ) ) {
+						result.push_back( pos + 1 );
+					}
+				}
+				if( text.size( ) > result.back( ) ) {
+					result.push_back( text.size( ) );
+				}
+				return result;
+			}
+
+			void parse_chunk( boost::string_ref text, size_t pos, size_t last, csv_options const & options, parsed_chunk & chunk ) {
+				auto const data = text.data( );
+				auto const delimiter = options.delimiter;
+				auto const quote = options.quote;
+				while( pos < last ) {
+					auto const record_first = chunk.fields.size( );
+					chunk.record_offsets.push_back( record_first );
+					while( true ) {
+						if( data[pos] == quote ) {
+							auto start = ++pos;
+							std::string * buffer = nullptr;
+							while( true ) {
+								auto const found = static_cast<char const *>( std::memchr( data + pos, quote, last - pos ) );
+								if( !found ) {
+									// Unterminated, the field runs to the end of the input
+									pos = last;
+									break;
+								}
+								auto const close = static_cast<size_t>( found - data );
+								if( close + 1 < last && data[close + 1] == quote ) {
+									if( !buffer ) {
+										chunk.unescaped.emplace_back( );
+										buffer = &chunk.unescaped.back( );
+									}
+									buffer->append( data + start, close + 1 - start );
+									pos = start = close + 2;
+									continue;
+								}
+								pos = close;
+								break;
+							}
+							if( buffer ) {
+								buffer->append( data + start, pos - start );
+								chunk.fields.emplace_back( *buffer );
+							} else {
+								chunk.fields.emplace_back( data + start, pos - start );
+							}
+							// Skip the closing quote and anything up to the end of the field
+							while( pos < last && data[pos] != delimiter && data[pos] != '\n' ) {
+								++pos;
+							}
+						} else {
+							auto const start = pos;
+							while( pos < last && data[pos] != delimiter && data[pos] != '\n' ) {
+								++pos;
+							}
+							auto end = pos;
+							if( end > start && data[end - 1] == '\r' && (pos == last || data[pos] == '\n') ) {
+								--end;
+							}
+							chunk.fields.emplace_back( data + start, end - start );
+						}
+						if( pos >= last ) {
+							break;
+						}
+						if( data[pos++] == '\n' ) {
+							break;
+						}
+						if( pos == last ) {
+							// A delimiter ends the input, the record has a final empty field
+							chunk.fields.emplace_back( );
+							break;
+						}
+					}
+					chunk.width = std::max( chunk.width, chunk.fields.size( ) - record_first );
+				}
+				chunk.record_offsets.push_back( chunk.fields.size( ) );
+			}
+
+			void classify_chunk( parsed_chunk & chunk, size_t first_record ) {
+				chunk.seen_types.assign( chunk.width, 0 );
+				for( auto record = first_record; record < chunk.record_count( ); ++record ) {
+					auto const first = chunk.record_offsets[record];
+					auto const last = chunk.record_offsets[record + 1];
+					for( auto n = first; n < last; ++n ) {
+						chunk.seen_types[n - first] |= type_bit( classify_value( chunk.fields[n] ).type );
+					}
+				}
+			}
+
+			expected_value_t infer_type( uint8_t seen ) noexcept {
+				seen &= static_cast<uint8_t>( ~type_bit( expected_value_t::General ) );
+				if( seen == 0 ) {
+					return expected_value_t::General;
+				}
+				if( (seen & (seen - 1)) != 0 ) {
+					return expected_value_t::Text;
+				}
+				auto result = 0u;
+				while( (seen >>= 1) != 0 ) {
+					++result;
+				}
+				return static_cast<expected_value_t>( result );
+			}
+
+			struct text_hash {
+				size_t operator( )( boost::string_ref text ) const noexcept {
+					uint64_t result = 0xCBF29CE484222325ull;
+					for( auto c: text ) {
+						result = (result ^ static_cast<unsigned char>( c )) * 0x100000001B3ull;
+					}
+					return static_cast<size_t>( result );
+				}
+			};	// text_hash
+
+			/// Fill store with a column of the chunks.  The column's distinct texts that do not
+			/// fit in a row are found first and interned with one lock on the pool, which the
+			/// columns built in parallel share, instead of a lock per row
+			void build_column( std::vector<parsed_chunk> const & chunks, size_t column, expected_value_t column_type, size_t row_count, csv_options const & options, impl::column_store & store ) {
+				std::unordered_map<boost::string_ref, size_t, text_hash> index;
+				std::vector<std::pair<boost::string_ref, size_t>> distinct;	// Text and the rows holding it
+				for( auto const & chunk: chunks ) {
+					for( size_t record = 0; record < chunk.record_count( ); ++record ) {
+						auto const text = chunk.field( record, column );
+						if( !impl::column_store::is_inline( text ) ) {
+							auto const inserted = index.emplace( text, distinct.size( ) );
+							if( inserted.second ) {
+								distinct.emplace_back( text, 0 );
+							}
+							++distinct[inserted.first->second].second;
+						}
+					}
+				}
+				auto text_pool = options.pool;
+				if( !text_pool && !distinct.empty( ) ) {
+					text_pool = std::make_shared<string_pool>( );
+				}
+				std::vector<string_pool::handle_t> handles;
+				handles.reserve( distinct.size( ) );
+				if( !distinct.empty( ) ) {
+					text_pool->intern( distinct.begin( ), distinct.end( ), []( std::pair<boost::string_ref, size_t> const & item ) {
+						return item.first;
+					}, []( std::pair<boost::string_ref, size_t> const & item ) {
+						return item.second;
+					}, std::back_inserter( handles ) );
+				}
+
+				store = impl::column_store{ std::move( text_pool ) };
+				store.reserve( row_count );
+				for( size_t n = 0; n < chunks.size( ); ++n ) {
+					auto const & chunk = chunks[n];
+					for( size_t record = 0; record < chunk.record_count( ); ++record ) {
+						auto const text = chunk.field( record, column );
+						auto const handle = impl::column_store::is_inline( text ) ? string_pool::empty_handle : handles[index.find( text )->second];
+						if( n == 0 && record == 0 && options.has_header ) {
+							store.push_back( expected_value_t::Text, text, handle );
+						} else {
+							store.push_back( text.empty( ) ? expected_value_t::General : column_type, text, handle );
+						}
+					}
+				}
+			}
+		}	// namespace anonymous
+
+		csv_table::csv_table( ):
+				columns{ },
+				row_count{ 0 } { }
+
+		csv_table parse_csv( boost::string_ref text, thread_pool & pool, csv_options const & options ) {
+			auto const bounds = split_records( text, options.quote, std::max<size_t>( options.chunk_size, 1 ), pool );
+			auto const chunk_count = bounds.size( ) - 1;
+			std::vector<parsed_chunk> chunks( chunk_count );
+			pool.parallel_for( chunk_count, 1, [&]( size_t n ) {
+				parse_chunk( text, bounds[n], bounds[n + 1], options, chunks[n] );
+				classify_chunk( chunks[n], n == 0 && options.has_header ? 1 : 0 );
+			} );
+
+			csv_table result{ };
+			std::vector<uint8_t> seen_types;
+			for( auto const & chunk: chunks ) {
+				result.row_count += chunk.record_count( );
+				if( chunk.seen_types.size( ) > seen_types.size( ) ) {
+					seen_types.resize( chunk.seen_types.size( ), 0 );
+				}
+				for( size_t column = 0; column < chunk.seen_types.size( ); ++column ) {
+					seen_types[column] |= chunk.seen_types[column];
+				}
+			}
+			// The header decides the width when no data record is as wide
+			if( options.has_header && !chunks.empty( ) && chunks.front( ).record_count( ) > 0 ) {
+				auto const & first = chunks.front( );
+				auto const header_width = first.record_offsets[1] - first.record_offsets[0];
+				seen_types.resize( std::max( seen_types.size( ), header_width ), 0 );
+			}
+
+			result.columns.resize( seen_types.size( ) );
+			pool.parallel_for( seen_types.size( ), 1, [&]( size_t column ) {
+				build_column( chunks, column, infer_type( seen_types[column] ), result.row_count, options, result.columns[column] );
+			} );
+			return result;
+		}
+
+		csv_table parse_csv( boost::string_ref text, csv_options const & options ) {
+			if( options.thread_count == 0 ) {
+				return parse_csv( text, *shared_thread_pool( ), options );
+			}
+			thread_pool pool{ options.thread_count };
+			return parse_csv( text, pool, options );
+		}
+
+		csv_table read_csv( std::string const & path, csv_options const & options ) {
+			mapped_file const file{ path };
+			return parse_csv( file.view( ), options );
+		}
+
+		void import_csv( sheet & target, std::string const & path, csv_options options ) {
+			options.pool = target.strings( );
+			auto table = read_csv( path, options );
+			sheet::transaction tx{ target };
+			for( size_t n = 0; n < table.columns.size( ); ++n ) {
+				target.assign_column( n, std::move( table.columns[n] ) );
+			}
+			target.resize( table.columns.size( ) );
+			tx.commit( );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
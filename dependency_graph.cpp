@@ -0,0 +1,388 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <utility>
+
+#include "dependency_graph.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			std::vector<cell_address> to_addresses( std::vector<uint64_t> const & keys ) {
+				std::vector<cell_address> result;
+				result.reserve( keys.size( ) );
+				for( auto const & key: keys ) {
+					result.push_back( cell_address::from_key( key ) );
+				}
+				return result;
+			}
+
+			template<typename T>
+			void erase_one( std::vector<T> & values, T const & value ) {
+				auto pos = std::find( values.begin( ), values.end( ), value );
+				if( pos != values.end( ) ) {
+					values.erase( pos );
+				}
+			}
+		}	// namespace anonymous
+
+		dependency_graph::row_spans::row_spans( ):
+				m_nodes{ },
+				m_level_sizes{ } { }
+
+		template<typename Function>
+		void dependency_graph::row_spans::for_each_cover( cell_address::index_t first, cell_address::index_t last, Function func ) {
+			// Bottom up segment tree decomposition of the half open [lo, hi)
+			auto lo = static_cast<uint64_t>( first );
+			auto hi = static_cast<uint64_t>( last ) + 1;
+			for( size_t level = 0; lo < hi; ++level ) {
+				if( (lo & 1u) != 0 ) {
+					func( level, lo++ );
+				}
+				if( (hi & 1u) != 0 ) {
+					func( level, --hi );
+				}
+				lo >>= 1;
+				hi >>= 1;
+			}
+		}
+
+		void dependency_graph::row_spans::insert( cell_address::index_t first, cell_address::index_t last, size_t range_id ) {
+			for_each_cover( first, last, [&]( size_t level, uint64_t prefix ) {
+				m_nodes[node_key( level, prefix )].push_back( range_id );
+				++m_level_sizes[level];
+			} );
+		}
+
+		void dependency_graph::row_spans::erase( cell_address::index_t first, cell_address::index_t last, size_t range_id ) {
+			for_each_cover( first, last, [&]( size_t level, uint64_t prefix ) {
+				auto it = m_nodes.find( node_key( level, prefix ) );
+				if( it == m_nodes.end( ) ) {
+					return;
+				}
+				auto pos = std::find( it->second.begin( ), it->second.end( ), range_id );
+				if( pos == it->second.end( ) ) {
+					return;
+				}
+				*pos = it->second.back( );
+				it->second.pop_back( );
+				--m_level_sizes[level];
+				if( it->second.empty( ) ) {
+					m_nodes.erase( it );
+				}
+			} );
+		}
+
+		bool dependency_graph::row_spans::empty( ) const noexcept {
+			return m_nodes.empty( );
+		}
+
+		dependency_graph::dependency_graph( ):
+				m_nodes{ },
+				m_ranges{ },
+				m_free_ranges{ },
+				m_range_columns{ },
+				m_dirty{ } { }
+
+		dependency_graph::~dependency_graph( ) { }
+
+		size_t dependency_graph::add_range( cell_range const & range, uint64_t dependent ) {
+			size_t range_id;
+			if( m_free_ranges.empty( ) ) {
+				range_id = m_ranges.size( );
+				m_ranges.push_back( range_edge_t{ range, dependent, true } );
+			} else {
+				range_id = m_free_ranges.back( );
+				m_free_ranges.pop_back( );
+				m_ranges[range_id] = range_edge_t{ range, dependent, true };
+			}
+			for( auto column = range.first.column; column <= range.last.column; ++column ) {
+				m_range_columns[column].insert( range.first.row, range.last.row, range_id );
+				if( column == range.last.column ) {
+					break;	// guard against wrapping at the largest column index
+				}
+			}
+			return range_id;
+		}
+
+		void dependency_graph::remove_range( size_t range_id ) {
+			auto & edge = m_ranges[range_id];
+			for( auto column = edge.range.first.column; column <= edge.range.last.column; ++column ) {
+				auto bucket = m_range_columns.find( column );
+				if( bucket != m_range_columns.end( ) ) {
+					bucket->second.erase( edge.range.first.row, edge.range.last.row, range_id );
+					if( bucket->second.empty( ) ) {
+						m_range_columns.erase( bucket );
+					}
+				}
+				if( column == edge.range.last.column ) {
+					break;
+				}
+			}
+			edge.in_use = false;
+			m_free_ranges.push_back( range_id );
+		}
+
+		void dependency_graph::erase_if_unused( uint64_t cell ) {
+			auto it = m_nodes.find( cell );
+			if( it != m_nodes.end( ) && !it->second.is_formula && it->second.dependents.empty( ) ) {
+				m_nodes.erase( it );
+			}
+		}
+
+		void dependency_graph::clear_precedents( uint64_t cell ) {
+			auto it = m_nodes.find( cell );
+			if( it == m_nodes.end( ) ) {
+				return;
+			}
+			auto precedents = std::move( it->second.precedents );
+			auto ranges = std::move( it->second.ranges );
+			it->second.precedents.clear( );
+			it->second.ranges.clear( );
+
+			for( auto const & precedent: precedents ) {
+				auto pos = m_nodes.find( precedent );
+				if( pos != m_nodes.end( ) ) {
+					erase_one( pos->second.dependents, cell );
+					if( precedent != cell ) {
+						erase_if_unused( precedent );
+					}
+				}
+			}
+			for( auto const & range_id: ranges ) {
+				remove_range( range_id );
+			}
+		}
+
+		void dependency_graph::set_precedents( cell_address const & cell, std::vector<cell_address> const & cells, std::vector<cell_range> const & ranges ) {
+			auto const key = cell.key( );
+			clear_precedents( key );
+
+			std::vector<uint64_t> precedents;
+			precedents.reserve( cells.size( ) );
+			for( auto const & precedent: cells ) {
+				precedents.push_back( precedent.key( ) );
+			}
+			std::sort( precedents.begin( ), precedents.end( ) );
+			precedents.erase( std::unique( precedents.begin( ), precedents.end( ) ), precedents.end( ) );
+
+			for( auto const & precedent: precedents ) {
+				m_nodes[precedent].dependents.push_back( key );
+			}
+			std::vector<size_t> range_ids;
+			range_ids.reserve( ranges.size( ) );
+			for( auto const & range: ranges ) {
+				range_ids.push_back( add_range( range, key ) );
+			}
+
+			auto & node = m_nodes[key];
+			node.is_formula = true;
+			node.precedents = std::move( precedents );
+			node.ranges = std::move( range_ids );
+		}
+
+		void dependency_graph::remove_formula( cell_address const & cell ) {
+			auto const key = cell.key( );
+			clear_precedents( key );
+			auto it = m_nodes.find( key );
+			if( it != m_nodes.end( ) ) {
+				it->second.is_formula = false;
+				erase_if_unused( key );
+			}
+			m_dirty.erase( key );
+		}
+
+		bool dependency_graph::is_formula( cell_address const & cell ) const {
+			auto it = m_nodes.find( cell.key( ) );
+			return it != m_nodes.end( ) && it->second.is_formula;
+		}
+
+		std::vector<cell_address> dependency_graph::precedents( cell_address const & cell ) const {
+			auto it = m_nodes.find( cell.key( ) );
+			if( it == m_nodes.end( ) ) {
+				return { };
+			}
+			return to_addresses( it->second.precedents );
+		}
+
+		std::vector<cell_range> dependency_graph::range_precedents( cell_address const & cell ) const {
+			std::vector<cell_range> result;
+			auto it = m_nodes.find( cell.key( ) );
+			if( it != m_nodes.end( ) ) {
+				for( auto const & range_id: it->second.ranges ) {
+					result.push_back( m_ranges[range_id].range );
+				}
+			}
+			return result;
+		}
+
+		std::vector<cell_address> dependency_graph::dependents( cell_address const & cell ) const {
+			std::vector<uint64_t> result;
+			for_each_dependent( cell.key( ), [&result]( uint64_t dependent ) {
+				result.push_back( dependent );
+			} );
+			std::sort( result.begin( ), result.end( ) );
+			result.erase( std::unique( result.begin( ), result.end( ) ), result.end( ) );
+			return to_addresses( result );
+		}
+
+		void dependency_graph::mark_dirty( cell_address const & changed ) {
+			mark_dirty( std::vector<cell_address>{ changed } );
+		}
+
+		void dependency_graph::mark_dirty( std::vector<cell_address> const & changed ) {
+			std::vector<uint64_t> pending;
+			for( auto const & cell: changed ) {
+				if( is_formula( cell ) ) {
+					m_dirty.insert( cell.key( ) );
+				}
+				// Always walk from the changed cells, edges may have been added since they
+				// were last marked
+				pending.push_back( cell.key( ) );
+			}
+			while( !pending.empty( ) ) {
+				auto const current = pending.back( );
+				pending.pop_back( );
+				for_each_dependent( current, [&]( uint64_t dependent ) {
+					if( m_dirty.insert( dependent ).second ) {
+						pending.push_back( dependent );
+					}
+				} );
+			}
+		}
+
+		bool dependency_graph::is_dirty( cell_address const & cell ) const {
+			return m_dirty.count( cell.key( ) ) != 0;
+		}
+
+		size_t dependency_graph::dirty_count( ) const noexcept {
+			return m_dirty.size( );
+		}
+
+		recalc_plan dependency_graph::take_dirty( ) {
+			std::unordered_set<uint64_t> dirty{ };
+			dirty.swap( m_dirty );
+			return plan( dirty );
+		}
+
+		recalc_plan dependency_graph::take_dirty( std::vector<cell_address> const & cells ) {
+			std::unordered_set<uint64_t> needed;
+			std::vector<uint64_t> pending;
+			auto const need = [&]( uint64_t cell ) {
+				if( m_dirty.count( cell ) != 0 && needed.insert( cell ).second ) {
+					pending.push_back( cell );
+				}
+			};
+			for( auto const & cell: cells ) {
+				need( cell.key( ) );
+			}
+			// A clean cell only reads clean cells, so the walk stops at them
+			while( !pending.empty( ) ) {
+				auto const current = pending.back( );
+				pending.pop_back( );
+				auto it = m_nodes.find( current );
+				if( it == m_nodes.end( ) ) {
+					continue;
+				}
+				for( auto const & precedent: it->second.precedents ) {
+					need( precedent );
+				}
+				for( auto const & range_id: it->second.ranges ) {
+					for_each_dirty( m_ranges[range_id].range, need );
+				}
+			}
+			for( auto const & cell: needed ) {
+				m_dirty.erase( cell );
+			}
+			return plan( needed );
+		}
+
+		recalc_plan dependency_graph::take_dirty( cell_range const & range ) {
+			std::vector<cell_address> cells;
+			for_each_dirty( range, [&cells]( uint64_t cell ) {
+				cells.push_back( cell_address::from_key( cell ) );
+			} );
+			return take_dirty( cells );
+		}
+
+		recalc_plan dependency_graph::plan( std::unordered_set<uint64_t> const & dirty ) const {
+			std::vector<uint64_t> cells{ dirty.begin( ), dirty.end( ) };
+			std::sort( cells.begin( ), cells.end( ) );
+
+			// Kahn's algorithm restricted to the dirty cells
+			std::unordered_map<uint64_t, size_t> in_degree;
+			in_degree.reserve( cells.size( ) );
+			for( auto const & cell: cells ) {
+				in_degree[cell];
+				for_each_dependent( cell, [&]( uint64_t dependent ) {
+					if( dirty.count( dependent ) != 0 ) {
+						++in_degree[dependent];
+					}
+				} );
+			}
+
+			std::vector<uint64_t> ready;
+			for( auto const & cell: cells ) {
+				if( in_degree[cell] == 0 ) {
+					ready.push_back( cell );
+				}
+			}
+
+			// Process a level at a time so the order is grouped by dependency depth
+			recalc_plan result{ };
+			result.order.reserve( cells.size( ) );
+			result.level_offsets.push_back( 0 );
+			while( !ready.empty( ) ) {
+				std::vector<uint64_t> next;
+				for( auto const & current: ready ) {
+					result.order.push_back( cell_address::from_key( current ) );
+					for_each_dependent( current, [&]( uint64_t dependent ) {
+						if( dirty.count( dependent ) != 0 && --in_degree[dependent] == 0 ) {
+							next.push_back( dependent );
+						}
+					} );
+				}
+				result.level_offsets.push_back( result.order.size( ) );
+				std::sort( next.begin( ), next.end( ) );
+				ready.swap( next );
+			}
+
+			if( result.order.size( ) != cells.size( ) ) {
+				for( auto const & cell: cells ) {
+					if( in_degree[cell] != 0 ) {
+						result.cycle.push_back( cell_address::from_key( cell ) );
+					}
+				}
+			}
+			return result;
+		}
+
+		void dependency_graph::clear( ) {
+			m_nodes.clear( );
+			m_ranges.clear( );
+			m_free_ranges.clear( );
+			m_range_columns.clear( );
+			m_dirty.clear( );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,418 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "edit_journal.h"
+#include "mapped_file.h"
+#include "sheet.h"
+#include "sheet_snapshot.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			// Each record is a record_prefix followed by size bytes of body, a record_body and
+			// the text.  The checksum covers the body
+			struct record_prefix {
+				uint32_t size;
+				uint32_t crc;
+			};	// record_prefix
+
+			struct record_body {
+				uint64_t sequence;
+				int64_t timestamp;
+				uint32_t row;
+				uint32_t column;
+				uint8_t kind;
+				uint8_t value_type;
+				uint16_t reserved;
+				uint32_t reserved2;
+			};	// record_body
+
+			static_assert( sizeof( record_prefix ) == 8, "Unexpected journal record layout" );
+			static_assert( sizeof( record_body ) == 32, "Unexpected journal record layout" );
+
+			constexpr uint8_t kind_count = static_cast<uint8_t>( journal_record::kind_t::resize ) + 1;
+			constexpr uint8_t type_count = static_cast<uint8_t>( journal_record::expected_value_t::Error ) + 1;
+
+			bool file_exists( std::string const & path ) {
+				struct stat info;
+				return ::stat( path.c_str( ), &info ) == 0;
+			}
+
+			int open_journal( std::string const & path ) {
+				auto const fd = ::open( path.c_str( ), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644 );
+				if( fd < 0 ) {
+					io_error( "Error opening journal", path );
+				}
+				return fd;
+			}
+
+			void write_all( int fd, char const * data, size_t size, std::string const & path ) {
+				while( size > 0 ) {
+					auto const written = ::write( fd, data, size );
+					if( written < 0 ) {
+						if( errno == EINTR ) {
+							continue;
+						}
+						io_error( "Error writing journal", path );
+					}
+					data += written;
+					size -= static_cast<size_t>( written );
+				}
+			}
+
+			void sync_file( int fd, std::string const & path ) {
+				if( ::fdatasync( fd ) != 0 ) {
+					io_error( "Error syncing journal", path );
+				}
+			}
+
+			/// @brief Call func for each valid record of data
+			/// @return the bytes taken by the valid records
+			template<typename Function>
+			size_t scan_records( boost::string_ref data, Function func ) {
+				size_t pos = 0;
+				while( data.size( ) - pos >= sizeof( record_prefix ) ) {
+					record_prefix prefix;
+					std::memcpy( &prefix, data.data( ) + pos, sizeof( prefix ) );
+					auto const body_first = pos + sizeof( record_prefix );
+					if( prefix.size < sizeof( record_body ) || prefix.size > data.size( ) - body_first ) {
+						break;
+					}
+					if( crc32c( data.data( ) + body_first, prefix.size ) != prefix.crc ) {
+						break;
+					}
+					record_body body;
+					std::memcpy( &body, data.data( ) + body_first, sizeof( body ) );
+					if( body.kind >= kind_count || body.value_type >= type_count ) {
+						break;
+					}
+					journal_record record{ };
+					record.kind = static_cast<journal_record::kind_t>( body.kind );
+					record.sequence = body.sequence;
+					record.timestamp = body.timestamp;
+					record.cell = cell_address{ body.row, body.column };
+					record.value_type = static_cast<journal_record::expected_value_t>( body.value_type );
+					record.text = boost::string_ref{ data.data( ) + body_first + sizeof( record_body ), prefix.size - sizeof( record_body ) };
+					func( record );
+					pos = body_first + prefix.size;
+				}
+				return pos;
+			}
+
+			int64_t now_microseconds( ) {
+				using namespace std::chrono;
+				return duration_cast<microseconds>( system_clock::now( ).time_since_epoch( ) ).count( );
+			}
+
+			void apply_record( sheet & target, journal_record const & record ) {
+				switch( record.kind ) {
+				case journal_record::kind_t::set_cell:
+					target.set_value( record.cell, record.value_type, record.text );
+					break;
+				case journal_record::kind_t::clear_column:
+					target.clear_column( record.cell.column );
+					break;
+				case journal_record::kind_t::resize:
+					target.resize( record.cell.column );
+					break;
+				}
+			}
+		}	// namespace anonymous
+
+		journal_record::journal_record( ) noexcept:
+				kind{ kind_t::set_cell },
+				sequence{ 0 },
+				timestamp{ 0 },
+				cell{ },
+				value_type{ expected_value_t::General },
+				text{ } { }
+
+		edit_journal::edit_journal( std::string path, journal_options options ):
+				m_options{ std::move( options ) },
+				m_path{ std::move( path ) },
+				m_fd{ -1 },
+				m_mutex{ },
+				m_pending_cv{ },
+				m_durable_cv{ },
+				m_pending{ },
+				m_last_sequence{ 0 },
+				m_durable_sequence{ 0 },
+				m_flush_requested{ false },
+				m_stop{ false },
+				m_error{ },
+				m_io_mutex{ },
+				m_writer{ } {
+
+			auto const last_sequence = [this]( journal_record const & record ) {
+				m_last_sequence = std::max( m_last_sequence, record.sequence );
+			};
+			if( file_exists( rotated_path( ) ) ) {
+				mapped_file const rotated{ rotated_path( ) };
+				scan_records( rotated.view( ), last_sequence );
+			}
+			m_fd = open_journal( m_path );
+			try {
+				sync_directory( m_path );
+			} catch( ... ) {
+				::close( m_fd );
+				throw;
+			}
+			size_t valid_size = 0;
+			size_t file_size = 0;
+			{
+				mapped_file const current{ m_path };
+				file_size = current.size( );
+				valid_size = scan_records( current.view( ), last_sequence );
+			}
+			if( valid_size != file_size && ::ftruncate( m_fd, static_cast<off_t>( valid_size ) ) != 0 ) {
+				::close( m_fd );
+				io_error( "Error truncating journal", m_path );
+			}
+			m_durable_sequence = m_last_sequence;
+			m_pending.reserve( m_options.commit_bytes );
+			m_writer = std::thread{ [this]( ) { writer( ); } };
+		}
+
+		edit_journal::~edit_journal( ) {
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				m_stop = true;
+			}
+			m_pending_cv.notify_all( );
+			m_writer.join( );
+			::close( m_fd );
+		}
+
+		std::string const & edit_journal::path( ) const noexcept {
+			return m_path;
+		}
+
+		std::string edit_journal::rotated_path( ) const {
+			return m_path + ".old";
+		}
+
+		uint64_t edit_journal::append( journal_record::kind_t kind, cell_address const & cell, journal_record::expected_value_t value_type, boost::string_ref text ) {
+			if( text.size( ) > std::numeric_limits<uint32_t>::max( ) - sizeof( record_body ) ) {
+				throw std::length_error{ "Cell text too large for the journal" };
+			}
+			record_body body{ };
+			body.timestamp = now_microseconds( );
+			body.row = cell.row;
+			body.column = cell.column;
+			body.kind = static_cast<uint8_t>( kind );
+			body.value_type = static_cast<uint8_t>( value_type );
+			record_prefix prefix{ };
+			prefix.size = static_cast<uint32_t>( sizeof( record_body ) + text.size( ) );
+
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			if( m_error ) {
+				std::rethrow_exception( m_error );
+			}
+			body.sequence = ++m_last_sequence;
+			prefix.crc = crc32c( text.data( ), text.size( ), crc32c( &body, sizeof( body ) ) );
+			auto const prefix_bytes = reinterpret_cast<char const *>( &prefix );
+			auto const body_bytes = reinterpret_cast<char const *>( &body );
+			m_pending.insert( m_pending.end( ), prefix_bytes, prefix_bytes + sizeof( prefix ) );
+			m_pending.insert( m_pending.end( ), body_bytes, body_bytes + sizeof( body ) );
+			m_pending.insert( m_pending.end( ), text.begin( ), text.end( ) );
+			if( m_pending.size( ) >= m_options.commit_bytes ) {
+				lock.unlock( );
+				m_pending_cv.notify_one( );
+			}
+			return body.sequence;
+		}
+
+		uint64_t edit_journal::append_set( cell_address const & cell, journal_record::expected_value_t value_type, boost::string_ref text ) {
+			return append( journal_record::kind_t::set_cell, cell, value_type, text );
+		}
+
+		uint64_t edit_journal::append_clear_column( size_t column ) {
+			return append( journal_record::kind_t::clear_column, cell_address{ 0, static_cast<cell_address::index_t>( column ) }, journal_record::expected_value_t::General, boost::string_ref{ } );
+		}
+
+		uint64_t edit_journal::append_resize( size_t column_count ) {
+			return append( journal_record::kind_t::resize, cell_address{ 0, static_cast<cell_address::index_t>( column_count ) }, journal_record::expected_value_t::General, boost::string_ref{ } );
+		}
+
+		uint64_t edit_journal::last_sequence( ) {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			return m_last_sequence;
+		}
+
+		void edit_journal::write_pending( std::unique_lock<std::mutex> & lock ) {
+			// Called with lock held.  The group is taken under the io lock, so rotate( ) never
+			// falls between taking a group and writing it, and appends carry on while it is written
+			lock.unlock( );
+			std::lock_guard<std::mutex> io_lock{ m_io_mutex };
+			lock.lock( );
+			std::vector<char> group;
+			group.reserve( m_options.commit_bytes );
+			group.swap( m_pending );
+			auto const sequence = m_last_sequence;
+			m_flush_requested = false;
+			lock.unlock( );
+			std::exception_ptr error{ };
+			try {
+				if( !group.empty( ) ) {
+					write_all( m_fd, group.data( ), group.size( ), m_path );
+					if( m_options.sync ) {
+						sync_file( m_fd, m_path );
+					}
+				}
+			} catch( ... ) {
+				error = std::current_exception( );
+			}
+			lock.lock( );
+			if( error ) {
+				if( !m_error ) {
+					m_error = error;
+				}
+			} else {
+				m_durable_sequence = std::max( m_durable_sequence, sequence );
+			}
+			m_durable_cv.notify_all( );
+		}
+
+		void edit_journal::writer( ) {
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			while( true ) {
+				m_pending_cv.wait_for( lock, m_options.commit_interval, [this]( ) {
+					return m_stop || m_flush_requested || m_pending.size( ) >= m_options.commit_bytes;
+				} );
+				if( !m_pending.empty( ) && !m_error ) {
+					write_pending( lock );
+				} else if( m_flush_requested ) {
+					m_flush_requested = false;
+					m_durable_cv.notify_all( );
+				}
+				if( m_stop && (m_pending.empty( ) || m_error) ) {
+					return;
+				}
+			}
+		}
+
+		void edit_journal::wait_durable( uint64_t sequence ) {
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			if( m_durable_sequence < sequence && !m_error ) {
+				m_flush_requested = true;
+				m_pending_cv.notify_one( );
+				m_durable_cv.wait( lock, [this, sequence]( ) {
+					return m_durable_sequence >= sequence || m_error;
+				} );
+			}
+			if( m_durable_sequence < sequence ) {
+				std::rethrow_exception( m_error );
+			}
+		}
+
+		void edit_journal::flush( ) {
+			wait_durable( last_sequence( ) );
+		}
+
+		void edit_journal::rotate( ) {
+			std::lock_guard<std::mutex> io_lock{ m_io_mutex };
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			if( m_error ) {
+				std::rethrow_exception( m_error );
+			}
+			auto const rotated = rotated_path( );
+			if( file_exists( rotated ) ) {
+				throw std::logic_error{ "A previous journal compaction has not finished" };
+			}
+			// Appends are blocked by the lock, so the rotated journal ends exactly here
+			write_all( m_fd, m_pending.data( ), m_pending.size( ), m_path );
+			m_pending.clear( );
+			sync_file( m_fd, m_path );
+			m_durable_sequence = m_last_sequence;
+			m_durable_cv.notify_all( );
+			if( std::rename( m_path.c_str( ), rotated.c_str( ) ) != 0 ) {
+				io_error( "Error rotating journal", m_path );
+			}
+			auto const fd = open_journal( m_path );
+			::close( m_fd );
+			m_fd = fd;
+			// Appends to the new journal are only durable once its directory entry is
+			sync_directory( m_path );
+		}
+
+		size_t read_journal( std::string const & path, std::function<void( journal_record const & )> const & func ) {
+			if( !file_exists( path ) ) {
+				return 0;
+			}
+			mapped_file const file{ path };
+			size_t count = 0;
+			scan_records( file.view( ), [&]( journal_record const & record ) {
+				func( record );
+				++count;
+			} );
+			return count;
+		}
+
+		size_t replay_journal( std::string const & path, sheet & target ) {
+			sheet::transaction tx{ target };
+			auto const count = read_journal( path, [&target]( journal_record const & record ) {
+				apply_record( target, record );
+			} );
+			tx.commit( );
+			return count;
+		}
+
+		void recover_sheet( sheet & target, std::string const & snapshot_path, std::string const & journal_path ) {
+			sheet::transaction tx{ target };
+			if( file_exists( snapshot_path ) ) {
+				sheet_snapshot{ snapshot_path }.load( target );
+			}
+			replay_journal( journal_path + ".old", target );
+			replay_journal( journal_path, target );
+			tx.commit( );
+		}
+
+		std::future<void> compact_journal( sheet const & source, edit_journal & journal, std::string snapshot_path ) {
+			std::vector<impl::column_store> columns;
+			columns.reserve( source.column_count( ) );
+			for( size_t n = 0; n < source.column_count( ); ++n ) {
+				columns.push_back( source.column( n ).store( ) );
+			}
+			journal.rotate( );
+			return std::async( std::launch::async, [columns = std::move( columns ), snapshot_path = std::move( snapshot_path ), rotated = journal.rotated_path( )]( ) {
+				// write_snapshot returns once the snapshot and its name are on disk, only then
+				// is the rotated journal holding the same edits no longer needed
+				write_snapshot( columns, snapshot_path );
+				if( ::unlink( rotated.c_str( ) ) != 0 && errno != ENOENT ) {
+					io_error( "Error removing rotated journal", rotated );
+				}
+				sync_directory( rotated );
+			} );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
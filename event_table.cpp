@@ -0,0 +1,350 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "event_table.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			constexpr uint64_t event_bits = 2;
+
+			template<typename Entries>
+			auto key_first( Entries & entries, uint64_t key ) {
+				return std::lower_bound( entries.begin( ), entries.end( ), key, []( auto const & e, uint64_t k ) {
+					return e.key < k;
+				} );
+			}
+
+			template<typename Iterator>
+			Iterator key_last( Iterator first, Iterator last, uint64_t key ) {
+				return std::upper_bound( first, last, key, []( uint64_t k, auto const & e ) {
+					return k < e.key;
+				} );
+			}
+		}	// namespace anonymous
+
+		event_table::event_table( ):
+				m_entries{ },
+				m_pending{ },
+				m_next_token{ 1 },
+				m_emit_depth{ 0 },
+				m_has_removed{ false },
+				m_change_listeners{ },
+				m_pending_change_listeners{ },
+				m_deliver_depth{ 0 },
+				m_deferred{ },
+				m_deferred_removals{ },
+				m_changes{ },
+				m_batch_depth{ 0 } { }
+
+		event_table::~event_table( ) { }
+
+		uint64_t event_table::make_key( id_t item, item_event event ) noexcept {
+			return (static_cast<uint64_t>( item ) << event_bits) | static_cast<uint64_t>( event );
+		}
+
+		void event_table::insert( entry value ) {
+			auto const pos = key_last( m_entries.begin( ), m_entries.end( ), value.key );
+			m_entries.insert( pos, std::move( value ) );
+		}
+
+		event_table::token_t event_table::add( id_t item, item_event event, listener_t listener, bool once ) {
+			entry value{ make_key( item, event ), m_next_token++, once, false, std::move( listener ) };
+			auto const token = value.token;
+			if( m_emit_depth > 0 ) {
+				m_pending.push_back( std::move( value ) );
+			} else {
+				insert( std::move( value ) );
+			}
+			return token;
+		}
+
+		void event_table::flush( ) {
+			if( m_has_removed ) {
+				m_entries.erase( std::remove_if( m_entries.begin( ), m_entries.end( ), []( entry const & e ) {
+					return e.removed;
+				} ), m_entries.end( ) );
+				m_has_removed = false;
+			}
+			for( auto & value: m_pending ) {
+				if( !value.removed ) {
+					insert( std::move( value ) );
+				}
+			}
+			m_pending.clear( );
+		}
+
+		event_table::token_t event_table::on( id_t item, item_event event, listener_t listener ) {
+			return add( item, event, std::move( listener ), false );
+		}
+
+		event_table::token_t event_table::on_next( id_t item, item_event event, listener_t listener ) {
+			return add( item, event, std::move( listener ), true );
+		}
+
+		void event_table::emit( id_t item, item_event event ) {
+			auto const key = make_key( item, event );
+			if( m_batch_depth > 0 ) {
+				// Repeated emits from one item are the common case when batching
+				if( m_deferred.empty( ) || m_deferred.back( ) != key ) {
+					m_deferred.push_back( key );
+					m_changes.add_id( item );
+				}
+				return;
+			}
+			auto const first = key_first( m_entries, key );
+			// Indices stay valid as nothing is inserted or erased while emitting
+			++m_emit_depth;
+			try {
+				for( auto n = static_cast<size_t>( first - m_entries.begin( ) ); n < m_entries.size( ) && m_entries[n].key == key; ++n ) {
+					auto & listener = m_entries[n];
+					if( listener.removed ) {
+						continue;
+					}
+					if( listener.once ) {
+						listener.removed = true;
+						m_has_removed = true;
+					}
+					listener.callback( item );
+				}
+			} catch( ... ) {
+				if( --m_emit_depth == 0 ) {
+					flush( );
+				}
+				throw;
+			}
+			if( --m_emit_depth == 0 && (m_has_removed || !m_pending.empty( )) ) {
+				flush( );
+			}
+		}
+
+		event_table::token_t event_table::on_changes( change_listener_t listener ) {
+			auto const token = m_next_token++;
+			change_entry value{ token, false, std::move( listener ) };
+			if( m_deliver_depth > 0 ) {
+				// Growing m_change_listeners could move the listener being called
+				m_pending_change_listeners.push_back( std::move( value ) );
+			} else {
+				m_change_listeners.push_back( std::move( value ) );
+			}
+			return token;
+		}
+
+		void event_table::flush_change_listeners( ) {
+			m_change_listeners.erase( std::remove_if( m_change_listeners.begin( ), m_change_listeners.end( ), []( change_entry const & e ) {
+				return e.removed;
+			} ), m_change_listeners.end( ) );
+			for( auto & value: m_pending_change_listeners ) {
+				if( !value.removed ) {
+					m_change_listeners.push_back( std::move( value ) );
+				}
+			}
+			m_pending_change_listeners.clear( );
+		}
+
+		void event_table::deliver( change_set const & changes ) {
+			// Listeners added while delivering are not called for these changes
+			auto const count = m_change_listeners.size( );
+			++m_deliver_depth;
+			try {
+				for( size_t n = 0; n < count; ++n ) {
+					if( !m_change_listeners[n].removed && m_change_listeners[n].callback ) {
+						m_change_listeners[n].callback( changes );
+					}
+				}
+			} catch( ... ) {
+				if( --m_deliver_depth == 0 ) {
+					flush_change_listeners( );
+				}
+				throw;
+			}
+			if( --m_deliver_depth == 0 ) {
+				flush_change_listeners( );
+			}
+		}
+
+		void event_table::begin_batch( ) {
+			++m_batch_depth;
+		}
+
+		void event_table::end_batch( ) {
+			if( m_batch_depth == 0 ) {
+				throw std::logic_error{ "event_table::end_batch called outside of a batch" };
+			}
+			if( --m_batch_depth > 0 ) {
+				return;
+			}
+			std::vector<uint64_t> deferred;
+			std::vector<id_t> removals;
+			change_set changes;
+			deferred.swap( m_deferred );
+			removals.swap( m_deferred_removals );
+			std::swap( changes, m_changes );
+			changes.coalesce( );
+
+			// Emit each key once, in the order they were first emitted
+			std::vector<std::pair<uint64_t, size_t>> keys;
+			keys.reserve( deferred.size( ) );
+			for( size_t n = 0; n < deferred.size( ); ++n ) {
+				keys.emplace_back( deferred[n], n );
+			}
+			std::sort( keys.begin( ), keys.end( ) );
+			keys.erase( std::unique( keys.begin( ), keys.end( ), []( auto const & lhs, auto const & rhs ) {
+				return lhs.first == rhs.first;
+			} ), keys.end( ) );
+			std::sort( keys.begin( ), keys.end( ), []( auto const & lhs, auto const & rhs ) {
+				return lhs.second < rhs.second;
+			} );
+			auto const remove_closed = [&]( ) {
+				for( auto const & item: removals ) {
+					remove_all( item );
+				}
+			};
+			try {
+				for( auto const & key: keys ) {
+					emit( static_cast<id_t>( key.first >> event_bits ), static_cast<item_event>( key.first & ((1u << event_bits) - 1) ) );
+				}
+			} catch( ... ) {
+				remove_closed( );
+				throw;
+			}
+			remove_closed( );
+			if( !changes.empty( ) ) {
+				deliver( changes );
+			}
+		}
+
+		bool event_table::in_batch( ) const noexcept {
+			return m_batch_depth > 0;
+		}
+
+		void event_table::add_change( cell_address const & cell ) {
+			add_change( cell_range{ cell, cell } );
+		}
+
+		void event_table::add_change( cell_range const & range ) {
+			if( m_batch_depth > 0 ) {
+				m_changes.add( range );
+				return;
+			}
+			change_set changes;
+			changes.add( range );
+			deliver( changes );
+		}
+
+		bool event_table::remove( token_t token ) {
+			auto const is_change_listener = [token]( change_entry const & e ) {
+				return e.token == token && !e.removed;
+			};
+			auto listener = std::find_if( m_change_listeners.begin( ), m_change_listeners.end( ), is_change_listener );
+			if( listener != m_change_listeners.end( ) ) {
+				if( m_deliver_depth > 0 ) {
+					// The listener may be the one running, it is destroyed after delivery
+					listener->removed = true;
+				} else {
+					m_change_listeners.erase( listener );
+				}
+				return true;
+			}
+			auto pending_listener = std::find_if( m_pending_change_listeners.begin( ), m_pending_change_listeners.end( ), is_change_listener );
+			if( pending_listener != m_pending_change_listeners.end( ) ) {
+				pending_listener->removed = true;
+				return true;
+			}
+			auto const matches = [token]( entry const & e ) {
+				return e.token == token && !e.removed;
+			};
+			auto pos = std::find_if( m_entries.begin( ), m_entries.end( ), matches );
+			if( pos == m_entries.end( ) ) {
+				auto pending = std::find_if( m_pending.begin( ), m_pending.end( ), matches );
+				if( pending == m_pending.end( ) ) {
+					return false;
+				}
+				pending->removed = true;
+				return true;
+			}
+			if( m_emit_depth > 0 ) {
+				pos->removed = true;
+				m_has_removed = true;
+			} else {
+				m_entries.erase( pos );
+			}
+			return true;
+		}
+
+		void event_table::remove_all( id_t item, item_event event ) {
+			auto const key = make_key( item, event );
+			auto first = key_first( m_entries, key );
+			auto last = key_last( first, m_entries.end( ), key );
+			if( m_emit_depth > 0 ) {
+				for( ; first != last; ++first ) {
+					first->removed = true;
+				}
+				m_has_removed = true;
+			} else {
+				m_entries.erase( first, last );
+			}
+			for( auto & value: m_pending ) {
+				if( value.key == key ) {
+					value.removed = true;
+				}
+			}
+		}
+
+		void event_table::remove_all( id_t item ) {
+			if( m_batch_depth > 0 ) {
+				m_deferred_removals.push_back( item );
+				return;
+			}
+			remove_all( item, item_event::closed );
+			remove_all( item, item_event::updated );
+			remove_all( item, item_event::data_updated );
+		}
+
+		size_t event_table::listener_count( id_t item, item_event event ) const {
+			auto const key = make_key( item, event );
+			auto const is_listener = [key]( entry const & e ) {
+				return e.key == key && !e.removed;
+			};
+			auto const first = key_first( m_entries, key );
+			auto const last = key_last( first, m_entries.end( ), key );
+			return static_cast<size_t>( std::count_if( first, last, is_listener ) + std::count_if( m_pending.begin( ), m_pending.end( ), is_listener ) );
+		}
+
+		size_t event_table::size( ) const noexcept {
+			return m_entries.size( ) + m_pending.size( );
+		}
+
+		bool event_table::empty( ) const noexcept {
+			return size( ) == 0;
+		}
+
+		std::shared_ptr<event_table> create_event_table( ) {
+			return std::make_shared<event_table>( );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
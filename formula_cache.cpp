@@ -0,0 +1,270 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#include "formula_cache.h"
+#include "sheetrock_flat_ast.h"
+#include "sheetrock_parser.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			using daw::parser::sheetrock::token_kind;
+
+			// The most columns an A1 reference can name, ZZZ
+			constexpr int64_t s_column_limit = 26 + 26 * 26 + 26 * 26 * 26;
+			constexpr int64_t s_row_limit = std::numeric_limits<cell_address::index_t>::max( );
+			constexpr size_t s_min_prune_size = 1024;
+
+			void append_number( std::string & out, int64_t value ) {
+				char buffer[24];
+				auto last = buffer + sizeof( buffer );
+				auto first = last;
+				auto magnitude = value < 0 ? 0 - static_cast<uint64_t>( value ) : static_cast<uint64_t>( value );
+				do {
+					*--first = static_cast<char>( '0' + magnitude % 10 );
+					magnitude /= 10;
+				} while( magnitude != 0 );
+				if( value < 0 ) {
+					*--first = '-';
+				}
+				out.append( first, last );
+			}
+
+			/// Anchored parts are written as $n, the others as the offset from cell
+			void append_relative( std::string & key, cell_address const & address, uint8_t anchors, cell_address const & cell ) {
+				key += "@r";
+				if( (anchors & anchor_row) != 0 ) {
+					key += '$';
+					append_number( key, address.row );
+				} else {
+					append_number( key, static_cast<int64_t>( address.row ) - static_cast<int64_t>( cell.row ) );
+				}
+				key += 'c';
+				if( (anchors & anchor_column) != 0 ) {
+					key += '$';
+					append_number( key, address.column );
+				} else {
+					append_number( key, static_cast<int64_t>( address.column ) - static_cast<int64_t>( cell.column ) );
+				}
+			}
+
+			bool append_reference( std::string & out, int64_t row, int64_t column, uint8_t anchors ) {
+				if( row < 0 || row >= s_row_limit || column < 0 || column >= s_column_limit ) {
+					out += to_string( formula_error::ref );
+					return false;
+				}
+				if( (anchors & anchor_column) != 0 ) {
+					out += '$';
+				}
+				char letters[3];
+				size_t count = 0;
+				for( auto n = column + 1; n > 0; n = (n - 1) / 26 ) {
+					letters[count++] = static_cast<char>( 'A' + (n - 1) % 26 );
+				}
+				while( count > 0 ) {
+					out += letters[--count];
+				}
+				if( (anchors & anchor_row) != 0 ) {
+					out += '$';
+				}
+				append_number( out, row + 1 );
+				return true;
+			}
+
+			int64_t moved( cell_address::index_t value, bool anchored, cell_address::index_t from, cell_address::index_t to ) noexcept {
+				if( anchored ) {
+					return value;
+				}
+				return static_cast<int64_t>( value ) - static_cast<int64_t>( from ) + static_cast<int64_t>( to );
+			}
+
+			using formula_map_t = std::unordered_map<std::string, std::shared_ptr<compiled_formula const>>;
+
+			size_t prune_unused( formula_map_t & formulas ) {
+				size_t count = 0;
+				for( auto pos = formulas.begin( ); pos != formulas.end( ); ) {
+					if( pos->second.use_count( ) == 1 ) {
+						pos = formulas.erase( pos );
+						++count;
+					} else {
+						++pos;
+					}
+				}
+				return count;
+			}
+		}	// namespace anonymous
+
+		compiled_formula::compiled_formula( ):
+				m_program{ },
+				m_origin{ },
+				m_parsed{ false } { }
+
+		compiled_formula::compiled_formula( formula_program program, cell_address const & origin ):
+				m_program{ std::move( program ) },
+				m_origin{ origin },
+				m_parsed{ true } { }
+
+		bool compiled_formula::parsed( ) const noexcept {
+			return m_parsed;
+		}
+
+		formula_program const & compiled_formula::program( ) const noexcept {
+			return m_program;
+		}
+
+		cell_address const & compiled_formula::origin( ) const noexcept {
+			return m_origin;
+		}
+
+		cell_address compiled_formula::cell( size_t index, cell_address const & at ) const noexcept {
+			return move_reference( m_program.cells[index], m_program.cell_anchors[index], m_origin, at );
+		}
+
+		cell_range compiled_formula::range( size_t index, cell_address const & at ) const noexcept {
+			return move_reference( m_program.ranges[index], m_program.range_anchors[index], m_origin, at );
+		}
+
+		void compiled_formula::references( cell_address const & at, std::vector<cell_address> & cells, std::vector<cell_range> & ranges ) const {
+			cells.clear( );
+			ranges.clear( );
+			for( size_t n = 0; n < m_program.cells.size( ); ++n ) {
+				cells.push_back( cell( n, at ) );
+			}
+			for( size_t n = 0; n < m_program.ranges.size( ); ++n ) {
+				ranges.push_back( range( n, at ) );
+			}
+		}
+
+		void normalize_formula( boost::string_ref formula, cell_address const & cell, std::string & key ) {
+			key.clear( );
+			daw::parser::sheetrock::tokenizer tokens{ formula };
+			auto tok = tokens.next( );
+			if( tok.kind == token_kind::op && tok.text == "=" ) {
+				tok = tokens.next( );
+			}
+			// Tokens are space separated so dropping the source's spacing cannot join two
+			// tokens into one
+			for( ; tok.kind != token_kind::end; tok = tokens.next( ) ) {
+				if( !key.empty( ) ) {
+					key += ' ';
+				}
+				switch( tok.kind ) {
+				case token_kind::cell:
+					append_relative( key, tok.address, tok.anchors, cell );
+					break;
+				case token_kind::name:
+				case token_kind::boolean:
+					// Function names and booleans are not case sensitive
+					std::transform( tok.text.begin( ), tok.text.end( ), std::back_inserter( key ), []( char c ) {
+						return (c >= 'a' && c <= 'z') ? static_cast<char>( c - ('a' - 'A') ) : c;
+					} );
+					break;
+				default:
+					key.append( tok.text.begin( ), tok.text.end( ) );
+					break;
+				}
+			}
+		}
+
+		bool move_formula( boost::string_ref formula, cell_address const & from, cell_address const & to, std::string & out ) {
+			out.clear( );
+			bool result = true;
+			size_t copied = 0;
+			daw::parser::sheetrock::tokenizer tokens{ formula };
+			for( auto tok = tokens.next( ); tok.kind != token_kind::end; tok = tokens.next( ) ) {
+				if( tok.kind != token_kind::cell ) {
+					continue;
+				}
+				out.append( formula.begin( ) + copied, formula.begin( ) + tok.position );
+				copied = tok.position + tok.text.size( );
+				auto const row = moved( tok.address.row, (tok.anchors & anchor_row) != 0, from.row, to.row );
+				auto const column = moved( tok.address.column, (tok.anchors & anchor_column) != 0, from.column, to.column );
+				result = append_reference( out, row, column, tok.anchors ) && result;
+			}
+			out.append( formula.begin( ) + copied, formula.end( ) );
+			return result;
+		}
+
+		formula_cache::formula_cache( ):
+				m_mutex{ },
+				m_formulas{ },
+				m_prune_size{ s_min_prune_size } { }
+
+		formula_cache::~formula_cache( ) { }
+
+		std::shared_ptr<compiled_formula const> formula_cache::get( boost::string_ref formula, cell_address const & cell ) {
+			static thread_local std::string s_key;
+			normalize_formula( formula, cell, s_key );
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				auto const pos = m_formulas.find( s_key );
+				if( pos != m_formulas.end( ) ) {
+					return pos->second;
+				}
+			}
+			// Compiled without the lock.  The AST only lives until compiled so one arena per
+			// thread is reused
+			static thread_local daw::parser::sheetrock::flat_ast s_arena;
+			s_arena.clear( );
+			std::shared_ptr<compiled_formula const> result;
+			auto parsed = daw::parser::sheetrock::parse_formula( formula, s_arena );
+			if( parsed ) {
+				result = std::make_shared<compiled_formula const>( compile_formula( s_arena, parsed.root ), cell );
+			} else {
+				result = std::make_shared<compiled_formula const>( );
+			}
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			auto const inserted = m_formulas.emplace( s_key, result );
+			if( !inserted.second ) {
+				// Another thread compiled the same shape first
+				return inserted.first->second;
+			}
+			if( m_formulas.size( ) >= m_prune_size ) {
+				prune_unused( m_formulas );
+				m_prune_size = std::max( s_min_prune_size, 2 * m_formulas.size( ) );
+			}
+			return result;
+		}
+
+		size_t formula_cache::size( ) const {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			return m_formulas.size( );
+		}
+
+		size_t formula_cache::prune( ) {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			return prune_unused( m_formulas );
+		}
+
+		void formula_cache::clear( ) {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_formulas.clear( );
+			m_prune_size = s_min_prune_size;
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
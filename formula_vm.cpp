@@ -0,0 +1,790 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#include <daw/daw_parser_helper.h>
+
+#include "formula_vm.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace ast = daw::parser::sheetrock::ast;
+		using daw::parser::sheetrock::flat_ast;
+		using daw::parser::sheetrock::flat_kind;
+
+		std::string to_string( formula_error error ) {
+			switch( error ) {
+			case formula_error::none: return "";
+			case formula_error::div_zero: return "#DIV/0!";
+			case formula_error::value: return "#VALUE!";
+			case formula_error::ref: return "#REF!";
+			case formula_error::name: return "#NAME?";
+			case formula_error::num: return "#NUM!";
+			case formula_error::cycle: return "#CIRC!";
+			case formula_error::na: return "#N/A";
+			}
+			return "#VALUE!";
+		}
+
+		formula_value::formula_value( ):
+				kind{ kind_t::empty },
+				boolean{ false },
+				error{ formula_error::none },
+				range_index{ 0 },
+				number{ },
+				text{ } { }
+
+		formula_value formula_value::from_number( number::big_num_t value ) {
+			formula_value result{ };
+			result.kind = kind_t::number;
+			result.number = std::move( value );
+			return result;
+		}
+
+		formula_value formula_value::from_string( std::string value ) {
+			formula_value result{ };
+			result.kind = kind_t::string;
+			result.text = std::move( value );
+			return result;
+		}
+
+		formula_value formula_value::from_boolean( bool value ) {
+			formula_value result{ };
+			result.kind = kind_t::boolean;
+			result.boolean = value;
+			return result;
+		}
+
+		formula_value formula_value::from_error( formula_error value ) {
+			formula_value result{ };
+			result.kind = kind_t::error;
+			result.error = value;
+			return result;
+		}
+
+		formula_value formula_value::from_range( uint32_t index ) {
+			formula_value result{ };
+			result.kind = kind_t::range;
+			result.range_index = index;
+			return result;
+		}
+
+		bool formula_value::is_error( ) const noexcept {
+			return kind == kind_t::error;
+		}
+
+		impl::cell_value::cell_variant_t to_variant( formula_value const & value ) {
+			using cell_variant_t = impl::cell_value::cell_variant_t;
+			switch( value.kind ) {
+			case formula_value::kind_t::number: return cell_variant_t{ }.store( value.number );
+			case formula_value::kind_t::string: return cell_variant_t{ }.store( value.text );
+			case formula_value::kind_t::boolean: return cell_variant_t{ }.store( value.boolean );
+			case formula_value::kind_t::error: return cell_variant_t{ }.store( to_string( value.error ) );
+			case formula_value::kind_t::range: return cell_variant_t{ }.store( to_string( formula_error::value ) );
+			case formula_value::kind_t::empty:
+			default: return cell_variant_t{ }.store( std::string{ } );
+			}
+		}
+
+		formula_program::formula_program( ):
+				code{ },
+				constants{ },
+				cells{ },
+				ranges{ },
+				cell_anchors{ },
+				range_anchors{ },
+				max_stack{ 0 } { }
+
+		namespace {
+			bool equal_nc( std::string const & lhs, char const * rhs ) {
+				size_t n = 0;
+				for( ; n < lhs.size( ) && rhs[n] != 0; ++n ) {
+					if( std::toupper( static_cast<unsigned char>( lhs[n] ) ) != std::toupper( static_cast<unsigned char>( rhs[n] ) ) ) {
+						return false;
+					}
+				}
+				return n == lhs.size( ) && rhs[n] == 0;
+			}
+
+			int compare_nc( std::string const & lhs, std::string const & rhs ) {
+				auto const count = std::min( lhs.size( ), rhs.size( ) );
+				for( size_t n = 0; n < count; ++n ) {
+					auto const l = std::toupper( static_cast<unsigned char>( lhs[n] ) );
+					auto const r = std::toupper( static_cast<unsigned char>( rhs[n] ) );
+					if( l != r ) {
+						return l < r ? -1 : 1;
+					}
+				}
+				return lhs.size( ) == rhs.size( ) ? 0 : (lhs.size( ) < rhs.size( ) ? -1 : 1);
+			}
+
+			class compiler {
+				formula_program & m_program;
+				size_t m_depth;
+				std::string m_name;
+
+				size_t emit( op_code code, uint32_t operand = 0, uint8_t argc = 0 ) {
+					m_program.code.push_back( instruction{ code, argc, operand } );
+					return m_program.code.size( ) - 1;
+				}
+
+				void push( ) {
+					m_program.max_stack = std::max( m_program.max_stack, ++m_depth );
+				}
+
+				void pop( size_t count = 1 ) {
+					m_depth -= count;
+				}
+
+				void patch( size_t jump ) {
+					m_program.code[jump].operand = static_cast<uint32_t>( m_program.code.size( ) );
+				}
+
+				void constant( formula_value value ) {
+					m_program.constants.push_back( std::move( value ) );
+					emit( op_code::push_constant, static_cast<uint32_t>( m_program.constants.size( ) - 1 ) );
+					push( );
+				}
+
+				/// Shared by both AST forms, compile_argument( n ) compiles the n'th argument
+				template<typename CompileArgument>
+				void compile_function( boost::string_ref function_name, size_t argument_count, CompileArgument compile_argument ) {
+					static std::unordered_map<std::string, formula_function> const s_functions = {
+							{ "SUM", formula_function::sum },
+							{ "AVERAGE", formula_function::average },
+							{ "MIN", formula_function::min },
+							{ "MAX", formula_function::max },
+							{ "COUNT", formula_function::count },
+							{ "ABS", formula_function::abs },
+							{ "AND", formula_function::logical_and },
+							{ "OR", formula_function::logical_or },
+							{ "NOT", formula_function::logical_not },
+							{ "MATCH", formula_function::match },
+							{ "VLOOKUP", formula_function::vlookup }
+					};
+					m_name.assign( function_name.begin( ), function_name.end( ) );
+					std::transform( m_name.begin( ), m_name.end( ), m_name.begin( ), []( char c ) {
+						return static_cast<char>( std::toupper( static_cast<unsigned char>( c ) ) );
+					} );
+					if( m_name == "IF" ) {
+						compile_if( argument_count, compile_argument );
+						return;
+					}
+					auto pos = s_functions.find( m_name );
+					if( pos == s_functions.end( ) || argument_count > 255 ) {
+						constant( formula_value::from_error( formula_error::name ) );
+						return;
+					}
+					for( size_t n = 0; n < argument_count; ++n ) {
+						compile_argument( n );
+					}
+					emit( op_code::call, static_cast<uint32_t>( pos->second ), static_cast<uint8_t>( argument_count ) );
+					pop( argument_count );
+					push( );
+				}
+
+				// IF( condition, when_true, when_false ) only evaluates the branch taken
+				template<typename CompileArgument>
+				void compile_if( size_t argument_count, CompileArgument compile_argument ) {
+					if( argument_count == 0 || argument_count > 3 ) {
+						constant( formula_value::from_error( formula_error::value ) );
+						return;
+					}
+					compile_argument( 0 );
+					auto const to_false = emit( op_code::jump_if_false );
+					pop( );
+					if( argument_count > 1 ) {
+						compile_argument( 1 );
+					} else {
+						constant( formula_value::from_boolean( true ) );
+					}
+					auto const to_end = emit( op_code::jump );
+					pop( );
+					patch( to_false );
+					if( argument_count > 2 ) {
+						compile_argument( 2 );
+					} else {
+						constant( formula_value::from_boolean( false ) );
+					}
+					patch( to_end );
+				}
+
+				void compile_number( boost::string_ref text ) {
+					number::big_num_t value{ };
+					auto const result = number::from_chars( text.begin( ), text.end( ), value );
+					daw::exception::daw_throw_on_false<daw::parser::ParserException>( result.ec == std::errc{ } && result.ptr == text.end( ), "Invalid number" );
+					constant( formula_value::from_number( std::move( value ) ) );
+				}
+
+				void compile_cell( cell_address const & address, uint8_t anchors ) {
+					m_program.cells.push_back( address );
+					m_program.cell_anchors.push_back( anchors );
+					emit( op_code::push_cell, static_cast<uint32_t>( m_program.cells.size( ) - 1 ) );
+					push( );
+				}
+
+				void compile_range( cell_address const & first, cell_address const & last, uint8_t anchors ) {
+					m_program.ranges.push_back( cell_range{
+							cell_address{ std::min( first.row, last.row ), std::min( first.column, last.column ) },
+							cell_address{ std::max( first.row, last.row ), std::max( first.column, last.column ) } } );
+					// The anchors follow their row and column to the corner they were sorted into
+					uint8_t const first_anchors = anchors & 3;
+					uint8_t const last_anchors = static_cast<uint8_t>( anchors >> 2 );
+					auto const top = first.row <= last.row ? first_anchors : last_anchors;
+					auto const bottom = first.row <= last.row ? last_anchors : first_anchors;
+					auto const left = first.column <= last.column ? first_anchors : last_anchors;
+					auto const right = first.column <= last.column ? last_anchors : first_anchors;
+					m_program.range_anchors.push_back( static_cast<uint8_t>(
+							(top & anchor_row) | (left & anchor_column) | (((bottom & anchor_row) | (right & anchor_column)) << 2) ) );
+					emit( op_code::push_range, static_cast<uint32_t>( m_program.ranges.size( ) - 1 ) );
+					push( );
+				}
+
+				static op_code binary_op_code( int32_t op ) {
+					switch( op ) {
+					case '+': return op_code::add;
+					case '-': return op_code::subtract;
+					case '*': return op_code::multiply;
+					case '/': return op_code::divide;
+					case '%': return op_code::modulus;
+					case '^': return op_code::power;
+					case '&': return op_code::logical_and;
+					case '|': return op_code::logical_or;
+					case '<': return op_code::less;
+					case '>': return op_code::greater;
+					case '=': return op_code::equal;
+					default:
+						throw daw::parser::ParserException{ };
+					}
+				}
+			public:
+				explicit compiler( formula_program & program ):
+						m_program{ program },
+						m_depth{ 0 },
+						m_name{ } { }
+
+				void compile( daw::optional_poly<ast::expression> const & node ) {
+					daw::exception::daw_throw_on_false<daw::parser::ParserException>( static_cast<bool>( node ), "Missing operand" );
+					compile( *node );
+				}
+
+				void compile( ast::expression const & node ) {
+					if( auto bin = dynamic_cast<ast::binary_operator const *>( &node ) ) {
+						compile( bin->lhs );
+						compile( bin->rhs );
+						emit( binary_op_code( bin->op_char( ) ) );
+						pop( );
+					} else if( auto un = dynamic_cast<ast::unary_operator const *>( &node ) ) {
+						compile( un->rhs );
+						emit( un->op == '%' ? op_code::percent : op_code::negate );
+					} else if( auto num = dynamic_cast<ast::number const *>( &node ) ) {
+						compile_number( num->value );
+					} else if( auto str = dynamic_cast<ast::string const *>( &node ) ) {
+						constant( formula_value::from_string( str->value ) );
+					} else if( auto b = dynamic_cast<ast::boolean const *>( &node ) ) {
+						constant( formula_value::from_boolean( b->value ) );
+					} else if( auto c = dynamic_cast<ast::cell const *>( &node ) ) {
+						compile_cell( c->address, anchor_none );
+					} else if( auto rng = dynamic_cast<ast::range const *>( &node ) ) {
+						daw::exception::daw_throw_on_false<daw::parser::ParserException>( rng->first && rng->last, "Incomplete range" );
+						compile_range( (*rng->first).address, (*rng->last).address, anchor_none );
+					} else if( auto fn = dynamic_cast<ast::function const *>( &node ) ) {
+						boost::string_ref name = fn->name ? boost::string_ref{ (*fn->name).value } : boost::string_ref{ };
+						compile_function( name, fn->arguments.size( ), [&]( size_t n ) {
+							compile( fn->arguments[n] );
+						} );
+					} else {
+						throw daw::parser::ParserException{ };
+					}
+				}
+
+				void compile( flat_ast const & tree, flat_ast::index_t index ) {
+					daw::exception::daw_throw_on_false<daw::parser::ParserException>( index < tree.size( ), "Missing operand" );
+					auto const & node = tree[index];
+					switch( node.kind ) {
+					case flat_kind::binary_operator:
+						compile( tree, node.a );
+						compile( tree, node.b );
+						emit( binary_op_code( node.op ) );
+						pop( );
+						break;
+					case flat_kind::unary_operator:
+						compile( tree, node.a );
+						emit( node.op == '%' ? op_code::percent : op_code::negate );
+						break;
+					case flat_kind::number:
+						compile_number( tree.text( node ) );
+						break;
+					case flat_kind::string:
+						constant( formula_value::from_string( tree.text( node ).to_string( ) ) );
+						break;
+					case flat_kind::boolean:
+						constant( formula_value::from_boolean( node.op != 0 ) );
+						break;
+					case flat_kind::cell:
+						compile_cell( tree.address( node ), static_cast<uint8_t>( node.op ) );
+						break;
+					case flat_kind::range: {
+							auto const rng = tree.range( node );
+							compile_range( rng.first, rng.last, static_cast<uint8_t>( node.op ) );
+							break;
+						}
+					case flat_kind::function:
+						compile_function( tree.text( node ), node.d, [&]( size_t n ) {
+							compile( tree, tree.argument( node, static_cast<uint32_t>( n ) ) );
+						} );
+						break;
+					default:
+						throw daw::parser::ParserException{ };
+					}
+				}
+			};	// compiler
+		}	// namespace anonymous
+
+		formula_program compile_formula( ast::expression const & expression ) {
+			formula_program result{ };
+			compiler{ result }.compile( expression );
+			return result;
+		}
+
+		formula_program compile_formula( flat_ast const & tree, flat_ast::index_t root ) {
+			formula_program result{ };
+			compiler{ result }.compile( tree, root );
+			return result;
+		}
+
+		namespace impl {
+			formula_value to_number( formula_value const & value ) {
+				switch( value.kind ) {
+				case formula_value::kind_t::number: return value;
+				case formula_value::kind_t::empty: return formula_value::from_number( 0 );
+				case formula_value::kind_t::boolean: return formula_value::from_number( value.boolean ? 1 : 0 );
+				case formula_value::kind_t::string: {
+						auto first = value.text.find_first_not_of( " \t" );
+						auto last = value.text.find_last_not_of( " \t" );
+						if( first == std::string::npos ) {
+							return formula_value::from_error( formula_error::value );
+						}
+						auto const text_first = value.text.data( ) + first;
+						auto const text_last = value.text.data( ) + last + 1;
+						number::big_num_t result{ };
+						auto const parsed = number::from_chars( text_first, text_last, result );
+						if( parsed.ec != std::errc{ } || parsed.ptr != text_last ) {
+							return formula_value::from_error( formula_error::value );
+						}
+						return formula_value::from_number( std::move( result ) );
+					}
+				case formula_value::kind_t::error: return value;
+				case formula_value::kind_t::range:
+				default: return formula_value::from_error( formula_error::value );
+				}
+			}
+
+			bool is_true( formula_value const & value, formula_error & error ) {
+				switch( value.kind ) {
+				case formula_value::kind_t::boolean: return value.boolean;
+				case formula_value::kind_t::number: return value.number != number::big_num_t{ 0 };
+				case formula_value::kind_t::empty: return false;
+				case formula_value::kind_t::string:
+					if( equal_nc( value.text, "TRUE" ) ) {
+						return true;
+					}
+					if( !equal_nc( value.text, "FALSE" ) ) {
+						error = formula_error::value;
+					}
+					return false;
+				case formula_value::kind_t::error:
+					error = value.error;
+					return false;
+				case formula_value::kind_t::range:
+				default:
+					error = formula_error::value;
+					return false;
+				}
+			}
+
+			formula_value apply_unary( op_code code, formula_value const & value ) {
+				auto result = to_number( value );
+				if( result.is_error( ) ) {
+					return result;
+				}
+				if( code == op_code::percent ) {
+					result.number /= number::big_num_t{ 100 };
+				} else {
+					result.number = number::big_num_t{ 0 } - result.number;
+				}
+				return result;
+			}
+
+			namespace {
+				// Arithmetic on value_t yields nan and inf instead of failing
+				bool is_finite( number::big_num_t::value_t const & value ) {
+					return static_cast<bool>( boost::multiprecision::isfinite( value ) );
+				}
+
+				// Orders values of different kinds as number < string < boolean, empty
+				// compares as the other operand's zero value
+				int compare( formula_value const & lhs, formula_value const & rhs ) {
+					using kind_t = formula_value::kind_t;
+					auto const rank = []( kind_t kind ) {
+						switch( kind ) {
+						case kind_t::number: return 0;
+						case kind_t::string: return 1;
+						case kind_t::boolean: return 2;
+						default: return 3;
+						}
+					};
+					auto l_kind = lhs.kind == kind_t::empty ? rhs.kind : lhs.kind;
+					auto r_kind = rhs.kind == kind_t::empty ? lhs.kind : rhs.kind;
+					if( l_kind != r_kind ) {
+						return rank( l_kind ) < rank( r_kind ) ? -1 : 1;
+					}
+					switch( l_kind ) {
+					case kind_t::number: {
+							auto const l = to_number( lhs ).number;
+							auto const r = to_number( rhs ).number;
+							return l < r ? -1 : (r < l ? 1 : 0);
+						}
+					case kind_t::string:
+						return compare_nc( lhs.text, rhs.text );
+					case kind_t::boolean:
+						return static_cast<int>( lhs.boolean ) - static_cast<int>( rhs.boolean );
+					default:
+						return 0;
+					}
+				}
+			}	// namespace anonymous
+
+			formula_value apply_binary( op_code code, formula_value const & lhs, formula_value const & rhs ) {
+				if( lhs.is_error( ) ) {
+					return lhs;
+				}
+				if( rhs.is_error( ) ) {
+					return rhs;
+				}
+				if( lhs.kind == formula_value::kind_t::range || rhs.kind == formula_value::kind_t::range ) {
+					return formula_value::from_error( formula_error::value );
+				}
+				switch( code ) {
+				case op_code::less: return formula_value::from_boolean( compare( lhs, rhs ) < 0 );
+				case op_code::greater: return formula_value::from_boolean( compare( lhs, rhs ) > 0 );
+				case op_code::equal: return formula_value::from_boolean( compare( lhs, rhs ) == 0 );
+				case op_code::logical_and:
+				case op_code::logical_or: {
+						auto error = formula_error::none;
+						auto const l = is_true( lhs, error );
+						auto const r = is_true( rhs, error );
+						if( error != formula_error::none ) {
+							return formula_value::from_error( error );
+						}
+						return formula_value::from_boolean( code == op_code::logical_and ? (l && r) : (l || r) );
+					}
+				default:
+					break;
+				}
+				auto result = to_number( lhs );
+				auto const r = to_number( rhs );
+				if( result.is_error( ) ) {
+					return result;
+				}
+				if( r.is_error( ) ) {
+					return r;
+				}
+				switch( code ) {
+				case op_code::add:
+					result.number += r.number;
+					break;
+				case op_code::subtract:
+					result.number -= r.number;
+					break;
+				case op_code::multiply:
+					result.number *= r.number;
+					break;
+				case op_code::divide:
+					if( r.number == number::big_num_t{ 0 } ) {
+						return formula_value::from_error( formula_error::div_zero );
+					}
+					result.number /= r.number;
+					break;
+				case op_code::modulus: {
+						if( r.number == number::big_num_t{ 0 } ) {
+							return formula_value::from_error( formula_error::div_zero );
+						}
+						auto remainder = boost::multiprecision::fmod( result.number.big_value( ), r.number.big_value( ) );
+						if( !is_finite( remainder ) ) {
+							return formula_value::from_error( formula_error::num );
+						}
+						result.number = number::big_num_t{ std::move( remainder ) };
+						break;
+					}
+				case op_code::power: {
+						if( result.number == number::big_num_t{ 0 } && r.number < number::big_num_t{ 0 } ) {
+							return formula_value::from_error( formula_error::div_zero );
+						}
+						auto raised = boost::multiprecision::pow( result.number.big_value( ), r.number.big_value( ) );
+						if( !is_finite( raised ) ) {
+							return formula_value::from_error( formula_error::num );
+						}
+						result.number = number::big_num_t{ std::move( raised ) };
+						break;
+					}
+				default:
+					return formula_value::from_error( formula_error::value );
+				}
+				if( !result.number.is_small( ) && !is_finite( result.number.big_value( ) ) ) {
+					return formula_value::from_error( formula_error::num );
+				}
+				return result;
+			}
+
+			aggregate_state::aggregate_state( formula_function func ):
+					function{ func },
+					error{ formula_error::none },
+					total{ 0 },
+					count{ 0 },
+					has_value{ false },
+					flag{ func == formula_function::logical_and } { }
+
+			void aggregate_state::add( formula_value const & value, bool from_range ) {
+				if( error != formula_error::none ) {
+					return;
+				}
+				if( value.is_error( ) ) {
+					error = value.error;
+					return;
+				}
+				switch( function ) {
+				case formula_function::count:
+					if( value.kind == formula_value::kind_t::number ) {
+						++count;
+					}
+					return;
+				case formula_function::logical_and:
+				case formula_function::logical_or:
+				case formula_function::logical_not: {
+						if( from_range && value.kind != formula_value::kind_t::boolean && value.kind != formula_value::kind_t::number ) {
+							return;
+						}
+						auto const b = is_true( value, error );
+						if( function == formula_function::logical_and ) {
+							flag = flag && b;
+						} else if( function == formula_function::logical_or ) {
+							flag = flag || b;
+						} else {
+							flag = !b;
+						}
+						++count;
+						return;
+					}
+				default:
+					break;
+				}
+				if( from_range && value.kind != formula_value::kind_t::number ) {
+					return;
+				}
+				auto const num = to_number( value );
+				if( num.is_error( ) ) {
+					error = num.error;
+					return;
+				}
+				switch( function ) {
+				case formula_function::sum:
+				case formula_function::average:
+					total += num.number;
+					break;
+				case formula_function::min:
+					if( !has_value || num.number < total ) {
+						total = num.number;
+					}
+					break;
+				case formula_function::max:
+					if( !has_value || total < num.number ) {
+						total = num.number;
+					}
+					break;
+				case formula_function::abs:
+					total = num.number < number::big_num_t{ 0 } ? number::big_num_t{ 0 } - num.number : num.number;
+					break;
+				default:
+					break;
+				}
+				has_value = true;
+				++count;
+			}
+
+			formula_value aggregate_state::finish( ) const {
+				if( error != formula_error::none ) {
+					return formula_value::from_error( error );
+				}
+				switch( function ) {
+				case formula_function::count:
+					return formula_value::from_number( count );
+				case formula_function::average:
+					if( count == 0 ) {
+						return formula_value::from_error( formula_error::div_zero );
+					}
+					return formula_value::from_number( total / number::big_num_t{ count } );
+				case formula_function::abs:
+					if( count != 1 ) {
+						return formula_value::from_error( formula_error::value );
+					}
+					return formula_value::from_number( total );
+				case formula_function::logical_and:
+				case formula_function::logical_or:
+				case formula_function::logical_not:
+					if( count == 0 || (function == formula_function::logical_not && count != 1) ) {
+						return formula_value::from_error( formula_error::value );
+					}
+					return formula_value::from_boolean( flag );
+				case formula_function::sum:
+				case formula_function::min:
+				case formula_function::max:
+				default:
+					return formula_value::from_number( total );
+				}
+			}
+
+			int compare_lookup( formula_value const & lhs, formula_value const & rhs ) {
+				if( lhs.kind != rhs.kind || !is_lookup_key( lhs ) ) {
+					return lookup_unordered;
+				}
+				switch( lhs.kind ) {
+				case formula_value::kind_t::number: {
+						auto const order = lhs.number.compare( rhs.number );
+						return order < 0 ? -1 : (order > 0 ? 1 : 0);
+					}
+				case formula_value::kind_t::string:
+					return compare_nc( lhs.text, rhs.text );
+				default:
+					return static_cast<int>( lhs.boolean ) - static_cast<int>( rhs.boolean );
+				}
+			}
+
+			bool is_lookup_key( formula_value const & value ) noexcept {
+				return value.kind == formula_value::kind_t::number || value.kind == formula_value::kind_t::string || value.kind == formula_value::kind_t::boolean;
+			}
+
+			uint64_t lookup_hash( formula_value const & value ) {
+				// FNV-1a over the number's shortest text or the upper cased text, seeded by kind
+				uint64_t result = 0xCBF29CE484222325ull ^ static_cast<uint64_t>( value.kind );
+				auto const add = [&result]( char c ) {
+					result = (result ^ static_cast<unsigned char>( c )) * 0x100000001B3ull;
+				};
+				switch( value.kind ) {
+				case formula_value::kind_t::number: {
+						char buffer[128];
+						auto const written = number::to_chars( buffer, buffer + sizeof( buffer ), value.number );
+						if( written.ec == std::errc{ } ) {
+							std::for_each( buffer, written.ptr, add );
+						} else {
+							auto const text = number::to_string( value.number );
+							std::for_each( text.begin( ), text.end( ), add );
+						}
+						break;
+					}
+				case formula_value::kind_t::string:
+					for( auto c: value.text ) {
+						add( static_cast<char>( std::toupper( static_cast<unsigned char>( c ) ) ) );
+					}
+					break;
+				case formula_value::kind_t::boolean:
+					add( value.boolean ? '1' : '0' );
+					break;
+				default:
+					break;
+				}
+				return result;
+			}
+
+			bool better_match( formula_value const & value, formula_value const & best, int match_type ) {
+				auto const order = compare_lookup( value, best );
+				return match_type > 0 ? order >= 0 : order < 0;
+			}
+
+			bool is_lookup( formula_function function ) noexcept {
+				return function == formula_function::match || function == formula_function::vlookup;
+			}
+
+			lookup_arguments check_lookup( formula_function function, formula_value const * args, size_t argc ) {
+				lookup_arguments result{ formula_error::none, 1, 1 };
+				auto const is_match = function == formula_function::match;
+				if( argc < (is_match ? 2u : 3u) || argc > (is_match ? 3u : 4u) ) {
+					result.error = formula_error::value;
+					return result;
+				}
+				if( args[0].is_error( ) ) {
+					result.error = args[0].error;
+					return result;
+				}
+				if( args[1].kind != formula_value::kind_t::range ) {
+					result.error = args[1].is_error( ) ? args[1].error : formula_error::na;
+					return result;
+				}
+				if( is_match ) {
+					if( argc == 3 ) {
+						auto const type = to_number( args[2] );
+						if( type.is_error( ) ) {
+							result.error = type.error;
+							return result;
+						}
+						auto const sign = type.number.compare( number::big_num_t{ 0 } );
+						result.match_type = sign < 0 ? -1 : (sign > 0 ? 1 : 0);
+					}
+					return result;
+				}
+				auto const column = to_number( args[2] );
+				if( column.is_error( ) ) {
+					result.error = column.error;
+					return result;
+				}
+				if( column.number < number::big_num_t{ 1 } ) {
+					result.error = formula_error::value;
+					return result;
+				}
+				result.column = std::numeric_limits<size_t>::max( );
+				if( column.number.is_small( ) ) {
+					auto whole = column.number.mantissa( );
+					for( auto n = column.number.scale( ); n > 0; --n ) {
+						whole /= 10;
+					}
+					result.column = static_cast<size_t>( whole );
+				}
+				if( argc == 4 ) {
+					auto error = formula_error::none;
+					auto const approximate = is_true( args[3], error );
+					if( error != formula_error::none ) {
+						result.error = error;
+						return result;
+					}
+					result.match_type = approximate ? 1 : 0;
+				}
+				return result;
+			}
+		}	// namespace impl
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -24,25 +24,20 @@
 #include <daw/daw_parser_addons.h>
 #include <unordered_map>
 
+#include "formula_cache.h"
+#include "formula_vm.h"
 #include "impl_cell_value.h"
+#include "value_classifier.h"
 
 
 namespace daw {
 	namespace spreadsheet {
 		namespace impl {
-			void cell_value::link_values( ) {
-				link_streamable( "value_type", m_value_type );
-				link_string( "string_value", m_string_value );
-			}
-
-			cell_value::cell_value( daw::nodepp::base::EventEmitter emitter, cell_value::expected_value_t value_type, std::string string_value, cell_value::eval_func_t eval_func ):
-					table_item{ std::move( emitter ) },
+			cell_value::cell_value( daw::nodepp::base::EventEmitter emitter, cell_value::expected_value_t value_type, std::string string_value, cell_value::eval_func_t eval_func, std::shared_ptr<event_table> events ):
+					table_item{ std::move( emitter ), std::move( events ) },
 					m_value_type{ value_type },
 					m_string_value{ std::move( string_value ) },
-					m_evaluated{ std::move( eval_func ) } {
-
-				link_values( );
-			}
+					m_evaluated{ std::move( eval_func ) } { }
 
 			cell_value::cell_value( ):
 					cell_value{ daw::nodepp::base::create_event_emitter( ) } { }
@@ -51,19 +46,13 @@ namespace daw {
 					table_item{ other },
 					m_value_type{ other.m_value_type },
 					m_string_value{ other.m_string_value },
-					m_evaluated{ nullptr } {
-
-				link_values( );
-			}
+					m_evaluated{ other.m_evaluated } { }
 
 			cell_value::cell_value( cell_value && other ):
 					table_item{ std::move( other ) },
 					m_value_type{ std::exchange( other.m_value_type, expected_value_t::General ) },
 					m_string_value{ std::exchange( other.m_string_value, "" ) },
-					m_evaluated{ std::exchange( other.m_evaluated, nullptr ) } {
-
-				link_values( );
-			}
+					m_evaluated{ std::exchange( other.m_evaluated, nullptr ) } { }
 
 			cell_value & cell_value::operator=( cell_value const & rhs ) {
 				if( this != &rhs ) {
@@ -91,62 +80,91 @@ namespace daw {
 				lhs.m_evaluated.swap( rhs.m_evaluated );
 			}
 
-			cell_value::~cell_value( ) {
-				try {
-					std::string event_id = id( ) + "_data_updated";
-					this->emitter( )->remove_all_listeners( event_id );
-				} catch( ... ) {
-					// I don't think I should care
-				}
+			std::string cell_value::encode( ) const {
+				return to_json( *this );
 			}
 
-			void cell_value::on_data_updated( std::function<void( std::string )> cb ) {
-				std::string message = id( ) + "_data_updated";
-				this->emitter( )->on( message, cb );
+			void cell_value::decode( boost::string_ref json_text ) {
+				from_json( json_text, *this );
 			}
 
-			void cell_value::emit_data_updated( ) {
-				std::string message = id( ) + "_data_updated";
-				this->emitter( )->emit( message );
+			// table_item removes this cell's listeners
+			cell_value::~cell_value( ) { }
+
+			void cell_value::on_data_updated( std::function<void( id_t )> cb ) {
+				events( )->on( id( ), item_event::data_updated, std::move( cb ) );
 			}
 
-			template<typename ForwardIterator>
-			boost::optional<daw::spreadsheet::number::big_num_t> try_numeric( ForwardIterator first, ForwardIterator last ) {
-				try {
-					return daw::spreadsheet::number::big_num_t{ first };
-				} catch( std::exception const & ) {
-					return boost::optional<daw::spreadsheet::number::big_num_t>{ };
-				}
+			void cell_value::emit_data_updated( ) {
+				events( )->emit( id( ), item_event::data_updated );
 			}
 
-			template<typename ForwardIterator>
-				cell_value::cell_variant_t to_variant( ForwardIterator first, ForwardIterator last ) {
-					auto result = daw::parser::find_number( first, last );
-					if( result ) {
-						auto opt_num = try_numeric( result.first, result.last );
-						assert( opt_num );
-						return cell_value::cell_variant_t{ }.store( *opt_num );
+			namespace {
+				/// Resolves references for a cell that does not belong to a sheet
+				struct detached_resolver {
+					formula_value value( cell_address const & ) const {
+						return formula_value::from_error( formula_error::ref );
 					}
-					return cell_value::cell_variant_t{ daw::parser::make_find_result( first, last ).as_string( ) };
+
+					template<typename Function>
+					void for_each_value( cell_range const &, Function func ) const {
+						func( formula_value::from_error( formula_error::ref ) );
+					}
+				};	// detached_resolver
+
+				/// Formulas of cells outside of a sheet, shared by all of them
+				formula_cache & detached_formulas( ) {
+					static formula_cache s_formulas;
+					return s_formulas;
 				}
+			}	// namespace anonymous
 
 			cell_value::eval_func_t cell_value::eval( boost::string_ref cell_value ) {
 				auto rng = daw::parser::trim( cell_value.begin( ), cell_value.end( ) );
-				if( !daw::parser::is_a( *rng.first, '=' ) ) {
-					// Evaluation needed
-					return std::function<cell_variant_t( )>( );
+				if( rng.first != rng.last && daw::parser::is_a( *rng.first, '=' ) ) {
+					// A formula, compiled once per shape and shared by every cell and copy
+					// holding it
+					auto formula = detached_formulas( ).get( boost::string_ref{ rng.first, static_cast<size_t>( std::distance( rng.first, rng.last ) ) }, cell_address{ } );
+					if( !formula->parsed( ) ) {
+						auto error = cell_variant_t{ }.store( to_string( formula_error::value ) );
+						return [error = std::move( error )]( ) {
+							return error;
+						};
+					}
+					return [formula]( ) {
+						return daw::spreadsheet::to_variant( formula->evaluate( cell_address{ }, detached_resolver{ } ) );
+					};
 				}
 				// A value
-				auto result = to_variant( rng.first, rng.last );
+				auto result = daw::spreadsheet::to_variant( classify_value( boost::string_ref{ rng.first, static_cast<size_t>( std::distance( rng.first, rng.last ) ) } ) );
 				return [res = std::move( result )]() {
 					return res;
 				};
 			}
 
+			void cell_value::set_value( boost::string_ref value ) {
+				m_string_value.assign( value.begin( ), value.end( ) );
+				m_evaluated = eval( m_string_value );
+				// Deferred and coalesced while the event table is batching
+				emit_data_updated( );
+			}
+
 			bool cell_value::empty( ) const {
 				return m_string_value.empty( );
 			}
 
+			cell_value::expected_value_t & cell_value::value_type( ) {
+				return m_value_type;
+			}
+
+			cell_value::expected_value_t const & cell_value::value_type( ) const {
+				return m_value_type;
+			}
+
+			std::string const & cell_value::string_value( ) const {
+				return m_string_value;
+			}
+
 			cell_value::expected_value_t expected_value_from_string( boost::string_ref value_type ) {
 				static std::unordered_map<std::string, cell_value::expected_value_t> const val_map = {
 						{ "Boolean", cell_value::expected_value_t::Boolean },
@@ -182,53 +200,40 @@ namespace daw {
 				expected_value = expected_value_from_string( val );
 				return is;
 			}
+		}    // namespace impl
 
-			column::column( daw::nodepp::base::EventEmitter emitter ):
-					table_item{ std::move( emitter ) },
-					m_values{ } {
-
-
-				link_array( "values", m_values );
-			}
-
-			column::column( column const & other ):
-					table_item{ other },
-					m_values{ other.m_values } {
-
-				link_array( "values", m_values );
-			}
-
-			column::column( column && other ):
-					table_item{ std::move( other ) },
-					m_values{ std::move( other.m_values ) } {
-
-				link_array( "values", m_values );
-			}
-
-			column & column::operator=( column const & rhs ) {
-				if( this != &rhs ) {
-					column tmp{ rhs };
-					using std::swap;
-					swap( *this, tmp );
-				}
-				return *this;
-			}
-
-			column & column::operator=( column && rhs ) {
-				if( this != &rhs ) {
-					column tmp{ std::move( rhs ) };
-					using std::swap;
-					swap( *this, tmp );
+		void json_schema<impl::cell_value>::decoded( impl::cell_value & value ) {
+			value.m_evaluated = value.eval( value.m_string_value );
+		}
+
+		namespace {
+			// Names in expected_value_t order, to_string's map without the lookup
+			constexpr char const * const s_value_type_names[] = { "General", "Text", "Number", "Timestamp", "Time", "Boolean" };
+			constexpr size_t s_value_type_count = sizeof( s_value_type_names ) / sizeof( s_value_type_names[0] );
+		}	// namespace anonymous
+
+		void json_value<impl::cell_value::expected_value_t>::encode( std::string & out, impl::cell_value::expected_value_t value ) {
+			auto const index = static_cast<size_t>( value );
+			if( index >= s_value_type_count ) {
+				append_json_string( out, impl::to_string( value ) );
+				return;
+			}
+			out += '"';
+			out += s_value_type_names[index];
+			out += '"';
+		}
+
+		void json_value<impl::cell_value::expected_value_t>::decode( json_reader & reader, impl::cell_value::expected_value_t & value ) {
+			static thread_local std::string s_name;
+			reader.read_string( s_name );
+			for( size_t n = 0; n < s_value_type_count; ++n ) {
+				if( s_name == s_value_type_names[n] ) {
+					value = static_cast<impl::cell_value::expected_value_t>( n );
+					return;
 				}
-				return *this;
-			}
-
-			void swap( column & lhs, column & rhs ) {
-				using std::swap;
-				swap( static_cast<table_item &>(lhs), static_cast<table_item &>(rhs) );
-				lhs.m_values.swap( rhs.m_values );
 			}
-		}    // namespace impl
+			value = impl::expected_value_from_string( s_name );
+		}
 	}    // namespace spreadsheet
 }    // namespace daw
 
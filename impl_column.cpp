@@ -0,0 +1,206 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdexcept>
+#include <utility>
+
+#include "impl_column.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace impl {
+			column::column( daw::nodepp::base::EventEmitter emitter, std::shared_ptr<event_table> events ):
+					table_item{ std::move( emitter ), std::move( events ) },
+					m_store{ } { }
+
+			column::column( column const & other ):
+					table_item{ other },
+					m_store{ other.m_store } { }
+
+			column::column( column && other ):
+					table_item{ std::move( other ) },
+					m_store{ std::move( other.m_store ) } { }
+
+			column & column::operator=( column const & rhs ) {
+				if( this != &rhs ) {
+					column tmp{ rhs };
+					using std::swap;
+					swap( *this, tmp );
+				}
+				return *this;
+			}
+
+			column & column::operator=( column && rhs ) {
+				if( this != &rhs ) {
+					column tmp{ std::move( rhs ) };
+					using std::swap;
+					swap( *this, tmp );
+				}
+				return *this;
+			}
+
+			void swap( column & lhs, column & rhs ) {
+				using std::swap;
+				swap( static_cast<table_item &>(lhs), static_cast<table_item &>(rhs) );
+				lhs.m_store.swap( rhs.m_store );
+			}
+
+			size_t column::size( ) const noexcept {
+				return m_store.size( );
+			}
+
+			bool column::empty( ) const noexcept {
+				return m_store.empty( );
+			}
+
+			cell_view column::operator[]( size_t row ) const {
+				return m_store[row];
+			}
+
+			void column::push_back( cell_value::expected_value_t value_type, boost::string_ref text ) {
+				m_store.push_back( value_type, text );
+			}
+
+			void column::push_back( cell_data const & value ) {
+				m_store.push_back( value.value_type, value.string_value );
+			}
+
+			void column::set_value( size_t row, boost::string_ref text ) {
+				m_store.set_value( row, text );
+				emit_updated( );
+			}
+
+			void column::set( size_t row, cell_value::expected_value_t value_type, boost::string_ref text ) {
+				m_store.set( row, value_type, text );
+				emit_updated( );
+			}
+
+			cell_data column::cell( size_t row ) const {
+				return cell_data{ m_store.value_type( row ), m_store.string_value( row ).to_string( ) };
+			}
+
+			column_store & column::store( ) noexcept {
+				return m_store;
+			}
+
+			column_store const & column::store( ) const noexcept {
+				return m_store;
+			}
+
+			std::string column::encode( ) const {
+				std::string result;
+				result.reserve( 32 + m_store.size( ) * 48 );
+				result += "{\"id\":";
+				append_json_integer( result, id( ) );
+				result += ",\"values\":[";
+				for( size_t row = 0; row < m_store.size( ); ++row ) {
+					if( row > 0 ) {
+						result += ',';
+					}
+					append_json( result, m_store.value_type( row ), m_store.string_value( row ) );
+				}
+				result += "]}";
+				return result;
+			}
+
+			void column::decode( boost::string_ref json_text ) {
+				json_reader reader{ json_text };
+				column_store store{ m_store.pool( ) };
+				std::string name;
+				// One cell is reused so decoding does not allocate per row
+				cell_data value;
+				reader.expect( '{' );
+				for( bool first = true; reader.more( '}', first ); ) {
+					reader.read_string( name );
+					reader.expect( ':' );
+					if( name != "values" ) {
+						reader.skip_value( );
+						continue;
+					}
+					reader.expect( '[' );
+					for( bool first_value = true; reader.more( ']', first_value ); ) {
+						impl::decode( reader, value );
+						store.push_back( value.value_type, value.string_value );
+					}
+				}
+				m_store.swap( store );
+			}
+
+			void column::write( json_writer & out ) const {
+				out.begin_object( );
+				out.key( "id" );
+				out.value( id( ) );
+				out.key( "values" );
+				out.begin_array( );
+				for( size_t row = 0; row < m_store.size( ); ++row ) {
+					append_json( out.value_buffer( ), m_store.value_type( row ), m_store.string_value( row ) );
+				}
+				out.end_array( );
+				out.end_object( );
+			}
+
+			void column::read( json_pull_reader & in, json_pull_reader::token current ) {
+				auto store = read_store( in, current, m_store.pool( ) );
+				m_store.swap( store );
+			}
+
+			column_store column::read_store( json_pull_reader & in, json_pull_reader::token current, std::shared_ptr<string_pool> pool ) {
+				using token = json_pull_reader::token;
+				auto const require = []( bool condition ) {
+					if( !condition ) {
+						throw std::invalid_argument{ "Unexpected JSON token in column" };
+					}
+				};
+				require( current == token::begin_object );
+				column_store store{ std::move( pool ) };
+				std::string text;
+				for( auto member = in.next( ); member != token::end_object; member = in.next( ) ) {
+					require( member == token::key );
+					if( in.text( ) != "values" ) {
+						in.skip_value( );
+						continue;
+					}
+					in.expect( token::begin_array );
+					for( auto value = in.next( ); value != token::end_array; value = in.next( ) ) {
+						require( value == token::begin_object );
+						auto value_type = cell_value::expected_value_t::General;
+						text.clear( );
+						for( auto field = in.next( ); field != token::end_object; field = in.next( ) ) {
+							require( field == token::key );
+							if( in.text( ) == "value_type" ) {
+								in.expect( token::string );
+								value_type = expected_value_from_string( in.text( ) );
+							} else if( in.text( ) == "string_value" ) {
+								in.expect( token::string );
+								text = in.text( );
+							} else {
+								in.skip_value( );
+							}
+						}
+						store.push_back( value_type, text );
+					}
+				}
+				return store;
+			}
+		}	// namespace impl
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -20,44 +20,118 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+
 #pragma once
 
 #include <boost/multiprecision/cpp_dec_float.hpp>
+#include <cstdint>
 #include <istream>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <system_error>
+#include <type_traits>
 
 namespace daw {
 	namespace spreadsheet {
 		namespace number {
+			/// @brief A decimal number.  Values that fit in an int64_t mantissa with up to 18
+			/// decimal places are kept inline and use integer arithmetic.  Anything else, or
+			/// any result that would overflow or lose precision, is promoted to value_t so
+			/// results are those of value_t
 			struct big_num_t {
 				using value_t = boost::multiprecision::cpp_dec_float_50;
-				value_t value;
+				static constexpr uint8_t max_scale = 18;
+			private:
+				int64_t m_mantissa;
+				uint8_t m_scale;
+				std::unique_ptr<value_t> m_big;
 
-				template<typename... Args>
-					big_num_t( Args && ... args ):
-							value{ std::forward<Args>( args )... } { }
+				void assign_integer( int64_t value ) noexcept;
+				void assign_unsigned( uint64_t value );
+				void assign_string( char const * first, char const * last );
+				void assign_big( value_t value );
+				void normalize( ) noexcept;
+			public:
+				big_num_t( ) noexcept;
 
-				~big_num_t( );
+				template<typename Integer, std::enable_if_t<std::is_integral<Integer>::value && std::is_signed<Integer>::value, int> = 0>
+					big_num_t( Integer value ) noexcept:
+							big_num_t{ } {
+
+						assign_integer( static_cast<int64_t>( value ) );
+					}
 
-				big_num_t( big_num_t const & ) = default;
+				template<typename Integer, std::enable_if_t<std::is_integral<Integer>::value && std::is_unsigned<Integer>::value, int> = 0>
+					big_num_t( Integer value ):
+							big_num_t{ } {
 
-				big_num_t( big_num_t && ) = default;
+						assign_unsigned( static_cast<uint64_t>( value ) );
+					}
 
-				big_num_t & operator=( big_num_t const & ) = default;
+				/// @throws std::exception when str is not a number, as value_t does
+				big_num_t( char const * str );
+				big_num_t( std::string const & str );
+				big_num_t( double value );
+				big_num_t( value_t value );
+
+				~big_num_t( );
 
-				big_num_t & operator=( big_num_t && ) = default;
+				big_num_t( big_num_t const & other );
+				big_num_t( big_num_t && other ) noexcept;
+				big_num_t & operator=( big_num_t const & rhs );
+				big_num_t & operator=( big_num_t && rhs ) noexcept;
+
+				/// @brief mantissa / 10^scale
+				static big_num_t from_scaled( int64_t mantissa, uint8_t scale );
 
 				void swap( big_num_t & rhs ) noexcept;
-				operator value_t&( );
-				operator value_t const &( ) const;
+
+				/// @brief true when the value is held inline as mantissa( ) / 10^scale( )
+				bool is_small( ) const noexcept;
+				int64_t mantissa( ) const noexcept;
+				uint8_t scale( ) const noexcept;
+
+				/// @brief The value as value_t, exact for inline values
+				value_t big_value( ) const;
+
 				big_num_t & operator+=( big_num_t const & rhs );
 				big_num_t & operator-=( big_num_t const & rhs );
 				big_num_t & operator*=( big_num_t const & rhs );
 				big_num_t & operator/=( big_num_t const & rhs );
+
+				/// @return <0, 0 or >0 as this is less than, equal to or greater than rhs
+				int compare( big_num_t const & rhs ) const;
 			};    // big_num_t
 
 			void swap( big_num_t & lhs, big_num_t & rhs ) noexcept;
+
+			struct to_chars_result {
+				char * ptr;
+				std::errc ec;
+			};	// to_chars_result
+
+			struct from_chars_result {
+				char const * ptr;
+				std::errc ec;
+			};	// from_chars_result
+
+			/// Enough room for any value that is_small( )
+			constexpr size_t max_small_chars = 32;
+
+			/// @brief Write value into [first, last) without allocating when it is_small( ).
+			/// Inline values use the fewest digits that parse back to the same value, others
+			/// the fewest that parse back to the same value rounded to value_t's digits10
+			/// @return one past the last character written, or errc::value_too_large
+			to_chars_result to_chars( char * first, char * last, big_num_t const & value );
+
+			/// @brief Parse the longest number at the start of [first, last) without throwing
+			/// and, for values that fit inline, without allocating
+			from_chars_result from_chars( char const * first, char const * last, big_num_t & value );
+
+			/// @brief Append value to out, as to_chars would write it
+			void append_to( std::string & out, big_num_t const & value );
+
 			big_num_t operator+( big_num_t lhs, big_num_t const & rhs );
 			big_num_t operator-( big_num_t lhs, big_num_t const & rhs );
 			big_num_t operator*( big_num_t lhs, big_num_t const & rhs );
@@ -74,4 +148,3 @@ namespace daw {
 		}	// namespace number
 	}	// namespace spreadsheet
 }	// namespace daw
-
@@ -0,0 +1,127 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace daw {
+	namespace spreadsheet {
+		/// Zero based row/column position of a cell within a sheet
+		struct cell_address {
+			using index_t = uint32_t;
+			index_t row;
+			index_t column;
+
+			constexpr cell_address( ) noexcept:
+					row{ 0 },
+					column{ 0 } { }
+
+			constexpr cell_address( index_t row_index, index_t column_index ) noexcept:
+					row{ row_index },
+					column{ column_index } { }
+
+			/// @return row and column packed into a single integer, ordered row major
+			constexpr uint64_t key( ) const noexcept {
+				return (static_cast<uint64_t>( row ) << 32) | static_cast<uint64_t>( column );
+			}
+
+			static constexpr cell_address from_key( uint64_t key ) noexcept {
+				return cell_address{ static_cast<index_t>( key >> 32 ), static_cast<index_t>( key & 0xFFFFFFFFu ) };
+			}
+		};	// cell_address
+
+		constexpr bool operator==( cell_address const & lhs, cell_address const & rhs ) noexcept {
+			return lhs.key( ) == rhs.key( );
+		}
+
+		constexpr bool operator!=( cell_address const & lhs, cell_address const & rhs ) noexcept {
+			return lhs.key( ) != rhs.key( );
+		}
+
+		constexpr bool operator<( cell_address const & lhs, cell_address const & rhs ) noexcept {
+			return lhs.key( ) < rhs.key( );
+		}
+
+		/// Parts of a reference written with $.  Anchored parts stay put when a formula is
+		/// filled or copied, the others move with it
+		enum reference_anchor: uint8_t { anchor_none = 0, anchor_row = 1, anchor_column = 2 };
+
+		/// @brief Where a reference written in cell from points when the formula is copied to to.
+		/// Offsets wrap around as unsigned values, so moves up and left are exact
+		constexpr cell_address move_reference( cell_address const & address, uint8_t anchors, cell_address const & from, cell_address const & to ) noexcept {
+			return cell_address{
+					(anchors & anchor_row) != 0 ? address.row : static_cast<cell_address::index_t>( address.row - from.row + to.row ),
+					(anchors & anchor_column) != 0 ? address.column : static_cast<cell_address::index_t>( address.column - from.column + to.column ) };
+		}
+
+		/// Inclusive rectangle of cells from first( top left ) to last( bottom right )
+		struct cell_range {
+			cell_address first;
+			cell_address last;
+
+			constexpr cell_range( ) noexcept:
+					first{ },
+					last{ } { }
+
+			constexpr cell_range( cell_address top_left, cell_address bottom_right ) noexcept:
+					first{ top_left },
+					last{ bottom_right } { }
+
+			constexpr bool contains( cell_address const & address ) const noexcept {
+				return address.row >= first.row && address.row <= last.row && address.column >= first.column && address.column <= last.column;
+			}
+
+			constexpr uint64_t size( ) const noexcept {
+				return (static_cast<uint64_t>( last.row - first.row ) + 1) * (static_cast<uint64_t>( last.column - first.column ) + 1);
+			}
+		};	// cell_range
+
+		constexpr bool operator==( cell_range const & lhs, cell_range const & rhs ) noexcept {
+			return lhs.first == rhs.first && lhs.last == rhs.last;
+		}
+
+		constexpr bool operator!=( cell_range const & lhs, cell_range const & rhs ) noexcept {
+			return !(lhs == rhs);
+		}
+
+		/// @brief move_reference for a range, anchors holds the bits of first | last << 2.  A
+		/// range with one anchored side can turn over, so the corners are sorted again
+		constexpr cell_range move_reference( cell_range const & range, uint8_t anchors, cell_address const & from, cell_address const & to ) noexcept {
+			auto const first = move_reference( range.first, static_cast<uint8_t>( anchors & 3 ), from, to );
+			auto const last = move_reference( range.last, static_cast<uint8_t>( anchors >> 2 ), from, to );
+			return cell_range{
+					cell_address{ first.row < last.row ? first.row : last.row, first.column < last.column ? first.column : last.column },
+					cell_address{ first.row < last.row ? last.row : first.row, first.column < last.column ? last.column : first.column } };
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
+
+namespace std {
+	template<>
+	struct hash<daw::spreadsheet::cell_address> {
+		size_t operator()( daw::spreadsheet::cell_address const & value ) const noexcept {
+			return std::hash<uint64_t>{ }( value.key( ) );
+		}
+	};	// hash
+}
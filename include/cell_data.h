@@ -0,0 +1,68 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <string>
+
+#include "impl_cell_value.h"
+#include "json_schema.h"
+#include "json_text.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace impl {
+			/// A cell as a plain value.  Unlike cell_value it has no id, listeners or JSON link
+			/// table of its own, the column or sheet holding it maps and notifies for all of
+			/// its cells at once
+			struct cell_data {
+				using expected_value_t = cell_value::expected_value_t;
+				expected_value_t value_type;
+				std::string string_value;
+
+				cell_data( );
+				cell_data( expected_value_t type, std::string text );
+
+				bool empty( ) const noexcept;
+			};	// cell_data
+
+			/// @brief Append a cell as the JSON object cell_value encodes to, without the id
+			void append_json( std::string & out, cell_data::expected_value_t value_type, boost::string_ref string_value );
+			std::string encode( cell_data const & value );
+
+			/// @brief Read a cell object.  Members other than value_type and string_value are skipped
+			void decode( json_reader & reader, cell_data & value );
+			cell_data decode_cell( boost::string_ref json_text );
+		}	// namespace impl
+
+		template<>
+		struct json_schema<impl::cell_data> {
+			static constexpr auto members( ) {
+				return std::make_tuple(
+					json_field( "value_type", &impl::cell_data::value_type ),
+					json_field( "string_value", &impl::cell_data::string_value ) );
+			}
+		};	// json_schema<cell_data>
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,59 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cell_address.h"
+
+namespace daw {
+	namespace spreadsheet {
+		/// The cells and items touched by a batch of edits.  Cells are recorded as they
+		/// are changed and coalesce( ) turns them into disjoint rectangles, so pasting a
+		/// block of cells is reported as one range
+		struct change_set {
+			using id_t = size_t;
+			std::vector<cell_range> ranges;
+			std::vector<id_t> ids;
+
+			change_set( );
+
+			void add( cell_address const & cell );
+			void add( cell_range const & range );
+			void add_id( id_t id );
+
+			/// @brief Merge overlapping and adjacent ranges into disjoint rectangles ordered by
+			/// their top left cell and sort the ids, dropping duplicates
+			void coalesce( );
+
+			bool contains( cell_address const & cell ) const noexcept;
+			/// @return number of cells covered by ranges, only exact after coalesce( )
+			uint64_t cell_count( ) const noexcept;
+			bool empty( ) const noexcept;
+			void clear( ) noexcept;
+		};	// change_set
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,195 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "big_num_t.h"
+#include "impl_cell_value.h"
+#include "string_pool.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace impl {
+			class column_store;
+
+			/// A non-owning view of a single row in a column_store.  Cheap to copy and
+			/// only valid while the store it refers to is not modified
+			class cell_view {
+				column_store const * m_store;
+				size_t m_row;
+			public:
+				cell_view( column_store const & store, size_t row ) noexcept;
+
+				size_t row( ) const noexcept;
+				cell_value::expected_value_t value_type( ) const;
+				boost::string_ref string_value( ) const;
+				bool empty( ) const;
+				bool has_value( ) const;
+				cell_value::cell_variant_t to_variant( ) const;
+			};	// cell_view
+
+			/// The valid numbers of a column as int64 mantissas at a common scale, laid out for
+			/// vectorized kernels.  Rows whose number does not fit the lane have a zero value
+			/// and their bit clear in lane_mask but set in number_mask
+			struct numeric_lane {
+				int64_t const * values;
+				uint64_t const * lane_mask;
+				uint64_t const * number_mask;
+				size_t size;
+				uint8_t scale;
+				uint64_t bound;	// No value in the lane has a larger magnitude
+			};	// numeric_lane
+
+			/// Column oriented storage for cell data.  Each row keeps its expected type and
+			/// its source text, inline when short and otherwise as a handle into a
+			/// string_pool the columns of a sheet share.  Rows that
+			/// parse as their expected type additionally have their value kept in a packed
+			/// array for that type and their bit set in the validity bitmap.
+			class column_store {
+			public:
+				using expected_value_t = cell_value::expected_value_t;
+				using number_t = cell_value::number_t;
+				using timestamp_t = cell_value::timestamp_t;
+				using duration_t = cell_value::duration_t;
+				using bool_t = cell_value::bool_t;
+				using cell_variant_t = cell_value::cell_variant_t;
+				using tick_t = int64_t;
+			private:
+				// Per row data
+				std::vector<uint8_t> m_types;
+				// Up to 7 bytes of text are held in the word itself, flagged in its last byte,
+				// longer text is a string_pool handle in its first four bytes
+				std::vector<uint64_t> m_text;
+				std::vector<uint32_t> m_slots;
+				std::vector<uint64_t> m_valid;
+
+				// Created on first use when not given one
+				std::shared_ptr<string_pool> m_pool;
+
+				// Typed chunks, indexed by m_slots[row]
+				std::vector<number_t> m_numbers;
+				std::vector<tick_t> m_timestamps;
+				std::vector<tick_t> m_durations;
+				std::vector<uint64_t> m_booleans;
+				size_t m_boolean_count;
+				size_t m_dead_slots;
+
+				// Numbers repeated in a numeric_lane, indexed by row
+				std::vector<int64_t> m_lane;
+				std::vector<uint64_t> m_lane_mask;
+				std::vector<uint64_t> m_number_mask;
+				uint8_t m_lane_scale;
+				uint64_t m_lane_bound;
+
+				uint64_t append_text( boost::string_ref text );
+				void push_word( expected_value_t value_type, boost::string_ref text, uint64_t word );
+				void update_lane( size_t row );
+				bool rescale_lane( uint8_t scale );
+				bool store_typed( size_t row, expected_value_t value_type, boost::string_ref text );
+				void set_valid( size_t row, bool is_valid );
+			public:
+				column_store( );
+				explicit column_store( std::shared_ptr<string_pool> pool );
+				~column_store( );
+				/// Copies share the pool and hold their own references to the text
+				column_store( column_store const & other );
+				column_store( column_store && other ) noexcept;
+				column_store & operator=( column_store const & rhs );
+				column_store & operator=( column_store && rhs ) noexcept;
+				void swap( column_store & rhs ) noexcept;
+
+				std::shared_ptr<string_pool> const & pool( ) const noexcept;
+				/// @brief Move the text of every row to pool
+				void use_pool( std::shared_ptr<string_pool> pool );
+
+				size_t size( ) const noexcept;
+				bool empty( ) const noexcept;
+				void reserve( size_t rows );
+				void resize( size_t rows );
+				void clear( );
+
+				void push_back( expected_value_t value_type, boost::string_ref text );
+				/// @brief push_back text the caller interned in pool( ), the row takes over one
+				/// reference to handle.  handle is empty_handle for text that is_inline
+				void push_back( expected_value_t value_type, boost::string_ref text, string_pool::handle_t handle );
+				/// @return true when a row holds text itself rather than a string_pool handle
+				static bool is_inline( boost::string_ref text ) noexcept;
+				void set( size_t row, expected_value_t value_type, boost::string_ref text );
+				void set_value( size_t row, boost::string_ref text );
+
+				expected_value_t value_type( size_t row ) const;
+				boost::string_ref string_value( size_t row ) const;
+				/// @brief Compare the text of two rows.  Constant time when the stores share a pool
+				bool same_text( size_t row, column_store const & other, size_t other_row ) const;
+				/// @return true if the row's text was successfully parsed as its expected type
+				bool has_value( size_t row ) const;
+
+				/// @pre has_value( row ) && value_type( row ) == expected_value_t::Number
+				number_t const & number( size_t row ) const;
+				/// @pre has_value( row ) && value_type( row ) == expected_value_t::Timestamp
+				timestamp_t timestamp( size_t row ) const;
+				/// @pre has_value( row ) && value_type( row ) == expected_value_t::Time
+				duration_t duration( size_t row ) const;
+				/// @pre has_value( row ) && value_type( row ) == expected_value_t::Boolean
+				bool_t boolean( size_t row ) const;
+
+				cell_variant_t to_variant( size_t row ) const;
+				cell_view operator[]( size_t row ) const;
+
+				/// Numbers with more decimal places than this are left out of the lane
+				static constexpr uint8_t max_lane_scale = 6;
+				numeric_lane lane( ) const noexcept;
+
+				/// @brief Calls func( row, number ) for every row holding a valid number
+				template<typename Function>
+				void for_each_number( Function func ) const {
+					auto const number_type = static_cast<uint8_t>( expected_value_t::Number );
+					for( size_t row = 0; row < m_types.size( ); ++row ) {
+						if( m_types[row] == number_type && has_value( row ) ) {
+							func( row, m_numbers[m_slots[row]] );
+						}
+					}
+				}
+
+				/// @brief Drop typed slots no longer referenced by any row
+				void compact( );
+
+				/// @brief Reorder the rows so row n holds what row order[n] held.  Text handles,
+				/// typed slots and lane values move with their rows, nothing is parsed or interned
+				/// @pre order is a permutation of [0, size( ))
+				void permute( std::vector<uint32_t> const & order );
+
+				/// @return Approximate number of bytes owned by the store, not counting the
+				/// shared string_pool
+				size_t memory_usage( ) const noexcept;
+			};	// column_store
+
+			void swap( column_store & lhs, column_store & rhs ) noexcept;
+		}	// namespace impl
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,93 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "column_store.h"
+#include "string_pool.h"
+#include "thread_pool.h"
+
+namespace daw {
+	namespace spreadsheet {
+		class sheet;
+
+		struct csv_options {
+			char delimiter;
+			char quote;
+			/// The first record names the columns.  It is kept as row 0, stored as Text and
+			/// left out of type inference
+			bool has_header;
+			/// Threads used including the calling thread, 0 for all cores on shared_thread_pool( )
+			size_t thread_count;
+			/// Bytes of input parsed by one task
+			size_t chunk_size;
+			/// Where the columns keep long text, each column has its own when null
+			std::shared_ptr<string_pool> pool;
+
+			csv_options( ):
+					delimiter{ ',' },
+					quote{ '"' },
+					has_header{ false },
+					thread_count{ 0 },
+					chunk_size{ 1u << 22 },
+					pool{ } { }
+
+			static csv_options tsv( ) {
+				csv_options result{ };
+				result.delimiter = '\t';
+				return result;
+			}
+		};	// csv_options
+
+		struct csv_table {
+			std::vector<impl::column_store> columns;
+			size_t row_count;
+
+			csv_table( );
+		};	// csv_table
+
+		/// @brief Parse delimited text into columns in parallel.
+		/// Records end at LF or CRLF outside of quotes.  A field starting with the quote
+		/// character is quoted, may hold delimiters and newlines and escapes the quote by
+		/// doubling it.  Quote characters inside unquoted fields are not supported, the
+		/// input is split into chunks by the parity of the quotes before each chunk.
+		/// Short records are padded with empty cells.  Each column's expected type is the
+		/// type every non-empty cell classifies as, Text when they disagree and General
+		/// when the column is empty.
+		csv_table parse_csv( boost::string_ref text, thread_pool & pool, csv_options const & options = csv_options{ } );
+		csv_table parse_csv( boost::string_ref text, csv_options const & options = csv_options{ } );
+
+		/// @brief Memory map path and parse it with parse_csv
+		/// @throws std::runtime_error when the file cannot be read
+		csv_table read_csv( std::string const & path, csv_options const & options = csv_options{ } );
+
+		/// @brief Replace the columns of target with those of the file as one change
+		void import_csv( sheet & target, std::string const & path, csv_options options = csv_options{ } );
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,223 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cell_address.h"
+
+namespace daw {
+	namespace spreadsheet {
+		/// The cells to recalculate, in an order where every cell comes after the
+		/// cells it depends on.  Cells that are part of, or depend on, a cycle cannot be
+		/// ordered and are listed in cycle instead.
+		/// order is grouped into levels, level n being [level_offsets[n], level_offsets[n + 1]).
+		/// Cells within a level do not depend on each other.
+		struct recalc_plan {
+			std::vector<cell_address> order;
+			std::vector<size_t> level_offsets;
+			std::vector<cell_address> cycle;
+
+			size_t level_count( ) const noexcept {
+				return level_offsets.empty( ) ? 0 : level_offsets.size( ) - 1;
+			}
+		};	// recalc_plan
+
+		/// @brief Tracks which formula cells depend on which cells.  Edits mark only the
+		/// transitive dependents of the changed cells dirty and recalculation visits the
+		/// dirty cells in topological order.
+		class dependency_graph {
+			struct node_t {
+				std::vector<uint64_t> precedents;
+				std::vector<size_t> ranges;
+				std::vector<uint64_t> dependents;
+				bool is_formula;
+
+				node_t( ):
+						precedents{ },
+						ranges{ },
+						dependents{ },
+						is_formula{ false } { }
+			};	// node_t
+
+			struct range_edge_t {
+				cell_range range;
+				uint64_t dependent;
+				bool in_use;
+			};	// range_edge_t
+
+			/// The row spans of the range edges covering a column.  Each span is stored at
+			/// the nodes of an implicit binary trie over the row indexes that exactly cover
+			/// it, so the spans holding a row are those at the row's 33 ancestors and finding
+			/// them costs O( log rows + hits ) however many spans the column has
+			class row_spans {
+				static constexpr size_t level_count = 33;
+				std::unordered_map<uint64_t, std::vector<size_t>> m_nodes;
+				// Spans stored at each level, levels without any are not probed
+				std::array<size_t, level_count> m_level_sizes;
+
+				static uint64_t node_key( size_t level, uint64_t prefix ) noexcept {
+					return (prefix << 6) | static_cast<uint64_t>( level );
+				}
+
+				// Calls func( level, prefix ) for each node covering [first, last]
+				template<typename Function>
+				static void for_each_cover( cell_address::index_t first, cell_address::index_t last, Function func );
+			public:
+				row_spans( );
+
+				void insert( cell_address::index_t first, cell_address::index_t last, size_t range_id );
+				void erase( cell_address::index_t first, cell_address::index_t last, size_t range_id );
+				bool empty( ) const noexcept;
+
+				/// @brief Calls func( range_id ) for each span containing row
+				template<typename Function>
+				void for_each_containing( cell_address::index_t row, Function func ) const {
+					for( size_t level = 0; level < level_count; ++level ) {
+						if( m_level_sizes[level] == 0 ) {
+							continue;
+						}
+						auto it = m_nodes.find( node_key( level, static_cast<uint64_t>( row ) >> level ) );
+						if( it != m_nodes.end( ) ) {
+							for( auto const & range_id: it->second ) {
+								func( range_id );
+							}
+						}
+					}
+				}
+			};	// row_spans
+
+			std::unordered_map<uint64_t, node_t> m_nodes;
+			std::vector<range_edge_t> m_ranges;
+			std::vector<size_t> m_free_ranges;
+			// Row spans of the range edges by each column they cover
+			std::unordered_map<cell_address::index_t, row_spans> m_range_columns;
+			std::unordered_set<uint64_t> m_dirty;
+
+			size_t add_range( cell_range const & range, uint64_t dependent );
+			void remove_range( size_t range_id );
+			void clear_precedents( uint64_t cell );
+			void erase_if_unused( uint64_t cell );
+			// Order dirty for evaluation, see recalc_plan
+			recalc_plan plan( std::unordered_set<uint64_t> const & dirty ) const;
+
+			/// Visits the cells of range, or the dirty set, whichever is smaller
+			template<typename Function>
+			void for_each_dirty( cell_range const & range, Function func ) const {
+				auto const area = (static_cast<uint64_t>( range.last.row ) - range.first.row + 1) * (static_cast<uint64_t>( range.last.column ) - range.first.column + 1);
+				if( area > m_dirty.size( ) ) {
+					for( auto const & cell: m_dirty ) {
+						if( range.contains( cell_address::from_key( cell ) ) ) {
+							func( cell );
+						}
+					}
+					return;
+				}
+				for( auto column = static_cast<uint64_t>( range.first.column ); column <= range.last.column; ++column ) {
+					for( auto row = static_cast<uint64_t>( range.first.row ); row <= range.last.row; ++row ) {
+						auto const cell = cell_address{ static_cast<cell_address::index_t>( row ), static_cast<cell_address::index_t>( column ) }.key( );
+						if( m_dirty.count( cell ) != 0 ) {
+							func( cell );
+						}
+					}
+				}
+			}
+
+			template<typename Function>
+			void for_each_dependent( uint64_t cell, Function func ) const {
+				auto it = m_nodes.find( cell );
+				if( it != m_nodes.end( ) ) {
+					for( auto const & dependent: it->second.dependents ) {
+						func( dependent );
+					}
+				}
+				auto const address = cell_address::from_key( cell );
+				auto bucket = m_range_columns.find( address.column );
+				if( bucket != m_range_columns.end( ) ) {
+					bucket->second.for_each_containing( address.row, [&]( size_t range_id ) {
+						func( m_ranges[range_id].dependent );
+					} );
+				}
+			}
+		public:
+			dependency_graph( );
+			~dependency_graph( );
+			dependency_graph( dependency_graph const & ) = default;
+			dependency_graph( dependency_graph && ) = default;
+			dependency_graph & operator=( dependency_graph const & ) = default;
+			dependency_graph & operator=( dependency_graph && ) = default;
+
+			/// @brief Record the cells and ranges the formula in cell reads, replacing any
+			/// previously recorded for it
+			void set_precedents( cell_address const & cell, std::vector<cell_address> const & cells, std::vector<cell_range> const & ranges = { } );
+
+			/// @brief Cell no longer holds a formula.  Cells depending on it are unaffected
+			void remove_formula( cell_address const & cell );
+
+			bool is_formula( cell_address const & cell ) const;
+			std::vector<cell_address> precedents( cell_address const & cell ) const;
+			std::vector<cell_range> range_precedents( cell_address const & cell ) const;
+			/// @return the cells that directly read cell, including through a range
+			std::vector<cell_address> dependents( cell_address const & cell ) const;
+
+			/// @brief Mark the formulas among changed and all of their transitive
+			/// dependents dirty
+			void mark_dirty( cell_address const & changed );
+			void mark_dirty( std::vector<cell_address> const & changed );
+			bool is_dirty( cell_address const & cell ) const;
+			size_t dirty_count( ) const noexcept;
+
+			/// @brief Order the dirty cells for evaluation and clear the dirty set
+			recalc_plan take_dirty( );
+			/// @brief Order and clear only the dirty cells needed to bring cells up to date:
+			/// those of cells that are dirty and the dirty cells they transitively read
+			recalc_plan take_dirty( std::vector<cell_address> const & cells );
+			/// @brief take_dirty for the cells of range
+			recalc_plan take_dirty( cell_range const & range );
+
+			/// @brief Evaluate each dirty cell, after its precedents, by calling evaluate( cell_address )
+			/// @return the plan that was run, cells in plan.cycle were not evaluated
+			template<typename Function>
+			recalc_plan recalculate( Function evaluate ) {
+				auto plan = take_dirty( );
+				for( auto const & cell: plan.order ) {
+					evaluate( cell );
+				}
+				return plan;
+			}
+
+			template<typename Function>
+			recalc_plan recalculate( std::vector<cell_address> const & changed, Function evaluate ) {
+				mark_dirty( changed );
+				return recalculate( evaluate );
+			}
+
+			void clear( );
+		};	// dependency_graph
+	}	// namespace spreadsheet
+}	// namespace daw
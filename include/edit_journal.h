@@ -0,0 +1,155 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cell_address.h"
+#include "impl_cell_value.h"
+
+namespace daw {
+	namespace spreadsheet {
+		class sheet;
+
+		struct journal_options {
+			/// Longest an appended edit waits before its group is written
+			std::chrono::milliseconds commit_interval;
+			/// Pending bytes that start a group commit early
+			size_t commit_bytes;
+			/// fdatasync each group once written
+			bool sync;
+
+			journal_options( ):
+					commit_interval{ 5 },
+					commit_bytes{ 1u << 20 },
+					sync{ true } { }
+		};	// journal_options
+
+		struct journal_record {
+			enum class kind_t: uint8_t { set_cell, clear_column, resize };
+			using expected_value_t = impl::cell_value::expected_value_t;
+
+			kind_t kind;
+			uint64_t sequence;
+			int64_t timestamp;	// Microseconds since 1970-01-01 UTC
+			cell_address cell;	// clear_column: the column, resize: the column count
+			expected_value_t value_type;
+			boost::string_ref text;	// Only valid during the callback it is passed to
+
+			journal_record( ) noexcept;
+		};	// journal_record
+
+		/// @brief Append only log of sheet edits.  An append encodes the edit into a pending
+		/// buffer and returns, a writer thread writes and syncs the pending edits as a group
+		/// every commit_interval or once commit_bytes are pending.  Every record carries a
+		/// checksum and a torn record at the end of the file, left by a crash mid write, is
+		/// cut off when the journal is opened.
+		///
+		/// Records are absolute assignments so replaying a journal twice has the same effect
+		/// as replaying it once.  Compaction relies on this: rotate( ) moves the journal aside,
+		/// a snapshot taken at that point is written and then the rotated journal is removed.
+		/// Recovery replays the rotated journal, if a crash left one, before the current one.
+		class edit_journal {
+			journal_options m_options;
+			std::string m_path;
+			int m_fd;
+			std::mutex m_mutex;
+			std::condition_variable m_pending_cv;
+			std::condition_variable m_durable_cv;
+			std::vector<char> m_pending;
+			uint64_t m_last_sequence;
+			uint64_t m_durable_sequence;
+			bool m_flush_requested;
+			bool m_stop;
+			std::exception_ptr m_error;
+			// Held while writing, so rotate( ) never swaps the file under the writer
+			std::mutex m_io_mutex;
+			std::thread m_writer;
+
+			uint64_t append( journal_record::kind_t kind, cell_address const & cell, journal_record::expected_value_t value_type, boost::string_ref text );
+			void write_pending( std::unique_lock<std::mutex> & lock );
+			void writer( );
+		public:
+			/// @brief Open or create the journal at path, appending after its last valid record
+			/// @throws std::runtime_error when the file cannot be opened
+			explicit edit_journal( std::string path, journal_options options = journal_options{ } );
+			/// @brief Writes and syncs the pending edits
+			~edit_journal( );
+			edit_journal( edit_journal const & ) = delete;
+			edit_journal( edit_journal && ) = delete;
+			edit_journal & operator=( edit_journal const & ) = delete;
+			edit_journal & operator=( edit_journal && ) = delete;
+
+			std::string const & path( ) const noexcept;
+			/// @brief Where rotate( ) moves the journal to
+			std::string rotated_path( ) const;
+
+			/// @return the sequence number of the record
+			/// @throws std::runtime_error when an earlier group failed to write
+			uint64_t append_set( cell_address const & cell, journal_record::expected_value_t value_type, boost::string_ref text );
+			uint64_t append_clear_column( size_t column );
+			uint64_t append_resize( size_t column_count );
+
+			uint64_t last_sequence( );
+			/// @brief Block until the record with sequence has been written and synced
+			/// @throws std::runtime_error when its group failed to write
+			void wait_durable( uint64_t sequence );
+			/// @brief Write and sync everything appended so far
+			void flush( );
+			/// @brief Move the journal to rotated_path( ) and continue in an empty one
+			/// @throws std::logic_error when an earlier rotated journal still exists
+			void rotate( );
+		};	// edit_journal
+
+		/// @brief Call func( journal_record const & ) for each valid record of the journal at
+		/// path, stopping at the first torn or corrupt record.  A missing file has no records
+		/// @return the number of records read
+		size_t read_journal( std::string const & path, std::function<void( journal_record const & )> const & func );
+
+		/// @brief Apply the records of a journal to target as one change
+		/// @return the number of records applied
+		size_t replay_journal( std::string const & path, sheet & target );
+
+		/// @brief Load the snapshot at snapshot_path, when it exists, and replay the rotated
+		/// journal of an unfinished compaction and then the journal at journal_path over it.
+		/// Call before attaching a journal to target, replayed edits are not journaled again
+		void recover_sheet( sheet & target, std::string const & snapshot_path, std::string const & journal_path );
+
+		/// @brief Fold the journal into a new snapshot.  The cells of source are copied and
+		/// the journal rotated on the calling thread, the snapshot is then written and the
+		/// rotated journal removed on a background thread
+		/// @return completes when the snapshot is in place, rethrowing any error writing it
+		std::future<void> compact_journal( sheet const & source, edit_journal & journal, std::string snapshot_path );
+	}	// namespace spreadsheet
+}	// namespace daw
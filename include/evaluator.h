@@ -25,10 +25,12 @@
 #include <algorithm>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/utility/string_ref.hpp>
+#include <iterator>
 
 #include <daw/daw_parser_helper.h>
 
 #include "impl_cell_value.h"
+#include "value_classifier.h"
 
 namespace daw {
 	namespace spreadsheet {
@@ -50,115 +52,67 @@ namespace daw {
 				return std::equal( first1, last1, first2, last2, equal_nc );
 			};
 
-		template<typename ForwardIterator>
-			auto eval_string( ForwardIterator first, ForwardIterator last ) {
-				return result_t{ daw::parser::make_find_result( first, last ).as_string( ) };
+		template<typename ContiguousIterator>
+			boost::string_ref to_string_ref( ContiguousIterator first, ContiguousIterator last ) {
+				return boost::string_ref{ &(*first), static_cast<size_t>( std::distance( first, last ) ) };
 			}
 
-		template<typename ForwardIterator>
-			auto eval_bool( ForwardIterator first, ForwardIterator last ) {
-				auto rng = daw::parser::trim_right( first, last );
-
-				static const std::string t = "true";
-				bool result = is_equal_nc( rng.first, rng.last, t.begin( ), t.last( ) );
-				if( !result ) {
-					static const std::string f = "false";
-					result = is_equal_nc( rng.first, rng.last, f.begin( ), f.last( ) );
-					if( !result ) {
-						// not a bool
-						throw daw::parser::ParserError{ };
-					}
+		/// @brief The value of an already classified cell.  Nothing is thrown for values
+		/// that do not parse, they are Text
+		inline result_t eval_classified( classified_value const & value ) {
+			auto result = to_variant( value );
+			return [result = std::move( result )]( ) {
+				return result;
+			};
+		}
+
+		template<typename ContiguousIterator>
+			auto eval_string( ContiguousIterator first, ContiguousIterator last ) {
+				return eval_classified( classified_value{ classified_value::expected_value_t::Text, to_string_ref( first, last ) } );
+			}
+
+		/// eval_bool, eval_timestamp, eval_duration and eval_number fall back to a string
+		/// when the text is not of their type
+		template<typename ContiguousIterator>
+			auto eval_as( classified_value::expected_value_t value_type, ContiguousIterator first, ContiguousIterator last ) {
+				auto const value = classify_value( to_string_ref( first, last ) );
+				if( value.type != value_type ) {
+					return eval_string( first, last );
 				}
-				return result_t{ result };
+				return eval_classified( value );
 			}
 
+		template<typename ContiguousIterator>
+			auto eval_bool( ContiguousIterator first, ContiguousIterator last ) {
+				return eval_as( classified_value::expected_value_t::Boolean, first, last );
+			}
 
-		template<typename ForwardIterator>
-			auto eval_timestamp( ForwardIterator first, ForwardIterator last ) {
-				auto rng = daw::parser::trim( fist, last );
-				try {
-					return result_t{ boost::posix_time::from_iso_string( rng.as_string( ) ) };
-				} catch( std::exception const & ) {
-					throw daw::parser::ParserException{ };
-				}
+		template<typename ContiguousIterator>
+			auto eval_timestamp( ContiguousIterator first, ContiguousIterator last ) {
+				return eval_as( classified_value::expected_value_t::Timestamp, first, last );
 			}
 
-		template<typename ForwardIterator>
-			auto eval_number( ForwardIterator first, ForwardIterator last ) {
-				try {
-					boost::string_ref val{ first, last };
-					cell_value::number_t result{ val.to_string( ) };
-					return result_t{ std::move( result ) };
-				} catch( std::exception const & ) {
-					throw daw::parser::ParserException{ };
-				}
+		template<typename ContiguousIterator>
+			auto eval_duration( ContiguousIterator first, ContiguousIterator last ) {
+				return eval_as( classified_value::expected_value_t::Time, first, last );
 			}
 
-		template<typename ForwardIterator>
-			auto eval_number_timestamp_or_duration( ForwardIterator first, ForwardIterator last ) {
-				try {
-					return eval_timestamp( first, last );
-				} catch( daw::parser::ParserException const & ) { }
-				try {
-					return eval_duration( first, last );
-				} catch( daw::parser::ParserException const & ) { }
-				try {
-					return eval_number( first, last );
-				} catch( daw::parser::ParserException const & ) { }
-				return eval_string( first, last );
+		template<typename ContiguousIterator>
+			auto eval_number( ContiguousIterator first, ContiguousIterator last ) {
+				return eval_as( classified_value::expected_value_t::Number, first, last );
 			}
 
-		template<typename ForwardIterator>
-			auto eval_func( ForwardIterator first, ForwardIterator last ) {
-				auto rng = daw::parser::until( first, last, &daw::parser::not_space<decltype(first)> );
-				switch( *rng.first ) {
-				case '0':
-				case '1':
-				case '2':
-				case '3':
-				case '4':
-				case '5':
-				case '6':
-				case '7':
-				case '8':
-				case '9': return eval_number_or_timestamp( rng.first, rng.last );
-				case '+':
-				case '-':
-				case '*':
-				case '/':
-				case '^':
-				case '%':
-				case '(':
-				case ')':
-				case '"':
-				}
+		/// @brief Classify the text in one scan instead of trying each type in turn
+		template<typename ContiguousIterator>
+			auto eval_number_timestamp_or_duration( ContiguousIterator first, ContiguousIterator last ) {
+				return eval_classified( classify_value( to_string_ref( first, last ) ) );
 			}
 
-		template<typename ForwardIterator>
-			auto evaluator( ForwardIterator first, ForwardIterator last ) {
+		template<typename ContiguousIterator>
+			auto evaluator( ContiguousIterator first, ContiguousIterator last ) {
 				auto rng = daw::parser::trim_left( first, last );
-				try {
-					switch( *rng.first ) {
-					case '=': return eval_func( std::next( rng.first ), rng.last );
-					case '0':
-					case '1':
-					case '2':
-					case '3':
-					case '4':
-					case '5':
-					case '6':
-					case '7':
-					case '8':
-					case '9': return eval_number_or_timestamp( rng.first, rng.last );
-					case 't':
-					case 'T':
-					case 'f':
-					case 'F': return eval_bool( rng.first, rng.last );
-					}
-				} catch( daw::parser::ParserError const & ) { }
-				return eval_string( rng.first, rng.last );
+				return eval_number_timestamp_or_duration( rng.first, rng.last );
 			}
-
 	}    // namespace spreadsheet
 }    // namespace daw
 
@@ -0,0 +1,132 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "cell_address.h"
+#include "change_set.h"
+
+namespace daw {
+	namespace spreadsheet {
+		enum class item_event: uint8_t { closed, updated, data_updated };
+
+		/// @brief Listeners keyed by (item id, event) in one sorted vector.  Emitting finds
+		/// the item's listeners with a binary search and does not allocate.  Listeners may
+		/// add or remove listeners, or emit, while being called.  Not thread safe
+		///
+		/// Between begin_batch( ) and end_batch( ) emits are deferred.  When the outermost
+		/// batch ends each item and event that was emitted is emitted once and the change
+		/// listeners receive one change_set holding the changed cells and item ids
+		class event_table {
+		public:
+			using id_t = size_t;
+			using listener_t = std::function<void( id_t )>;
+			using change_listener_t = std::function<void( change_set const & )>;
+			using token_t = uint64_t;
+		private:
+			struct entry {
+				uint64_t key;
+				token_t token;
+				bool once;
+				bool removed;
+				listener_t callback;
+			};	// entry
+
+			struct change_entry {
+				token_t token;
+				bool removed;
+				change_listener_t callback;
+			};	// change_entry
+
+			// Sorted by key, listeners of one key in the order they were added
+			std::vector<entry> m_entries;
+			// Listeners added while emitting, merged when the outermost emit returns
+			std::vector<entry> m_pending;
+			token_t m_next_token;
+			size_t m_emit_depth;
+			bool m_has_removed;
+
+			std::vector<change_entry> m_change_listeners;
+			// Change listeners added while delivering, appended when the outermost delivery returns
+			std::vector<change_entry> m_pending_change_listeners;
+			size_t m_deliver_depth;
+			// Keys emitted and items whose listeners were removed while batching
+			std::vector<uint64_t> m_deferred;
+			std::vector<id_t> m_deferred_removals;
+			change_set m_changes;
+			size_t m_batch_depth;
+
+			static uint64_t make_key( id_t item, item_event event ) noexcept;
+			token_t add( id_t item, item_event event, listener_t listener, bool once );
+			void insert( entry value );
+			void flush( );
+			void deliver( change_set const & changes );
+			void flush_change_listeners( );
+		public:
+			event_table( );
+			~event_table( );
+			event_table( event_table const & ) = delete;
+			event_table( event_table && ) = default;
+			event_table & operator=( event_table const & ) = delete;
+			event_table & operator=( event_table && ) = default;
+
+			/// @return a token for remove( )
+			token_t on( id_t item, item_event event, listener_t listener );
+			/// @brief The listener is removed after its first call
+			token_t on_next( id_t item, item_event event, listener_t listener );
+			void emit( id_t item, item_event event );
+
+			/// @brief The listener is called with the changes of each batch
+			token_t on_changes( change_listener_t listener );
+
+			/// @brief Defer emits until the matching end_batch( ).  Batches nest
+			void begin_batch( );
+			/// @throws std::logic_error when not in a batch
+			void end_batch( );
+			bool in_batch( ) const noexcept;
+			/// @brief Record cells changed by the current batch.  Outside of a batch the
+			/// change listeners are called immediately
+			void add_change( cell_address const & cell );
+			void add_change( cell_range const & range );
+
+			bool remove( token_t token );
+			void remove_all( id_t item, item_event event );
+			/// @brief While batching the item's listeners are kept until the deferred
+			/// events, such as closed, have been emitted
+			void remove_all( id_t item );
+
+			size_t listener_count( id_t item, item_event event ) const;
+			/// @brief Number of entries, including listeners removed during an emit
+			size_t size( ) const noexcept;
+			bool empty( ) const noexcept;
+		};	// event_table
+
+		std::shared_ptr<event_table> create_event_table( );
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,124 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cell_address.h"
+#include "formula_vm.h"
+
+namespace daw {
+	namespace spreadsheet {
+		/// @brief A formula compiled once and shared by every cell holding a formula of the
+		/// same shape.  The program keeps its references as written in origin, they are moved
+		/// to the cell being evaluated so filled and copied formulas are not parsed again.
+		/// Immutable once built, so it is shared between threads without locking
+		class compiled_formula {
+			formula_program m_program;
+			cell_address m_origin;
+			bool m_parsed;
+
+			/// Moves the program's references to the cell being evaluated
+			struct moved_references {
+				compiled_formula const * m_formula;
+				cell_address m_at;
+
+				cell_address cell( uint32_t index ) const noexcept {
+					return m_formula->cell( index, m_at );
+				}
+
+				cell_range range( uint32_t index ) const noexcept {
+					return m_formula->range( index, m_at );
+				}
+			};	// moved_references
+		public:
+			/// @brief A formula that did not parse, it evaluates to #VALUE!
+			compiled_formula( );
+			compiled_formula( formula_program program, cell_address const & origin );
+
+			bool parsed( ) const noexcept;
+			formula_program const & program( ) const noexcept;
+			cell_address const & origin( ) const noexcept;
+
+			/// @brief Address of the index'th cell read when evaluated in cell at
+			cell_address cell( size_t index, cell_address const & at ) const noexcept;
+			cell_range range( size_t index, cell_address const & at ) const noexcept;
+			/// @brief Replace cells and ranges with those read when evaluated in cell at
+			void references( cell_address const & at, std::vector<cell_address> & cells, std::vector<cell_range> & ranges ) const;
+
+			/// @brief Evaluate as the formula of cell at, see evaluate( formula_program, Resolver )
+			template<typename Resolver>
+			formula_value evaluate( cell_address const & at, Resolver const & resolver ) const {
+				if( !m_parsed ) {
+					return formula_value::from_error( formula_error::value );
+				}
+				if( at == m_origin ) {
+					return daw::spreadsheet::evaluate( m_program, resolver );
+				}
+				return daw::spreadsheet::evaluate( m_program, resolver, moved_references{ this, at } );
+			}
+		};	// compiled_formula
+
+		/// @brief Write formula, with or without its =, to key with its references relative to
+		/// cell.  Formulas that only differ by where they were filled or copied to get the same key
+		void normalize_formula( boost::string_ref formula, cell_address const & cell, std::string & key );
+
+		/// @brief Write formula as it reads when the cell from is copied to to, moving the
+		/// references that are not anchored with $
+		/// @return false when a reference moved off the sheet, it is written as #REF!
+		bool move_formula( boost::string_ref formula, cell_address const & from, cell_address const & to, std::string & out );
+
+		/// @brief Compiled formulas keyed by normalized text, so cells holding formulas of the
+		/// same shape share one compiled_formula.  Thread safe
+		class formula_cache {
+			mutable std::mutex m_mutex;
+			std::unordered_map<std::string, std::shared_ptr<compiled_formula const>> m_formulas;
+			// Unused formulas are pruned when the cache reaches this size
+			size_t m_prune_size;
+		public:
+			formula_cache( );
+			~formula_cache( );
+			formula_cache( formula_cache const & ) = delete;
+			formula_cache( formula_cache && ) = delete;
+			formula_cache & operator=( formula_cache const & ) = delete;
+			formula_cache & operator=( formula_cache && ) = delete;
+
+			/// @brief The compiled form of formula, with or without its =, written in cell.  Only
+			/// the first formula of each shape is parsed
+			std::shared_ptr<compiled_formula const> get( boost::string_ref formula, cell_address const & cell );
+			size_t size( ) const;
+			/// @brief Drop the formulas no longer held outside of the cache
+			/// @return the number dropped
+			size_t prune( );
+			void clear( );
+		};	// formula_cache
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,354 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "big_num_t.h"
+#include "cell_address.h"
+#include "impl_cell_value.h"
+#include "sheetrock.h"
+#include "sheetrock_flat_ast.h"
+
+namespace daw {
+	namespace spreadsheet {
+		enum class formula_error: uint8_t { none, div_zero, value, ref, name, num, cycle, na };
+		std::string to_string( formula_error error );
+
+		/// A value on the formula VM's stack
+		struct formula_value {
+			enum class kind_t: uint8_t { empty, number, string, boolean, error, range };
+			kind_t kind;
+			bool boolean;
+			formula_error error;
+			uint32_t range_index;
+			number::big_num_t number;
+			std::string text;
+
+			formula_value( );
+			static formula_value from_number( number::big_num_t value );
+			static formula_value from_string( std::string value );
+			static formula_value from_boolean( bool value );
+			static formula_value from_error( formula_error value );
+			static formula_value from_range( uint32_t index );
+
+			bool is_error( ) const noexcept;
+		};	// formula_value
+
+		impl::cell_value::cell_variant_t to_variant( formula_value const & value );
+
+		enum class formula_function: uint8_t { sum, average, min, max, count, abs, logical_and, logical_or, logical_not, match, vlookup };
+
+		enum class op_code: uint8_t {
+			push_constant,	// operand: index into constants
+			push_cell,		// operand: index into cells
+			push_range,		// operand: index into ranges
+			negate,
+			percent,
+			add,
+			subtract,
+			multiply,
+			divide,
+			modulus,
+			power,
+			logical_and,
+			logical_or,
+			less,
+			greater,
+			equal,
+			call,			// operand: formula_function, argc: argument count
+			jump,			// operand: target instruction
+			jump_if_false	// operand: target instruction, pops the condition
+		};
+
+		struct instruction {
+			op_code code;
+			uint8_t argc;
+			uint32_t operand;
+		};	// instruction
+
+		/// A formula compiled to a flat instruction array.  Constants and the cells and
+		/// ranges read by the formula are stored in pools referenced by index
+		struct formula_program {
+			std::vector<instruction> code;
+			std::vector<formula_value> constants;
+			std::vector<cell_address> cells;
+			std::vector<cell_range> ranges;
+			/// reference_anchor bits of each cell, and of each range's first | last << 2
+			std::vector<uint8_t> cell_anchors;
+			std::vector<uint8_t> range_anchors;
+			size_t max_stack;
+
+			formula_program( );
+		};	// formula_program
+
+		/// @brief Compile an expression tree to bytecode.  Unknown function names compile to
+		/// a #NAME? error
+		/// @throws daw::parser::ParserException on nodes that cannot be evaluated
+		formula_program compile_formula( daw::parser::sheetrock::ast::expression const & expression );
+
+		/// @brief Compile the formula rooted at root in a flat_ast arena
+		formula_program compile_formula( daw::parser::sheetrock::flat_ast const & tree, daw::parser::sheetrock::flat_ast::index_t root );
+
+		namespace impl {
+			formula_value to_number( formula_value const & value );
+			formula_value apply_unary( op_code code, formula_value const & value );
+			formula_value apply_binary( op_code code, formula_value const & lhs, formula_value const & rhs );
+			bool is_true( formula_value const & value, formula_error & error );
+
+			struct aggregate_state {
+				formula_function function;
+				formula_error error;
+				number::big_num_t total;
+				size_t count;
+				bool has_value;
+				bool flag;
+
+				explicit aggregate_state( formula_function func );
+				/// @brief Add an argument, values read from ranges skip text and booleans
+				void add( formula_value const & value, bool from_range );
+				formula_value finish( ) const;
+			};	// aggregate_state
+
+			/// Returned by lookups that found nothing
+			constexpr size_t no_match = std::numeric_limits<size_t>::max( );
+			/// compare_lookup's result for values a lookup does not compare
+			constexpr int lookup_unordered = 2;
+
+			/// @brief Order values as MATCH and VLOOKUP do.  Only numbers, text and booleans
+			/// take part and only against their own kind, text is compared without case
+			/// @return -1, 0 or 1, or lookup_unordered
+			int compare_lookup( formula_value const & lhs, formula_value const & rhs );
+			bool is_lookup_key( formula_value const & value ) noexcept;
+			/// @brief A hash agreeing with compare_lookup( lhs, rhs ) == 0
+			uint64_t lookup_hash( formula_value const & value );
+
+			/// @brief Whether value at a later position replaces best as the result of an
+			/// approximate match.  match_type 1 looks for the largest value not above the key
+			/// taking the last of equal values, -1 for the smallest not below it taking the first
+			bool better_match( formula_value const & value, formula_value const & best, int match_type );
+
+			/// @brief The position in range, a single row or column, of the cell matching key.
+			/// match_type 0 finds the first equal value, see better_match for 1 and -1
+			template<typename Resolver>
+			size_t linear_match( Resolver const & resolver, cell_range const & range, formula_value const & key, int match_type ) {
+				if( !is_lookup_key( key ) || (range.first.row != range.last.row && range.first.column != range.last.column) ) {
+					return no_match;
+				}
+				auto const down = range.first.column == range.last.column;
+				auto const count = down ? static_cast<size_t>( range.last.row - range.first.row ) + 1 : static_cast<size_t>( range.last.column - range.first.column ) + 1;
+				size_t best = no_match;
+				formula_value best_value{ };
+				for( size_t n = 0; n < count; ++n ) {
+					auto const offset = static_cast<cell_address::index_t>( n );
+					auto value = resolver.value( down ? cell_address{ range.first.row + offset, range.first.column } : cell_address{ range.first.row, range.first.column + offset } );
+					auto const order = compare_lookup( value, key );
+					if( order == lookup_unordered ) {
+						continue;
+					}
+					if( match_type == 0 ) {
+						if( order == 0 ) {
+							return n;
+						}
+					} else if( (match_type > 0 ? order <= 0 : order >= 0) && (best == no_match || better_match( value, best_value, match_type )) ) {
+						best = n;
+						best_value = std::move( value );
+					}
+				}
+				return best;
+			}
+
+			/// Resolvers with a find_match( range, key, match_type ) member answer lookups
+			/// themselves, say from an index, the others are scanned
+			template<typename Resolver>
+			auto find_match( Resolver const & resolver, cell_range const & range, formula_value const & key, int match_type, int ) -> decltype( resolver.find_match( range, key, match_type ) ) {
+				return resolver.find_match( range, key, match_type );
+			}
+
+			template<typename Resolver>
+			size_t find_match( Resolver const & resolver, cell_range const & range, formula_value const & key, int match_type, long ) {
+				return linear_match( resolver, range, key, match_type );
+			}
+
+			bool is_lookup( formula_function function ) noexcept;
+
+			struct lookup_arguments {
+				formula_error error;
+				int match_type;
+				/// One based column of a VLOOKUP table
+				size_t column;
+			};	// lookup_arguments
+
+			/// @brief Check the arguments of a MATCH( key, range[, match_type] ) or
+			/// VLOOKUP( key, table, column[, approximate] ) call
+			lookup_arguments check_lookup( formula_function function, formula_value const * args, size_t argc );
+
+			template<typename Resolver, typename References>
+			formula_value call_lookup( formula_function function, formula_value const * args, size_t argc, References const & references, Resolver const & resolver ) {
+				auto const checked = check_lookup( function, args, argc );
+				if( checked.error != formula_error::none ) {
+					return formula_value::from_error( checked.error );
+				}
+				cell_range const table = references.range( args[1].range_index );
+				auto search = table;
+				if( function == formula_function::vlookup ) {
+					if( checked.column > static_cast<size_t>( table.last.column - table.first.column ) + 1 ) {
+						return formula_value::from_error( formula_error::ref );
+					}
+					search.last.column = search.first.column;
+				}
+				auto const found = find_match( resolver, search, args[0], checked.match_type, 0 );
+				if( found == no_match ) {
+					return formula_value::from_error( formula_error::na );
+				}
+				if( function == formula_function::match ) {
+					return formula_value::from_number( found + 1 );
+				}
+				return resolver.value( cell_address{
+						static_cast<cell_address::index_t>( table.first.row + found ),
+						static_cast<cell_address::index_t>( table.first.column + checked.column - 1 ) } );
+			}
+
+			/// The references of a program read where it was compiled
+			struct program_references {
+				formula_program const * program;
+
+				cell_address const & cell( uint32_t index ) const {
+					return program->cells[index];
+				}
+
+				cell_range const & range( uint32_t index ) const {
+					return program->ranges[index];
+				}
+			};	// program_references
+		}	// namespace impl
+
+		/// @brief Run a compiled formula, taking the address of each cell and range it reads
+		/// from references.cell( index ) and references.range( index ).
+		/// Resolver must provide
+		///		formula_value value( cell_address ) const and
+		///		void for_each_value( cell_range, Function ) const calling Function( formula_value const & )
+		///		for each non-empty cell in the range
+		///	and may provide size_t find_match( cell_range, formula_value key, int match_type ) const
+		///	returning what impl::linear_match would
+		template<typename Resolver, typename References>
+		formula_value evaluate( formula_program const & program, Resolver const & resolver, References const & references ) {
+			std::vector<formula_value> stack;
+			stack.reserve( program.max_stack );
+			auto const & code = program.code;
+			size_t ip = 0;
+			while( ip < code.size( ) ) {
+				auto const & inst = code[ip++];
+				switch( inst.code ) {
+				case op_code::push_constant:
+					stack.push_back( program.constants[inst.operand] );
+					break;
+				case op_code::push_cell:
+					stack.push_back( resolver.value( references.cell( inst.operand ) ) );
+					break;
+				case op_code::push_range:
+					stack.push_back( formula_value::from_range( inst.operand ) );
+					break;
+				case op_code::negate:
+				case op_code::percent:
+					stack.back( ) = impl::apply_unary( inst.code, stack.back( ) );
+					break;
+				case op_code::add:
+				case op_code::subtract:
+				case op_code::multiply:
+				case op_code::divide:
+				case op_code::modulus:
+				case op_code::power:
+				case op_code::logical_and:
+				case op_code::logical_or:
+				case op_code::less:
+				case op_code::greater:
+				case op_code::equal: {
+						auto rhs = std::move( stack.back( ) );
+						stack.pop_back( );
+						stack.back( ) = impl::apply_binary( inst.code, stack.back( ), rhs );
+						break;
+					}
+				case op_code::call: {
+						auto const function = static_cast<formula_function>( inst.operand );
+						auto const first = stack.size( ) - inst.argc;
+						if( impl::is_lookup( function ) ) {
+							auto result = impl::call_lookup( function, stack.data( ) + first, inst.argc, references, resolver );
+							stack.resize( first );
+							stack.push_back( std::move( result ) );
+							break;
+						}
+						impl::aggregate_state state{ function };
+						for( auto n = first; n < stack.size( ); ++n ) {
+							auto const & arg = stack[n];
+							if( arg.kind == formula_value::kind_t::range ) {
+								resolver.for_each_value( references.range( arg.range_index ), [&state]( formula_value const & value ) {
+									state.add( value, true );
+								} );
+							} else {
+								state.add( arg, false );
+							}
+						}
+						stack.resize( first );
+						stack.push_back( state.finish( ) );
+						break;
+					}
+				case op_code::jump:
+					ip = inst.operand;
+					break;
+				case op_code::jump_if_false: {
+						auto error = formula_error::none;
+						auto const condition = impl::is_true( stack.back( ), error );
+						if( error != formula_error::none ) {
+							stack.back( ) = formula_value::from_error( error );
+							ip = code.size( );
+							break;
+						}
+						stack.pop_back( );
+						if( !condition ) {
+							ip = inst.operand;
+						}
+						break;
+					}
+				}
+			}
+			if( stack.empty( ) ) {
+				return formula_value{ };
+			}
+			if( stack.back( ).kind == formula_value::kind_t::range ) {
+				return formula_value::from_error( formula_error::value );
+			}
+			return std::move( stack.back( ) );
+		}
+
+		/// @brief Run a compiled formula reading the cells and ranges it was compiled with
+		template<typename Resolver>
+		formula_value evaluate( formula_program const & program, Resolver const & resolver ) {
+			return evaluate( program, resolver, impl::program_references{ &program } );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
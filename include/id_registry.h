@@ -0,0 +1,178 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "table_item.h"
+
+namespace daw {
+	namespace spreadsheet {
+		/// @brief Maps table_item ids to values in an open addressing table with linear
+		/// probing.  Id 0, which no live item has, marks an empty slot and erase shifts the
+		/// entries after it back, so no tombstones build up.  A lookup is a multiply, a
+		/// shift and usually a single probe
+		template<typename T>
+		class id_registry {
+		public:
+			using id_t = table_item::id_t;
+			using value_type = T;
+		private:
+			struct slot {
+				id_t id;
+				T value;
+			};	// slot
+
+			static constexpr size_t min_capacity = 16;
+
+			std::vector<slot> m_slots;
+			size_t m_size;
+			size_t m_shift;
+
+			size_t mask( ) const noexcept {
+				return m_slots.size( ) - 1;
+			}
+
+			// Fibonacci hashing spreads the runs of ids handed out by one thread
+			size_t home( id_t id ) const noexcept {
+				return static_cast<size_t>( (static_cast<uint64_t>( id ) * 0x9E3779B97F4A7C15ull) >> m_shift );
+			}
+
+			size_t find_slot( id_t id ) const noexcept {
+				auto pos = home( id );
+				while( m_slots[pos].id != id && m_slots[pos].id != 0 ) {
+					pos = (pos + 1) & mask( );
+				}
+				return pos;
+			}
+
+			void rehash( size_t capacity ) {
+				std::vector<slot> old( capacity, slot{ 0, T{ } } );
+				old.swap( m_slots );
+				m_shift = 64;
+				for( auto n = capacity; n > 1; n >>= 1 ) {
+					--m_shift;
+				}
+				for( auto & entry: old ) {
+					if( entry.id != 0 ) {
+						m_slots[find_slot( entry.id )] = std::move( entry );
+					}
+				}
+			}
+		public:
+			id_registry( ):
+					m_slots{ },
+					m_size{ 0 },
+					m_shift{ 64 } { }
+
+			size_t size( ) const noexcept {
+				return m_size;
+			}
+
+			bool empty( ) const noexcept {
+				return m_size == 0;
+			}
+
+			/// @brief Make room for count ids without rehashing
+			void reserve( size_t count ) {
+				auto capacity = min_capacity;
+				while( capacity < 2 * count ) {
+					capacity *= 2;
+				}
+				if( capacity > m_slots.size( ) ) {
+					rehash( capacity );
+				}
+			}
+
+			/// @brief Map id to value, replacing its current value
+			/// @throws std::invalid_argument when id is 0
+			T & insert( id_t id, T value ) {
+				if( id == 0 ) {
+					throw std::invalid_argument{ "Cannot register an item without an id" };
+				}
+				// At most half full so probe runs stay short
+				if( 2 * (m_size + 1) > m_slots.size( ) ) {
+					rehash( m_slots.empty( ) ? min_capacity : 2 * m_slots.size( ) );
+				}
+				auto & entry = m_slots[find_slot( id )];
+				if( entry.id == 0 ) {
+					entry.id = id;
+					++m_size;
+				}
+				entry.value = std::move( value );
+				return entry.value;
+			}
+
+			/// @return false when id was not registered
+			bool erase( id_t id ) noexcept {
+				if( m_size == 0 || id == 0 ) {
+					return false;
+				}
+				auto hole = find_slot( id );
+				if( m_slots[hole].id == 0 ) {
+					return false;
+				}
+				// Move back each following entry of the run whose home is not between the
+				// hole and its slot
+				for( auto next = (hole + 1) & mask( ); m_slots[next].id != 0; next = (next + 1) & mask( ) ) {
+					if( ((next - home( m_slots[next].id )) & mask( )) >= ((next - hole) & mask( )) ) {
+						m_slots[hole] = std::move( m_slots[next] );
+						hole = next;
+					}
+				}
+				m_slots[hole] = slot{ 0, T{ } };
+				--m_size;
+				return true;
+			}
+
+			/// @return the value of id, or nullptr when it is not registered
+			T * find( id_t id ) noexcept {
+				if( m_size == 0 || id == 0 ) {
+					return nullptr;
+				}
+				auto & entry = m_slots[find_slot( id )];
+				return entry.id == id ? &entry.value : nullptr;
+			}
+
+			T const * find( id_t id ) const noexcept {
+				return const_cast<id_registry *>( this )->find( id );
+			}
+
+			bool contains( id_t id ) const noexcept {
+				return find( id ) != nullptr;
+			}
+
+			void clear( ) noexcept {
+				for( auto & entry: m_slots ) {
+					entry = slot{ 0, T{ } };
+				}
+				m_size = 0;
+			}
+		};	// id_registry
+	}	// namespace spreadsheet
+}	// namespace daw
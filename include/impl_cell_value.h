@@ -28,32 +28,17 @@
 #include <memory>
 #include <vector>
 
-#include <daw/json/daw_json_link.h>
 #include <daw/nodepp/base_event_emitter.h>
 #include <daw/daw_variant.h>
 
 #include "big_num_t.h"
+#include "json_schema.h"
 #include "table_item.h"
 #include "sheetrock.h"
 
 namespace daw {
 	namespace spreadsheet {
 		namespace impl {
-			class cell_value;
-
-			class column: public table_item {
-				std::vector<cell_value> m_values;
-			public:
-				column( daw::nodepp::base::EventEmitter emitter );
-				column( column const & other );
-				column( column && other );
-				column & operator=( column const & rhs );
-				column & operator=( column && rhs );
-				friend void swap( column & lhs, column & rhs );
-			};	// column
-
-			void swap( column & lhs, column & rhs );
-
 			struct cell_value: public table_item {
 				enum class expected_value_t: size_t { General, Text, Number, Timestamp, Time, Boolean, Error };
 				using string_t = std::string;
@@ -64,7 +49,7 @@ namespace daw {
 				using cell_variant_t = daw::variant_t<string_t, number_t, timestamp_t, duration_t, bool_t >;
 				using eval_func_t = std::function<cell_variant_t( )>;
 			private:
-				void link_values( );
+				friend struct daw::spreadsheet::json_schema<cell_value>;
 				// State values
 				expected_value_t m_value_type;
 				std::string m_string_value;
@@ -76,13 +61,14 @@ namespace daw {
 			public:
 				cell_value( );
 
-				cell_value( daw::nodepp::base::EventEmitter emitter, expected_value_t value_type = expected_value_t::General, std::string string_value = "", eval_func_t eval_func = nullptr );
+				cell_value( daw::nodepp::base::EventEmitter emitter, expected_value_t value_type = expected_value_t::General, std::string string_value = "", eval_func_t eval_func = nullptr, std::shared_ptr<event_table> events = nullptr );
 				virtual ~cell_value( );
 				std::string evaluate( );
 				void set_value( boost::string_ref );
 
 				expected_value_t & value_type( );
 				expected_value_t const & value_type( ) const;
+				std::string const & string_value( ) const;
 
 				cell_value( cell_value const & other );
 				cell_value( cell_value && other );
@@ -90,9 +76,13 @@ namespace daw {
 				cell_value & operator=( cell_value && rhs );
 
 				friend void swap( cell_value & lhs, cell_value & rhs ) noexcept;
+
+				std::string encode( ) const;
+				/// @brief The id is not restored, it identifies this cell's listeners
+				void decode( boost::string_ref json_text );
 				///
 				/// \param cb A callback function that takes the string id of the updated cell
-				void on_data_updated( std::function<void( std::string )> cb );
+				void on_data_updated( std::function<void( id_t )> cb );
 
 				bool empty( ) const;
 
@@ -105,6 +95,25 @@ namespace daw {
 			std::istream & operator>>( std::istream & os, cell_value::expected_value_t & expected_value );
 
 		}	// namespace impl
+
+		template<>
+		struct json_value<impl::cell_value::expected_value_t> {
+			static void encode( std::string & out, impl::cell_value::expected_value_t value );
+			static void decode( json_reader & reader, impl::cell_value::expected_value_t & value );
+		};	// json_value<expected_value_t>
+
+		template<>
+		struct json_schema<impl::cell_value> {
+			static constexpr auto members( ) {
+				return std::make_tuple(
+					json_getter( "id", &table_item::id ),
+					json_field( "value_type", &impl::cell_value::m_value_type ),
+					json_field( "string_value", &impl::cell_value::m_string_value ) );
+			}
+
+			/// @brief Re-evaluate the decoded text
+			static void decoded( impl::cell_value & value );
+		};	// json_schema<cell_value>
 	}	// namespace spreadsheet
 }	// namespace daw
 
@@ -0,0 +1,84 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <daw/nodepp/base_event_emitter.h>
+
+#include "cell_data.h"
+#include "column_store.h"
+#include "impl_cell_value.h"
+#include "json_text.h"
+#include "table_item.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace impl {
+			/// A column of cells.  The cells are plain values in a column_store and the
+			/// column maps them to and from JSON itself, so no per cell objects are built
+			class column: public table_item {
+				column_store m_store;
+			public:
+				column( daw::nodepp::base::EventEmitter emitter, std::shared_ptr<event_table> events = nullptr );
+				column( column const & other );
+				column( column && other );
+				column & operator=( column const & rhs );
+				column & operator=( column && rhs );
+				friend void swap( column & lhs, column & rhs );
+
+				size_t size( ) const noexcept;
+				bool empty( ) const noexcept;
+				cell_view operator[]( size_t row ) const;
+				void push_back( cell_value::expected_value_t value_type, boost::string_ref text );
+				void push_back( cell_data const & value );
+				void set_value( size_t row, boost::string_ref text );
+				void set( size_t row, cell_value::expected_value_t value_type, boost::string_ref text );
+				cell_data cell( size_t row ) const;
+
+				column_store & store( ) noexcept;
+				column_store const & store( ) const noexcept;
+
+				/// @brief Encode as {"id":..,"values":[{"value_type":..,"string_value":..},..]}
+				std::string encode( ) const;
+				/// @brief Replace the cells with those of the values array.  The id is not
+				/// restored, it identifies this column's listeners
+				/// @throws std::invalid_argument on malformed JSON
+				void decode( boost::string_ref json_text );
+
+				/// @brief Write the JSON encode( ) produces through out, a row at a time
+				void write( json_writer & out ) const;
+				/// @brief Read a column object, starting with the current token, as decode( ) does
+				void read( json_pull_reader & in, json_pull_reader::token current );
+				/// @brief Read the cells of a column object that starts with the current token,
+				/// keeping long text in pool when given one
+				static column_store read_store( json_pull_reader & in, json_pull_reader::token current, std::shared_ptr<string_pool> pool = nullptr );
+			};	// column
+
+			void swap( column & lhs, column & rhs );
+		}	// namespace impl
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,293 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "json_text.h"
+
+namespace daw {
+	namespace spreadsheet {
+		/// @brief Describes the JSON object for T.  Specialize with a static constexpr
+		/// members( ) returning a std::tuple of json_field and json_getter entries:
+		///		template<> struct json_schema<foo> {
+		///			static constexpr auto members( ) {
+		///				return std::make_tuple( json_field( "name", &foo::name ), json_getter( "id", &foo::id ) );
+		///			}
+		///		};
+		/// encode_json and decode_json are generated from it, nothing is registered per object.
+		/// An optional static void decoded( T & ) is called after an object is read
+		template<typename T>
+		struct json_schema;
+
+		/// @brief How a member type is written and read.  Specialize for enums and other
+		/// types that have a string form
+		template<typename T, typename = void>
+		struct json_value;
+
+		namespace impl {
+			template<typename...>
+			using void_t = void;
+
+			template<typename T, typename = void>
+			struct has_json_schema: std::false_type { };
+
+			template<typename T>
+			struct has_json_schema<T, void_t<decltype( json_schema<T>::members( ) )>>: std::true_type { };
+
+			template<typename T, typename = void>
+			struct has_decoded_hook: std::false_type { };
+
+			template<typename T>
+			struct has_decoded_hook<T, void_t<decltype( json_schema<T>::decoded( std::declval<T &>( ) ) )>>: std::true_type { };
+
+			template<typename T>
+			void call_decoded( T & value, std::true_type ) {
+				json_schema<T>::decoded( value );
+			}
+
+			template<typename T>
+			void call_decoded( T &, std::false_type ) { }
+
+			template<typename Tuple, typename Function, size_t... Is>
+			void for_each_member( Tuple const & members, Function & func, std::index_sequence<Is...> ) {
+				(void)std::initializer_list<int>{ (func( std::get<Is>( members ) ), 0)... };
+			}
+
+			template<typename... Members, typename Function>
+			void for_each_member( std::tuple<Members...> const & members, Function func ) {
+				for_each_member( members, func, std::index_sequence_for<Members...>{ } );
+			}
+
+			inline void append_json_name( std::string & out, char const * name ) {
+				// Schema names are identifiers and need no escaping
+				out += '"';
+				out += name;
+				out += "\":";
+			}
+		}	// namespace impl
+
+		/// A data member that is encoded and decoded
+		template<typename Class, typename Member>
+		struct json_field_t {
+			char const * name;
+			Member Class::* pointer;
+
+			template<typename T>
+			void encode( std::string & out, T const & obj ) const {
+				impl::append_json_name( out, name );
+				json_value<Member>::encode( out, obj.*pointer );
+			}
+
+			template<typename T>
+			void decode( json_reader & reader, T & obj ) const {
+				json_value<Member>::decode( reader, obj.*pointer );
+			}
+		};	// json_field_t
+
+		/// A value read through a const member function.  It is encoded only, and skipped
+		/// when decoding
+		template<typename Class, typename Result>
+		struct json_getter_t {
+			char const * name;
+			Result ( Class::* getter )( ) const;
+
+			template<typename T>
+			void encode( std::string & out, T const & obj ) const {
+				impl::append_json_name( out, name );
+				json_value<std::decay_t<Result>>::encode( out, (obj.*getter)( ) );
+			}
+
+			template<typename T>
+			void decode( json_reader & reader, T & ) const {
+				reader.skip_value( );
+			}
+		};	// json_getter_t
+
+		template<typename Class, typename Member>
+		constexpr json_field_t<Class, Member> json_field( char const * name, Member Class::* pointer ) noexcept {
+			return json_field_t<Class, Member>{ name, pointer };
+		}
+
+		template<typename Class, typename Result>
+		constexpr json_getter_t<Class, Result> json_getter( char const * name, Result ( Class::* getter )( ) const ) noexcept {
+			return json_getter_t<Class, Result>{ name, getter };
+		}
+
+		template<typename T>
+		void encode_json( std::string & out, T const & value ) {
+			static_assert( impl::has_json_schema<T>::value, "T needs a json_schema specialization" );
+			out += '{';
+			bool first = true;
+			impl::for_each_member( json_schema<T>::members( ), [&]( auto const & member ) {
+				if( !first ) {
+					out += ',';
+				}
+				first = false;
+				member.encode( out, value );
+			} );
+			out += '}';
+		}
+
+		/// @brief Read an object into value.  Members not in the schema are skipped and
+		/// members missing from the text keep their current value
+		template<typename T>
+		void decode_json( json_reader & reader, T & value ) {
+			static_assert( impl::has_json_schema<T>::value, "T needs a json_schema specialization" );
+			std::string name;
+			reader.expect( '{' );
+			for( bool first = true; reader.more( '}', first ); ) {
+				reader.read_string( name );
+				reader.expect( ':' );
+				bool found = false;
+				impl::for_each_member( json_schema<T>::members( ), [&]( auto const & member ) {
+					if( !found && name == member.name ) {
+						found = true;
+						member.decode( reader, value );
+					}
+				} );
+				if( !found ) {
+					reader.skip_value( );
+				}
+			}
+			impl::call_decoded( value, impl::has_decoded_hook<T>{ } );
+		}
+
+		template<typename T>
+		std::string to_json( T const & value ) {
+			std::string result;
+			encode_json( result, value );
+			return result;
+		}
+
+		template<typename T>
+		void from_json( boost::string_ref json_text, T & value ) {
+			json_reader reader{ json_text };
+			decode_json( reader, value );
+		}
+
+		template<>
+		struct json_value<std::string> {
+			static void encode( std::string & out, std::string const & value ) {
+				append_json_string( out, value );
+			}
+
+			static void decode( json_reader & reader, std::string & value ) {
+				reader.read_string( value );
+			}
+		};	// json_value<std::string>
+
+		/// Encode only, a string_ref cannot own decoded text
+		template<>
+		struct json_value<boost::string_ref> {
+			static void encode( std::string & out, boost::string_ref value ) {
+				append_json_string( out, value );
+			}
+		};	// json_value<boost::string_ref>
+
+		template<typename T>
+		struct json_value<T, std::enable_if_t<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>> {
+			static void encode( std::string & out, T value ) {
+				append_json_integer( out, value );
+			}
+
+			static void decode( json_reader & reader, T & value ) {
+				auto const result = reader.read_unsigned( );
+				if( result > std::numeric_limits<T>::max( ) ) {
+					throw std::invalid_argument{ "JSON number out of range" };
+				}
+				value = static_cast<T>( result );
+			}
+		};	// json_value<unsigned>
+
+		template<typename T>
+		struct json_value<T, std::enable_if_t<impl::has_json_schema<T>::value>> {
+			static void encode( std::string & out, T const & value ) {
+				encode_json( out, value );
+			}
+
+			static void decode( json_reader & reader, T & value ) {
+				decode_json( reader, value );
+			}
+		};	// json_value<schema>
+
+		/// An owned object, created on decode when null
+		template<typename T>
+		struct json_value<std::unique_ptr<T>> {
+			static void encode( std::string & out, std::unique_ptr<T> const & value ) {
+				if( value ) {
+					json_value<T>::encode( out, *value );
+				} else {
+					out += "null";
+				}
+			}
+
+			static void decode( json_reader & reader, std::unique_ptr<T> & value ) {
+				if( reader.peek( ) == 'n' ) {
+					reader.skip_value( );
+					value.reset( );
+					return;
+				}
+				if( !value ) {
+					value = std::make_unique<T>( );
+				}
+				json_value<T>::decode( reader, *value );
+			}
+		};	// json_value<std::unique_ptr>
+
+		template<typename T>
+		struct json_value<std::vector<T>> {
+			static void encode( std::string & out, std::vector<T> const & values ) {
+				out += '[';
+				for( size_t n = 0; n < values.size( ); ++n ) {
+					if( n > 0 ) {
+						out += ',';
+					}
+					json_value<T>::encode( out, values[n] );
+				}
+				out += ']';
+			}
+
+			static void decode( json_reader & reader, std::vector<T> & values ) {
+				values.clear( );
+				reader.expect( '[' );
+				for( bool first = true; reader.more( ']', first ); ) {
+					values.emplace_back( );
+					json_value<T>::decode( reader, values.back( ) );
+				}
+			}
+		};	// json_value<std::vector>
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,160 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace daw {
+	namespace spreadsheet {
+		/// @brief Append value as a quoted and escaped JSON string
+		void append_json_string( std::string & out, boost::string_ref value );
+		void append_json_integer( std::string & out, uint64_t value );
+
+		/// @brief Reads JSON text a token at a time, for types that map themselves without a
+		/// DOM.  Objects and arrays are walked with more( ):
+		///		reader.expect( '{' );
+		///		for( bool first = true; reader.more( '}', first ); ) {
+		///			auto name = reader.read_string( );
+		///			reader.expect( ':' );
+		///			...
+		///		}
+		/// @throws std::invalid_argument on malformed text
+		class json_reader {
+			char const * m_first;
+			char const * m_last;
+
+			[[noreturn]] void fail( char const * what ) const;
+		public:
+			explicit json_reader( boost::string_ref text ) noexcept;
+
+			void skip_whitespace( ) noexcept;
+			bool at_end( ) noexcept;
+			/// @return the next non whitespace character, or 0 at the end of the text
+			char peek( ) noexcept;
+			void expect( char c );
+			/// @brief Consume the separator before the next member or element
+			/// @return false, having consumed close, when there are no more
+			bool more( char close, bool & first );
+
+			void read_string( std::string & out );
+			std::string read_string( );
+			uint64_t read_unsigned( );
+			/// @brief Skip any value, including nested objects and arrays
+			void skip_value( );
+		};	// json_reader
+
+		/// @brief Writes JSON to a std::ostream or file descriptor as it is produced.  At most
+		/// buffer_size bytes, plus the value being written, are held before being written out.
+		/// Separators are added as values and keys are written
+		class json_writer {
+			std::ostream * m_stream;
+			int m_fd;
+			std::string m_buffer;
+			size_t m_buffer_size;
+			uint64_t m_bytes_written;
+			// One entry per open object or array, true until its first member
+			std::vector<bool> m_first;
+			bool m_after_key;
+
+			void write_out( char const * data, size_t size );
+			void separate( );
+		public:
+			static constexpr size_t default_buffer_size = 64 * 1024;
+
+			explicit json_writer( std::ostream & out, size_t buffer_size = default_buffer_size );
+			explicit json_writer( int fd, size_t buffer_size = default_buffer_size );
+			/// @brief Flushes, errors are lost, call flush( ) first to see them
+			~json_writer( );
+			json_writer( json_writer const & ) = delete;
+			json_writer( json_writer && ) = delete;
+			json_writer & operator=( json_writer const & ) = delete;
+			json_writer & operator=( json_writer && ) = delete;
+
+			void begin_object( );
+			void end_object( );
+			void begin_array( );
+			void end_array( );
+			void key( boost::string_ref name );
+			void value( boost::string_ref text );
+			void value( uint64_t number );
+			/// @brief Start a value and return the buffer to append its JSON text to
+			std::string & value_buffer( );
+
+			/// @throws std::runtime_error when the output cannot be written
+			void flush( );
+			/// @return bytes handed to the output so far, excluding those still buffered
+			uint64_t bytes_written( ) const noexcept;
+		};	// json_writer
+
+		/// @brief Reads JSON from a std::istream or file descriptor through a fixed size
+		/// buffer, returning one token at a time.  No DOM is built, the caller consumes the
+		/// tokens as they arrive.  Separators are checked loosely
+		/// @throws std::invalid_argument on malformed text
+		class json_pull_reader {
+		public:
+			enum class token: uint8_t { end, begin_object, end_object, begin_array, end_array, key, string, number, literal };
+		private:
+			std::istream * m_stream;
+			int m_fd;
+			std::vector<char> m_buffer;
+			size_t m_pos;
+			size_t m_end;
+			bool m_eof;
+			std::string m_text;
+
+			[[noreturn]] void fail( char const * what ) const;
+			/// @brief Make at least count bytes available unless the input ends first
+			bool fill( size_t count );
+			char peek( );
+			void skip_separators( );
+			void read_string( );
+		public:
+			static constexpr size_t default_buffer_size = 64 * 1024;
+
+			explicit json_pull_reader( std::istream & in, size_t buffer_size = default_buffer_size );
+			explicit json_pull_reader( int fd, size_t buffer_size = default_buffer_size );
+			json_pull_reader( json_pull_reader const & ) = delete;
+			json_pull_reader( json_pull_reader && ) = delete;
+			json_pull_reader & operator=( json_pull_reader const & ) = delete;
+			json_pull_reader & operator=( json_pull_reader && ) = delete;
+
+			token next( );
+			/// @brief The key, string, number or literal text of the last token
+			std::string const & text( ) const noexcept;
+			/// @brief Skip the value that starts with current, reading to the matching end
+			/// of an object or array
+			void skip( token current );
+			/// @brief Read the next token and skip the value it starts
+			void skip_value( );
+			/// @throws std::invalid_argument if the next token is not expected
+			void expect( token expected );
+		};	// json_pull_reader
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,94 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "cell_address.h"
+#include "formula_vm.h"
+
+namespace daw {
+	namespace spreadsheet {
+		enum class lookup_index_kind: uint8_t { hash, sorted };
+
+		/// @brief Secondary indexes over the values of one column, used by MATCH and VLOOKUP
+		/// in place of a scan.  The hash index answers exact matches in O( 1 ) from the hash
+		/// of each value.  The sorted index answers approximate matches, and exact ones
+		/// without a hash index, in O( log n ).  Rows holding formulas are kept aside and
+		/// read when searched, as their results change during recalculation
+		class lookup_index {
+		public:
+			using row_t = cell_address::index_t;
+			/// Reads the current value of a row of the column
+			using value_of_t = std::function<formula_value( row_t )>;
+		private:
+			struct sorted_entry {
+				formula_value value;
+				row_t row;
+			};	// sorted_entry
+
+			/// Orders numbers before text before booleans, then by value and row
+			struct sorted_less {
+				bool operator( )( sorted_entry const & lhs, sorted_entry const & rhs ) const;
+			};	// sorted_less
+
+			bool m_hashed;
+			bool m_sorted;
+			// Rows of each value hash in ascending order
+			std::unordered_map<uint64_t, std::vector<row_t>> m_hash;
+			std::set<sorted_entry, sorted_less> m_values;
+			std::set<row_t> m_formula_rows;
+		public:
+			lookup_index( );
+
+			bool has( lookup_index_kind kind ) const noexcept;
+			/// @brief Start keeping kind, the rows must then all be added again
+			void enable( lookup_index_kind kind );
+			void disable( lookup_index_kind kind );
+			/// @return false when no kind of index is kept
+			bool enabled( ) const noexcept;
+			/// @brief Drop every entry but keep the kinds enabled
+			void clear( ) noexcept;
+
+			/// @brief Index the value of row, values that are not lookup keys are skipped
+			void add( row_t row, formula_value const & value );
+			/// @brief Remove row, value must be the value it was added with
+			void remove( row_t row, formula_value const & value );
+			void add_formula( row_t row );
+			void remove_formula( row_t row );
+
+			/// @return whether the kinds kept can answer lookups of match_type
+			bool can_match( int match_type ) const noexcept;
+			/// @brief impl::linear_match over rows first to last of the column.  Searches costing
+			/// more than a scan of the rows, say of a small range in a large index, scan instead
+			/// @return the offset from first of the row found, or impl::no_match
+			size_t match( formula_value const & key, int match_type, row_t first, row_t last, value_of_t const & value_of ) const;
+		};	// lookup_index
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,59 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <string>
+
+namespace daw {
+	namespace spreadsheet {
+		/// @brief Throw a std::runtime_error naming what failed on path and why, from errno
+		[[noreturn]] void io_error( char const * what, std::string const & path );
+
+		/// @brief Make a rename or unlink of an entry of the directory holding path durable
+		/// @throws std::runtime_error when the directory cannot be synced
+		void sync_directory( std::string const & path );
+
+		/// @brief A whole file mapped read only into memory.  An empty file maps to an empty range
+		class mapped_file {
+			void * m_data;
+			size_t m_size;
+		public:
+			/// @throws std::runtime_error when the file cannot be opened or mapped
+			explicit mapped_file( std::string const & path );
+			mapped_file( ) noexcept;
+			~mapped_file( );
+			mapped_file( mapped_file const & ) = delete;
+			mapped_file( mapped_file && other ) noexcept;
+			mapped_file & operator=( mapped_file const & ) = delete;
+			mapped_file & operator=( mapped_file && rhs ) noexcept;
+			void swap( mapped_file & rhs ) noexcept;
+
+			char const * data( ) const noexcept;
+			size_t size( ) const noexcept;
+			boost::string_ref view( ) const noexcept;
+		};	// mapped_file
+	}	// namespace spreadsheet
+}	// namespace daw
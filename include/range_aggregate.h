@@ -0,0 +1,50 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "column_store.h"
+#include "formula_vm.h"
+
+namespace daw {
+	namespace spreadsheet {
+		enum class simd_level: uint8_t { scalar, sse42, avx2 };
+
+		/// @brief The best kernel set this CPU can run
+		simd_level supported_simd_level( ) noexcept;
+		/// @brief The kernel set in use, the supported one unless lowered with set_simd_level
+		simd_level active_simd_level( ) noexcept;
+		/// @brief Select a kernel set, capped at what the CPU supports.  For benchmarks and
+		/// for checking the kernels against each other
+		void set_simd_level( simd_level level ) noexcept;
+
+		/// @brief SUM, AVERAGE, MIN, MAX or COUNT over rows [first_row, first_row + row_count)
+		/// of a column.  Only rows holding a valid number take part.  Other functions give
+		/// #VALUE!, an AVERAGE of no numbers #DIV/0!
+		formula_value aggregate_value( impl::column_store const & store, formula_function function, size_t first_row, size_t row_count );
+		impl::cell_value::cell_variant_t aggregate( impl::column_store const & store, formula_function function, size_t first_row, size_t row_count );
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,131 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cell_address.h"
+#include "dependency_graph.h"
+#include "thread_pool.h"
+
+namespace daw {
+	namespace spreadsheet {
+		struct recalc_options {
+			/// Threads used for recalculation including the calling thread, 0 for all cores.
+			/// Ignored when pool is set
+			size_t thread_count;
+			/// Commit results on the calling thread in plan order instead of as they finish
+			bool deterministic;
+			/// Cells handed to a worker at a time
+			size_t grain;
+			/// Leave the formulas affected by an edit stale and evaluate them when a range
+			/// holding them, or reading them, is evaluated
+			bool lazy;
+			/// Pool to recalculate on, which may be shared by many sheets.  When null a
+			/// thread_count of 0 uses shared_thread_pool( ) and any other count gets a pool
+			/// of its own
+			std::shared_ptr<thread_pool> pool;
+
+			recalc_options( ):
+					thread_count{ 0 },
+					deterministic{ false },
+					grain{ 64 },
+					lazy{ false },
+					pool{ } { }
+		};	// recalc_options
+
+		/// @brief Recalculates the dirty cells of a dependency_graph on a work stealing
+		/// thread pool.  Each topological level of the plan is run in parallel, a level
+		/// only starts once every cell of the previous level has been committed.
+		class recalc_scheduler {
+			recalc_options m_options;
+			std::shared_ptr<thread_pool> m_pool;
+		public:
+			explicit recalc_scheduler( recalc_options options = recalc_options{ } );
+			~recalc_scheduler( );
+			recalc_scheduler( recalc_scheduler const & ) = delete;
+			recalc_scheduler( recalc_scheduler && ) = delete;
+			recalc_scheduler & operator=( recalc_scheduler const & ) = delete;
+			recalc_scheduler & operator=( recalc_scheduler && ) = delete;
+
+			recalc_options const & options( ) const noexcept;
+			size_t thread_count( ) const noexcept;
+			thread_pool & pool( ) noexcept;
+
+			/// @brief Evaluate the dirty cells of graph.
+			/// compute( cell_address ) is called concurrently and must only read cells.
+			/// commit( cell_address, result ) stores the result.  In deterministic mode it
+			/// is called on the calling thread in plan order, otherwise it is called on the
+			/// worker that computed the value and must be thread safe.
+			/// @return the plan that was run, cells in plan.cycle were not evaluated
+			template<typename Compute, typename Commit>
+			recalc_plan run( dependency_graph & graph, Compute compute, Commit commit ) {
+				auto plan = graph.take_dirty( );
+				run( plan, compute, commit );
+				return plan;
+			}
+
+			/// @brief Evaluate the cells of a plan taken from a dependency_graph, as run does
+			template<typename Compute, typename Commit>
+			void run( recalc_plan const & plan, Compute compute, Commit commit ) {
+				for( size_t level = 0; level < plan.level_count( ); ++level ) {
+					auto const first = plan.level_offsets[level];
+					auto const count = plan.level_offsets[level + 1] - first;
+					if( m_options.deterministic ) {
+						using result_t = decltype( compute( std::declval<cell_address>( ) ) );
+						std::vector<result_t> results( count );
+						m_pool->parallel_for( count, m_options.grain, [&]( size_t n ) {
+							results[n] = compute( plan.order[first + n] );
+						} );
+						for( size_t n = 0; n < count; ++n ) {
+							commit( plan.order[first + n], std::move( results[n] ) );
+						}
+					} else {
+						m_pool->parallel_for( count, m_options.grain, [&]( size_t n ) {
+							auto const & cell = plan.order[first + n];
+							commit( cell, compute( cell ) );
+						} );
+					}
+				}
+			}
+
+			/// @brief Evaluate the dirty cells of graph by calling evaluate( cell_address )
+			/// concurrently for the cells of each level
+			template<typename Evaluate>
+			recalc_plan run( dependency_graph & graph, Evaluate evaluate ) {
+				auto plan = graph.take_dirty( );
+				for( size_t level = 0; level < plan.level_count( ); ++level ) {
+					auto const first = plan.level_offsets[level];
+					auto const count = plan.level_offsets[level + 1] - first;
+					m_pool->parallel_for( count, m_options.grain, [&]( size_t n ) {
+						evaluate( plan.order[first + n] );
+					} );
+				}
+				return plan;
+			}
+		};	// recalc_scheduler
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,87 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "cell_address.h"
+#include "formula_vm.h"
+#include "thread_pool.h"
+
+namespace daw {
+	namespace spreadsheet {
+		class sheet;
+
+		/// @brief The rows of a sheet in some order, possibly a subset of them.  Row n of
+		/// the view is row source_row( n ) of the sheet, no cells are moved to make one
+		class row_view {
+			std::vector<cell_address::index_t> m_rows;
+			size_t m_source_rows;
+		public:
+			row_view( );
+			/// @brief Every row of a sheet with row_count rows, in order
+			explicit row_view( size_t row_count );
+			/// @param rows the source row of each row of the view
+			/// @param source_rows rows in the sheet the view was made from
+			/// @throws std::out_of_range when a row is not below source_rows
+			row_view( std::vector<cell_address::index_t> rows, size_t source_rows );
+
+			size_t size( ) const noexcept;
+			bool empty( ) const noexcept;
+			size_t source_rows( ) const noexcept;
+			std::vector<cell_address::index_t> const & rows( ) const noexcept;
+
+			/// @throws std::out_of_range when row is not below size( )
+			size_t source_row( size_t row ) const;
+			/// @brief The cell of the sheet shown at cell of the view
+			cell_address source_cell( cell_address const & cell ) const;
+		};	// row_view
+
+		struct sort_key {
+			size_t column;
+			bool ascending;
+
+			sort_key( size_t key_column, bool is_ascending = true ) noexcept;
+		};	// sort_key
+
+		/// @brief Order the rows of view by keys, the first key deciding first.  Numbers sort
+		/// before times, timestamps, text, booleans and errors, each compared by value and
+		/// text without case; empty cells sort last in either direction.  Formula cells sort
+		/// by their result, stale formulas of the key columns are evaluated first.  Rows that
+		/// compare equal keep their order in view.  Runs as a merge sort on pool
+		row_view sort_rows( sheet & source, row_view const & view, std::vector<sort_key> const & keys, thread_pool & pool );
+		/// @brief Sort every row of source
+		row_view sort_rows( sheet & source, std::vector<sort_key> const & keys, thread_pool & pool );
+
+		/// @brief The rows of view for which keep( source_row ) is true, in view order.
+		/// keep is called from the threads of pool
+		row_view filter_rows( row_view const & view, std::function<bool( size_t source_row )> const & keep, thread_pool & pool );
+		/// @brief The rows of view whose value in column passes test, read as sheet::value does
+		/// after evaluating the stale formulas of column
+		row_view filter_rows( sheet & source, row_view const & view, size_t column, std::function<bool( formula_value const & value )> const & test, thread_pool & pool );
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,207 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <daw/nodepp/base_event_emitter.h>
+
+#include "cell_address.h"
+#include "change_set.h"
+#include "dependency_graph.h"
+#include "edit_journal.h"
+#include "event_table.h"
+#include "formula_cache.h"
+#include "formula_vm.h"
+#include "id_registry.h"
+#include "impl_column.h"
+#include "json_text.h"
+#include "lookup_index.h"
+#include "recalc_scheduler.h"
+#include "row_view.h"
+#include "sparse_grid.h"
+#include "string_pool.h"
+#include "table_item.h"
+
+namespace daw {
+	namespace spreadsheet {
+		/// @brief A grid of columns whose formula cells are kept up to date as cells change.
+		/// Edits made inside a transaction are recalculated together when the outermost
+		/// transaction commits and listeners receive a single change_set for them.  Edits
+		/// outside of a transaction are committed one at a time
+		class sheet: public table_item {
+			struct formula_cell {
+				// Shared by every cell whose formula has the same shape
+				std::shared_ptr<compiled_formula const> formula;
+				formula_value result;
+			};	// formula_cell
+
+			// Text of every column, so repeated text is stored once per sheet
+			std::shared_ptr<string_pool> m_strings;
+			std::shared_ptr<formula_cache> m_formula_cache;
+			// A deque so adding columns never relocates, and so never re-identifies, existing ones
+			std::deque<impl::column> m_columns;
+			// Index of each column by its id
+			id_registry<size_t> m_column_ids;
+			sparse_grid<formula_cell> m_formulas;
+			// Lookup indexes by column, null for columns without one
+			std::vector<std::unique_ptr<lookup_index>> m_indexes;
+			dependency_graph m_graph;
+			std::unique_ptr<recalc_scheduler> m_scheduler;
+			// Cells edited since the outermost transaction began
+			std::vector<cell_address> m_edited;
+			size_t m_transaction_depth;
+			std::shared_ptr<edit_journal> m_journal;
+
+			impl::column & prepare_cell( cell_address const & cell );
+			void finish_edit( impl::column const & col, cell_address const & cell, boost::string_ref text );
+			void store_formula( cell_address const & cell, boost::string_ref text );
+			void erase_formula( cell_address const & cell );
+			formula_value compute( cell_address const & cell ) const;
+			void run_plan( recalc_plan const & plan );
+			void recalculate_edits( );
+			lookup_index * index_of( size_t column ) const noexcept;
+			// Called before and after a cell of an indexed column changes
+			void unindex_cell( cell_address const & cell );
+			void index_cell( cell_address const & cell );
+			void rebuild_index( size_t column );
+			// Log the whole column as absolute assignments
+			void journal_column( size_t column );
+		public:
+			/// @brief Commits the transaction it began when destroyed, unless commit( ) was called
+			class transaction {
+				sheet * m_sheet;
+			public:
+				explicit transaction( sheet & owner );
+				~transaction( );
+				transaction( transaction const & ) = delete;
+				transaction( transaction && ) = delete;
+				transaction & operator=( transaction const & ) = delete;
+				transaction & operator=( transaction && ) = delete;
+
+				void commit( );
+			};	// transaction
+
+			explicit sheet( daw::nodepp::base::EventEmitter emitter, recalc_options options = recalc_options{ } );
+			~sheet( );
+			sheet( sheet const & ) = delete;
+			sheet( sheet && ) = default;
+			sheet & operator=( sheet const & ) = delete;
+			sheet & operator=( sheet && ) = default;
+
+			size_t column_count( ) const noexcept;
+			/// @return the number of rows in the longest column
+			size_t row_count( ) const noexcept;
+			/// @brief Add or remove columns.  Formulas reading removed columns are recalculated
+			void resize( size_t column_count );
+			impl::column const & column( size_t index ) const;
+			/// @return the column with id, or nullptr when no column of this sheet has it
+			impl::column const * find_column( id_t id ) const noexcept;
+			/// @throws std::out_of_range when no column of this sheet has id
+			size_t column_index( id_t id ) const;
+			std::shared_ptr<string_pool> const & strings( ) const noexcept;
+			std::shared_ptr<formula_cache> const & formulas( ) const noexcept;
+
+			/// @brief Set the text of a cell, a leading = makes it a formula.  Columns and
+			/// rows are added as needed
+			void set_value( cell_address const & cell, boost::string_ref text );
+			/// @brief Set the text and expected type of a cell
+			void set_value( cell_address const & cell, impl::cell_value::expected_value_t value_type, boost::string_ref text );
+			/// @brief Copy the cells of source so its top left cell lands on destination, as a
+			/// paste does.  Relative references of copied formulas move with them and the copies
+			/// share the source's compiled formula.  Overlapping ranges copy source as it was
+			/// @throws std::out_of_range when the copy would extend past the last row or column
+			void copy_cells( cell_range const & source, cell_address const & destination );
+			/// @brief Copy the top row of range into the rows below it
+			void fill_down( cell_range const & range );
+			/// @brief Empty every cell of a column as a single change
+			void clear_column( size_t index );
+			/// @brief Replace the cells of a column as a single change, adding columns as needed.
+			/// A journal receives it as a clear_column and a set for each non-empty cell, so
+			/// compact the journal after bulk loads
+			void assign_column( size_t index, impl::column_store store );
+			/// @brief Move the rows of every column into the order of view as a single change,
+			/// rows the view leaves out following in their current order.  Each column is
+			/// reordered in one pass and relative references of formulas move with their
+			/// rows.  Journaled like assign_column for every column
+			/// @throws std::invalid_argument when view was not made from this sheet's rows or
+			/// repeats a row
+			void reorder_rows( row_view const & view );
+
+			boost::string_ref string_value( cell_address const & cell ) const;
+			/// @return the value of a cell, the last computed result for formulas.  With
+			/// recalc_options::lazy that result is stale until an evaluate( ) covers the cell
+			formula_value value( cell_address const & cell ) const;
+			bool is_formula( cell_address const & cell ) const;
+
+			/// @brief Bring the stale formulas of range up to date, evaluating only them and
+			/// the stale cells they transitively read.  Listeners receive the evaluated cells.
+			/// Nothing is stale unless the sheet was made with recalc_options::lazy
+			void evaluate( cell_range const & range );
+			/// @brief The values of range row by row, as a viewport shows them, after
+			/// evaluating it
+			std::vector<formula_value> values( cell_range const & range );
+			/// @return true when cell is a formula whose result is out of date
+			bool is_stale( cell_address const & cell ) const;
+			size_t stale_count( ) const noexcept;
+
+			/// @brief Keep a lookup index of kind on a column for MATCH and VLOOKUP.  It is
+			/// built now and updated on every edit of the column
+			/// @throws std::out_of_range when the column does not exist
+			void create_index( size_t column, lookup_index_kind kind );
+			void drop_index( size_t column, lookup_index_kind kind );
+			bool has_index( size_t column, lookup_index_kind kind ) const noexcept;
+			/// @brief impl::linear_match over range, answered from the column's lookup index
+			/// when it has one that supports match_type
+			size_t find_match( cell_range const & range, formula_value const & key, int match_type ) const;
+
+			void begin_transaction( );
+			/// @brief End a transaction.  Ending the outermost recalculates the formulas
+			/// affected by its edits in one pass and then delivers the deferred events
+			/// @throws std::logic_error when no transaction is open
+			void commit( );
+			size_t transaction_depth( ) const noexcept;
+
+			/// @brief Write {"id":..,"columns":[..]} with each column as column::encode( )
+			/// produces it, a row at a time
+			void write( json_writer & out ) const;
+			/// @brief Replace the columns with those read from in, filling each column's store
+			/// as its cells arrive.  All cells are committed as one change
+			/// @throws std::invalid_argument on malformed JSON
+			void read( json_pull_reader & in );
+
+			/// @brief Log every edit to journal from now on, null stops logging
+			void attach_journal( std::shared_ptr<edit_journal> journal );
+			std::shared_ptr<edit_journal> const & journal( ) const noexcept;
+
+			/// @brief The listener receives the cells and items changed by each commit,
+			/// including formula cells whose result was recalculated
+			event_table::token_t on_changes( event_table::change_listener_t listener );
+		};	// sheet
+	}	// namespace spreadsheet
+}	// namespace daw
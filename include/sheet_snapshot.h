@@ -0,0 +1,110 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cell_address.h"
+#include "column_store.h"
+#include "impl_cell_value.h"
+#include "mapped_file.h"
+
+namespace daw {
+	namespace spreadsheet {
+		class sheet;
+
+		/// @brief CRC-32C (Castagnoli) of data, continuing from crc.  Uses the SSE4.2 crc32
+		/// instruction when the CPU has it
+		uint32_t crc32c( void const * data, size_t size, uint32_t crc = 0 ) noexcept;
+
+		/// @brief A read only view of a sheet snapshot file, memory mapped so opening only
+		/// reads and checks the header and column directory.  Cell text is returned straight
+		/// from the mapping and typed values are decoded when asked for.  Each column's
+		/// checksum is verified the first time the column is accessed.
+		///
+		/// Layout, little endian, version 1:
+		///		header		magic "DAWSNAP", version, column count, directory crc, header crc
+		///		directory	per column: section offset and size, row count, heap size, crc
+		///		sections	per column, 8 byte aligned: uint32 text end offsets[rows],
+		///					text heap, uint8 expected types[rows]
+		class sheet_snapshot {
+		public:
+			using expected_value_t = impl::cell_value::expected_value_t;
+			using cell_variant_t = impl::cell_value::cell_variant_t;
+			static constexpr uint32_t current_version = 1;
+		private:
+			struct column_t {
+				uint32_t const * offsets;
+				char const * heap;
+				uint8_t const * types;
+				uint32_t rows;
+				uint32_t crc;
+				uint64_t section_size;
+			};	// column_t
+
+			mapped_file m_file;
+			std::vector<column_t> m_columns;
+			std::unique_ptr<std::once_flag[]> m_verified;
+
+			column_t const & checked_column( size_t column ) const;
+		public:
+			/// @throws std::runtime_error when the file cannot be mapped or its header,
+			/// directory or layout is invalid
+			explicit sheet_snapshot( std::string const & path );
+			~sheet_snapshot( );
+			sheet_snapshot( sheet_snapshot const & ) = delete;
+			sheet_snapshot( sheet_snapshot && other ) noexcept;
+			sheet_snapshot & operator=( sheet_snapshot const & ) = delete;
+			sheet_snapshot & operator=( sheet_snapshot && rhs ) noexcept;
+			void swap( sheet_snapshot & rhs ) noexcept;
+
+			size_t column_count( ) const noexcept;
+			/// @throws std::runtime_error when the column's checksum does not match
+			size_t row_count( size_t column ) const;
+			expected_value_t value_type( cell_address const & cell ) const;
+			/// @return the cell's text, pointing into the mapped file
+			boost::string_ref string_value( cell_address const & cell ) const;
+			cell_variant_t to_variant( cell_address const & cell ) const;
+
+			/// @brief Check every column's checksum
+			bool verify( ) const noexcept;
+			/// @brief Copy a column's cells, keeping long text in pool when given one
+			impl::column_store load_column( size_t column, std::shared_ptr<string_pool> pool = nullptr ) const;
+			/// @brief Replace the columns of target as one change
+			void load( sheet & target ) const;
+		};	// sheet_snapshot
+
+		/// @brief Write the cells of source as a snapshot.  The file is written beside path,
+		/// synced and renamed over it, and the rename is synced before returning
+		/// @throws std::runtime_error on IO errors
+		void write_snapshot( sheet const & source, std::string const & path );
+		void write_snapshot( std::vector<impl::column_store> const & columns, std::string const & path );
+	}	// namespace spreadsheet
+}	// namespace daw
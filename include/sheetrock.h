@@ -33,6 +33,8 @@
 #include <daw/daw_optional.h>
 #include <daw/daw_optional_poly.h>
 
+#include "cell_address.h"
+
 namespace daw {
 	namespace parser {
 		namespace sheetrock {
@@ -50,11 +52,43 @@ namespace daw {
 
 				struct expression: public ast_item { };
 
-				struct boolean: public expression { };
-				struct number: public expression { };
-				struct string: public expression { };
+				struct boolean: public expression {
+					bool value;
+					explicit boolean( bool v ):
+							expression{ },
+							value{ v } { }
+					virtual ~boolean( ) = default;
+				};	// boolean
+
+				struct number: public expression {
+					/// Decimal text of the number, converted without loss when compiled
+					std::string value;
+					explicit number( std::string v ):
+							expression{ },
+							value{ std::move( v ) } { }
+					virtual ~number( ) = default;
+				};	// number
+
+				struct string: public expression {
+					std::string value;
+					explicit string( std::string v ):
+							expression{ },
+							value{ std::move( v ) } { }
+					virtual ~string( ) = default;
+				};	// string
+
 				struct variant: public expression { };
-				struct cell: public ast_item { };
+
+				struct cell: public expression {
+					daw::spreadsheet::cell_address address;
+					cell( ):
+							expression{ },
+							address{ } { }
+					explicit cell( daw::spreadsheet::cell_address a ):
+							expression{ },
+							address{ a } { }
+					virtual ~cell( ) = default;
+				};	// cell
 
 				struct range: public expression {
 					daw::optional_poly<cell> first;
@@ -69,6 +103,16 @@ namespace daw {
 
 				struct unary_operator: public expression {
 					daw::optional_poly<expression> rhs;
+					/// '-' for negation or '%' for percent
+					char op;
+					unary_operator( ):
+							expression{ },
+							rhs{ },
+							op{ '-' } { }
+					unary_operator( char o, daw::optional_poly<expression> r ):
+							expression{ },
+							rhs{ std::move( r ) },
+							op{ o } { }
 					virtual ~unary_operator( ) = default;
 				};	// unary_operator
 
@@ -76,38 +120,18 @@ namespace daw {
 					daw::optional_poly<expression> lhs;
 					daw::optional_poly<expression> rhs;
 					virtual ~binary_operator( ) = default;
+					virtual int32_t op_char( ) const = 0;
 				protected:
-					template<typename ForwardIterator, typename T>
-					binary_operator( ForwardIterator first, ForwardIterator last, T op ):
+					binary_operator( daw::optional_poly<expression> l, daw::optional_poly<expression> r ):
 							expression{ },
-							lhs{ },
-							rhs{ } {
-
-						auto rng = daw::parser::split_on( first, last, op );
-						daw::exception::daw_throw_on_false<daw::parser::ParserException>( rng.size( ) == 2, "Expected binary expression" );
-						auto l = parse_expression( rng[0].begin( ), rng[0].end( ) );
-						auto r = parse_expression( rng[1].begin( ), rng[1].end( ) );
-						daw::exception::daw_throw_on_false<daw::parser::ParserException>( l, "Invalid expression on lhs of +" );
-						daw::exception::daw_throw_on_false<daw::parser::ParserException>( r, "Invalid expression on rhs of +" );
-						lhs = *l;
-						rhs = *r;
-					}
-
-					virtual int32_t op_char( ) const = 0;
+							lhs{ std::move( l ) },
+							rhs{ std::move( r ) } { }
 				};	// binary_operator
 				namespace impl {
 					template<char op>
 					struct bin_op_derived: public binary_operator {
-						template<typename ForwardIterator>
-						bin_op_derived( ForwardIterator first, ForwardIterator last ):
-								binary_operator{ first, last, op } { }
-
-						template<typename ForwardIterator>
-							static daw::optional_poly<bin_op_derived> create( ForwardIterator first, ForwardIterator last ) {
-								daw::optional_poly<bin_op_derived> result;
-								result = bin_op_derived( first, last );
-								return result;
-							}
+						bin_op_derived( daw::optional_poly<expression> l, daw::optional_poly<expression> r ):
+								binary_operator{ std::move( l ), std::move( r ) } { }
 
 						int32_t op_char( ) const override { return static_cast<int32_t>(op); }
 					};    // bin_op_derived
@@ -126,41 +150,15 @@ namespace daw {
 				using bin_op_equal = impl::bin_op_derived<'='>;
 
 
-				template<typename ForwardIterator, typename T>
-				daw::optional_poly<binary_operator> get_binary_operator( ForwardIterator first, ForwardIterator last, T op ) {
-					switch( op ) {
-					case '+': return bin_op_addition::create<ForwardIterator>( first, last );
-					case '-': return bin_op_subtraction::create<ForwardIterator>( first, last );
-					case '*': return bin_op_multiplication::create<ForwardIterator>( first, last );
-					case '/': return bin_op_division::create<ForwardIterator>( first, last );
-					case '%': return bin_op_modulus::create<ForwardIterator>( first, last );
-					case '^': return bin_op_power::create<ForwardIterator>( first, last );
-					case '&': return bin_op_and::create<ForwardIterator>( first, last );
-					case '|': return bin_op_or::create<ForwardIterator>( first, last );
-					case '<': return bin_op_less::create<ForwardIterator>( first, last );
-					case '>': return bin_op_greater::create<ForwardIterator>( first, last );
-					case '=': return bin_op_equal::create<ForwardIterator>( first, last );
-					default:
-						return daw::optional_poly<binary_operator>{ };
-					}
-				}
-
 				template<typename T>
 				bool is_binary_operator( T value ) {
 					return is_a( value, '+', '-', '*', '/', '%', '^', '&', '|', '<', '>', '=' );
 				}
 
-				template<typename ForwardIterator>
-				daw::optional_poly<expression> create_binary_operation( ForwardIterator first, ForwardIterator last ) {
-					using value_t = daw::traits::root_type_t<decltype(*first)>;
-					auto lhs = daw::parser::until( first, last, &is_binary_operator<value_t> );
-					daw::exception::daw_throw_on_false<daw::parser::ParserException>( lhs, "Could not find binary operator" );
-					return get_binary_operator<ForwardIterator>( first, last, *lhs.last );
-				}
-
 				struct function: public expression {
 					daw::optional_poly<label> name;
 					daw::optional_poly<block> blk;
+					std::vector<daw::optional_poly<expression>> arguments;
 					virtual ~function( ) = default;
 				};	// function
 			}	// namespace ast	
@@ -207,14 +205,6 @@ namespace daw {
 					return result;
 				}
 
-			template<typename ForwardIterator>
-				daw::optional_poly<ast::expression> parse_expression( ForwardIterator first, ForwardIterator const last ) {
-					auto result = parse_binary_operand( first, last );
-					if( result ) {
-						return result;
-					}
-				}
-
 			template<typename ForwardIterator>
 			std::vector<ast::ast_item> parse( ForwardIterator first, ForwardIterator const last ) {
 				std::vector<ast::ast_item> result;
@@ -0,0 +1,102 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "cell_address.h"
+
+namespace daw {
+	namespace parser {
+		namespace sheetrock {
+			enum class flat_kind: uint8_t { number, string, boolean, cell, range, unary_operator, binary_operator, function };
+
+			/// A node of a flat_ast.  The meaning of a-d depends on kind
+			///		number, string:		a, b = offset and size of the text in the arena
+			///		boolean:			op = 0 or 1
+			///		cell:				a, b = row, column; op = reference_anchor bits
+			///		range:				a, b = first row, column; c, d = last row, column; op = reference_anchor
+			///							bits of first, and of last shifted left by 2
+			///		unary_operator:		op, a = operand
+			///		binary_operator:	op, a = lhs, b = rhs
+			///		function:			a, b = name text; c, d = first argument slot and argument count
+			struct flat_node {
+				flat_kind kind;
+				char op;
+				uint32_t a;
+				uint32_t b;
+				uint32_t c;
+				uint32_t d;
+			};	// flat_node
+
+			/// @brief An arena holding the nodes of one or more parsed formulas.  Children are
+			/// referred to by index and all text lives in one buffer, so a formula is freed
+			/// in one step and clear( ) keeps the storage for reuse by the next batch.
+			class flat_ast {
+				std::vector<flat_node> m_nodes;
+				std::vector<uint32_t> m_arguments;
+				std::vector<uint32_t> m_scratch;
+				std::string m_text;
+			public:
+				using index_t = uint32_t;
+				static constexpr index_t npos = std::numeric_limits<index_t>::max( );
+
+				flat_ast( );
+				~flat_ast( );
+				flat_ast( flat_ast const & ) = default;
+				flat_ast( flat_ast && ) = default;
+				flat_ast & operator=( flat_ast const & ) = default;
+				flat_ast & operator=( flat_ast && ) = default;
+
+				/// @brief Drop all nodes but keep the allocated storage
+				void clear( ) noexcept;
+				size_t size( ) const noexcept;
+				size_t memory_usage( ) const noexcept;
+
+				flat_node const & operator[]( index_t index ) const;
+				boost::string_ref text( flat_node const & node ) const;
+				index_t argument( flat_node const & node, uint32_t n ) const;
+				daw::spreadsheet::cell_address address( flat_node const & node ) const;
+				daw::spreadsheet::cell_range range( flat_node const & node ) const;
+
+				index_t add_number( boost::string_ref text );
+				index_t add_string( boost::string_ref value );
+				index_t add_boolean( bool value );
+				index_t add_cell( daw::spreadsheet::cell_address const & address, uint8_t anchors = 0 );
+				index_t add_range( daw::spreadsheet::cell_address const & first, daw::spreadsheet::cell_address const & last, uint8_t anchors = 0 );
+				index_t add_unary( char op, index_t operand );
+				index_t add_binary( char op, index_t lhs, index_t rhs );
+
+				/// Function arguments are collected on a scratch stack so nested calls can be
+				/// built before their parent
+				size_t begin_arguments( ) const noexcept;
+				void push_argument( index_t argument );
+				index_t add_function( boost::string_ref name, size_t arguments_mark );
+			};	// flat_ast
+		}	// namespace sheetrock
+	}	// namespace parser
+}	// namespace daw
@@ -0,0 +1,99 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstdint>
+
+#include <daw/daw_optional_poly.h>
+
+#include "cell_address.h"
+#include "sheetrock.h"
+#include "sheetrock_flat_ast.h"
+
+namespace daw {
+	namespace parser {
+		namespace sheetrock {
+			enum class token_kind: uint8_t { end, number, string, boolean, cell, name, op, left_paren, right_paren, comma, colon, error };
+
+			struct token {
+				token_kind kind;
+				/// The token's source text, string tokens include their quotes
+				boost::string_ref text;
+				size_t position;
+				/// Set for cell tokens
+				daw::spreadsheet::cell_address address;
+				/// reference_anchor bits of cell tokens
+				uint8_t anchors;
+			};	// token
+
+			/// @brief Splits formula text into tokens in a single forward pass
+			class tokenizer {
+				boost::string_ref m_text;
+				size_t m_position;
+			public:
+				explicit tokenizer( boost::string_ref text ) noexcept;
+				token next( ) noexcept;
+				size_t position( ) const noexcept;
+			};	// tokenizer
+
+			/// @brief Parse an A1 style reference such as B7 or $AA$10
+			/// @return false if text is not a complete cell reference
+			bool parse_cell_reference( boost::string_ref text, daw::spreadsheet::cell_address & address ) noexcept;
+			/// @brief As above, also reporting which parts were written with $ as reference_anchor bits
+			bool parse_cell_reference( boost::string_ref text, daw::spreadsheet::cell_address & address, uint8_t & anchors ) noexcept;
+
+			struct parse_error {
+				size_t position;
+				/// Static description of the problem, nullptr when there is no error
+				char const * message;
+			};	// parse_error
+
+			struct parse_result {
+				daw::optional_poly<ast::expression> expression;
+				parse_error error;
+
+				bool has_error( ) const noexcept;
+				explicit operator bool( ) const noexcept;
+			};	// parse_result
+
+			/// @brief Parse a formula, with or without its leading '=', in time linear to its
+			/// length.  Errors are reported in the result instead of thrown.  '%' is the modulus
+			/// operator when an operand follows it and otherwise percent, a sign after it is
+			/// the next binary operator: 5%+3 is 3.05 and 5%3 is 2
+			parse_result parse_formula( boost::string_ref text );
+
+			struct flat_parse_result {
+				flat_ast::index_t root;
+				parse_error error;
+
+				bool has_error( ) const noexcept;
+				explicit operator bool( ) const noexcept;
+			};	// flat_parse_result
+
+			/// @brief Parse a formula into arena.  Nodes are appended, so one arena can hold
+			/// a batch of formulas.  On error the arena may hold unreachable nodes.
+			flat_parse_result parse_formula( boost::string_ref text, flat_ast & arena );
+		}	// namespace sheetrock
+	}	// namespace parser
+}	// namespace daw
@@ -0,0 +1,440 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cell_address.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace impl {
+			inline size_t count_trailing_zeros( uint64_t value ) noexcept {
+#if defined( __GNUC__ ) || defined( __clang__ )
+				return static_cast<size_t>( __builtin_ctzll( value ) );
+#else
+				size_t result = 0;
+				while( (value & 1u) == 0 ) {
+					value >>= 1;
+					++result;
+				}
+				return result;
+#endif
+			}
+
+			inline size_t pop_count( uint64_t value ) noexcept {
+#if defined( __GNUC__ ) || defined( __clang__ )
+				return static_cast<size_t>( __builtin_popcountll( value ) );
+#else
+				size_t result = 0;
+				for( ; value != 0; value &= value - 1 ) {
+					++result;
+				}
+				return result;
+#endif
+			}
+		}	// namespace impl
+
+		/// @brief A sheet sized grid that only allocates the TileDim x TileDim tiles that
+		/// hold at least one cell, each storing only its occupied cells.  Lookups are a hash
+		/// of the tile position followed by a rank in the tile's occupancy bitmap, iteration
+		/// only visits occupied cells.  Adding or erasing a cell invalidates pointers to the
+		/// other cells of its tile
+		template<typename T, size_t TileBits = 6>
+		class sparse_grid {
+		public:
+			using value_type = T;
+			using index_t = cell_address::index_t;
+			static constexpr size_t tile_dim = static_cast<size_t>(1) << TileBits;
+			static constexpr size_t tile_cells = tile_dim * tile_dim;
+		private:
+			static_assert( TileBits > 0 && TileBits <= 8, "Tiles must be between 2x2 and 256x256 cells" );
+			static constexpr size_t words_per_tile = (tile_cells + 63) / 64;
+			static constexpr index_t tile_mask = static_cast<index_t>( tile_dim - 1 );
+
+			/// Occupancy bitmap over the tile's positions with the occupied cells stored
+			/// densely in position order, so a tile costs memory for its cells only.  A
+			/// cell's slot is the number of occupied positions before it
+			class tile {
+				std::array<uint64_t, words_per_tile> m_occupied;
+				// Cells in the words before each word
+				std::array<uint16_t, words_per_tile> m_before;
+				std::vector<T> m_cells;
+
+				size_t slot( size_t pos ) const noexcept {
+					auto const below = m_occupied[pos / 64] & ((static_cast<uint64_t>(1) << (pos % 64)) - 1);
+					return static_cast<size_t>( m_before[pos / 64] ) + impl::pop_count( below );
+				}
+
+				void adjust_after( size_t pos, int delta ) noexcept {
+					for( auto n = pos / 64 + 1; n < words_per_tile; ++n ) {
+						m_before[n] = static_cast<uint16_t>( m_before[n] + delta );
+					}
+				}
+			public:
+				tile( ) noexcept:
+						m_occupied{ },
+						m_before{ },
+						m_cells{ } { }
+
+				size_t size( ) const noexcept {
+					return m_cells.size( );
+				}
+
+				size_t capacity( ) const noexcept {
+					return m_cells.capacity( );
+				}
+
+				bool contains( size_t pos ) const noexcept {
+					return ((m_occupied[pos / 64] >> (pos % 64)) & 1u) != 0;
+				}
+
+				T * get( size_t pos ) noexcept {
+					return contains( pos ) ? &m_cells[slot( pos )] : nullptr;
+				}
+
+				T const * get( size_t pos ) const noexcept {
+					return contains( pos ) ? &m_cells[slot( pos )] : nullptr;
+				}
+
+				/// @brief Construct, or replace, the cell at pos.  Adding a cell moves the
+				/// tile's later cells
+				template<typename... Args>
+				T & emplace( size_t pos, Args && ... args ) {
+					auto const n = slot( pos );
+					if( contains( pos ) ) {
+						m_cells[n] = T( std::forward<Args>( args )... );
+						return m_cells[n];
+					}
+					auto result = m_cells.emplace( m_cells.begin( ) + static_cast<std::ptrdiff_t>( n ), std::forward<Args>( args )... );
+					m_occupied[pos / 64] |= static_cast<uint64_t>(1) << (pos % 64);
+					adjust_after( pos, 1 );
+					return *result;
+				}
+
+				bool erase( size_t pos ) {
+					if( !contains( pos ) ) {
+						return false;
+					}
+					m_cells.erase( m_cells.begin( ) + static_cast<std::ptrdiff_t>( slot( pos ) ) );
+					m_occupied[pos / 64] &= ~(static_cast<uint64_t>(1) << (pos % 64));
+					adjust_after( pos, -1 );
+					return true;
+				}
+
+				/// @brief Remove the cells for which pred( value ) is true
+				/// @return the number of cells removed
+				template<typename Predicate>
+				size_t remove_if( Predicate pred ) {
+					size_t kept = 0;
+					size_t n = 0;
+					for( size_t w = 0; w < words_per_tile; ++w ) {
+						m_before[w] = static_cast<uint16_t>( kept );
+						auto word = m_occupied[w];
+						while( word != 0 ) {
+							auto const bit = word & (~word + 1);
+							if( pred( m_cells[n] ) ) {
+								m_occupied[w] &= ~bit;
+							} else {
+								if( kept != n ) {
+									m_cells[kept] = std::move( m_cells[n] );
+								}
+								++kept;
+							}
+							++n;
+							word &= word - 1;
+						}
+					}
+					auto const removed = m_cells.size( ) - kept;
+					m_cells.erase( m_cells.begin( ) + static_cast<std::ptrdiff_t>( kept ), m_cells.end( ) );
+					if( removed != 0 ) {
+						m_cells.shrink_to_fit( );
+					}
+					return removed;
+				}
+
+				template<typename Function>
+				void for_each( Function func ) {
+					size_t n = 0;
+					for( size_t w = 0; w < words_per_tile; ++w ) {
+						auto word = m_occupied[w];
+						while( word != 0 ) {
+							func( w * 64 + impl::count_trailing_zeros( word ), m_cells[n++] );
+							word &= word - 1;
+						}
+					}
+				}
+
+				template<typename Function>
+				void for_each( Function func ) const {
+					size_t n = 0;
+					for( size_t w = 0; w < words_per_tile; ++w ) {
+						auto word = m_occupied[w];
+						while( word != 0 ) {
+							func( w * 64 + impl::count_trailing_zeros( word ), m_cells[n++] );
+							word &= word - 1;
+						}
+					}
+				}
+			};	// tile
+
+			std::unordered_map<uint64_t, std::unique_ptr<tile>> m_tiles;
+			size_t m_size;
+
+			static uint64_t tile_key( index_t tile_row, index_t tile_column ) noexcept {
+				return (static_cast<uint64_t>( tile_row ) << 32) | static_cast<uint64_t>( tile_column );
+			}
+
+			static uint64_t tile_key( cell_address const & address ) noexcept {
+				return tile_key( address.row >> TileBits, address.column >> TileBits );
+			}
+
+			static size_t tile_pos( cell_address const & address ) noexcept {
+				return (static_cast<size_t>( address.row & tile_mask ) << TileBits) | static_cast<size_t>( address.column & tile_mask );
+			}
+
+			static cell_address to_address( uint64_t key, size_t pos ) noexcept {
+				auto const tile_row = static_cast<index_t>( key >> 32 );
+				auto const tile_column = static_cast<index_t>( key & 0xFFFFFFFFu );
+				return cell_address{ static_cast<index_t>( (tile_row << TileBits) | static_cast<index_t>( pos >> TileBits ) ),
+					static_cast<index_t>( (tile_column << TileBits) | static_cast<index_t>( pos & tile_mask ) ) };
+			}
+
+			tile * find_tile( cell_address const & address ) const {
+				auto it = m_tiles.find( tile_key( address ) );
+				return it == m_tiles.end( ) ? nullptr : it->second.get( );
+			}
+
+			template<typename Grid, typename Function>
+			static void for_each_in_range_impl( Grid & grid, cell_address const & first, cell_address const & last, Function & func ) {
+				using tile_t = std::conditional_t<std::is_const<Grid>::value, tile const, tile>;
+				auto const visit = [&]( uint64_t key, tile_t & t ) {
+					t.for_each( [&]( size_t pos, auto & value ) {
+						auto const address = to_address( key, pos );
+						if( address.row >= first.row && address.row <= last.row && address.column >= first.column && address.column <= last.column ) {
+							func( address, value );
+						}
+					} );
+				};
+				auto const tile_rows = static_cast<uint64_t>( (last.row >> TileBits) - (first.row >> TileBits) ) + 1;
+				auto const tile_columns = static_cast<uint64_t>( (last.column >> TileBits) - (first.column >> TileBits) ) + 1;
+				if( tile_rows * tile_columns > grid.m_tiles.size( ) ) {
+					// Cheaper to filter the allocated tiles than to probe every tile position
+					for( auto & item: grid.m_tiles ) {
+						visit( item.first, *item.second );
+					}
+					return;
+				}
+				for( auto tr = first.row >> TileBits; tr <= (last.row >> TileBits); ++tr ) {
+					for( auto tc = first.column >> TileBits; tc <= (last.column >> TileBits); ++tc ) {
+						auto const key = tile_key( tr, tc );
+						auto it = grid.m_tiles.find( key );
+						if( it != grid.m_tiles.end( ) ) {
+							visit( key, *it->second );
+						}
+					}
+				}
+			}
+		public:
+			sparse_grid( ):
+					m_tiles{ },
+					m_size{ 0 } { }
+
+			~sparse_grid( ) = default;
+
+			sparse_grid( sparse_grid const & other ):
+					m_tiles{ },
+					m_size{ other.m_size } {
+
+				m_tiles.reserve( other.m_tiles.size( ) );
+				for( auto const & item: other.m_tiles ) {
+					m_tiles.emplace( item.first, std::make_unique<tile>( *item.second ) );
+				}
+			}
+
+			sparse_grid( sparse_grid && ) = default;
+
+			sparse_grid & operator=( sparse_grid const & rhs ) {
+				if( this != &rhs ) {
+					sparse_grid tmp{ rhs };
+					swap( tmp );
+				}
+				return *this;
+			}
+
+			sparse_grid & operator=( sparse_grid && ) = default;
+
+			void swap( sparse_grid & rhs ) noexcept {
+				using std::swap;
+				m_tiles.swap( rhs.m_tiles );
+				swap( m_size, rhs.m_size );
+			}
+
+			/// @return number of occupied cells
+			size_t size( ) const noexcept {
+				return m_size;
+			}
+
+			bool empty( ) const noexcept {
+				return m_size == 0;
+			}
+
+			size_t tile_count( ) const noexcept {
+				return m_tiles.size( );
+			}
+
+			bool contains( cell_address const & address ) const {
+				auto t = find_tile( address );
+				return t != nullptr && t->contains( tile_pos( address ) );
+			}
+
+			/// @return pointer to the cell at address or nullptr if it is unoccupied
+			T * find( cell_address const & address ) {
+				auto t = find_tile( address );
+				return t == nullptr ? nullptr : t->get( tile_pos( address ) );
+			}
+
+			T const * find( cell_address const & address ) const {
+				auto t = find_tile( address );
+				return t == nullptr ? nullptr : t->get( tile_pos( address ) );
+			}
+
+			/// @brief Construct, or replace, the cell at address
+			template<typename... Args>
+			T & emplace( cell_address const & address, Args && ... args ) {
+				auto & t = m_tiles[tile_key( address )];
+				if( !t ) {
+					t = std::make_unique<tile>( );
+				}
+				auto const count = t->size( );
+				auto & result = t->emplace( tile_pos( address ), std::forward<Args>( args )... );
+				m_size += t->size( ) - count;
+				return result;
+			}
+
+			/// @return the cell at address, default constructing it if unoccupied
+			T & operator[]( cell_address const & address ) {
+				auto result = find( address );
+				if( result != nullptr ) {
+					return *result;
+				}
+				return emplace( address );
+			}
+
+			bool erase( cell_address const & address ) {
+				auto it = m_tiles.find( tile_key( address ) );
+				if( it == m_tiles.end( ) || !it->second->erase( tile_pos( address ) ) ) {
+					return false;
+				}
+				--m_size;
+				if( it->second->size( ) == 0 ) {
+					m_tiles.erase( it );
+				}
+				return true;
+			}
+
+			void clear( ) noexcept {
+				m_tiles.clear( );
+				m_size = 0;
+			}
+
+			/// @brief Calls func( cell_address, T & ) for each occupied cell.  The order is
+			/// row major within a tile but unspecified between tiles
+			template<typename Function>
+			void for_each( Function func ) {
+				for( auto & item: m_tiles ) {
+					auto const key = item.first;
+					item.second->for_each( [&]( size_t pos, T & value ) {
+						func( to_address( key, pos ), value );
+					} );
+				}
+			}
+
+			template<typename Function>
+			void for_each( Function func ) const {
+				for( auto const & item: m_tiles ) {
+					auto const key = item.first;
+					static_cast<tile const &>( *item.second ).for_each( [&]( size_t pos, T const & value ) {
+						func( to_address( key, pos ), value );
+					} );
+				}
+			}
+
+			/// @brief Calls func( cell_address, T & ) for each occupied cell inside the
+			/// inclusive rectangle [first, last]
+			template<typename Function>
+			void for_each_in_range( cell_address const & first, cell_address const & last, Function func ) {
+				for_each_in_range_impl( *this, first, last, func );
+			}
+
+			template<typename Function>
+			void for_each_in_range( cell_address const & first, cell_address const & last, Function func ) const {
+				for_each_in_range_impl( *this, first, last, func );
+			}
+
+			/// @brief Remove the cells for which pred( value ) is true and free any tile
+			/// left without cells
+			template<typename Predicate>
+			void compact( Predicate pred ) {
+				for( auto it = m_tiles.begin( ); it != m_tiles.end( ); ) {
+					m_size -= it->second->remove_if( pred );
+					if( it->second->size( ) == 0 ) {
+						it = m_tiles.erase( it );
+					} else {
+						++it;
+					}
+				}
+			}
+
+			/// @brief Remove the cells whose value is empty( ) and free any tile left
+			/// without cells
+			void compact( ) {
+				compact( []( T const & value ) {
+					return value.empty( );
+				} );
+			}
+
+			/// @return Approximate number of bytes owned by the grid, excluding memory owned
+			/// by the cells themselves
+			size_t memory_usage( ) const noexcept {
+				auto result = sizeof( *this ) + m_tiles.bucket_count( ) * sizeof( void * );
+				for( auto const & item: m_tiles ) {
+					result += sizeof( tile ) + sizeof( typename decltype( m_tiles )::value_type ) + sizeof( void * ) + item.second->capacity( ) * sizeof( T );
+				}
+				return result;
+			}
+		};	// sparse_grid
+
+		template<typename T, size_t TileBits>
+		void swap( sparse_grid<T, TileBits> & lhs, sparse_grid<T, TileBits> & rhs ) noexcept {
+			lhs.swap( rhs );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -25,18 +25,18 @@
 #include <memory>
 
 #include <daw/nodepp/base_event_emitter.h>
-#include <daw/json/daw_json_link.h>
 
 #include "impl_cell_value.h"
+#include "impl_column.h"
+#include "json_schema.h"
 
 namespace daw {
 	namespace spreadsheet {
 
-		class cell_t: public daw::json::JsonLink<cell_t> {
+		class cell_t {
+			friend struct json_schema<cell_t>;
 			std::unique_ptr<impl::cell_value> m_value;
 
-			void link_values( );
-
 		public:
 			cell_t( daw::nodepp::base::EventEmitter emitter );
 			~cell_t( );
@@ -45,9 +45,19 @@ namespace daw {
 			cell_t & operator=( cell_t const & ) = default;
 			cell_t & operator=( cell_t && ) = default;
 			friend void swap( cell_t & lhs, cell_t & rhs ) noexcept;
+
+			std::string encode( ) const;
+			void decode( boost::string_ref json_text );
 		};
 
 		void swap( cell_t & lhs, cell_t & rhs ) noexcept;
+
+		template<>
+		struct json_schema<cell_t> {
+			static constexpr auto members( ) {
+				return std::make_tuple( json_field( "value", &cell_t::m_value ) );
+			}
+		};	// json_schema<cell_t>
 	}	// namespace spreadsheet
 }	// namespace daw
 
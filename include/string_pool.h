@@ -0,0 +1,147 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace daw {
+	namespace spreadsheet {
+		/// @brief Reference counted, interned strings shared by the columns of a sheet.
+		/// Each distinct text is stored once and named by a handle, so two handles from
+		/// the same pool are equal exactly when their texts are.  Texts of up to
+		/// inline_capacity bytes live in the entry itself.
+		///
+		/// Interning and releasing take a lock.  text( ) does not, entries never move, so
+		/// the text of a handle someone holds a reference to can be read from any thread.
+		class string_pool {
+		public:
+			using handle_t = uint32_t;
+			static constexpr handle_t empty_handle = 0;
+			static constexpr size_t inline_capacity = 16;
+		private:
+			struct entry {
+				union {
+					char * heap;
+					char local[inline_capacity];
+				};
+				uint32_t size;
+				uint32_t refs;
+				uint64_t hash;
+			};	// entry
+
+			// Block n holds first_block_size << n entries, so a handle finds its block with
+			// one count of leading zeros and blocks never need to be reallocated
+			static constexpr size_t first_block_bits = 10;
+			static constexpr size_t first_block_size = static_cast<size_t>( 1 ) << first_block_bits;
+			static constexpr size_t block_count = 33 - first_block_bits;
+
+			// The high half of the hash is kept beside the handle so probing past other
+			// texts does not touch their entries
+			struct index_slot {
+				handle_t handle;
+				uint32_t tag;
+			};	// index_slot
+
+			mutable std::mutex m_mutex;
+			std::array<std::atomic<entry *>, block_count> m_blocks;
+			// Open addressing index of live handles
+			std::vector<index_slot> m_index;
+			size_t m_index_used;	// Live handles and tombstones
+			std::vector<handle_t> m_free;
+			uint64_t m_next;
+			size_t m_live;
+			size_t m_heap_bytes;
+
+			entry & entry_at( handle_t handle ) const noexcept;
+			handle_t new_handle( );
+			void grow_index( );
+			static uint64_t checked_hash( boost::string_ref text );
+			handle_t intern_locked( boost::string_ref text, uint64_t hash, uint32_t refs );
+			void retain_locked( handle_t handle ) noexcept;
+			void release_locked( handle_t handle ) noexcept;
+		public:
+			string_pool( );
+			~string_pool( );
+			string_pool( string_pool const & ) = delete;
+			string_pool( string_pool && ) = delete;
+			string_pool & operator=( string_pool const & ) = delete;
+			string_pool & operator=( string_pool && ) = delete;
+
+			/// @return the handle of text, holding a new reference to it
+			/// @throws std::length_error when the pool runs out of handles
+			handle_t intern( boost::string_ref text );
+			void retain( handle_t handle );
+
+			/// @brief Intern text_of( item ) for each item of [first, last) under one lock,
+			/// holding refs_of( item ) references to it, and write the handles to out.  Texts
+			/// are hashed before the lock is taken
+			/// @throws std::length_error when the pool runs out of handles
+			template<typename Iterator, typename TextOf, typename RefsOf, typename OutputIterator>
+			OutputIterator intern( Iterator first, Iterator last, TextOf text_of, RefsOf refs_of, OutputIterator out ) {
+				std::vector<uint64_t> hashes;
+				for( auto it = first; it != last; ++it ) {
+					hashes.push_back( checked_hash( text_of( *it ) ) );
+				}
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				for( size_t n = 0; first != last; ++first, ++n ) {
+					boost::string_ref const text = text_of( *first );
+					auto const refs = static_cast<uint32_t>( refs_of( *first ) );
+					*out++ = text.empty( ) || refs == 0 ? empty_handle : intern_locked( text, hashes[n], refs );
+				}
+				return out;
+			}
+			/// @brief Drop a reference, the text is freed with the last one
+			void release( handle_t handle ) noexcept;
+
+			/// @brief Add a reference to handle_of( item ) for each item of [first, last)
+			/// under one lock
+			template<typename Iterator, typename HandleOf>
+			void retain( Iterator first, Iterator last, HandleOf handle_of ) {
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				for( ; first != last; ++first ) {
+					retain_locked( handle_of( *first ) );
+				}
+			}
+
+			template<typename Iterator, typename HandleOf>
+			void release( Iterator first, Iterator last, HandleOf handle_of ) noexcept {
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				for( ; first != last; ++first ) {
+					release_locked( handle_of( *first ) );
+				}
+			}
+
+			boost::string_ref text( handle_t handle ) const noexcept;
+			/// @return number of distinct texts held
+			size_t size( ) const;
+			size_t memory_usage( ) const;
+		};	// string_pool
+	}	// namespace spreadsheet
+}	// namespace daw
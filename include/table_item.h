@@ -25,16 +25,19 @@
 #include <atomic>
 #include <cstdint>
 #include <istream>
+#include <memory>
 #include <ostream>
 #include <utility>
 
-#include <daw/json/daw_json_link.h>
 #include <daw/nodepp/base_event_emitter.h>
 
+#include "event_table.h"
+#include "json_schema.h"
+
 namespace daw {
 	namespace spreadsheet {
 
-		struct table_item: public daw::json::JsonLink<table_item>, public daw::nodepp::base::StandardEvents<table_item> {
+		struct table_item: public daw::nodepp::base::StandardEvents<table_item> {
 			using id_t = size_t;
 			enum class table_item_type: size_t { Table = 0, Cell = 1, Row = 2, Column = 3 };
 		private:
@@ -42,19 +45,27 @@ namespace daw {
 
 			id_t m_id;
 			table_item_type m_item_type;
+			std::shared_ptr<event_table> m_events;
 		public:
 			virtual ~table_item( );
 			
 			table_item( ) = delete;
-			table_item( daw::nodepp::base::EventEmitter emitter );
+			/// @param events Listener table for this item, items built from a parent should share
+			/// the parent's.  A new table is created when null
+			table_item( daw::nodepp::base::EventEmitter emitter, std::shared_ptr<event_table> events = nullptr );
 			table_item( table_item const & other );
 			table_item( table_item && other );
 			table_item & operator=( table_item const & rhs );
 			table_item & operator=( table_item && rhs );
 
 			id_t id( ) const;
+			std::shared_ptr<event_table> const & events( ) const;
 			friend void swap( table_item & lhs, table_item & rhs );
 
+			std::string encode( ) const;
+			/// @brief The id is not restored, it identifies this item's listeners
+			void decode( boost::string_ref json_text );
+
 			void emit_closed( );
 			void on_closed( std::function<void( id_t )> listener );
 			void emit_updated( );
@@ -64,6 +75,13 @@ namespace daw {
 
 		void swap( table_item & lhs, table_item & rhs );
 
+		template<>
+		struct json_schema<table_item> {
+			static constexpr auto members( ) {
+				return std::make_tuple( json_getter( "id", &table_item::id ) );
+			}
+		};	// json_schema<table_item>
+
 		std::string to_string( table_item::table_item_type item_type );
 		table_item::table_item_type table_item_type_from_string( boost::string_ref item_type );
 		std::ostream & operator<<( std::ostream & os, table_item::table_item_type item_type );
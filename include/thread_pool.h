@@ -0,0 +1,149 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace daw {
+	namespace spreadsheet {
+		/// @brief Fixed size pool of worker threads.  Each worker owns a task queue, takes
+		/// work from the back of its own queue and steals from the front of the others
+		/// when it runs dry.
+		class thread_pool {
+		public:
+			using task_t = std::function<void( )>;
+		private:
+			struct worker_queue {
+				std::mutex mutex;
+				std::deque<task_t> tasks;
+			};	// worker_queue
+
+			std::vector<std::unique_ptr<worker_queue>> m_queues;
+			std::vector<std::thread> m_threads;
+			std::mutex m_sleep_mutex;
+			std::condition_variable m_sleep_cv;
+			std::atomic<size_t> m_queued;
+			std::atomic<size_t> m_next_queue;
+			bool m_stop;
+
+			bool try_pop( size_t queue_index, task_t & task );
+			bool try_steal( size_t thief_index, task_t & task );
+			void worker( size_t index );
+		public:
+			/// @param thread_count total threads taking part in parallel work, including
+			/// the thread waiting on it.  0 uses the hardware concurrency
+			explicit thread_pool( size_t thread_count = 0 );
+			~thread_pool( );
+			thread_pool( thread_pool const & ) = delete;
+			thread_pool( thread_pool && ) = delete;
+			thread_pool & operator=( thread_pool const & ) = delete;
+			thread_pool & operator=( thread_pool && ) = delete;
+
+			/// @return number of threads that take part in parallel work, including the caller
+			size_t size( ) const noexcept;
+
+			void add_task( task_t task );
+
+			/// @brief Run one queued task on the calling thread if there is one
+			/// @return true if a task was run
+			bool try_run_one( );
+
+			/// @brief Call func( first, last ) over consecutive blocks of [0, count) of at
+			/// most grain items and wait for all of them.  The calling thread helps run
+			/// tasks while it waits.  The first exception thrown is rethrown here.
+			template<typename Function>
+			void parallel_for_blocks( size_t count, size_t grain, Function func ) {
+				if( count == 0 ) {
+					return;
+				}
+				grain = std::max<size_t>( grain, 1 );
+				auto const block_count = (count + grain - 1) / grain;
+				if( block_count == 1 || size( ) == 1 ) {
+					func( static_cast<size_t>( 0 ), count );
+					return;
+				}
+				struct state_t {
+					std::atomic<size_t> remaining;
+					std::mutex mutex;
+					std::condition_variable cv;
+					std::exception_ptr error;
+				};
+				auto state = std::make_shared<state_t>( );
+				state->remaining = block_count;
+				for( size_t block = 0; block < block_count; ++block ) {
+					auto const first = block * grain;
+					auto const last = std::min( first + grain, count );
+					add_task( [state, first, last, &func]( ) {
+						try {
+							func( first, last );
+						} catch( ... ) {
+							std::lock_guard<std::mutex> lock{ state->mutex };
+							if( !state->error ) {
+								state->error = std::current_exception( );
+							}
+						}
+						if( --state->remaining == 0 ) {
+							std::lock_guard<std::mutex> lock{ state->mutex };
+							state->cv.notify_all( );
+						}
+					} );
+				}
+				while( state->remaining != 0 ) {
+					if( !try_run_one( ) ) {
+						std::unique_lock<std::mutex> lock{ state->mutex };
+						state->cv.wait_for( lock, std::chrono::milliseconds( 1 ), [&state]( ) {
+							return state->remaining == 0;
+						} );
+					}
+				}
+				if( state->error ) {
+					std::rethrow_exception( state->error );
+				}
+			}
+
+			/// @brief Call func( n ) for each n in [0, count) and wait for completion
+			template<typename Function>
+			void parallel_for( size_t count, size_t grain, Function func ) {
+				parallel_for_blocks( count, grain, [&func]( size_t first, size_t last ) {
+					for( auto n = first; n < last; ++n ) {
+						func( n );
+					}
+				} );
+			}
+		};	// thread_pool
+
+		/// @brief A pool using the hardware concurrency, created on first use and shared by
+		/// every sheet and CSV parse that is not given a pool or a thread count
+		std::shared_ptr<thread_pool> shared_thread_pool( );
+	}	// namespace spreadsheet
+}	// namespace daw
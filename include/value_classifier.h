@@ -0,0 +1,66 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "impl_cell_value.h"
+
+namespace daw {
+	namespace spreadsheet {
+		/// The outcome of classifying a cell's text.  text is the trimmed input and
+		/// the typed payload is already decoded for the types that are cheap to decode
+		struct classified_value {
+			using expected_value_t = impl::cell_value::expected_value_t;
+			expected_value_t type;
+			boost::string_ref text;
+			int64_t ticks;	// Timestamp: ticks since 1970-01-01, Time: length in ticks
+			bool boolean;
+
+			classified_value( ) noexcept;
+			classified_value( expected_value_t value_type, boost::string_ref value_text ) noexcept;
+		};	// classified_value
+
+		/// @brief Decide if text is empty(General), a Number, ISO Timestamp(YYYYMMDDTHHMMSS[.f]),
+		/// Time([-]H:MM[:SS[.f]]), Boolean(true/false) or Text in one scan.  Never throws
+		classified_value classify_value( boost::string_ref text ) noexcept;
+
+		/// @brief Classify each value in [first, last) into out, which must have room for them
+		void classify_values( boost::string_ref const * first, boost::string_ref const * last, classified_value * out ) noexcept;
+		std::vector<classified_value> classify_values( std::vector<boost::string_ref> const & values );
+
+		/// @brief Classify each delimiter separated value of buffer, appending to out.  The
+		/// text of each result refers into buffer
+		/// @return number of values appended
+		size_t classify_column( boost::string_ref buffer, char delimiter, std::vector<classified_value> & out );
+
+		/// Typed values of a classified_value.  Only valid for the matching type
+		impl::cell_value::number_t to_number( classified_value const & value );
+		impl::cell_value::timestamp_t to_timestamp( classified_value const & value );
+		impl::cell_value::duration_t to_duration( classified_value const & value );
+		impl::cell_value::cell_variant_t to_variant( classified_value const & value );
+	}	// namespace spreadsheet
+}	// namespace daw
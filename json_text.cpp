@@ -0,0 +1,613 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "json_text.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			constexpr char const s_hex[] = "0123456789abcdef";
+
+			void append_utf8( std::string & out, uint32_t code_point ) {
+				if( code_point < 0x80 ) {
+					out += static_cast<char>( code_point );
+				} else if( code_point < 0x800 ) {
+					out += static_cast<char>( 0xC0 | (code_point >> 6) );
+					out += static_cast<char>( 0x80 | (code_point & 0x3F) );
+				} else if( code_point < 0x10000 ) {
+					out += static_cast<char>( 0xE0 | (code_point >> 12) );
+					out += static_cast<char>( 0x80 | ((code_point >> 6) & 0x3F) );
+					out += static_cast<char>( 0x80 | (code_point & 0x3F) );
+				} else {
+					out += static_cast<char>( 0xF0 | (code_point >> 18) );
+					out += static_cast<char>( 0x80 | ((code_point >> 12) & 0x3F) );
+					out += static_cast<char>( 0x80 | ((code_point >> 6) & 0x3F) );
+					out += static_cast<char>( 0x80 | (code_point & 0x3F) );
+				}
+			}
+
+			int hex_value( char c ) noexcept {
+				if( c >= '0' && c <= '9' ) {
+					return c - '0';
+				}
+				if( c >= 'a' && c <= 'f' ) {
+					return c - 'a' + 10;
+				}
+				if( c >= 'A' && c <= 'F' ) {
+					return c - 'A' + 10;
+				}
+				return -1;
+			}
+
+			[[noreturn]] void fail_escape( char const * what ) {
+				throw std::invalid_argument{ what };
+			}
+
+			/// Longest escape, a surrogate pair, after the first backslash
+			constexpr size_t max_escape_size = 11;
+
+			/// @brief Decode the escape sequence following a backslash at first
+			/// @param complete last is the end of the input rather than of what has been read
+			/// @return the position after the escape, or nullptr if it is cut off by last
+			char const * decode_escape( char const * first, char const * last, std::string & out, bool complete ) {
+				if( first == last ) {
+					return nullptr;
+				}
+				switch( *first++ ) {
+				case '"': out += '"'; return first;
+				case '\\': out += '\\'; return first;
+				case '/': out += '/'; return first;
+				case 'b': out += '\b'; return first;
+				case 'f': out += '\f'; return first;
+				case 'n': out += '\n'; return first;
+				case 'r': out += '\r'; return first;
+				case 't': out += '\t'; return first;
+				case 'u': break;
+				default: fail_escape( "Invalid JSON escape" );
+				}
+				auto const read_unit = [&first]( uint32_t & unit ) {
+					unit = 0;
+					for( int n = 0; n < 4; ++n ) {
+						auto const digit = hex_value( *first++ );
+						if( digit < 0 ) {
+							fail_escape( "Invalid JSON unicode escape" );
+						}
+						unit = (unit << 4) | static_cast<uint32_t>( digit );
+					}
+				};
+				if( last - first < 4 ) {
+					return nullptr;
+				}
+				uint32_t code_point = 0;
+				read_unit( code_point );
+				if( code_point >= 0xD800 && code_point < 0xDC00 ) {
+					if( last - first < 6 && !complete ) {
+						return nullptr;
+					}
+					if( last - first >= 6 && first[0] == '\\' && first[1] == 'u' ) {
+						first += 2;
+						uint32_t low = 0;
+						read_unit( low );
+						if( low < 0xDC00 || low >= 0xE000 ) {
+							fail_escape( "Invalid JSON surrogate pair" );
+						}
+						code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+					}
+				}
+				append_utf8( out, code_point );
+				return first;
+			}
+		}	// namespace anonymous
+
+		void append_json_string( std::string & out, boost::string_ref value ) {
+			out += '"';
+			auto run = value.begin( );
+			for( auto it = value.begin( ); it != value.end( ); ++it ) {
+				auto const c = static_cast<unsigned char>( *it );
+				if( c >= 0x20 && c != '"' && c != '\\' ) {
+					continue;
+				}
+				// Characters that need no escaping are copied a run at a time
+				out.append( run, it );
+				run = it + 1;
+				switch( c ) {
+				case '"': out += "\\\""; break;
+				case '\\': out += "\\\\"; break;
+				case '\b': out += "\\b"; break;
+				case '\f': out += "\\f"; break;
+				case '\n': out += "\\n"; break;
+				case '\r': out += "\\r"; break;
+				case '\t': out += "\\t"; break;
+				default:
+					out += "\\u00";
+					out += s_hex[c >> 4];
+					out += s_hex[c & 0xF];
+					break;
+				}
+			}
+			out.append( run, value.end( ) );
+			out += '"';
+		}
+
+		void append_json_integer( std::string & out, uint64_t value ) {
+			char buffer[20];
+			auto pos = buffer + sizeof( buffer );
+			do {
+				*--pos = static_cast<char>( '0' + value % 10 );
+				value /= 10;
+			} while( value != 0 );
+			out.append( pos, buffer + sizeof( buffer ) );
+		}
+
+		json_reader::json_reader( boost::string_ref text ) noexcept:
+				m_first{ text.begin( ) },
+				m_last{ text.end( ) } { }
+
+		void json_reader::fail( char const * what ) const {
+			throw std::invalid_argument{ what };
+		}
+
+		void json_reader::skip_whitespace( ) noexcept {
+			while( m_first != m_last && (*m_first == ' ' || *m_first == '\t' || *m_first == '\n' || *m_first == '\r') ) {
+				++m_first;
+			}
+		}
+
+		bool json_reader::at_end( ) noexcept {
+			skip_whitespace( );
+			return m_first == m_last;
+		}
+
+		char json_reader::peek( ) noexcept {
+			skip_whitespace( );
+			return m_first == m_last ? '\0' : *m_first;
+		}
+
+		void json_reader::expect( char c ) {
+			if( peek( ) != c ) {
+				fail( "Unexpected character in JSON text" );
+			}
+			++m_first;
+		}
+
+		bool json_reader::more( char close, bool & first ) {
+			if( peek( ) == close ) {
+				++m_first;
+				return false;
+			}
+			if( !first ) {
+				expect( ',' );
+			}
+			first = false;
+			return true;
+		}
+
+		void json_reader::read_string( std::string & out ) {
+			expect( '"' );
+			out.clear( );
+			auto run = m_first;
+			while( true ) {
+				if( m_first == m_last ) {
+					fail( "Unterminated JSON string" );
+				}
+				auto const c = *m_first;
+				if( c == '"' ) {
+					out.append( run, m_first );
+					++m_first;
+					return;
+				}
+				if( c != '\\' ) {
+					++m_first;
+					continue;
+				}
+				out.append( run, m_first );
+				auto const next = decode_escape( m_first + 1, m_last, out, true );
+				if( next == nullptr ) {
+					fail( "Truncated JSON escape" );
+				}
+				m_first = next;
+				run = m_first;
+			}
+		}
+
+		std::string json_reader::read_string( ) {
+			std::string result;
+			read_string( result );
+			return result;
+		}
+
+		uint64_t json_reader::read_unsigned( ) {
+			skip_whitespace( );
+			if( m_first == m_last || *m_first < '0' || *m_first > '9' ) {
+				fail( "Expected an unsigned JSON number" );
+			}
+			uint64_t result = 0;
+			while( m_first != m_last && *m_first >= '0' && *m_first <= '9' ) {
+				auto const digit = static_cast<uint64_t>( *m_first++ - '0' );
+				if( result > (std::numeric_limits<uint64_t>::max( ) - digit) / 10 ) {
+					fail( "JSON number out of range" );
+				}
+				result = result * 10 + digit;
+			}
+			return result;
+		}
+
+		void json_reader::skip_value( ) {
+			switch( peek( ) ) {
+			case '"': {
+					std::string ignored;
+					read_string( ignored );
+					return;
+				}
+			case '{': {
+					++m_first;
+					for( bool first = true; more( '}', first ); ) {
+						std::string ignored;
+						read_string( ignored );
+						expect( ':' );
+						skip_value( );
+					}
+					return;
+				}
+			case '[': {
+					++m_first;
+					for( bool first = true; more( ']', first ); ) {
+						skip_value( );
+					}
+					return;
+				}
+			default: {
+					// Numbers and literals run until the next delimiter
+					auto const start = m_first;
+					while( m_first != m_last && *m_first != ',' && *m_first != '}' && *m_first != ']' && *m_first != ' ' && *m_first != '\t' && *m_first != '\n' && *m_first != '\r' ) {
+						++m_first;
+					}
+					if( start == m_first ) {
+						fail( "Expected a JSON value" );
+					}
+					return;
+				}
+			}
+		}
+
+		json_writer::json_writer( std::ostream & out, size_t buffer_size ):
+				m_stream{ &out },
+				m_fd{ -1 },
+				m_buffer{ },
+				m_buffer_size{ std::max<size_t>( buffer_size, 1 ) },
+				m_bytes_written{ 0 },
+				m_first{ },
+				m_after_key{ false } {
+
+			m_buffer.reserve( m_buffer_size );
+		}
+
+		json_writer::json_writer( int fd, size_t buffer_size ):
+				m_stream{ nullptr },
+				m_fd{ fd },
+				m_buffer{ },
+				m_buffer_size{ std::max<size_t>( buffer_size, 1 ) },
+				m_bytes_written{ 0 },
+				m_first{ },
+				m_after_key{ false } {
+
+			m_buffer.reserve( m_buffer_size );
+		}
+
+		json_writer::~json_writer( ) {
+			try {
+				flush( );
+			} catch( ... ) {
+				// Errors cannot be reported from a destructor
+			}
+		}
+
+		void json_writer::write_out( char const * data, size_t size ) {
+			if( m_stream != nullptr ) {
+				if( !m_stream->write( data, static_cast<std::streamsize>( size ) ) ) {
+					throw std::runtime_error{ "Error writing JSON to stream" };
+				}
+			} else {
+				while( size > 0 ) {
+					auto const written = ::write( m_fd, data, size );
+					if( written < 0 ) {
+						if( errno == EINTR ) {
+							continue;
+						}
+						throw std::runtime_error{ std::string{ "Error writing JSON: " } + std::strerror( errno ) };
+					}
+					data += written;
+					size -= static_cast<size_t>( written );
+				}
+			}
+		}
+
+		void json_writer::flush( ) {
+			if( !m_buffer.empty( ) ) {
+				write_out( m_buffer.data( ), m_buffer.size( ) );
+				m_bytes_written += m_buffer.size( );
+				m_buffer.clear( );
+			}
+			if( m_stream != nullptr ) {
+				m_stream->flush( );
+			}
+		}
+
+		void json_writer::separate( ) {
+			if( m_buffer.size( ) >= m_buffer_size ) {
+				write_out( m_buffer.data( ), m_buffer.size( ) );
+				m_bytes_written += m_buffer.size( );
+				m_buffer.clear( );
+			}
+			if( m_after_key ) {
+				m_after_key = false;
+				return;
+			}
+			if( !m_first.empty( ) ) {
+				if( !m_first.back( ) ) {
+					m_buffer += ',';
+				}
+				m_first.back( ) = false;
+			}
+		}
+
+		void json_writer::begin_object( ) {
+			separate( );
+			m_buffer += '{';
+			m_first.push_back( true );
+		}
+
+		void json_writer::end_object( ) {
+			m_first.pop_back( );
+			m_buffer += '}';
+		}
+
+		void json_writer::begin_array( ) {
+			separate( );
+			m_buffer += '[';
+			m_first.push_back( true );
+		}
+
+		void json_writer::end_array( ) {
+			m_first.pop_back( );
+			m_buffer += ']';
+		}
+
+		void json_writer::key( boost::string_ref name ) {
+			separate( );
+			append_json_string( m_buffer, name );
+			m_buffer += ':';
+			m_after_key = true;
+		}
+
+		void json_writer::value( boost::string_ref text ) {
+			separate( );
+			append_json_string( m_buffer, text );
+		}
+
+		void json_writer::value( uint64_t number ) {
+			separate( );
+			append_json_integer( m_buffer, number );
+		}
+
+		std::string & json_writer::value_buffer( ) {
+			separate( );
+			return m_buffer;
+		}
+
+		uint64_t json_writer::bytes_written( ) const noexcept {
+			return m_bytes_written;
+		}
+
+		json_pull_reader::json_pull_reader( std::istream & in, size_t buffer_size ):
+				m_stream{ &in },
+				m_fd{ -1 },
+				m_buffer( std::max( buffer_size, max_escape_size + 1 ) ),
+				m_pos{ 0 },
+				m_end{ 0 },
+				m_eof{ false },
+				m_text{ } { }
+
+		json_pull_reader::json_pull_reader( int fd, size_t buffer_size ):
+				m_stream{ nullptr },
+				m_fd{ fd },
+				m_buffer( std::max( buffer_size, max_escape_size + 1 ) ),
+				m_pos{ 0 },
+				m_end{ 0 },
+				m_eof{ false },
+				m_text{ } { }
+
+		void json_pull_reader::fail( char const * what ) const {
+			throw std::invalid_argument{ what };
+		}
+
+		bool json_pull_reader::fill( size_t count ) {
+			if( m_end - m_pos >= count ) {
+				return true;
+			}
+			// Keep the unread tail and read after it
+			std::copy( m_buffer.begin( ) + static_cast<std::ptrdiff_t>( m_pos ), m_buffer.begin( ) + static_cast<std::ptrdiff_t>( m_end ), m_buffer.begin( ) );
+			m_end -= m_pos;
+			m_pos = 0;
+			while( !m_eof && m_end < count ) {
+				auto const space = m_buffer.size( ) - m_end;
+				size_t got = 0;
+				if( m_stream != nullptr ) {
+					m_stream->read( m_buffer.data( ) + m_end, static_cast<std::streamsize>( space ) );
+					got = static_cast<size_t>( m_stream->gcount( ) );
+					if( got == 0 && m_stream->bad( ) ) {
+						throw std::runtime_error{ "Error reading JSON from stream" };
+					}
+				} else {
+					auto const result = ::read( m_fd, m_buffer.data( ) + m_end, space );
+					if( result < 0 ) {
+						if( errno == EINTR ) {
+							continue;
+						}
+						throw std::runtime_error{ std::string{ "Error reading JSON: " } + std::strerror( errno ) };
+					}
+					got = static_cast<size_t>( result );
+				}
+				m_eof = got == 0;
+				m_end += got;
+			}
+			return m_end - m_pos >= count;
+		}
+
+		char json_pull_reader::peek( ) {
+			return fill( 1 ) ? m_buffer[m_pos] : '\0';
+		}
+
+		void json_pull_reader::skip_separators( ) {
+			while( true ) {
+				auto const c = peek( );
+				if( c != ' ' && c != '\t' && c != '\n' && c != '\r' && c != ',' && c != ':' ) {
+					return;
+				}
+				++m_pos;
+			}
+		}
+
+		void json_pull_reader::read_string( ) {
+			// The opening quote has been consumed
+			m_text.clear( );
+			while( true ) {
+				if( !fill( 1 ) ) {
+					fail( "Unterminated JSON string" );
+				}
+				auto const first = m_buffer.data( ) + m_pos;
+				auto const last = m_buffer.data( ) + m_end;
+				auto const special = std::find_if( first, last, []( char c ) {
+					return c == '"' || c == '\\';
+				} );
+				m_text.append( first, special );
+				m_pos += static_cast<size_t>( special - first );
+				if( special == last ) {
+					continue;
+				}
+				if( *special == '"' ) {
+					++m_pos;
+					return;
+				}
+				auto const complete = !fill( max_escape_size + 1 );
+				auto const escape = m_buffer.data( ) + m_pos + 1;
+				auto const next = decode_escape( escape, m_buffer.data( ) + m_end, m_text, complete );
+				if( next == nullptr ) {
+					fail( "Truncated JSON escape" );
+				}
+				m_pos += static_cast<size_t>( next - escape ) + 1;
+			}
+		}
+
+		json_pull_reader::token json_pull_reader::next( ) {
+			skip_separators( );
+			auto const c = peek( );
+			switch( c ) {
+			case '\0':
+				if( m_pos == m_end ) {
+					return token::end;
+				}
+				fail( "Unexpected character in JSON text" );
+			case '{': ++m_pos; return token::begin_object;
+			case '}': ++m_pos; return token::end_object;
+			case '[': ++m_pos; return token::begin_array;
+			case ']': ++m_pos; return token::end_array;
+			case '"':
+				++m_pos;
+				read_string( );
+				// A string followed by a colon is a key
+				while( true ) {
+					auto const after = peek( );
+					if( after == ':' ) {
+						++m_pos;
+						return token::key;
+					}
+					if( after != ' ' && after != '\t' && after != '\n' && after != '\r' ) {
+						return token::string;
+					}
+					++m_pos;
+				}
+			default: {
+					m_text.clear( );
+					auto const is_number = c == '-' || (c >= '0' && c <= '9');
+					while( true ) {
+						auto const d = peek( );
+						if( d == '\0' || d == ',' || d == '}' || d == ']' || d == ':' || d == ' ' || d == '\t' || d == '\n' || d == '\r' ) {
+							break;
+						}
+						m_text += d;
+						++m_pos;
+					}
+					if( m_text.empty( ) ) {
+						fail( "Expected a JSON value" );
+					}
+					return is_number ? token::number : token::literal;
+				}
+			}
+		}
+
+		std::string const & json_pull_reader::text( ) const noexcept {
+			return m_text;
+		}
+
+		void json_pull_reader::skip( token current ) {
+			if( current != token::begin_object && current != token::begin_array ) {
+				return;
+			}
+			size_t depth = 1;
+			while( depth > 0 ) {
+				switch( next( ) ) {
+				case token::begin_object:
+				case token::begin_array:
+					++depth;
+					break;
+				case token::end_object:
+				case token::end_array:
+					--depth;
+					break;
+				case token::end:
+					fail( "Unexpected end of JSON text" );
+				default:
+					break;
+				}
+			}
+		}
+
+		void json_pull_reader::skip_value( ) {
+			skip( next( ) );
+		}
+
+		void json_pull_reader::expect( token expected ) {
+			if( next( ) != expected ) {
+				fail( "Unexpected JSON token" );
+			}
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,269 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "lookup_index.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			int kind_rank( formula_value::kind_t kind ) noexcept {
+				switch( kind ) {
+				case formula_value::kind_t::number: return 0;
+				case formula_value::kind_t::string: return 1;
+				default: return 2;
+				}
+			}
+
+			bool qualifies( formula_value const & value, formula_value const & key, int match_type ) {
+				auto const order = impl::compare_lookup( value, key );
+				if( order == impl::lookup_unordered ) {
+					return false;
+				}
+				if( match_type == 0 ) {
+					return order == 0;
+				}
+				return match_type > 0 ? order <= 0 : order >= 0;
+			}
+
+			/// The best row found so far, rows may be offered in any order
+			class best_match {
+				int m_match_type;
+				size_t m_row;
+				formula_value m_value;
+			public:
+				explicit best_match( int match_type ):
+						m_match_type{ match_type },
+						m_row{ impl::no_match },
+						m_value{ } { }
+
+				size_t row( ) const noexcept {
+					return m_row;
+				}
+
+				void offer( lookup_index::row_t row, formula_value value ) {
+					if( m_row != impl::no_match ) {
+						if( m_match_type == 0 ) {
+							if( row > m_row ) {
+								return;
+							}
+						} else {
+							auto const order = impl::compare_lookup( value, m_value );
+							auto const better = m_match_type > 0 ? (order > 0 || (order == 0 && row > m_row)) : (order < 0 || (order == 0 && row < m_row));
+							if( !better ) {
+								return;
+							}
+						}
+					}
+					m_row = row;
+					m_value = std::move( value );
+				}
+			};	// best_match
+
+			/// impl::linear_match over rows first to last, reading them through value_of
+			size_t scan_match( formula_value const & key, int match_type, lookup_index::row_t first, lookup_index::row_t last, lookup_index::value_of_t const & value_of ) {
+				best_match best{ match_type };
+				for( auto row = static_cast<uint64_t>( first ); row <= last; ++row ) {
+					auto value = value_of( static_cast<lookup_index::row_t>( row ) );
+					if( qualifies( value, key, match_type ) ) {
+						best.offer( static_cast<lookup_index::row_t>( row ), std::move( value ) );
+						if( match_type == 0 ) {
+							break;
+						}
+					}
+				}
+				return best.row( ) == impl::no_match ? impl::no_match : best.row( ) - first;
+			}
+		}	// namespace anonymous
+
+		bool lookup_index::sorted_less::operator( )( sorted_entry const & lhs, sorted_entry const & rhs ) const {
+			auto const l_rank = kind_rank( lhs.value.kind );
+			auto const r_rank = kind_rank( rhs.value.kind );
+			if( l_rank != r_rank ) {
+				return l_rank < r_rank;
+			}
+			auto const order = impl::compare_lookup( lhs.value, rhs.value );
+			if( order != 0 ) {
+				return order < 0;
+			}
+			return lhs.row < rhs.row;
+		}
+
+		lookup_index::lookup_index( ):
+				m_hashed{ false },
+				m_sorted{ false },
+				m_hash{ },
+				m_values{ },
+				m_formula_rows{ } { }
+
+		bool lookup_index::has( lookup_index_kind kind ) const noexcept {
+			return kind == lookup_index_kind::hash ? m_hashed : m_sorted;
+		}
+
+		void lookup_index::enable( lookup_index_kind kind ) {
+			clear( );
+			if( kind == lookup_index_kind::hash ) {
+				m_hashed = true;
+			} else {
+				m_sorted = true;
+			}
+		}
+
+		void lookup_index::disable( lookup_index_kind kind ) {
+			if( kind == lookup_index_kind::hash ) {
+				m_hashed = false;
+				m_hash.clear( );
+			} else {
+				m_sorted = false;
+				m_values.clear( );
+			}
+			if( !enabled( ) ) {
+				m_formula_rows.clear( );
+			}
+		}
+
+		bool lookup_index::enabled( ) const noexcept {
+			return m_hashed || m_sorted;
+		}
+
+		void lookup_index::clear( ) noexcept {
+			m_hash.clear( );
+			m_values.clear( );
+			m_formula_rows.clear( );
+		}
+
+		void lookup_index::add( row_t row, formula_value const & value ) {
+			if( !impl::is_lookup_key( value ) ) {
+				return;
+			}
+			if( m_hashed ) {
+				auto & rows = m_hash[impl::lookup_hash( value )];
+				rows.insert( std::lower_bound( rows.begin( ), rows.end( ), row ), row );
+			}
+			if( m_sorted ) {
+				m_values.insert( sorted_entry{ value, row } );
+			}
+		}
+
+		void lookup_index::remove( row_t row, formula_value const & value ) {
+			if( !impl::is_lookup_key( value ) ) {
+				return;
+			}
+			if( m_hashed ) {
+				auto const pos = m_hash.find( impl::lookup_hash( value ) );
+				if( pos != m_hash.end( ) ) {
+					auto & rows = pos->second;
+					auto const found = std::lower_bound( rows.begin( ), rows.end( ), row );
+					if( found != rows.end( ) && *found == row ) {
+						rows.erase( found );
+					}
+					if( rows.empty( ) ) {
+						m_hash.erase( pos );
+					}
+				}
+			}
+			if( m_sorted ) {
+				m_values.erase( sorted_entry{ value, row } );
+			}
+		}
+
+		void lookup_index::add_formula( row_t row ) {
+			m_formula_rows.insert( row );
+		}
+
+		void lookup_index::remove_formula( row_t row ) {
+			m_formula_rows.erase( row );
+		}
+
+		bool lookup_index::can_match( int match_type ) const noexcept {
+			return m_sorted || (m_hashed && match_type == 0);
+		}
+
+		size_t lookup_index::match( formula_value const & key, int match_type, row_t first, row_t last, value_of_t const & value_of ) const {
+			if( !impl::is_lookup_key( key ) || first > last ) {
+				return impl::no_match;
+			}
+			best_match best{ match_type };
+			auto const in_range = [first, last]( row_t row ) {
+				return row >= first && row <= last;
+			};
+			// The sorted walks skip the entries of rows outside the range.  Once they have
+			// skipped as many as the range has rows, scanning the range is cheaper
+			auto budget = static_cast<size_t>( last - first ) + 1;
+			if( match_type == 0 && m_hashed ) {
+				// Equal hashes are checked against the cell as values can collide
+				auto const pos = m_hash.find( impl::lookup_hash( key ) );
+				if( pos != m_hash.end( ) ) {
+					auto const & rows = pos->second;
+					for( auto row = std::lower_bound( rows.begin( ), rows.end( ), first ); row != rows.end( ) && *row <= last; ++row ) {
+						auto value = value_of( *row );
+						if( impl::compare_lookup( value, key ) == 0 ) {
+							best.offer( *row, std::move( value ) );
+							break;
+						}
+					}
+				}
+			} else if( match_type > 0 ) {
+				// Back from the last entry not above the key, the first in range is the
+				// largest value and the last of its rows
+				auto pos = m_values.upper_bound( sorted_entry{ key, std::numeric_limits<row_t>::max( ) } );
+				while( pos != m_values.begin( ) ) {
+					if( budget-- == 0 ) {
+						return scan_match( key, match_type, first, last, value_of );
+					}
+					--pos;
+					if( pos->value.kind != key.kind ) {
+						break;
+					}
+					if( in_range( pos->row ) ) {
+						best.offer( pos->row, pos->value );
+						break;
+					}
+				}
+			} else {
+				for( auto pos = m_values.lower_bound( sorted_entry{ key, 0 } ); pos != m_values.end( ) && pos->value.kind == key.kind; ++pos ) {
+					if( match_type == 0 && impl::compare_lookup( pos->value, key ) != 0 ) {
+						break;
+					}
+					if( budget-- == 0 ) {
+						return scan_match( key, match_type, first, last, value_of );
+					}
+					if( in_range( pos->row ) ) {
+						best.offer( pos->row, pos->value );
+						break;
+					}
+				}
+			}
+			for( auto pos = m_formula_rows.lower_bound( first ); pos != m_formula_rows.end( ) && *pos <= last; ++pos ) {
+				auto value = value_of( *pos );
+				if( qualifies( value, key, match_type ) ) {
+					best.offer( *pos, std::move( value ) );
+				}
+			}
+			return best.row( ) == impl::no_match ? impl::no_match : best.row( ) - first;
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,121 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "mapped_file.h"
+
+namespace daw {
+	namespace spreadsheet {
+		void io_error( char const * what, std::string const & path ) {
+			throw std::runtime_error{ std::string{ what } + " '" + path + "': " + std::strerror( errno ) };
+		}
+
+		void sync_directory( std::string const & path ) {
+			auto const slash = path.find_last_of( '/' );
+			auto const directory = slash == std::string::npos ? std::string{ "." } : (slash == 0 ? std::string{ "/" } : path.substr( 0, slash ));
+			auto const fd = ::open( directory.c_str( ), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+			if( fd < 0 ) {
+				io_error( "Error opening directory", directory );
+			}
+			auto const result = ::fsync( fd );
+			::close( fd );
+			if( result != 0 ) {
+				io_error( "Error syncing directory", directory );
+			}
+		}
+
+		mapped_file::mapped_file( ) noexcept:
+				m_data{ nullptr },
+				m_size{ 0 } { }
+
+		mapped_file::mapped_file( std::string const & path ):
+				m_data{ nullptr },
+				m_size{ 0 } {
+
+			auto const fd = ::open( path.c_str( ), O_RDONLY | O_CLOEXEC );
+			if( fd < 0 ) {
+				io_error( "Error opening", path );
+			}
+			struct stat info;
+			if( ::fstat( fd, &info ) != 0 ) {
+				::close( fd );
+				io_error( "Error reading", path );
+			}
+			auto const size = static_cast<size_t>( info.st_size );
+			if( size > 0 ) {
+				auto const data = ::mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+				if( data == MAP_FAILED ) {
+					::close( fd );
+					io_error( "Error mapping", path );
+				}
+				m_data = data;
+				m_size = size;
+			}
+			::close( fd );
+		}
+
+		mapped_file::~mapped_file( ) {
+			if( m_data ) {
+				::munmap( m_data, m_size );
+			}
+		}
+
+		mapped_file::mapped_file( mapped_file && other ) noexcept:
+				m_data{ nullptr },
+				m_size{ 0 } {
+
+			swap( other );
+		}
+
+		mapped_file & mapped_file::operator=( mapped_file && rhs ) noexcept {
+			swap( rhs );
+			return *this;
+		}
+
+		void mapped_file::swap( mapped_file & rhs ) noexcept {
+			using std::swap;
+			swap( m_data, rhs.m_data );
+			swap( m_size, rhs.m_size );
+		}
+
+		char const * mapped_file::data( ) const noexcept {
+			return static_cast<char const *>( m_data );
+		}
+
+		size_t mapped_file::size( ) const noexcept {
+			return m_size;
+		}
+
+		boost::string_ref mapped_file::view( ) const noexcept {
+			return boost::string_ref{ data( ), m_size };
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
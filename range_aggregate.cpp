@@ -0,0 +1,359 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#include "range_aggregate.h"
+#include "sparse_grid.h"
+
+#if (defined( __x86_64__ ) || defined( __i386__ )) && (defined( __GNUC__ ) || defined( __clang__ ))
+#define DAW_SPREADSHEET_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			constexpr size_t bits_per_word = 64;
+
+			// Kernels over a lane.  The min/max kernels take one 64 row block and a non-zero
+			// mask of the rows to include
+			struct kernel_set {
+				int64_t ( *sum )( int64_t const * values, size_t count );
+				int64_t ( *min_block )( int64_t const * values, uint64_t mask );
+				int64_t ( *max_block )( int64_t const * values, uint64_t mask );
+			};	// kernel_set
+
+			int64_t sum_scalar( int64_t const * values, size_t count ) {
+				// Wrapping addition, the caller keeps blocks short enough not to overflow
+				uint64_t result = 0;
+				for( size_t n = 0; n < count; ++n ) {
+					result += static_cast<uint64_t>( values[n] );
+				}
+				return static_cast<int64_t>( result );
+			}
+
+			template<typename Compare>
+			int64_t select_block_scalar( int64_t const * values, uint64_t mask, Compare better ) {
+				auto result = values[impl::count_trailing_zeros( mask )];
+				for( ; mask != 0; mask &= mask - 1 ) {
+					auto const value = values[impl::count_trailing_zeros( mask )];
+					if( better( value, result ) ) {
+						result = value;
+					}
+				}
+				return result;
+			}
+
+			int64_t min_block_scalar( int64_t const * values, uint64_t mask ) {
+				return select_block_scalar( values, mask, []( int64_t a, int64_t b ) { return a < b; } );
+			}
+
+			int64_t max_block_scalar( int64_t const * values, uint64_t mask ) {
+				return select_block_scalar( values, mask, []( int64_t a, int64_t b ) { return a > b; } );
+			}
+
+#ifdef DAW_SPREADSHEET_X86_KERNELS
+			__attribute__(( target( "sse4.2" ) ))
+			int64_t sum_sse42( int64_t const * values, size_t count ) {
+				auto acc0 = _mm_setzero_si128( );
+				auto acc1 = _mm_setzero_si128( );
+				size_t n = 0;
+				for( ; n + 4 <= count; n += 4 ) {
+					acc0 = _mm_add_epi64( acc0, _mm_loadu_si128( reinterpret_cast<__m128i const *>( values + n ) ) );
+					acc1 = _mm_add_epi64( acc1, _mm_loadu_si128( reinterpret_cast<__m128i const *>( values + n + 2 ) ) );
+				}
+				alignas( 16 ) int64_t lanes[2];
+				_mm_store_si128( reinterpret_cast<__m128i *>( lanes ), _mm_add_epi64( acc0, acc1 ) );
+				return static_cast<int64_t>( static_cast<uint64_t>( lanes[0] ) + static_cast<uint64_t>( lanes[1] ) + static_cast<uint64_t>( sum_scalar( values + n, count - n ) ) );
+			}
+
+			// Rows outside the mask are replaced by the neutral value before the compare
+			template<bool is_min>
+			__attribute__(( target( "sse4.2" ) ))
+			int64_t select_block_sse42( int64_t const * values, uint64_t mask ) {
+				auto const neutral = _mm_set1_epi64x( is_min ? std::numeric_limits<int64_t>::max( ) : std::numeric_limits<int64_t>::min( ) );
+				auto const bits = _mm_set_epi64x( 2, 1 );
+				auto best = neutral;
+				if( mask == ~static_cast<uint64_t>( 0 ) ) {
+					// Every row of the block takes part, no blend needed
+					for( size_t group = 0; group < bits_per_word / 2; ++group ) {
+						auto const value = _mm_loadu_si128( reinterpret_cast<__m128i const *>( values + group * 2 ) );
+						auto const replace = is_min ? _mm_cmpgt_epi64( best, value ) : _mm_cmpgt_epi64( value, best );
+						best = _mm_blendv_epi8( best, value, replace );
+					}
+					mask = 0;
+				}
+				for( size_t group = 0; mask != 0 && group < bits_per_word / 2; ++group ) {
+					auto const group_mask = static_cast<int64_t>( (mask >> (group * 2)) & 0x3 );
+					if( group_mask == 0 ) {
+						continue;
+					}
+					auto const selected = _mm_cmpeq_epi64( _mm_and_si128( _mm_set1_epi64x( group_mask ), bits ), bits );
+					auto const value = _mm_blendv_epi8( neutral, _mm_loadu_si128( reinterpret_cast<__m128i const *>( values + group * 2 ) ), selected );
+					auto const replace = is_min ? _mm_cmpgt_epi64( best, value ) : _mm_cmpgt_epi64( value, best );
+					best = _mm_blendv_epi8( best, value, replace );
+				}
+				alignas( 16 ) int64_t lanes[2];
+				_mm_store_si128( reinterpret_cast<__m128i *>( lanes ), best );
+				return is_min ? std::min( lanes[0], lanes[1] ) : std::max( lanes[0], lanes[1] );
+			}
+
+			__attribute__(( target( "avx2" ) ))
+			int64_t sum_avx2( int64_t const * values, size_t count ) {
+				auto acc0 = _mm256_setzero_si256( );
+				auto acc1 = _mm256_setzero_si256( );
+				size_t n = 0;
+				for( ; n + 8 <= count; n += 8 ) {
+					acc0 = _mm256_add_epi64( acc0, _mm256_loadu_si256( reinterpret_cast<__m256i const *>( values + n ) ) );
+					acc1 = _mm256_add_epi64( acc1, _mm256_loadu_si256( reinterpret_cast<__m256i const *>( values + n + 4 ) ) );
+				}
+				alignas( 32 ) int64_t lanes[4];
+				_mm256_store_si256( reinterpret_cast<__m256i *>( lanes ), _mm256_add_epi64( acc0, acc1 ) );
+				uint64_t result = static_cast<uint64_t>( sum_scalar( values + n, count - n ) );
+				for( auto lane: lanes ) {
+					result += static_cast<uint64_t>( lane );
+				}
+				return static_cast<int64_t>( result );
+			}
+
+			template<bool is_min>
+			__attribute__(( target( "avx2" ) ))
+			int64_t select_block_avx2( int64_t const * values, uint64_t mask ) {
+				auto const neutral = _mm256_set1_epi64x( is_min ? std::numeric_limits<int64_t>::max( ) : std::numeric_limits<int64_t>::min( ) );
+				auto const bits = _mm256_set_epi64x( 8, 4, 2, 1 );
+				auto best = neutral;
+				if( mask == ~static_cast<uint64_t>( 0 ) ) {
+					// Every row of the block takes part, no blend needed
+					for( size_t group = 0; group < bits_per_word / 4; ++group ) {
+						auto const value = _mm256_loadu_si256( reinterpret_cast<__m256i const *>( values + group * 4 ) );
+						auto const replace = is_min ? _mm256_cmpgt_epi64( best, value ) : _mm256_cmpgt_epi64( value, best );
+						best = _mm256_blendv_epi8( best, value, replace );
+					}
+					mask = 0;
+				}
+				for( size_t group = 0; mask != 0 && group < bits_per_word / 4; ++group ) {
+					auto const group_mask = static_cast<int64_t>( (mask >> (group * 4)) & 0xF );
+					if( group_mask == 0 ) {
+						continue;
+					}
+					auto const selected = _mm256_cmpeq_epi64( _mm256_and_si256( _mm256_set1_epi64x( group_mask ), bits ), bits );
+					auto const value = _mm256_blendv_epi8( neutral, _mm256_loadu_si256( reinterpret_cast<__m256i const *>( values + group * 4 ) ), selected );
+					auto const replace = is_min ? _mm256_cmpgt_epi64( best, value ) : _mm256_cmpgt_epi64( value, best );
+					best = _mm256_blendv_epi8( best, value, replace );
+				}
+				alignas( 32 ) int64_t lanes[4];
+				_mm256_store_si256( reinterpret_cast<__m256i *>( lanes ), best );
+				return is_min ? *std::min_element( lanes, lanes + 4 ) : *std::max_element( lanes, lanes + 4 );
+			}
+#endif
+
+			kernel_set kernels_for( simd_level level ) noexcept {
+				switch( level ) {
+#ifdef DAW_SPREADSHEET_X86_KERNELS
+				case simd_level::avx2: return { &sum_avx2, &select_block_avx2<true>, &select_block_avx2<false> };
+				case simd_level::sse42: return { &sum_sse42, &select_block_sse42<true>, &select_block_sse42<false> };
+#endif
+				case simd_level::scalar:
+				default: return { &sum_scalar, &min_block_scalar, &max_block_scalar };
+				}
+			}
+
+			simd_level detect_simd_level( ) noexcept {
+#ifdef DAW_SPREADSHEET_X86_KERNELS
+				__builtin_cpu_init( );
+				if( __builtin_cpu_supports( "avx2" ) ) {
+					return simd_level::avx2;
+				}
+				if( __builtin_cpu_supports( "sse4.2" ) ) {
+					return simd_level::sse42;
+				}
+#endif
+				return simd_level::scalar;
+			}
+
+			std::atomic<simd_level> & active_level( ) noexcept {
+				static std::atomic<simd_level> s_level{ supported_simd_level( ) };
+				return s_level;
+			}
+
+			uint64_t range_mask( size_t word, size_t first_row, size_t last_row ) noexcept {
+				auto const word_first = word * bits_per_word;
+				uint64_t result = ~static_cast<uint64_t>( 0 );
+				if( first_row > word_first ) {
+					result &= ~static_cast<uint64_t>( 0 ) << (first_row - word_first);
+				}
+				if( last_row < word_first + bits_per_word ) {
+					result &= (static_cast<uint64_t>( 1 ) << (last_row - word_first)) - 1;
+				}
+				return result;
+			}
+
+			size_t popcount( uint64_t value ) noexcept {
+				return static_cast<size_t>( __builtin_popcountll( value ) );
+			}
+
+			/// The numbers in the range that are not in the lane, too big or too precise
+			template<typename Function>
+			void for_each_outside_lane( impl::column_store const & store, impl::numeric_lane const & lane, size_t first_row, size_t last_row, Function func ) {
+				for( auto word = first_row / bits_per_word; word * bits_per_word < last_row; ++word ) {
+					auto mask = lane.number_mask[word] & ~lane.lane_mask[word] & range_mask( word, first_row, last_row );
+					for( ; mask != 0; mask &= mask - 1 ) {
+						func( store.number( word * bits_per_word + impl::count_trailing_zeros( mask ) ) );
+					}
+				}
+			}
+
+			number::big_num_t lane_sum( kernel_set const & kernels, impl::numeric_lane const & lane, size_t first_row, size_t last_row ) {
+				// Rows outside the lane are zero, so no mask is needed.  Blocks are short enough
+				// that their int64 sum cannot overflow
+				auto const block_rows = lane.bound == 0 ? last_row - first_row : static_cast<size_t>( std::min<uint64_t>( std::numeric_limits<int64_t>::max( ) / lane.bound, std::numeric_limits<size_t>::max( ) ) );
+				int64_t total = 0;
+				number::big_num_t big_total{ };
+				bool use_big = false;
+				for( auto row = first_row; row < last_row; ) {
+					auto const count = std::min( block_rows, last_row - row );
+					auto const block = kernels.sum( lane.values + row, count );
+					int64_t next_total;
+					if( use_big || __builtin_add_overflow( total, block, &next_total ) ) {
+						if( !use_big ) {
+							big_total = number::big_num_t{ total };
+							use_big = true;
+						}
+						big_total += number::big_num_t{ block };
+					} else {
+						total = next_total;
+					}
+					row += count;
+				}
+				if( !use_big ) {
+					big_total = number::big_num_t{ total };
+				}
+				return big_total;
+			}
+
+			/// Min or max of the lane rows in range, false if there are none
+			bool lane_select( int64_t ( *select_block )( int64_t const *, uint64_t ), bool is_min, impl::numeric_lane const & lane, size_t first_row, size_t last_row, int64_t & result ) {
+				bool found = false;
+				for( auto word = first_row / bits_per_word; word * bits_per_word < last_row; ++word ) {
+					auto const mask = lane.lane_mask[word] & range_mask( word, first_row, last_row );
+					if( mask == 0 ) {
+						continue;
+					}
+					auto const block_first = word * bits_per_word;
+					int64_t value;
+					if( block_first + bits_per_word <= lane.size ) {
+						value = select_block( lane.values + block_first, mask );
+					} else if( is_min ) {
+						// The last partial block may not have 64 readable values
+						value = min_block_scalar( lane.values + block_first, mask );
+					} else {
+						value = max_block_scalar( lane.values + block_first, mask );
+					}
+					if( !found || (is_min ? value < result : value > result) ) {
+						result = value;
+						found = true;
+					}
+				}
+				return found;
+			}
+
+			size_t count_numbers( impl::numeric_lane const & lane, size_t first_row, size_t last_row ) noexcept {
+				size_t result = 0;
+				for( auto word = first_row / bits_per_word; word * bits_per_word < last_row; ++word ) {
+					result += popcount( lane.number_mask[word] & range_mask( word, first_row, last_row ) );
+				}
+				return result;
+			}
+		}	// namespace anonymous
+
+		simd_level supported_simd_level( ) noexcept {
+			static simd_level const s_level = detect_simd_level( );
+			return s_level;
+		}
+
+		simd_level active_simd_level( ) noexcept {
+			return active_level( ).load( std::memory_order_relaxed );
+		}
+
+		void set_simd_level( simd_level level ) noexcept {
+			active_level( ).store( std::min( level, supported_simd_level( ) ), std::memory_order_relaxed );
+		}
+
+		formula_value aggregate_value( impl::column_store const & store, formula_function function, size_t first_row, size_t row_count ) {
+			auto const lane = store.lane( );
+			auto const last_row = std::min( lane.size, first_row + row_count );
+			first_row = std::min( first_row, last_row );
+			auto const kernels = kernels_for( active_simd_level( ) );
+			auto const from_lane = [&lane]( int64_t mantissa ) {
+				return number::big_num_t::from_scaled( mantissa, lane.scale );
+			};
+			switch( function ) {
+			case formula_function::count:
+				return formula_value::from_number( number::big_num_t{ count_numbers( lane, first_row, last_row ) } );
+			case formula_function::sum:
+			case formula_function::average: {
+					// The lane sum is of mantissas, scaling it afterwards is exact
+					auto total = lane_sum( kernels, lane, first_row, last_row );
+					if( lane.scale != 0 ) {
+						total *= from_lane( 1 );
+					}
+					for_each_outside_lane( store, lane, first_row, last_row, [&total]( number::big_num_t const & value ) {
+						total += value;
+					} );
+					if( function == formula_function::sum ) {
+						return formula_value::from_number( std::move( total ) );
+					}
+					auto const count = count_numbers( lane, first_row, last_row );
+					if( count == 0 ) {
+						return formula_value::from_error( formula_error::div_zero );
+					}
+					return formula_value::from_number( total / number::big_num_t{ count } );
+				}
+			case formula_function::min:
+			case formula_function::max: {
+					bool const is_min = function == formula_function::min;
+					int64_t selected = 0;
+					bool found = lane_select( is_min ? kernels.min_block : kernels.max_block, is_min, lane, first_row, last_row, selected );
+					number::big_num_t result = found ? from_lane( selected ) : number::big_num_t{ };
+					for_each_outside_lane( store, lane, first_row, last_row, [&]( number::big_num_t const & value ) {
+						if( !found || (is_min ? value < result : value > result) ) {
+							result = value;
+							found = true;
+						}
+					} );
+					// No numbers gives 0, as MIN and MAX of the formula VM do
+					return formula_value::from_number( std::move( result ) );
+				}
+			default:
+				return formula_value::from_error( formula_error::value );
+			}
+		}
+
+		impl::cell_value::cell_variant_t aggregate( impl::column_store const & store, formula_function function, size_t first_row, size_t row_count ) {
+			return to_variant( aggregate_value( store, function, first_row, row_count ) );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
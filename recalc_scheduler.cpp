@@ -0,0 +1,57 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "recalc_scheduler.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			std::shared_ptr<thread_pool> pool_for( recalc_options const & options ) {
+				if( options.pool ) {
+					return options.pool;
+				}
+				if( options.thread_count == 0 ) {
+					return shared_thread_pool( );
+				}
+				return std::make_shared<thread_pool>( options.thread_count );
+			}
+		}	// namespace anonymous
+
+		recalc_scheduler::recalc_scheduler( recalc_options options ):
+				m_options{ options },
+				m_pool{ pool_for( options ) } { }
+
+		recalc_scheduler::~recalc_scheduler( ) { }
+
+		recalc_options const & recalc_scheduler::options( ) const noexcept {
+			return m_options;
+		}
+
+		size_t recalc_scheduler::thread_count( ) const noexcept {
+			return m_pool->size( );
+		}
+
+		thread_pool & recalc_scheduler::pool( ) noexcept {
+			return *m_pool;
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,516 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "row_view.h"
+#include "sheet.h"
+#include "value_classifier.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			using expected_value_t = impl::cell_value::expected_value_t;
+
+			// Kinds in the order an ascending sort puts them
+			enum class sort_rank: uint8_t { number, time, timestamp, text, boolean, error, empty };
+
+			constexpr unsigned prefix_bits = 61;
+			constexpr uint64_t prefix_mask = (static_cast<uint64_t>( 1 ) << prefix_bits) - 1;
+
+			/// A cell as a sort compares it.  number holds numbers, the ticks of times and
+			/// timestamps, booleans and error codes.  prefix orders cells of the same rank
+			/// without deciding ties: a smaller prefix is a smaller cell, an equal one needs
+			/// the full comparison
+			struct sort_cell {
+				uint64_t prefix;
+				number::big_num_t number;
+				boost::string_ref text;
+				sort_rank rank;
+
+				sort_cell( ):
+						prefix{ 0 },
+						number{ },
+						text{ },
+						rank{ sort_rank::empty } { }
+			};	// sort_cell
+
+			unsigned char fold_case( char c ) noexcept {
+				auto const result = static_cast<unsigned char>( c );
+				return result >= 'A' && result <= 'Z' ? static_cast<unsigned char>( result | 0x20 ) : result;
+			}
+
+			int compare_text( boost::string_ref lhs, boost::string_ref rhs ) noexcept {
+				auto const count = std::min( lhs.size( ), rhs.size( ) );
+				for( size_t n = 0; n < count; ++n ) {
+					auto const l = fold_case( lhs[n] );
+					auto const r = fold_case( rhs[n] );
+					if( l != r ) {
+						return l < r ? -1 : 1;
+					}
+				}
+				return lhs.size( ) == rhs.size( ) ? 0 : (lhs.size( ) < rhs.size( ) ? -1 : 1);
+			}
+
+			int compare_cells( sort_cell const & lhs, sort_cell const & rhs ) {
+				if( lhs.rank != rhs.rank ) {
+					return lhs.rank < rhs.rank ? -1 : 1;
+				}
+				if( lhs.prefix != rhs.prefix ) {
+					return lhs.prefix < rhs.prefix ? -1 : 1;
+				}
+				switch( lhs.rank ) {
+				case sort_rank::text:
+					return compare_text( lhs.text, rhs.text );
+				case sort_rank::empty:
+					return 0;
+				default: {
+						auto const result = lhs.number.compare( rhs.number );
+						if( result != 0 || lhs.rank != sort_rank::error ) {
+							return result < 0 ? -1 : (result > 0 ? 1 : 0);
+						}
+						return compare_text( lhs.text, rhs.text );
+					}
+				}
+			}
+
+			uint64_t integer_prefix( int64_t value ) noexcept {
+				return (static_cast<uint64_t>( value ) ^ (static_cast<uint64_t>( 1 ) << 63)) >> (64 - prefix_bits);
+			}
+
+			/// The first bytes of the text without case, so prefixes order as compare_text does
+			uint64_t text_prefix( boost::string_ref text ) noexcept {
+				uint64_t result = 0;
+				for( size_t n = 0; n < 8; ++n ) {
+					result = (result << 8) | (n < text.size( ) ? fold_case( text[n] ) : 0u);
+				}
+				return result >> (64 - prefix_bits);
+			}
+
+			/// A double orders numbers correctly when it is the correctly rounded value, which
+			/// it is when the mantissa and the power of ten are both exact doubles
+			bool number_prefix( number::big_num_t const & value, uint64_t & result ) noexcept {
+				constexpr int64_t exact_mantissa = static_cast<int64_t>( 1 ) << 53;
+				static double const s_powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+				if( !value.is_small( ) || value.mantissa( ) > exact_mantissa || value.mantissa( ) < -exact_mantissa || value.scale( ) > number::big_num_t::max_scale ) {
+					return false;
+				}
+				auto const approximate = static_cast<double>( value.mantissa( ) ) / s_powers[value.scale( )];
+				uint64_t bits;
+				std::memcpy( &bits, &approximate, sizeof( bits ) );
+				bits = (bits >> 63) != 0 ? ~bits : bits | (static_cast<uint64_t>( 1 ) << 63);
+				result = bits >> (64 - prefix_bits);
+				return true;
+			}
+
+			int64_t ticks_since_epoch( boost::posix_time::ptime const & value ) {
+				static boost::posix_time::ptime const s_epoch{ boost::gregorian::date{ 1970, 1, 1 } };
+				return (value - s_epoch).ticks( );
+			}
+
+			void set_ticks( sort_rank rank, int64_t ticks, sort_cell & result ) {
+				result.rank = rank;
+				result.number = ticks;
+				result.prefix = integer_prefix( ticks );
+			}
+
+			void set_boolean( bool value, sort_cell & result ) {
+				result.rank = sort_rank::boolean;
+				result.number = value ? 1 : 0;
+				result.prefix = value ? 1 : 0;
+			}
+
+			void set_text( sort_rank rank, boost::string_ref text, sort_cell & result ) {
+				result.rank = rank;
+				result.text = text;
+				result.prefix = text_prefix( text );
+			}
+
+			void from_text( boost::string_ref text, sort_cell & result ) {
+				if( text.empty( ) ) {
+					return;
+				}
+				auto const classified = classify_value( text );
+				switch( classified.type ) {
+				case expected_value_t::Number:
+					result.rank = sort_rank::number;
+					result.number = to_number( classified );
+					return;
+				case expected_value_t::Time:
+					set_ticks( sort_rank::time, classified.ticks, result );
+					return;
+				case expected_value_t::Timestamp:
+					set_ticks( sort_rank::timestamp, classified.ticks, result );
+					return;
+				case expected_value_t::Boolean:
+					set_boolean( classified.boolean, result );
+					return;
+				default:
+					set_text( sort_rank::text, text, result );
+					return;
+				}
+			}
+
+			/// Typed rows are read from their packed values, others are classified as
+			/// sheet::value classifies them.  Number prefixes are left to the caller
+			void from_store( impl::column_store const & store, size_t row, sort_cell & result ) {
+				auto const text = store.string_value( row );
+				if( !store.has_value( row ) ) {
+					if( store.value_type( row ) == expected_value_t::Error && !text.empty( ) ) {
+						set_text( sort_rank::error, text, result );
+					} else {
+						from_text( text, result );
+					}
+					return;
+				}
+				switch( store.value_type( row ) ) {
+				case expected_value_t::Number:
+					result.rank = sort_rank::number;
+					result.number = store.number( row );
+					return;
+				case expected_value_t::Time:
+					set_ticks( sort_rank::time, store.duration( row ).ticks( ), result );
+					return;
+				case expected_value_t::Timestamp:
+					set_ticks( sort_rank::timestamp, ticks_since_epoch( store.timestamp( row ) ), result );
+					return;
+				case expected_value_t::Boolean:
+					set_boolean( store.boolean( row ), result );
+					return;
+				default:
+					from_text( text, result );
+					return;
+				}
+			}
+
+			/// The cells of one key column for each row of a view.  Text refers into the
+			/// column or, for formula results, into m_results
+			class sort_column {
+				std::vector<sort_cell> m_cells;
+				std::deque<std::string> m_results;
+
+				void from_result( formula_value value, sort_cell & result ) {
+					switch( value.kind ) {
+					case formula_value::kind_t::number:
+						result.rank = sort_rank::number;
+						result.number = std::move( value.number );
+						return;
+					case formula_value::kind_t::string:
+						if( !value.text.empty( ) ) {
+							m_results.push_back( std::move( value.text ) );
+							set_text( sort_rank::text, m_results.back( ), result );
+						}
+						return;
+					case formula_value::kind_t::boolean:
+						set_boolean( value.boolean, result );
+						return;
+					case formula_value::kind_t::error:
+						result.rank = sort_rank::error;
+						result.number = static_cast<int>( value.error );
+						result.prefix = static_cast<uint64_t>( value.error );
+						return;
+					default:
+						return;
+					}
+				}
+			public:
+				sort_column( sheet const & source, row_view const & view, size_t column, thread_pool & pool ):
+						m_cells( view.size( ) ),
+						m_results{ } {
+
+					if( column >= source.column_count( ) ) {
+						return;
+					}
+					auto const & store = source.column( column ).store( );
+					auto const & rows = view.rows( );
+					auto const index = static_cast<cell_address::index_t>( column );
+					std::vector<uint8_t> is_formula( rows.size( ), 0 );
+					std::atomic<bool> exact_numbers{ true };
+					pool.parallel_for_blocks( rows.size( ), 4096, [&]( size_t first, size_t last ) {
+						bool exact = true;
+						for( auto n = first; n < last; ++n ) {
+							if( rows[n] >= store.size( ) ) {
+								continue;
+							}
+							if( source.is_formula( cell_address{ rows[n], index } ) ) {
+								is_formula[n] = 1;
+								continue;
+							}
+							auto & cell = m_cells[n];
+							from_store( store, rows[n], cell );
+							if( cell.rank == sort_rank::number ) {
+								exact &= number_prefix( cell.number, cell.prefix );
+							}
+						}
+						if( !exact ) {
+							exact_numbers = false;
+						}
+					} );
+					// Results are copies, kept here so the cells can refer to their text
+					for( size_t n = 0; n < rows.size( ); ++n ) {
+						if( is_formula[n] != 0 ) {
+							auto & cell = m_cells[n];
+							from_result( source.value( cell_address{ rows[n], index } ), cell );
+							if( cell.rank == sort_rank::number && !number_prefix( cell.number, cell.prefix ) ) {
+								exact_numbers = false;
+							}
+						}
+					}
+					// One number without a correctly rounded double makes prefixes of numbers unusable
+					if( !exact_numbers ) {
+						for( auto & cell: m_cells ) {
+							if( cell.rank == sort_rank::number ) {
+								cell.prefix = 0;
+							}
+						}
+					}
+				}
+
+				sort_cell const & operator[]( size_t n ) const noexcept {
+					return m_cells[n];
+				}
+
+				/// @brief The rank and prefix of the cell at n in one integer, ordered as the
+				/// key orders the cells except for ties
+				uint64_t key( size_t n, bool ascending ) const noexcept {
+					auto const & cell = m_cells[n];
+					if( cell.rank == sort_rank::empty ) {
+						return ~static_cast<uint64_t>( 0 );
+					}
+					auto const rank = static_cast<uint64_t>( cell.rank );
+					if( ascending ) {
+						return (rank << prefix_bits) | cell.prefix;
+					}
+					auto const last_rank = static_cast<uint64_t>( sort_rank::error );
+					return ((last_rank - rank) << prefix_bits) | (~cell.prefix & prefix_mask);
+				}
+			};	// sort_column
+
+			/// A position in the view with the first key's rank and prefix
+			struct sort_entry {
+				uint64_t key;
+				uint32_t position;
+			};	// sort_entry
+
+			/// Orders entries by their first key's prefix, then by all keys, then by position
+			/// so the order is total and equal rows keep their order
+			class sort_less {
+				std::vector<sort_column> const * m_columns;
+				std::vector<sort_key> const * m_keys;
+
+				bool less_cells( uint32_t lhs, uint32_t rhs ) const {
+					for( size_t k = 0; k < m_keys->size( ); ++k ) {
+						auto const & l = (*m_columns)[k][lhs];
+						auto const & r = (*m_columns)[k][rhs];
+						if( l.rank == sort_rank::empty || r.rank == sort_rank::empty ) {
+							if( l.rank != r.rank ) {
+								return r.rank == sort_rank::empty;
+							}
+							continue;
+						}
+						auto const order = compare_cells( l, r );
+						if( order != 0 ) {
+							return (*m_keys)[k].ascending ? order < 0 : order > 0;
+						}
+					}
+					return lhs < rhs;
+				}
+			public:
+				sort_less( std::vector<sort_column> const & columns, std::vector<sort_key> const & keys ) noexcept:
+						m_columns{ &columns },
+						m_keys{ &keys } { }
+
+				bool operator( )( sort_entry const & lhs, sort_entry const & rhs ) const {
+					if( lhs.key != rhs.key ) {
+						return lhs.key < rhs.key;
+					}
+					return less_cells( lhs.position, rhs.position );
+				}
+			};	// sort_less
+
+			/// Sort blocks of entries in parallel, then merge pairs of runs in parallel,
+			/// doubling the run length each pass
+			void merge_sort( std::vector<sort_entry> & entries, sort_less const & less, thread_pool & pool ) {
+				auto const count = entries.size( );
+				auto const block_count = std::max<size_t>( pool.size( ) * 4, 1 );
+				auto const run = std::max<size_t>( (count + block_count - 1) / block_count, 2048 );
+				pool.parallel_for_blocks( count, run, [&]( size_t first, size_t last ) {
+					std::sort( entries.begin( ) + static_cast<std::ptrdiff_t>( first ), entries.begin( ) + static_cast<std::ptrdiff_t>( last ), less );
+				} );
+				if( run >= count ) {
+					return;
+				}
+				std::vector<sort_entry> buffer( count );
+				for( auto width = run; width < count; width *= 2 ) {
+					auto const pair_count = (count + 2 * width - 1) / (2 * width);
+					pool.parallel_for( pair_count, 1, [&]( size_t pair ) {
+						auto const first = pair * 2 * width;
+						auto const middle = std::min( first + width, count );
+						auto const last = std::min( first + 2 * width, count );
+						auto const from = entries.begin( );
+						std::merge( from + static_cast<std::ptrdiff_t>( first ), from + static_cast<std::ptrdiff_t>( middle ),
+								from + static_cast<std::ptrdiff_t>( middle ), from + static_cast<std::ptrdiff_t>( last ),
+								buffer.begin( ) + static_cast<std::ptrdiff_t>( first ), less );
+					} );
+					entries.swap( buffer );
+				}
+			}
+
+			/// Bring the stale formulas of a column up to date so their results can be read
+			void evaluate_column( sheet & source, size_t column ) {
+				if( source.stale_count( ) == 0 || column >= source.column_count( ) || source.row_count( ) == 0 ) {
+					return;
+				}
+				auto const index = static_cast<cell_address::index_t>( column );
+				source.evaluate( cell_range{ cell_address{ 0, index }, cell_address{ static_cast<cell_address::index_t>( source.row_count( ) - 1 ), index } } );
+			}
+		}	// namespace anonymous
+
+		row_view::row_view( ):
+				m_rows{ },
+				m_source_rows{ 0 } { }
+
+		row_view::row_view( size_t row_count ):
+				m_rows( row_count ),
+				m_source_rows{ row_count } {
+
+			std::iota( m_rows.begin( ), m_rows.end( ), static_cast<cell_address::index_t>( 0 ) );
+		}
+
+		row_view::row_view( std::vector<cell_address::index_t> rows, size_t source_rows ):
+				m_rows{ std::move( rows ) },
+				m_source_rows{ source_rows } {
+
+			for( auto const row: m_rows ) {
+				if( row >= m_source_rows ) {
+					throw std::out_of_range{ "Row of view is past the end of its source" };
+				}
+			}
+		}
+
+		size_t row_view::size( ) const noexcept {
+			return m_rows.size( );
+		}
+
+		bool row_view::empty( ) const noexcept {
+			return m_rows.empty( );
+		}
+
+		size_t row_view::source_rows( ) const noexcept {
+			return m_source_rows;
+		}
+
+		std::vector<cell_address::index_t> const & row_view::rows( ) const noexcept {
+			return m_rows;
+		}
+
+		size_t row_view::source_row( size_t row ) const {
+			if( row >= m_rows.size( ) ) {
+				throw std::out_of_range{ "Row is past the end of the view" };
+			}
+			return m_rows[row];
+		}
+
+		cell_address row_view::source_cell( cell_address const & cell ) const {
+			return cell_address{ static_cast<cell_address::index_t>( source_row( cell.row ) ), cell.column };
+		}
+
+		sort_key::sort_key( size_t key_column, bool is_ascending ) noexcept:
+				column{ key_column },
+				ascending{ is_ascending } { }
+
+		row_view sort_rows( sheet & source, row_view const & view, std::vector<sort_key> const & keys, thread_pool & pool ) {
+			for( auto const & key: keys ) {
+				evaluate_column( source, key.column );
+			}
+			std::vector<sort_column> columns;
+			columns.reserve( keys.size( ) );
+			for( auto const & key: keys ) {
+				columns.emplace_back( source, view, key.column, pool );
+			}
+			std::vector<sort_entry> entries( view.size( ) );
+			pool.parallel_for_blocks( entries.size( ), 65536, [&]( size_t first, size_t last ) {
+				for( auto n = first; n < last; ++n ) {
+					entries[n] = sort_entry{ keys.empty( ) ? 0 : columns.front( ).key( n, keys.front( ).ascending ), static_cast<uint32_t>( n ) };
+				}
+			} );
+			merge_sort( entries, sort_less{ columns, keys }, pool );
+
+			std::vector<cell_address::index_t> rows( entries.size( ) );
+			for( size_t n = 0; n < entries.size( ); ++n ) {
+				rows[n] = view.rows( )[entries[n].position];
+			}
+			return row_view{ std::move( rows ), view.source_rows( ) };
+		}
+
+		row_view sort_rows( sheet & source, std::vector<sort_key> const & keys, thread_pool & pool ) {
+			return sort_rows( source, row_view{ source.row_count( ) }, keys, pool );
+		}
+
+		row_view filter_rows( row_view const & view, std::function<bool( size_t source_row )> const & keep, thread_pool & pool ) {
+			auto const & rows = view.rows( );
+			size_t const block_size = 4096;
+			auto const block_count = (rows.size( ) + block_size - 1) / block_size;
+			std::vector<uint8_t> kept( rows.size( ), 0 );
+			std::vector<size_t> counts( block_count, 0 );
+			pool.parallel_for( block_count, 1, [&]( size_t block ) {
+				auto const last = std::min( (block + 1) * block_size, rows.size( ) );
+				for( auto n = block * block_size; n < last; ++n ) {
+					if( keep( rows[n] ) ) {
+						kept[n] = 1;
+						++counts[block];
+					}
+				}
+			} );
+			std::vector<size_t> offsets( block_count + 1, 0 );
+			std::partial_sum( counts.begin( ), counts.end( ), offsets.begin( ) + 1 );
+			std::vector<cell_address::index_t> result( offsets.back( ) );
+			pool.parallel_for( block_count, 1, [&]( size_t block ) {
+				auto const last = std::min( (block + 1) * block_size, rows.size( ) );
+				auto out = offsets[block];
+				for( auto n = block * block_size; n < last; ++n ) {
+					if( kept[n] != 0 ) {
+						result[out++] = rows[n];
+					}
+				}
+			} );
+			return row_view{ std::move( result ), view.source_rows( ) };
+		}
+
+		row_view filter_rows( sheet & source, row_view const & view, size_t column, std::function<bool( formula_value const & value )> const & test, thread_pool & pool ) {
+			evaluate_column( source, column );
+			auto const index = static_cast<cell_address::index_t>( column );
+			return filter_rows( view, [&]( size_t row ) {
+				return test( source.value( cell_address{ static_cast<cell_address::index_t>( row ), index } ) );
+			}, pool );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -0,0 +1,767 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "sheet.h"
+#include "value_classifier.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			/// @return the text of a formula without its leading =, or an empty string_ref
+			/// when text is not a formula
+			boost::string_ref formula_text( boost::string_ref text ) noexcept {
+				auto first = std::find_if( text.begin( ), text.end( ), []( char c ) {
+					return c != ' ' && c != '\t';
+				} );
+				if( first == text.end( ) || *first != '=' ) {
+					return boost::string_ref{ };
+				}
+				return boost::string_ref{ first, static_cast<size_t>( std::distance( first, text.end( ) ) ) };
+			}
+
+			formula_value to_formula_value( impl::column_store const & store, size_t row ) {
+				if( store.has_value( row ) ) {
+					switch( store.value_type( row ) ) {
+					case impl::cell_value::expected_value_t::Number: return formula_value::from_number( store.number( row ) );
+					case impl::cell_value::expected_value_t::Boolean: return formula_value::from_boolean( store.boolean( row ) );
+					default: break;
+					}
+				}
+				auto const text = store.string_value( row );
+				if( text.empty( ) ) {
+					return formula_value{ };
+				}
+				auto const classified = classify_value( text );
+				switch( classified.type ) {
+				case impl::cell_value::expected_value_t::Number: return formula_value::from_number( to_number( classified ) );
+				case impl::cell_value::expected_value_t::Boolean: return formula_value::from_boolean( classified.boolean );
+				default: return formula_value::from_string( text.to_string( ) );
+				}
+			}
+
+			/// Reads the cells of a sheet for the formula VM
+			struct sheet_resolver {
+				sheet const * m_sheet;
+
+				formula_value value( cell_address const & cell ) const {
+					return m_sheet->value( cell );
+				}
+
+				template<typename Function>
+				void for_each_value( cell_range const & range, Function func ) const {
+					for( size_t column = range.first.column; column <= range.last.column && column < m_sheet->column_count( ); ++column ) {
+						auto const rows = m_sheet->column( column ).size( );
+						for( size_t row = range.first.row; row <= range.last.row && row < rows; ++row ) {
+							auto result = value( cell_address{ static_cast<cell_address::index_t>( row ), static_cast<cell_address::index_t>( column ) } );
+							if( result.kind != formula_value::kind_t::empty ) {
+								func( result );
+							}
+						}
+					}
+				}
+
+				size_t find_match( cell_range const & range, formula_value const & key, int match_type ) const {
+					return m_sheet->find_match( range, key, match_type );
+				}
+			};	// sheet_resolver
+
+			struct copied_cell {
+				cell_address cell;
+				impl::cell_value::expected_value_t value_type;
+				std::string text;
+			};	// copied_cell
+
+			/// The cells of source that exist, read before pasting so overlapping copies see
+			/// the source as it was
+			std::vector<copied_cell> copy_out( sheet const & source_sheet, cell_range const & source ) {
+				std::vector<copied_cell> result;
+				for( uint64_t column = source.first.column; column <= source.last.column && column < source_sheet.column_count( ); ++column ) {
+					auto const & store = source_sheet.column( column ).store( );
+					for( uint64_t row = source.first.row; row <= source.last.row && row < store.size( ); ++row ) {
+						result.push_back( copied_cell{
+								cell_address{ static_cast<cell_address::index_t>( row ), static_cast<cell_address::index_t>( column ) },
+								store.value_type( row ),
+								store.string_value( row ).to_string( ) } );
+					}
+				}
+				return result;
+			}
+
+			/// Writes cells copied relative to from so from lands on to, moving formula references
+			void paste( sheet & target, std::vector<copied_cell> const & cells, cell_address const & from, cell_address const & to ) {
+				static thread_local std::string s_moved;
+				for( auto const & copied: cells ) {
+					auto const row = static_cast<uint64_t>( copied.cell.row ) - from.row + to.row;
+					auto const column = static_cast<uint64_t>( copied.cell.column ) - from.column + to.column;
+					if( row > std::numeric_limits<cell_address::index_t>::max( ) || column > std::numeric_limits<cell_address::index_t>::max( ) ) {
+						throw std::out_of_range{ "Copied cells extend past the end of the sheet" };
+					}
+					cell_address const cell{ static_cast<cell_address::index_t>( row ), static_cast<cell_address::index_t>( column ) };
+					if( formula_text( copied.text ).empty( ) ) {
+						target.set_value( cell, copied.value_type, copied.text );
+					} else {
+						move_formula( copied.text, copied.cell, cell, s_moved );
+						target.set_value( cell, copied.value_type, s_moved );
+					}
+				}
+			}
+		}	// namespace anonymous
+
+		sheet::transaction::transaction( sheet & owner ):
+				m_sheet{ &owner } {
+
+			m_sheet->begin_transaction( );
+		}
+
+		sheet::transaction::~transaction( ) {
+			if( m_sheet == nullptr ) {
+				return;
+			}
+			try {
+				m_sheet->commit( );
+			} catch( ... ) {
+				// Listeners cannot be reported to from a destructor
+			}
+		}
+
+		void sheet::transaction::commit( ) {
+			if( m_sheet != nullptr ) {
+				std::exchange( m_sheet, nullptr )->commit( );
+			}
+		}
+
+		sheet::sheet( daw::nodepp::base::EventEmitter emitter, recalc_options options ):
+				table_item{ std::move( emitter ) },
+				m_strings{ std::make_shared<string_pool>( ) },
+				m_formula_cache{ std::make_shared<formula_cache>( ) },
+				m_columns{ },
+				m_column_ids{ },
+				m_formulas{ },
+				m_indexes{ },
+				m_graph{ },
+				m_scheduler{ std::make_unique<recalc_scheduler>( options ) },
+				m_edited{ },
+				m_transaction_depth{ 0 },
+				m_journal{ } { }
+
+		sheet::~sheet( ) { }
+
+		size_t sheet::column_count( ) const noexcept {
+			return m_columns.size( );
+		}
+
+		size_t sheet::row_count( ) const noexcept {
+			size_t result = 0;
+			for( auto const & col: m_columns ) {
+				result = std::max( result, col.size( ) );
+			}
+			return result;
+		}
+
+		void sheet::resize( size_t column_count ) {
+			transaction tx{ *this };
+			if( m_journal ) {
+				m_journal->append_resize( column_count );
+			}
+			for( auto column = column_count; column < m_columns.size( ); ++column ) {
+				auto const rows = m_columns[column].size( );
+				if( rows == 0 ) {
+					continue;
+				}
+				auto const index = static_cast<cell_address::index_t>( column );
+				for( size_t row = 0; row < rows; ++row ) {
+					cell_address const cell{ static_cast<cell_address::index_t>( row ), index };
+					erase_formula( cell );
+					m_edited.push_back( cell );
+				}
+				events( )->add_change( cell_range{ cell_address{ 0, index }, cell_address{ static_cast<cell_address::index_t>( rows - 1 ), index } } );
+			}
+			if( column_count < m_columns.size( ) ) {
+				for( auto column = column_count; column < m_columns.size( ); ++column ) {
+					m_column_ids.erase( m_columns[column].id( ) );
+				}
+				if( m_indexes.size( ) > column_count ) {
+					m_indexes.resize( column_count );
+				}
+				// The columns' closed events are deferred until the commit
+				m_columns.erase( m_columns.begin( ) + static_cast<std::ptrdiff_t>( column_count ), m_columns.end( ) );
+			} else {
+				while( m_columns.size( ) < column_count ) {
+					m_columns.emplace_back( emitter( ), events( ) );
+					m_columns.back( ).store( ).use_pool( m_strings );
+					m_column_ids.insert( m_columns.back( ).id( ), m_columns.size( ) - 1 );
+				}
+			}
+			tx.commit( );
+		}
+
+		impl::column const & sheet::column( size_t index ) const {
+			return m_columns.at( index );
+		}
+
+		impl::column const * sheet::find_column( id_t id ) const noexcept {
+			auto const index = m_column_ids.find( id );
+			return index != nullptr ? &m_columns[*index] : nullptr;
+		}
+
+		size_t sheet::column_index( id_t id ) const {
+			auto const index = m_column_ids.find( id );
+			if( index == nullptr ) {
+				throw std::out_of_range{ "No column of the sheet has this id" };
+			}
+			return *index;
+		}
+
+		std::shared_ptr<string_pool> const & sheet::strings( ) const noexcept {
+			return m_strings;
+		}
+
+		std::shared_ptr<formula_cache> const & sheet::formulas( ) const noexcept {
+			return m_formula_cache;
+		}
+
+		void sheet::store_formula( cell_address const & cell, boost::string_ref text ) {
+			static thread_local std::vector<cell_address> s_cells;
+			static thread_local std::vector<cell_range> s_ranges;
+			formula_cell entry{ m_formula_cache->get( text, cell ), formula_value{ } };
+			if( entry.formula->parsed( ) ) {
+				entry.formula->references( cell, s_cells, s_ranges );
+				m_graph.set_precedents( cell, s_cells, s_ranges );
+			} else {
+				entry.result = formula_value::from_error( formula_error::value );
+				m_graph.set_precedents( cell, { } );
+			}
+			m_formulas.emplace( cell, std::move( entry ) );
+		}
+
+		void sheet::erase_formula( cell_address const & cell ) {
+			if( m_formulas.erase( cell ) ) {
+				m_graph.remove_formula( cell );
+			}
+		}
+
+		impl::column & sheet::prepare_cell( cell_address const & cell ) {
+			if( cell.column >= m_columns.size( ) ) {
+				resize( static_cast<size_t>( cell.column ) + 1 );
+			}
+			auto & col = m_columns[cell.column];
+			if( cell.row >= col.size( ) ) {
+				col.store( ).resize( static_cast<size_t>( cell.row ) + 1 );
+			}
+			return col;
+		}
+
+		void sheet::finish_edit( impl::column const & col, cell_address const & cell, boost::string_ref text ) {
+			auto const formula = formula_text( text );
+			if( formula.empty( ) ) {
+				erase_formula( cell );
+			} else {
+				store_formula( cell, formula );
+			}
+			m_edited.push_back( cell );
+			events( )->add_change( cell );
+			if( m_journal ) {
+				m_journal->append_set( cell, col.store( ).value_type( cell.row ), text );
+			}
+		}
+
+		void sheet::set_value( cell_address const & cell, boost::string_ref text ) {
+			transaction tx{ *this };
+			auto & col = prepare_cell( cell );
+			unindex_cell( cell );
+			col.set_value( cell.row, text );
+			finish_edit( col, cell, text );
+			index_cell( cell );
+			tx.commit( );
+		}
+
+		void sheet::set_value( cell_address const & cell, impl::cell_value::expected_value_t value_type, boost::string_ref text ) {
+			transaction tx{ *this };
+			auto & col = prepare_cell( cell );
+			unindex_cell( cell );
+			col.set( cell.row, value_type, text );
+			finish_edit( col, cell, text );
+			index_cell( cell );
+			tx.commit( );
+		}
+
+		void sheet::copy_cells( cell_range const & source, cell_address const & destination ) {
+			auto const copied = copy_out( *this, source );
+			transaction tx{ *this };
+			paste( *this, copied, source.first, destination );
+			tx.commit( );
+		}
+
+		void sheet::fill_down( cell_range const & range ) {
+			auto const top = cell_range{ range.first, cell_address{ range.first.row, range.last.column } };
+			auto const copied = copy_out( *this, top );
+			transaction tx{ *this };
+			for( auto row = static_cast<uint64_t>( range.first.row ) + 1; row <= range.last.row; ++row ) {
+				paste( *this, copied, range.first, cell_address{ static_cast<cell_address::index_t>( row ), range.first.column } );
+			}
+			tx.commit( );
+		}
+
+		void sheet::clear_column( size_t index ) {
+			if( index >= m_columns.size( ) ) {
+				return;
+			}
+			transaction tx{ *this };
+			if( m_journal ) {
+				m_journal->append_clear_column( index );
+			}
+			auto & col = m_columns[index];
+			auto const column = static_cast<cell_address::index_t>( index );
+			for( size_t row = 0; row < col.size( ); ++row ) {
+				if( col.store( ).string_value( row ).empty( ) ) {
+					continue;
+				}
+				cell_address const cell{ static_cast<cell_address::index_t>( row ), column };
+				col.set_value( row, boost::string_ref{ } );
+				erase_formula( cell );
+				m_edited.push_back( cell );
+				events( )->add_change( cell );
+			}
+			if( auto const lookup = index_of( index ) ) {
+				lookup->clear( );
+			}
+			tx.commit( );
+		}
+
+		void sheet::assign_column( size_t index, impl::column_store store ) {
+			transaction tx{ *this };
+			if( index >= m_columns.size( ) ) {
+				resize( index + 1 );
+			}
+			auto & col = m_columns[index];
+			auto const column = static_cast<cell_address::index_t>( index );
+			auto const rows = std::max( col.size( ), store.size( ) );
+			store.use_pool( m_strings );
+			if( !m_formulas.empty( ) ) {
+				for( size_t row = 0; row < col.size( ); ++row ) {
+					erase_formula( cell_address{ static_cast<cell_address::index_t>( row ), column } );
+				}
+			}
+			col.store( ).swap( store );
+			for( size_t row = 0; row < col.size( ); ++row ) {
+				auto const formula = formula_text( col.store( ).string_value( row ) );
+				if( !formula.empty( ) ) {
+					store_formula( cell_address{ static_cast<cell_address::index_t>( row ), column }, formula );
+				}
+			}
+			if( rows > 0 ) {
+				m_edited.reserve( m_edited.size( ) + rows );
+				for( size_t row = 0; row < rows; ++row ) {
+					m_edited.emplace_back( static_cast<cell_address::index_t>( row ), column );
+				}
+				events( )->add_change( cell_range{ cell_address{ 0, column }, cell_address{ static_cast<cell_address::index_t>( rows - 1 ), column } } );
+				col.emit_updated( );
+			}
+			rebuild_index( index );
+			journal_column( index );
+			tx.commit( );
+		}
+
+		void sheet::reorder_rows( row_view const & view ) {
+			auto const rows = row_count( );
+			if( view.source_rows( ) != rows ) {
+				throw std::invalid_argument{ "View was not made from the rows of this sheet" };
+			}
+			// order[n] is the row that moves to row n
+			std::vector<uint32_t> order;
+			order.reserve( rows );
+			std::vector<bool> placed( rows, false );
+			for( auto const row: view.rows( ) ) {
+				if( placed[row] ) {
+					throw std::invalid_argument{ "View repeats a row" };
+				}
+				placed[row] = true;
+				order.push_back( row );
+			}
+			for( size_t row = 0; row < rows; ++row ) {
+				if( !placed[row] ) {
+					order.push_back( static_cast<uint32_t>( row ) );
+				}
+			}
+			std::vector<cell_address::index_t> moved_to( rows );
+			bool unchanged = true;
+			for( size_t row = 0; row < rows; ++row ) {
+				moved_to[order[row]] = static_cast<cell_address::index_t>( row );
+				unchanged &= order[row] == row;
+			}
+			if( unchanged ) {
+				return;
+			}
+
+			transaction tx{ *this };
+			struct moved_formula {
+				cell_address from;
+				cell_address to;
+			};
+			std::vector<moved_formula> formulas;
+			if( !m_formulas.empty( ) ) {
+				for( size_t column = 0; column < m_columns.size( ); ++column ) {
+					auto const index = static_cast<cell_address::index_t>( column );
+					for( size_t row = 0; row < m_columns[column].size( ); ++row ) {
+						cell_address const cell{ static_cast<cell_address::index_t>( row ), index };
+						if( is_formula( cell ) ) {
+							formulas.push_back( moved_formula{ cell, cell_address{ moved_to[row], index } } );
+							erase_formula( cell );
+						}
+					}
+				}
+			}
+			for( auto & col: m_columns ) {
+				if( !col.empty( ) && col.size( ) < rows ) {
+					col.store( ).resize( rows );
+				}
+			}
+			m_scheduler->pool( ).parallel_for( m_columns.size( ), 1, [&]( size_t column ) {
+				if( !m_columns[column].empty( ) ) {
+					m_columns[column].store( ).permute( order );
+				}
+			} );
+			std::string moved;
+			for( auto const & formula: formulas ) {
+				auto & store = m_columns[formula.to.column].store( );
+				auto const text = store.string_value( formula.to.row ).to_string( );
+				move_formula( text, formula.from, formula.to, moved );
+				if( moved != text ) {
+					store.set( formula.to.row, store.value_type( formula.to.row ), moved );
+				}
+				store_formula( formula.to, formula_text( moved ) );
+			}
+			m_edited.reserve( m_edited.size( ) + rows * m_columns.size( ) );
+			for( size_t column = 0; column < m_columns.size( ); ++column ) {
+				auto & col = m_columns[column];
+				if( col.empty( ) ) {
+					continue;
+				}
+				auto const index = static_cast<cell_address::index_t>( column );
+				for( size_t row = 0; row < rows; ++row ) {
+					m_edited.emplace_back( static_cast<cell_address::index_t>( row ), index );
+				}
+				events( )->add_change( cell_range{ cell_address{ 0, index }, cell_address{ static_cast<cell_address::index_t>( rows - 1 ), index } } );
+				col.emit_updated( );
+				rebuild_index( column );
+				journal_column( column );
+			}
+			tx.commit( );
+		}
+
+		boost::string_ref sheet::string_value( cell_address const & cell ) const {
+			if( cell.column >= m_columns.size( ) || cell.row >= m_columns[cell.column].size( ) ) {
+				return boost::string_ref{ };
+			}
+			return m_columns[cell.column].store( ).string_value( cell.row );
+		}
+
+		formula_value sheet::value( cell_address const & cell ) const {
+			auto const formula = m_formulas.find( cell );
+			if( formula != nullptr ) {
+				return formula->result;
+			}
+			if( cell.column >= m_columns.size( ) || cell.row >= m_columns[cell.column].size( ) ) {
+				return formula_value{ };
+			}
+			return to_formula_value( m_columns[cell.column].store( ), cell.row );
+		}
+
+		bool sheet::is_formula( cell_address const & cell ) const {
+			return m_formulas.contains( cell );
+		}
+
+		lookup_index * sheet::index_of( size_t column ) const noexcept {
+			return column < m_indexes.size( ) ? m_indexes[column].get( ) : nullptr;
+		}
+
+		void sheet::unindex_cell( cell_address const & cell ) {
+			auto const lookup = index_of( cell.column );
+			if( lookup == nullptr ) {
+				return;
+			}
+			if( is_formula( cell ) ) {
+				lookup->remove_formula( cell.row );
+			} else {
+				lookup->remove( cell.row, value( cell ) );
+			}
+		}
+
+		void sheet::index_cell( cell_address const & cell ) {
+			auto const lookup = index_of( cell.column );
+			if( lookup == nullptr ) {
+				return;
+			}
+			if( is_formula( cell ) ) {
+				lookup->add_formula( cell.row );
+			} else {
+				lookup->add( cell.row, value( cell ) );
+			}
+		}
+
+		void sheet::rebuild_index( size_t column ) {
+			auto const lookup = index_of( column );
+			if( lookup == nullptr ) {
+				return;
+			}
+			lookup->clear( );
+			auto const rows = m_columns[column].size( );
+			for( size_t row = 0; row < rows; ++row ) {
+				index_cell( cell_address{ static_cast<cell_address::index_t>( row ), static_cast<cell_address::index_t>( column ) } );
+			}
+		}
+
+		void sheet::journal_column( size_t column ) {
+			if( !m_journal ) {
+				return;
+			}
+			m_journal->append_clear_column( column );
+			auto const & store = m_columns[column].store( );
+			auto const index = static_cast<cell_address::index_t>( column );
+			for( size_t row = 0; row < store.size( ); ++row ) {
+				auto const text = store.string_value( row );
+				if( !text.empty( ) || store.value_type( row ) != impl::cell_value::expected_value_t::General ) {
+					m_journal->append_set( cell_address{ static_cast<cell_address::index_t>( row ), index }, store.value_type( row ), text );
+				}
+			}
+		}
+
+		void sheet::create_index( size_t column, lookup_index_kind kind ) {
+			if( column >= m_columns.size( ) ) {
+				throw std::out_of_range{ "Cannot index a column the sheet does not have" };
+			}
+			if( m_indexes.size( ) <= column ) {
+				m_indexes.resize( column + 1 );
+			}
+			auto & lookup = m_indexes[column];
+			if( !lookup ) {
+				lookup = std::make_unique<lookup_index>( );
+			} else if( lookup->has( kind ) ) {
+				return;
+			}
+			lookup->enable( kind );
+			rebuild_index( column );
+		}
+
+		void sheet::drop_index( size_t column, lookup_index_kind kind ) {
+			auto const lookup = index_of( column );
+			if( lookup == nullptr ) {
+				return;
+			}
+			lookup->disable( kind );
+			if( !lookup->enabled( ) ) {
+				m_indexes[column].reset( );
+			}
+		}
+
+		bool sheet::has_index( size_t column, lookup_index_kind kind ) const noexcept {
+			auto const lookup = index_of( column );
+			return lookup != nullptr && lookup->has( kind );
+		}
+
+		size_t sheet::find_match( cell_range const & range, formula_value const & key, int match_type ) const {
+			if( range.first.column >= m_columns.size( ) ) {
+				return impl::no_match;
+			}
+			auto clamped = range;
+			if( range.first.column == range.last.column ) {
+				// Rows past the end of the column are empty and never match
+				auto const column = range.first.column;
+				auto const rows = m_columns[column].size( );
+				if( rows == 0 || range.first.row >= rows ) {
+					return impl::no_match;
+				}
+				clamped.last.row = static_cast<cell_address::index_t>( std::min<size_t>( range.last.row, rows - 1 ) );
+				auto const lookup = index_of( column );
+				if( lookup != nullptr && lookup->can_match( match_type ) ) {
+					return lookup->match( key, match_type, clamped.first.row, clamped.last.row, [this, column]( lookup_index::row_t row ) {
+						return value( cell_address{ row, column } );
+					} );
+				}
+			} else if( range.first.row == range.last.row ) {
+				clamped.last.column = static_cast<cell_address::index_t>( std::min<size_t>( range.last.column, m_columns.size( ) - 1 ) );
+			}
+			return impl::linear_match( sheet_resolver{ this }, clamped, key, match_type );
+		}
+
+		formula_value sheet::compute( cell_address const & cell ) const {
+			auto const formula = m_formulas.find( cell );
+			if( formula == nullptr ) {
+				return formula_value{ };
+			}
+			if( !formula->formula->parsed( ) ) {
+				return formula->result;
+			}
+			return formula->formula->evaluate( cell, sheet_resolver{ this } );
+		}
+
+		void sheet::run_plan( recalc_plan const & plan ) {
+			// Results are written to existing grid cells only, so committing from the
+			// workers does not race with the readers of other cells
+			m_scheduler->run( plan, [this]( cell_address const & cell ) {
+				return compute( cell );
+			}, [this]( cell_address const & cell, formula_value result ) {
+				m_formulas.find( cell )->result = std::move( result );
+			} );
+			for( auto const & cell: plan.cycle ) {
+				m_formulas.find( cell )->result = formula_value::from_error( formula_error::cycle );
+			}
+			auto & table = *events( );
+			for( auto const & cell: plan.order ) {
+				table.add_change( cell );
+			}
+			for( auto const & cell: plan.cycle ) {
+				table.add_change( cell );
+			}
+		}
+
+		void sheet::recalculate_edits( ) {
+			if( m_edited.empty( ) ) {
+				return;
+			}
+			std::vector<cell_address> edited;
+			edited.swap( m_edited );
+			m_graph.mark_dirty( edited );
+			if( !m_scheduler->options( ).lazy ) {
+				run_plan( m_graph.take_dirty( ) );
+			}
+			emit_updated( );
+		}
+
+		void sheet::evaluate( cell_range const & range ) {
+			if( m_graph.dirty_count( ) == 0 ) {
+				return;
+			}
+			transaction tx{ *this };
+			auto const plan = m_graph.take_dirty( range );
+			if( !plan.order.empty( ) || !plan.cycle.empty( ) ) {
+				run_plan( plan );
+				emit_updated( );
+			}
+			tx.commit( );
+		}
+
+		std::vector<formula_value> sheet::values( cell_range const & range ) {
+			evaluate( range );
+			std::vector<formula_value> result;
+			result.reserve( (static_cast<size_t>( range.last.row ) - range.first.row + 1) * (static_cast<size_t>( range.last.column ) - range.first.column + 1) );
+			for( auto row = static_cast<uint64_t>( range.first.row ); row <= range.last.row; ++row ) {
+				for( auto column = static_cast<uint64_t>( range.first.column ); column <= range.last.column; ++column ) {
+					result.push_back( value( cell_address{ static_cast<cell_address::index_t>( row ), static_cast<cell_address::index_t>( column ) } ) );
+				}
+			}
+			return result;
+		}
+
+		bool sheet::is_stale( cell_address const & cell ) const {
+			return m_graph.is_dirty( cell );
+		}
+
+		size_t sheet::stale_count( ) const noexcept {
+			return m_graph.dirty_count( );
+		}
+
+		void sheet::begin_transaction( ) {
+			events( )->begin_batch( );
+			++m_transaction_depth;
+		}
+
+		void sheet::commit( ) {
+			if( m_transaction_depth == 0 ) {
+				throw std::logic_error{ "sheet::commit called without a transaction" };
+			}
+			if( m_transaction_depth == 1 ) {
+				try {
+					recalculate_edits( );
+				} catch( ... ) {
+					m_edited.clear( );
+					m_transaction_depth = 0;
+					events( )->end_batch( );
+					throw;
+				}
+			}
+			--m_transaction_depth;
+			events( )->end_batch( );
+		}
+
+		size_t sheet::transaction_depth( ) const noexcept {
+			return m_transaction_depth;
+		}
+
+		void sheet::write( json_writer & out ) const {
+			out.begin_object( );
+			out.key( "id" );
+			out.value( id( ) );
+			out.key( "columns" );
+			out.begin_array( );
+			for( auto const & col: m_columns ) {
+				col.write( out );
+			}
+			out.end_array( );
+			out.end_object( );
+		}
+
+		void sheet::read( json_pull_reader & in ) {
+			using token = json_pull_reader::token;
+			auto const require = []( bool condition ) {
+				if( !condition ) {
+					throw std::invalid_argument{ "Unexpected JSON token in sheet" };
+				}
+			};
+			transaction tx{ *this };
+			in.expect( token::begin_object );
+			size_t column_count = 0;
+			for( auto member = in.next( ); member != token::end_object; member = in.next( ) ) {
+				require( member == token::key );
+				if( in.text( ) != "columns" ) {
+					in.skip_value( );
+					continue;
+				}
+				in.expect( token::begin_array );
+				for( auto value = in.next( ); value != token::end_array; value = in.next( ) ) {
+					assign_column( column_count++, impl::column::read_store( in, value, m_strings ) );
+				}
+			}
+			resize( column_count );
+			tx.commit( );
+		}
+
+		void sheet::attach_journal( std::shared_ptr<edit_journal> journal ) {
+			m_journal = std::move( journal );
+		}
+
+		std::shared_ptr<edit_journal> const & sheet::journal( ) const noexcept {
+			return m_journal;
+		}
+
+		event_table::token_t sheet::on_changes( event_table::change_listener_t listener ) {
+			return events( )->on_changes( std::move( listener ) );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
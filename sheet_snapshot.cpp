@@ -0,0 +1,537 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "mapped_file.h"
+#include "sheet.h"
+#include "sheet_snapshot.h"
+#include "value_classifier.h"
+
+#if (defined( __x86_64__ ) || defined( __i386__ )) && (defined( __GNUC__ ) || defined( __clang__ ))
+#define DAW_SPREADSHEET_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Sheet snapshots are read in place and require a little endian target"
+#endif
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			constexpr char const snapshot_magic[8] = { 'D', 'A', 'W', 'S', 'N', 'A', 'P', '\0' };
+			constexpr size_t section_alignment = 8;
+			constexpr uint8_t type_count = static_cast<uint8_t>( impl::cell_value::expected_value_t::Error ) + 1;
+
+			struct file_header {
+				char magic[8];
+				uint32_t version;
+				uint32_t column_count;
+				uint32_t directory_crc;
+				uint32_t header_crc;	// Of the bytes before it
+			};	// file_header
+
+			struct directory_entry {
+				uint64_t offset;
+				uint64_t size;
+				uint32_t rows;
+				uint32_t heap_size;
+				uint32_t crc;
+				uint32_t reserved;
+			};	// directory_entry
+
+			static_assert( sizeof( file_header ) == 24, "Unexpected snapshot header layout" );
+			static_assert( sizeof( directory_entry ) == 32, "Unexpected snapshot directory layout" );
+
+			constexpr uint64_t section_size( uint64_t rows, uint64_t heap_size ) noexcept {
+				return rows * sizeof( uint32_t ) + heap_size + rows;
+			}
+
+			constexpr uint64_t align_section( uint64_t offset ) noexcept {
+				return (offset + section_alignment - 1) & ~static_cast<uint64_t>( section_alignment - 1 );
+			}
+
+			[[noreturn]] void invalid_snapshot( char const * what ) {
+				throw std::runtime_error{ std::string{ "Invalid sheet snapshot: " } + what };
+			}
+
+			// Slicing by 8 tables for the reflected Castagnoli polynomial
+			struct crc32c_tables {
+				std::array<std::array<uint32_t, 256>, 8> table;
+
+				crc32c_tables( ) {
+					for( uint32_t n = 0; n < 256; ++n ) {
+						auto crc = n;
+						for( int bit = 0; bit < 8; ++bit ) {
+							crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+						}
+						table[0][n] = crc;
+					}
+					for( uint32_t n = 0; n < 256; ++n ) {
+						for( size_t k = 1; k < 8; ++k ) {
+							table[k][n] = (table[k - 1][n] >> 8) ^ table[0][table[k - 1][n] & 0xFFu];
+						}
+					}
+				}
+			};	// crc32c_tables
+
+			uint32_t crc32c_scalar( uint32_t crc, unsigned char const * data, size_t size ) noexcept {
+				static crc32c_tables const s_tables{ };
+				auto const & t = s_tables.table;
+				while( size >= 8 ) {
+					uint64_t word;
+					std::memcpy( &word, data, sizeof( word ) );
+					word ^= crc;
+					crc = t[7][word & 0xFFu] ^ t[6][(word >> 8) & 0xFFu] ^ t[5][(word >> 16) & 0xFFu] ^ t[4][(word >> 24) & 0xFFu]
+						^ t[3][(word >> 32) & 0xFFu] ^ t[2][(word >> 40) & 0xFFu] ^ t[1][(word >> 48) & 0xFFu] ^ t[0][word >> 56];
+					data += 8;
+					size -= 8;
+				}
+				while( size-- > 0 ) {
+					crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFFu];
+				}
+				return crc;
+			}
+
+#ifdef DAW_SPREADSHEET_X86_KERNELS
+			__attribute__(( target( "sse4.2" ) ))
+			uint32_t crc32c_sse42( uint32_t crc, unsigned char const * data, size_t size ) noexcept {
+#ifdef __x86_64__
+				uint64_t wide = crc;
+				while( size >= 8 ) {
+					uint64_t word;
+					std::memcpy( &word, data, sizeof( word ) );
+					wide = _mm_crc32_u64( wide, word );
+					data += 8;
+					size -= 8;
+				}
+				crc = static_cast<uint32_t>( wide );
+#endif
+				while( size >= 4 ) {
+					uint32_t word;
+					std::memcpy( &word, data, sizeof( word ) );
+					crc = _mm_crc32_u32( crc, word );
+					data += 4;
+					size -= 4;
+				}
+				while( size-- > 0 ) {
+					crc = _mm_crc32_u8( crc, *data++ );
+				}
+				return crc;
+			}
+#endif
+
+			using crc32c_kernel_t = uint32_t( * )( uint32_t, unsigned char const *, size_t );
+
+			crc32c_kernel_t select_crc32c_kernel( ) noexcept {
+#ifdef DAW_SPREADSHEET_X86_KERNELS
+				__builtin_cpu_init( );
+				if( __builtin_cpu_supports( "sse4.2" ) ) {
+					return &crc32c_sse42;
+				}
+#endif
+				return &crc32c_scalar;
+			}
+
+			uint32_t header_crc( file_header const & header ) noexcept {
+				return crc32c( &header, offsetof( file_header, header_crc ) );
+			}
+
+			// Writes the snapshot to a file beside its destination, renaming it into place on
+			// commit and removing it otherwise
+			class snapshot_file {
+				std::string m_path;
+				std::string m_temp_path;
+				int m_fd;
+				std::vector<char> m_buffer;
+				uint64_t m_position;
+				uint32_t m_crc;
+
+				void write_all( char const * data, size_t size ) {
+					while( size > 0 ) {
+						auto const written = ::write( m_fd, data, size );
+						if( written < 0 ) {
+							if( errno == EINTR ) {
+								continue;
+							}
+							io_error( "Error writing sheet snapshot", m_temp_path );
+						}
+						data += written;
+						size -= static_cast<size_t>( written );
+					}
+				}
+			public:
+				explicit snapshot_file( std::string path ):
+						m_path{ std::move( path ) },
+						m_temp_path{ m_path + ".tmp" },
+						m_fd{ ::open( m_temp_path.c_str( ), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) },
+						m_buffer{ },
+						m_position{ 0 },
+						m_crc{ 0 } {
+
+					if( m_fd < 0 ) {
+						io_error( "Error creating sheet snapshot", m_temp_path );
+					}
+					m_buffer.reserve( 1u << 16 );
+				}
+
+				~snapshot_file( ) {
+					if( m_fd >= 0 ) {
+						::close( m_fd );
+						::unlink( m_temp_path.c_str( ) );
+					}
+				}
+
+				snapshot_file( snapshot_file const & ) = delete;
+				snapshot_file( snapshot_file && ) = delete;
+				snapshot_file & operator=( snapshot_file const & ) = delete;
+				snapshot_file & operator=( snapshot_file && ) = delete;
+
+				uint64_t position( ) const noexcept {
+					return m_position;
+				}
+
+				/// @brief Start a new checksum over the following writes
+				uint32_t take_crc( ) noexcept {
+					auto const result = m_crc;
+					m_crc = 0;
+					return result;
+				}
+
+				void put( void const * data, size_t size ) {
+					auto const bytes = static_cast<char const *>( data );
+					m_crc = crc32c( bytes, size, m_crc );
+					m_position += size;
+					if( m_buffer.size( ) + size > m_buffer.capacity( ) ) {
+						flush( );
+						if( size >= m_buffer.capacity( ) ) {
+							write_all( bytes, size );
+							return;
+						}
+					}
+					m_buffer.insert( m_buffer.end( ), bytes, bytes + size );
+				}
+
+				void pad_to( uint64_t position ) {
+					static char const zeros[section_alignment] = { };
+					while( m_position < position ) {
+						put( zeros, static_cast<size_t>( std::min<uint64_t>( position - m_position, sizeof( zeros ) ) ) );
+					}
+				}
+
+				void flush( ) {
+					write_all( m_buffer.data( ), m_buffer.size( ) );
+					m_buffer.clear( );
+				}
+
+				void write_at( uint64_t offset, void const * data, size_t size ) {
+					flush( );
+					if( ::lseek( m_fd, static_cast<off_t>( offset ), SEEK_SET ) < 0 ) {
+						io_error( "Error seeking in sheet snapshot", m_temp_path );
+					}
+					write_all( static_cast<char const *>( data ), size );
+				}
+
+				/// The data reaches the disk before the rename and the rename before returning,
+				/// so after a crash the path holds either the old or the complete new snapshot
+				void commit( ) {
+					flush( );
+					auto const fd = m_fd;
+					m_fd = -1;
+					if( ::fdatasync( fd ) != 0 ) {
+						::close( fd );
+						::unlink( m_temp_path.c_str( ) );
+						io_error( "Error syncing sheet snapshot", m_temp_path );
+					}
+					if( ::close( fd ) != 0 ) {
+						::unlink( m_temp_path.c_str( ) );
+						io_error( "Error closing sheet snapshot", m_temp_path );
+					}
+					if( std::rename( m_temp_path.c_str( ), m_path.c_str( ) ) != 0 ) {
+						::unlink( m_temp_path.c_str( ) );
+						io_error( "Error renaming sheet snapshot", m_path );
+					}
+					sync_directory( m_path );
+				}
+			};	// snapshot_file
+
+			template<typename StoreAt>
+			void write_columns( size_t column_count, StoreAt store_at, std::string const & path ) {
+				if( column_count > std::numeric_limits<uint32_t>::max( ) ) {
+					throw std::length_error{ "Too many columns for a sheet snapshot" };
+				}
+				std::vector<directory_entry> directory( column_count, directory_entry{ } );
+				auto offset = static_cast<uint64_t>( sizeof( file_header ) + column_count * sizeof( directory_entry ) );
+				for( size_t n = 0; n < column_count; ++n ) {
+					auto const & store = store_at( n );
+					uint64_t heap_size = 0;
+					for( size_t row = 0; row < store.size( ); ++row ) {
+						heap_size += store.string_value( row ).size( );
+					}
+					if( store.size( ) > std::numeric_limits<uint32_t>::max( ) || heap_size > std::numeric_limits<uint32_t>::max( ) ) {
+						throw std::length_error{ "Column too large for a sheet snapshot" };
+					}
+					auto & entry = directory[n];
+					entry.offset = align_section( offset );
+					entry.rows = static_cast<uint32_t>( store.size( ) );
+					entry.heap_size = static_cast<uint32_t>( heap_size );
+					entry.size = section_size( entry.rows, entry.heap_size );
+					offset = entry.offset + entry.size;
+				}
+
+				snapshot_file out{ path };
+				out.pad_to( sizeof( file_header ) + column_count * sizeof( directory_entry ) );
+				for( size_t n = 0; n < column_count; ++n ) {
+					auto const & store = store_at( n );
+					auto & entry = directory[n];
+					out.pad_to( entry.offset );
+					out.take_crc( );
+					uint32_t end_offset = 0;
+					for( size_t row = 0; row < store.size( ); ++row ) {
+						end_offset += static_cast<uint32_t>( store.string_value( row ).size( ) );
+						out.put( &end_offset, sizeof( end_offset ) );
+					}
+					for( size_t row = 0; row < store.size( ); ++row ) {
+						auto const text = store.string_value( row );
+						out.put( text.data( ), text.size( ) );
+					}
+					for( size_t row = 0; row < store.size( ); ++row ) {
+						auto const type = static_cast<uint8_t>( store.value_type( row ) );
+						out.put( &type, sizeof( type ) );
+					}
+					entry.crc = out.take_crc( );
+				}
+
+				file_header header{ };
+				std::memcpy( header.magic, snapshot_magic, sizeof( snapshot_magic ) );
+				header.version = sheet_snapshot::current_version;
+				header.column_count = static_cast<uint32_t>( column_count );
+				header.directory_crc = crc32c( directory.data( ), directory.size( ) * sizeof( directory_entry ) );
+				header.header_crc = header_crc( header );
+				out.write_at( 0, &header, sizeof( header ) );
+				out.write_at( sizeof( header ), directory.data( ), directory.size( ) * sizeof( directory_entry ) );
+				out.commit( );
+			}
+		}	// namespace anonymous
+
+		uint32_t crc32c( void const * data, size_t size, uint32_t crc ) noexcept {
+			static crc32c_kernel_t const s_kernel = select_crc32c_kernel( );
+			return ~s_kernel( ~crc, static_cast<unsigned char const *>( data ), size );
+		}
+
+		void write_snapshot( sheet const & source, std::string const & path ) {
+			write_columns( source.column_count( ), [&source]( size_t n ) -> impl::column_store const & {
+				return source.column( n ).store( );
+			}, path );
+		}
+
+		void write_snapshot( std::vector<impl::column_store> const & columns, std::string const & path ) {
+			write_columns( columns.size( ), [&columns]( size_t n ) -> impl::column_store const & {
+				return columns[n];
+			}, path );
+		}
+
+		sheet_snapshot::sheet_snapshot( std::string const & path ):
+				m_file{ path },
+				m_columns{ },
+				m_verified{ } {
+
+			auto const base = m_file.data( );
+			auto const size = m_file.size( );
+			if( size < sizeof( file_header ) ) {
+				invalid_snapshot( "file is too small" );
+			}
+			file_header header;
+			std::memcpy( &header, base, sizeof( header ) );
+			if( std::memcmp( header.magic, snapshot_magic, sizeof( snapshot_magic ) ) != 0 ) {
+				invalid_snapshot( "bad magic" );
+			}
+			if( header.version != current_version ) {
+				invalid_snapshot( "unsupported version" );
+			}
+			if( header.header_crc != header_crc( header ) ) {
+				invalid_snapshot( "header checksum mismatch" );
+			}
+			auto const directory_size = static_cast<uint64_t>( header.column_count ) * sizeof( directory_entry );
+			if( directory_size > size - sizeof( file_header ) ) {
+				invalid_snapshot( "truncated directory" );
+			}
+			auto const directory = base + sizeof( file_header );
+			if( crc32c( directory, static_cast<size_t>( directory_size ) ) != header.directory_crc ) {
+				invalid_snapshot( "directory checksum mismatch" );
+			}
+			m_columns.reserve( header.column_count );
+			for( size_t n = 0; n < header.column_count; ++n ) {
+				directory_entry entry;
+				std::memcpy( &entry, directory + n * sizeof( directory_entry ), sizeof( entry ) );
+				if( entry.offset % section_alignment != 0 || entry.offset < sizeof( file_header ) + directory_size
+						|| entry.size != section_size( entry.rows, entry.heap_size )
+						|| entry.offset > size || entry.size > size - entry.offset ) {
+					invalid_snapshot( "bad column section" );
+				}
+				auto const section = base + entry.offset;
+				auto const heap = section + entry.rows * sizeof( uint32_t );
+				m_columns.push_back( column_t{
+					reinterpret_cast<uint32_t const *>( section ),
+					heap,
+					reinterpret_cast<uint8_t const *>( heap + entry.heap_size ),
+					entry.rows,
+					entry.crc,
+					entry.size } );
+			}
+			m_verified.reset( new std::once_flag[m_columns.size( )] );
+		}
+
+		sheet_snapshot::~sheet_snapshot( ) { }
+
+		sheet_snapshot::sheet_snapshot( sheet_snapshot && other ) noexcept:
+				m_file{ },
+				m_columns{ },
+				m_verified{ } {
+
+			swap( other );
+		}
+
+		sheet_snapshot & sheet_snapshot::operator=( sheet_snapshot && rhs ) noexcept {
+			swap( rhs );
+			return *this;
+		}
+
+		void sheet_snapshot::swap( sheet_snapshot & rhs ) noexcept {
+			using std::swap;
+			m_file.swap( rhs.m_file );
+			swap( m_columns, rhs.m_columns );
+			swap( m_verified, rhs.m_verified );
+		}
+
+		sheet_snapshot::column_t const & sheet_snapshot::checked_column( size_t column ) const {
+			if( column >= m_columns.size( ) ) {
+				throw std::out_of_range{ "Column index out of range" };
+			}
+			auto const & result = m_columns[column];
+			// Only the first access pays for reading the whole section.  A failed check throws
+			// out of call_once, so later accesses check and throw again
+			std::call_once( m_verified[column], [&result]( ) {
+				if( crc32c( result.offsets, static_cast<size_t>( result.section_size ) ) != result.crc ) {
+					invalid_snapshot( "column checksum mismatch" );
+				}
+				uint32_t previous = 0;
+				for( uint32_t row = 0; row < result.rows; ++row ) {
+					if( result.offsets[row] < previous || result.types[row] >= type_count ) {
+						invalid_snapshot( "bad column data" );
+					}
+					previous = result.offsets[row];
+				}
+				if( reinterpret_cast<char const *>( result.types ) - result.heap != previous ) {
+					invalid_snapshot( "bad column data" );
+				}
+			} );
+			return result;
+		}
+
+		size_t sheet_snapshot::column_count( ) const noexcept {
+			return m_columns.size( );
+		}
+
+		size_t sheet_snapshot::row_count( size_t column ) const {
+			return checked_column( column ).rows;
+		}
+
+		sheet_snapshot::expected_value_t sheet_snapshot::value_type( cell_address const & cell ) const {
+			auto const & col = checked_column( cell.column );
+			if( cell.row >= col.rows ) {
+				return expected_value_t::General;
+			}
+			return static_cast<expected_value_t>( col.types[cell.row] );
+		}
+
+		boost::string_ref sheet_snapshot::string_value( cell_address const & cell ) const {
+			auto const & col = checked_column( cell.column );
+			if( cell.row >= col.rows ) {
+				return boost::string_ref{ };
+			}
+			auto const first = cell.row == 0 ? 0 : col.offsets[cell.row - 1];
+			return boost::string_ref{ col.heap + first, col.offsets[cell.row] - first };
+		}
+
+		sheet_snapshot::cell_variant_t sheet_snapshot::to_variant( cell_address const & cell ) const {
+			auto const type = value_type( cell );
+			auto const text = string_value( cell );
+			switch( type ) {
+			case expected_value_t::Number:
+			case expected_value_t::Timestamp:
+			case expected_value_t::Time:
+			case expected_value_t::Boolean: {
+					auto const classified = classify_value( text );
+					if( classified.type == type ) {
+						return daw::spreadsheet::to_variant( classified );
+					}
+					break;
+				}
+			default:
+				break;
+			}
+			return cell_variant_t{ }.store( text.to_string( ) );
+		}
+
+		bool sheet_snapshot::verify( ) const noexcept {
+			try {
+				for( size_t n = 0; n < m_columns.size( ); ++n ) {
+					checked_column( n );
+				}
+				return true;
+			} catch( std::exception const & ) {
+				return false;
+			}
+		}
+
+		impl::column_store sheet_snapshot::load_column( size_t column, std::shared_ptr<string_pool> pool ) const {
+			auto const & col = checked_column( column );
+			impl::column_store result{ std::move( pool ) };
+			result.reserve( col.rows );
+			for( uint32_t row = 0; row < col.rows; ++row ) {
+				result.push_back( static_cast<expected_value_t>( col.types[row] ), string_value( cell_address{ row, static_cast<cell_address::index_t>( column ) } ) );
+			}
+			return result;
+		}
+
+		void sheet_snapshot::load( sheet & target ) const {
+			sheet::transaction tx{ target };
+			for( size_t n = 0; n < column_count( ); ++n ) {
+				target.assign_column( n, load_column( n, target.strings( ) ) );
+			}
+			target.resize( column_count( ) );
+			tx.commit( );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
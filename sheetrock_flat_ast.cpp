@@ -0,0 +1,150 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cassert>
+#include <stdexcept>
+
+#include "sheetrock_flat_ast.h"
+
+namespace daw {
+	namespace parser {
+		namespace sheetrock {
+			namespace {
+				uint32_t to_index( size_t value ) {
+					if( value >= flat_ast::npos ) {
+						throw std::length_error{ "flat_ast exceeds 4G entries" };
+					}
+					return static_cast<uint32_t>( value );
+				}
+			}	// namespace anonymous
+
+			constexpr flat_ast::index_t flat_ast::npos;
+
+			flat_ast::flat_ast( ):
+					m_nodes{ },
+					m_arguments{ },
+					m_scratch{ },
+					m_text{ } { }
+
+			flat_ast::~flat_ast( ) { }
+
+			void flat_ast::clear( ) noexcept {
+				m_nodes.clear( );
+				m_arguments.clear( );
+				m_scratch.clear( );
+				m_text.clear( );
+			}
+
+			size_t flat_ast::size( ) const noexcept {
+				return m_nodes.size( );
+			}
+
+			size_t flat_ast::memory_usage( ) const noexcept {
+				return sizeof( *this ) + m_nodes.capacity( ) * sizeof( flat_node ) + (m_arguments.capacity( ) + m_scratch.capacity( )) * sizeof( uint32_t ) + m_text.capacity( );
+			}
+
+			flat_node const & flat_ast::operator[]( index_t index ) const {
+				assert( index < m_nodes.size( ) );
+				return m_nodes[index];
+			}
+
+			boost::string_ref flat_ast::text( flat_node const & node ) const {
+				assert( node.kind == flat_kind::number || node.kind == flat_kind::string || node.kind == flat_kind::function );
+				return boost::string_ref{ m_text.data( ) + node.a, node.b };
+			}
+
+			flat_ast::index_t flat_ast::argument( flat_node const & node, uint32_t n ) const {
+				assert( node.kind == flat_kind::function && n < node.d );
+				return m_arguments[node.c + n];
+			}
+
+			daw::spreadsheet::cell_address flat_ast::address( flat_node const & node ) const {
+				assert( node.kind == flat_kind::cell );
+				return daw::spreadsheet::cell_address{ node.a, node.b };
+			}
+
+			daw::spreadsheet::cell_range flat_ast::range( flat_node const & node ) const {
+				assert( node.kind == flat_kind::range );
+				return daw::spreadsheet::cell_range{ daw::spreadsheet::cell_address{ node.a, node.b }, daw::spreadsheet::cell_address{ node.c, node.d } };
+			}
+
+			flat_ast::index_t flat_ast::add_number( boost::string_ref text ) {
+				auto const offset = to_index( m_text.size( ) );
+				m_text.append( text.begin( ), text.end( ) );
+				m_nodes.push_back( flat_node{ flat_kind::number, 0, offset, to_index( text.size( ) ), 0, 0 } );
+				return to_index( m_nodes.size( ) - 1 );
+			}
+
+			flat_ast::index_t flat_ast::add_string( boost::string_ref value ) {
+				auto const offset = to_index( m_text.size( ) );
+				m_text.append( value.begin( ), value.end( ) );
+				m_nodes.push_back( flat_node{ flat_kind::string, 0, offset, to_index( value.size( ) ), 0, 0 } );
+				return to_index( m_nodes.size( ) - 1 );
+			}
+
+			flat_ast::index_t flat_ast::add_boolean( bool value ) {
+				m_nodes.push_back( flat_node{ flat_kind::boolean, static_cast<char>( value ? 1 : 0 ), 0, 0, 0, 0 } );
+				return to_index( m_nodes.size( ) - 1 );
+			}
+
+			flat_ast::index_t flat_ast::add_cell( daw::spreadsheet::cell_address const & address, uint8_t anchors ) {
+				m_nodes.push_back( flat_node{ flat_kind::cell, static_cast<char>( anchors ), address.row, address.column, 0, 0 } );
+				return to_index( m_nodes.size( ) - 1 );
+			}
+
+			flat_ast::index_t flat_ast::add_range( daw::spreadsheet::cell_address const & first, daw::spreadsheet::cell_address const & last, uint8_t anchors ) {
+				m_nodes.push_back( flat_node{ flat_kind::range, static_cast<char>( anchors ), first.row, first.column, last.row, last.column } );
+				return to_index( m_nodes.size( ) - 1 );
+			}
+
+			flat_ast::index_t flat_ast::add_unary( char op, index_t operand ) {
+				m_nodes.push_back( flat_node{ flat_kind::unary_operator, op, operand, 0, 0, 0 } );
+				return to_index( m_nodes.size( ) - 1 );
+			}
+
+			flat_ast::index_t flat_ast::add_binary( char op, index_t lhs, index_t rhs ) {
+				m_nodes.push_back( flat_node{ flat_kind::binary_operator, op, lhs, rhs, 0, 0 } );
+				return to_index( m_nodes.size( ) - 1 );
+			}
+
+			size_t flat_ast::begin_arguments( ) const noexcept {
+				return m_scratch.size( );
+			}
+
+			void flat_ast::push_argument( index_t argument ) {
+				m_scratch.push_back( argument );
+			}
+
+			flat_ast::index_t flat_ast::add_function( boost::string_ref name, size_t arguments_mark ) {
+				assert( arguments_mark <= m_scratch.size( ) );
+				auto const name_offset = to_index( m_text.size( ) );
+				m_text.append( name.begin( ), name.end( ) );
+				auto const first_argument = to_index( m_arguments.size( ) );
+				auto const count = to_index( m_scratch.size( ) - arguments_mark );
+				m_arguments.insert( m_arguments.end( ), m_scratch.begin( ) + static_cast<std::ptrdiff_t>( arguments_mark ), m_scratch.end( ) );
+				m_scratch.resize( arguments_mark );
+				m_nodes.push_back( flat_node{ flat_kind::function, 0, name_offset, to_index( name.size( ) ), first_argument, count } );
+				return to_index( m_nodes.size( ) - 1 );
+			}
+		}	// namespace sheetrock
+	}	// namespace parser
+}	// namespace daw
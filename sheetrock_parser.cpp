@@ -0,0 +1,653 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "sheetrock_parser.h"
+
+namespace daw {
+	namespace parser {
+		namespace sheetrock {
+			namespace {
+				bool is_digit( char c ) noexcept {
+					return c >= '0' && c <= '9';
+				}
+
+				bool is_alpha( char c ) noexcept {
+					return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+				}
+
+				bool is_space( char c ) noexcept {
+					return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+				}
+
+				bool is_identifier_char( char c ) noexcept {
+					return is_alpha( c ) || is_digit( c ) || c == '_' || c == '.' || c == '$';
+				}
+
+				char to_upper( char c ) noexcept {
+					return (c >= 'a' && c <= 'z') ? static_cast<char>( c - ('a' - 'A') ) : c;
+				}
+
+				bool equal_nc( boost::string_ref lhs, boost::string_ref rhs ) noexcept {
+					if( lhs.size( ) != rhs.size( ) ) {
+						return false;
+					}
+					for( size_t n = 0; n < lhs.size( ); ++n ) {
+						if( to_upper( lhs[n] ) != to_upper( rhs[n] ) ) {
+							return false;
+						}
+					}
+					return true;
+				}
+			}	// namespace anonymous
+
+			bool parse_cell_reference( boost::string_ref text, daw::spreadsheet::cell_address & address ) noexcept {
+				uint8_t anchors = 0;
+				return parse_cell_reference( text, address, anchors );
+			}
+
+			bool parse_cell_reference( boost::string_ref text, daw::spreadsheet::cell_address & address, uint8_t & anchors ) noexcept {
+				size_t pos = 0;
+				uint8_t found = daw::spreadsheet::anchor_none;
+				if( pos < text.size( ) && text[pos] == '$' ) {
+					found |= daw::spreadsheet::anchor_column;
+					++pos;
+				}
+				uint64_t column = 0;
+				size_t letters = 0;
+				for( ; pos < text.size( ) && is_alpha( text[pos] ); ++pos, ++letters ) {
+					column = column * 26 + static_cast<uint64_t>( to_upper( text[pos] ) - 'A' + 1 );
+				}
+				if( letters == 0 || letters > 3 ) {
+					return false;
+				}
+				if( pos < text.size( ) && text[pos] == '$' ) {
+					found |= daw::spreadsheet::anchor_row;
+					++pos;
+				}
+				if( pos >= text.size( ) || !is_digit( text[pos] ) || text[pos] == '0' ) {
+					return false;
+				}
+				uint64_t row = 0;
+				for( ; pos < text.size( ) && is_digit( text[pos] ); ++pos ) {
+					row = row * 10 + static_cast<uint64_t>( text[pos] - '0' );
+					if( row > std::numeric_limits<daw::spreadsheet::cell_address::index_t>::max( ) ) {
+						return false;
+					}
+				}
+				if( pos != text.size( ) ) {
+					return false;
+				}
+				address = daw::spreadsheet::cell_address{ static_cast<daw::spreadsheet::cell_address::index_t>( row - 1 ), static_cast<daw::spreadsheet::cell_address::index_t>( column - 1 ) };
+				anchors = found;
+				return true;
+			}
+
+			tokenizer::tokenizer( boost::string_ref text ) noexcept:
+					m_text{ text },
+					m_position{ 0 } { }
+
+			size_t tokenizer::position( ) const noexcept {
+				return m_position;
+			}
+
+			token tokenizer::next( ) noexcept {
+				while( m_position < m_text.size( ) && is_space( m_text[m_position] ) ) {
+					++m_position;
+				}
+				auto const first = m_position;
+				auto const make = [&]( token_kind kind ) {
+					return token{ kind, m_text.substr( first, m_position - first ), first, daw::spreadsheet::cell_address{ }, 0 };
+				};
+				if( m_position >= m_text.size( ) ) {
+					return make( token_kind::end );
+				}
+				auto const peek = [&]( size_t offset ) -> char {
+					return m_position + offset < m_text.size( ) ? m_text[m_position + offset] : '\0';
+				};
+				auto const c = m_text[m_position];
+
+				if( is_digit( c ) || (c == '.' && is_digit( peek( 1 ) )) ) {
+					while( is_digit( peek( 0 ) ) ) {
+						++m_position;
+					}
+					if( peek( 0 ) == '.' ) {
+						++m_position;
+						while( is_digit( peek( 0 ) ) ) {
+							++m_position;
+						}
+					}
+					if( (peek( 0 ) == 'e' || peek( 0 ) == 'E') && (is_digit( peek( 1 ) ) || ((peek( 1 ) == '+' || peek( 1 ) == '-') && is_digit( peek( 2 ) ))) ) {
+						m_position += 2;
+						while( is_digit( peek( 0 ) ) ) {
+							++m_position;
+						}
+					}
+					return make( token_kind::number );
+				}
+
+				if( c == '"' || c == '\'' ) {
+					++m_position;
+					while( m_position < m_text.size( ) ) {
+						auto const current = m_text[m_position++];
+						if( current == '\\' ) {
+							++m_position;
+						} else if( current == c ) {
+							if( peek( 0 ) != c ) {
+								return make( token_kind::string );
+							}
+							++m_position;	// A doubled quote is an escaped quote
+						}
+					}
+					m_position = m_text.size( );
+					return make( token_kind::error );
+				}
+
+				if( is_alpha( c ) || c == '_' || c == '$' ) {
+					while( m_position < m_text.size( ) && is_identifier_char( m_text[m_position] ) ) {
+						++m_position;
+					}
+					auto result = make( token_kind::name );
+					auto after = m_position;
+					while( after < m_text.size( ) && is_space( m_text[after] ) ) {
+						++after;
+					}
+					if( after < m_text.size( ) && m_text[after] == '(' ) {
+						return result;
+					}
+					if( parse_cell_reference( result.text, result.address, result.anchors ) ) {
+						result.kind = token_kind::cell;
+					} else if( equal_nc( result.text, "TRUE" ) || equal_nc( result.text, "FALSE" ) ) {
+						result.kind = token_kind::boolean;
+					}
+					return result;
+				}
+
+				++m_position;
+				switch( c ) {
+				case '(': return make( token_kind::left_paren );
+				case ')': return make( token_kind::right_paren );
+				case ',':
+				case ';': return make( token_kind::comma );
+				case ':': return make( token_kind::colon );
+				case '<':
+					if( peek( 0 ) == '=' || peek( 0 ) == '>' ) {
+						++m_position;
+					}
+					return make( token_kind::op );
+				case '>':
+					if( peek( 0 ) == '=' ) {
+						++m_position;
+					}
+					return make( token_kind::op );
+				case '+':
+				case '-':
+				case '*':
+				case '/':
+				case '%':
+				case '^':
+				case '&':
+				case '|':
+				case '=': return make( token_kind::op );
+				default: return make( token_kind::error );
+				}
+			}
+
+			bool parse_result::has_error( ) const noexcept {
+				return error.message != nullptr;
+			}
+
+			parse_result::operator bool( ) const noexcept {
+				return !has_error( );
+			}
+
+			namespace {
+				struct binding_power {
+					int left;
+					int right;
+				};	// binding_power
+
+				constexpr int unary_power = 50;
+				constexpr size_t max_depth = 256;
+
+				// Lowest to highest: | & comparisons + - * / % ^ unary
+				binding_power infix_power( boost::string_ref op ) noexcept {
+					switch( op[0] ) {
+					case '|': return { 5, 6 };
+					case '&': return { 7, 8 };
+					case '<':
+					case '>':
+					case '=': return { 10, 11 };
+					case '+':
+					case '-': return { 20, 21 };
+					case '*':
+					case '/':
+					case '%': return { 30, 31 };
+					case '^': return { 40, 40 };	// right associative
+					default: return { -1, -1 };
+					}
+				}
+
+				void unquote( boost::string_ref text, std::string & result ) {
+					auto const quote = text.front( );
+					text = text.substr( 1, text.size( ) - 2 );
+					result.clear( );
+					result.reserve( text.size( ) );
+					for( size_t n = 0; n < text.size( ); ++n ) {
+						if( text[n] == '\\' && n + 1 < text.size( ) ) {
+							result.push_back( text[++n] );
+						} else {
+							result.push_back( text[n] );
+							if( text[n] == quote ) {
+								++n;	// skip the second of a doubled quote
+							}
+						}
+					}
+				}
+
+				/// <=, >= and <> are the negation of the opposite single character comparison
+				char negated_comparison( boost::string_ref op ) noexcept {
+					if( op == "<=" ) {
+						return '>';
+					} else if( op == ">=" ) {
+						return '<';
+					}
+					return '=';
+				}
+
+				/// Builds the optional_poly based sheetrock::ast tree
+				class tree_builder {
+				public:
+					using node_t = daw::optional_poly<ast::expression>;
+				private:
+					std::vector<node_t> m_arguments;
+
+					template<typename Node>
+					static node_t make_node( Node node ) {
+						node_t result;
+						result = std::move( node );
+						return result;
+					}
+
+					static node_t make_binary( char op, node_t lhs, node_t rhs ) {
+						switch( op ) {
+						case '+': return make_node( ast::bin_op_addition{ std::move( lhs ), std::move( rhs ) } );
+						case '-': return make_node( ast::bin_op_subtraction{ std::move( lhs ), std::move( rhs ) } );
+						case '*': return make_node( ast::bin_op_multiplication{ std::move( lhs ), std::move( rhs ) } );
+						case '/': return make_node( ast::bin_op_division{ std::move( lhs ), std::move( rhs ) } );
+						case '%': return make_node( ast::bin_op_modulus{ std::move( lhs ), std::move( rhs ) } );
+						case '^': return make_node( ast::bin_op_power{ std::move( lhs ), std::move( rhs ) } );
+						case '&': return make_node( ast::bin_op_and{ std::move( lhs ), std::move( rhs ) } );
+						case '|': return make_node( ast::bin_op_or{ std::move( lhs ), std::move( rhs ) } );
+						case '<': return make_node( ast::bin_op_less{ std::move( lhs ), std::move( rhs ) } );
+						case '>': return make_node( ast::bin_op_greater{ std::move( lhs ), std::move( rhs ) } );
+						default: return make_node( ast::bin_op_equal{ std::move( lhs ), std::move( rhs ) } );
+						}
+					}
+				public:
+					static node_t invalid( ) {
+						return node_t{ };
+					}
+
+					node_t number( boost::string_ref text ) {
+						return make_node( ast::number{ text.to_string( ) } );
+					}
+
+					node_t string( boost::string_ref quoted ) {
+						std::string value;
+						unquote( quoted, value );
+						return make_node( ast::string{ std::move( value ) } );
+					}
+
+					node_t boolean( bool value ) {
+						return make_node( ast::boolean{ value } );
+					}
+
+					node_t cell( daw::spreadsheet::cell_address const & address, uint8_t ) {
+						return make_node( ast::cell{ address } );
+					}
+
+					node_t range( daw::spreadsheet::cell_address const & first, daw::spreadsheet::cell_address const & last, uint8_t ) {
+						ast::range result{ };
+						result.first = ast::cell{ first };
+						result.last = ast::cell{ last };
+						return make_node( std::move( result ) );
+					}
+
+					node_t unary( char op, node_t operand ) {
+						return make_node( ast::unary_operator{ op, std::move( operand ) } );
+					}
+
+					node_t binary( boost::string_ref op, node_t lhs, node_t rhs ) {
+						if( op.size( ) == 2 ) {
+							auto const mark = begin_arguments( );
+							push_argument( make_binary( negated_comparison( op ), std::move( lhs ), std::move( rhs ) ) );
+							return function( "NOT", mark );
+						}
+						return make_binary( op[0], std::move( lhs ), std::move( rhs ) );
+					}
+
+					size_t begin_arguments( ) const noexcept {
+						return m_arguments.size( );
+					}
+
+					void push_argument( node_t argument ) {
+						m_arguments.push_back( std::move( argument ) );
+					}
+
+					node_t function( boost::string_ref name, size_t mark ) {
+						ast::function result{ };
+						ast::label label{ };
+						label.value = name.to_string( );
+						result.name = std::move( label );
+						auto const first = m_arguments.begin( ) + static_cast<std::ptrdiff_t>( mark );
+						result.arguments.assign( std::make_move_iterator( first ), std::make_move_iterator( m_arguments.end( ) ) );
+						m_arguments.erase( first, m_arguments.end( ) );
+						return make_node( std::move( result ) );
+					}
+				};	// tree_builder
+
+				/// Builds nodes into a flat_ast arena
+				class flat_builder {
+					flat_ast & m_arena;
+					std::string m_buffer;
+				public:
+					using node_t = flat_ast::index_t;
+
+					explicit flat_builder( flat_ast & arena ):
+							m_arena{ arena },
+							m_buffer{ } { }
+
+					static node_t invalid( ) {
+						return flat_ast::npos;
+					}
+
+					node_t number( boost::string_ref text ) {
+						return m_arena.add_number( text );
+					}
+
+					node_t string( boost::string_ref quoted ) {
+						unquote( quoted, m_buffer );
+						return m_arena.add_string( m_buffer );
+					}
+
+					node_t boolean( bool value ) {
+						return m_arena.add_boolean( value );
+					}
+
+					node_t cell( daw::spreadsheet::cell_address const & address, uint8_t anchors ) {
+						return m_arena.add_cell( address, anchors );
+					}
+
+					node_t range( daw::spreadsheet::cell_address const & first, daw::spreadsheet::cell_address const & last, uint8_t anchors ) {
+						return m_arena.add_range( first, last, anchors );
+					}
+
+					node_t unary( char op, node_t operand ) {
+						return m_arena.add_unary( op, operand );
+					}
+
+					node_t binary( boost::string_ref op, node_t lhs, node_t rhs ) {
+						if( op.size( ) == 2 ) {
+							auto const mark = begin_arguments( );
+							push_argument( m_arena.add_binary( negated_comparison( op ), lhs, rhs ) );
+							return function( "NOT", mark );
+						}
+						return m_arena.add_binary( op[0], lhs, rhs );
+					}
+
+					size_t begin_arguments( ) const noexcept {
+						return m_arena.begin_arguments( );
+					}
+
+					void push_argument( node_t argument ) {
+						m_arena.push_argument( argument );
+					}
+
+					node_t function( boost::string_ref name, size_t mark ) {
+						return m_arena.add_function( name, mark );
+					}
+				};	// flat_builder
+
+				/// Whether a '%' followed by tok is the modulus operator rather than percent.  A
+				/// sign is not taken as the start of an operand, so 5%+3 is 5% plus 3
+				bool starts_modulus_operand( token const & tok ) noexcept {
+					switch( tok.kind ) {
+					case token_kind::number:
+					case token_kind::string:
+					case token_kind::boolean:
+					case token_kind::cell:
+					case token_kind::name:
+					case token_kind::left_paren:
+						return true;
+					default:
+						return false;
+					}
+				}
+
+				/// Precedence climbing parser, each token is read exactly once.  Builder
+				/// decides how nodes are represented
+				template<typename Builder>
+				class pratt_parser {
+					using node_t = typename Builder::node_t;
+
+					Builder & m_builder;
+					tokenizer m_tokens;
+					token m_current;
+					parse_error m_error;
+					size_t m_depth;
+
+					void advance( ) noexcept {
+						m_current = m_tokens.next( );
+					}
+
+					node_t fail( char const * message ) noexcept {
+						if( m_error.message == nullptr ) {
+							m_error = parse_error{ m_current.position, message };
+						}
+						return Builder::invalid( );
+					}
+
+					bool failed( ) const noexcept {
+						return m_error.message != nullptr;
+					}
+
+					node_t function_call( token const & name_token ) {
+						advance( );	// (
+						auto const mark = m_builder.begin_arguments( );
+						if( m_current.kind == token_kind::right_paren ) {
+							advance( );
+							return m_builder.function( name_token.text, mark );
+						}
+						while( true ) {
+							auto arg = expression( 0 );
+							if( failed( ) ) {
+								return Builder::invalid( );
+							}
+							m_builder.push_argument( std::move( arg ) );
+							if( m_current.kind == token_kind::comma ) {
+								advance( );
+								continue;
+							}
+							if( m_current.kind != token_kind::right_paren ) {
+								return fail( "Expected ',' or ')' in function arguments" );
+							}
+							advance( );
+							return m_builder.function( name_token.text, mark );
+						}
+					}
+
+					node_t prefix( ) {
+						auto const tok = m_current;
+						switch( tok.kind ) {
+						case token_kind::number:
+							advance( );
+							return m_builder.number( tok.text );
+						case token_kind::string:
+							advance( );
+							return m_builder.string( tok.text );
+						case token_kind::boolean:
+							advance( );
+							return m_builder.boolean( to_upper( tok.text[0] ) == 'T' );
+						case token_kind::cell:
+							advance( );
+							if( m_current.kind == token_kind::colon ) {
+								advance( );
+								if( m_current.kind != token_kind::cell ) {
+									return fail( "Expected a cell reference after ':'" );
+								}
+								auto const last = m_current.address;
+								auto const anchors = static_cast<uint8_t>( tok.anchors | (m_current.anchors << 2) );
+								advance( );
+								return m_builder.range( tok.address, last, anchors );
+							}
+							return m_builder.cell( tok.address, tok.anchors );
+						case token_kind::name:
+							advance( );
+							if( m_current.kind != token_kind::left_paren ) {
+								return fail( "Unknown name" );
+							}
+							return function_call( tok );
+						case token_kind::left_paren: {
+								advance( );
+								auto result = expression( 0 );
+								if( failed( ) ) {
+									return Builder::invalid( );
+								}
+								if( m_current.kind != token_kind::right_paren ) {
+									return fail( "Expected ')'" );
+								}
+								advance( );
+								return result;
+							}
+						case token_kind::op:
+							if( tok.text == "-" || tok.text == "+" ) {
+								advance( );
+								auto rhs = expression( unary_power );
+								if( failed( ) || tok.text == "+" ) {
+									return rhs;
+								}
+								return m_builder.unary( '-', std::move( rhs ) );
+							}
+							return fail( "Unexpected operator" );
+						case token_kind::end:
+							return fail( "Unexpected end of formula" );
+						case token_kind::error:
+							return fail( "Invalid character or unterminated string" );
+						default:
+							return fail( "Unexpected token" );
+						}
+					}
+				public:
+					pratt_parser( Builder & builder, boost::string_ref text ) noexcept:
+							m_builder{ builder },
+							m_tokens{ text },
+							m_current{ },
+							m_error{ 0, nullptr },
+							m_depth{ 0 } {
+
+						advance( );
+					}
+
+					node_t expression( int min_power ) {
+						if( ++m_depth > max_depth ) {
+							return fail( "Formula is nested too deeply" );
+						}
+						auto lhs = prefix( );
+						while( !failed( ) && m_current.kind == token_kind::op ) {
+							auto const op = m_current;
+							auto const power = infix_power( op.text );
+							if( power.left < min_power ) {
+								break;
+							}
+							advance( );
+							if( op.text == "%" && !starts_modulus_operand( m_current ) ) {
+								// Postfix percent
+								lhs = m_builder.unary( '%', std::move( lhs ) );
+								continue;
+							}
+							auto rhs = expression( power.right );
+							if( failed( ) ) {
+								break;
+							}
+							lhs = m_builder.binary( op.text, std::move( lhs ), std::move( rhs ) );
+						}
+						--m_depth;
+						return failed( ) ? Builder::invalid( ) : std::move( lhs );
+					}
+
+					/// @return the root node, invalid on error
+					node_t parse( parse_error & error ) {
+						auto result = expression( 0 );
+						if( !failed( ) && m_current.kind != token_kind::end ) {
+							fail( "Unexpected text after expression" );
+						}
+						error = m_error;
+						return failed( ) ? Builder::invalid( ) : std::move( result );
+					}
+				};	// pratt_parser
+
+				/// Skip leading whitespace and the '=' that marks a formula
+				size_t formula_start( boost::string_ref text ) noexcept {
+					size_t pos = 0;
+					while( pos < text.size( ) && is_space( text[pos] ) ) {
+						++pos;
+					}
+					if( pos < text.size( ) && text[pos] == '=' ) {
+						++pos;
+					}
+					return pos;
+				}
+			}	// namespace anonymous
+
+			parse_result parse_formula( boost::string_ref text ) {
+				auto const start = formula_start( text );
+				tree_builder builder{ };
+				parse_result result{ };
+				result.expression = pratt_parser<tree_builder>{ builder, text.substr( start ) }.parse( result.error );
+				// Report positions relative to the text passed in
+				result.error.position += start;
+				return result;
+			}
+
+			bool flat_parse_result::has_error( ) const noexcept {
+				return error.message != nullptr;
+			}
+
+			flat_parse_result::operator bool( ) const noexcept {
+				return !has_error( );
+			}
+
+			flat_parse_result parse_formula( boost::string_ref text, flat_ast & arena ) {
+				auto const start = formula_start( text );
+				flat_builder builder{ arena };
+				flat_parse_result result{ flat_ast::npos, parse_error{ 0, nullptr } };
+				result.root = pratt_parser<flat_builder>{ builder, text.substr( start ) }.parse( result.error );
+				result.error.position += start;
+				return result;
+			}
+		}	// namespace sheetrock
+	}	// namespace parser
+}	// namespace daw
@@ -26,24 +26,23 @@
 
 namespace daw {
 	namespace spreadsheet {
-		void cell_t::link_values( ) {
-			link_object( "value", *m_value );
-		}
-
 		cell_t::cell_t( daw::nodepp::base::EventEmitter emitter ):
-				daw::json::JsonLink<cell_t>{ },
-				m_value{ std::make_unique<impl::cell_value>( std::move( emitter ) ) } {
-
-			link_values( );
-		}
+				m_value{ std::make_unique<impl::cell_value>( std::move( emitter ) ) } { }
 
 		cell_t::~cell_t( ) { }
 
 		void swap( cell_t & lhs, cell_t & rhs ) noexcept {
 			using std::swap;
-			swap( static_cast<daw::json::JsonLink<cell_t> &>(lhs), static_cast<daw::json::JsonLink<cell_t> &>(lhs) );
 			lhs.m_value.swap( rhs.m_value );
 		}
+
+		std::string cell_t::encode( ) const {
+			return to_json( *this );
+		}
+
+		void cell_t::decode( boost::string_ref json_text ) {
+			from_json( json_text, *this );
+		}
 	}	// namespace spreadsheet
 }	// namespace daw
 
@@ -0,0 +1,263 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "string_pool.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			constexpr string_pool::handle_t tombstone = std::numeric_limits<string_pool::handle_t>::max( );
+
+			uint64_t hash_text( boost::string_ref text ) noexcept {
+				constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+				uint64_t result = text.size( ) * multiplier;
+				auto data = text.data( );
+				auto size = text.size( );
+				while( size >= 8 ) {
+					uint64_t word;
+					std::memcpy( &word, data, sizeof( word ) );
+					result = (result ^ word) * multiplier;
+					data += 8;
+					size -= 8;
+				}
+				if( size > 0 ) {
+					uint64_t word = 0;
+					std::memcpy( &word, data, size );
+					result = (result ^ word) * multiplier;
+				}
+				// Mix the high bits down, the index uses the low ones
+				result ^= result >> 33;
+				result *= 0xFF51AFD7ED558CCDull;
+				result ^= result >> 33;
+				return result;
+			}
+
+			size_t block_of( uint64_t handle, size_t first_block_bits ) noexcept {
+				return static_cast<size_t>( 63 - __builtin_clzll( (handle >> first_block_bits) + 1 ) );
+			}
+		}	// namespace anonymous
+
+		constexpr string_pool::handle_t string_pool::empty_handle;
+		constexpr size_t string_pool::inline_capacity;
+
+		string_pool::string_pool( ):
+				m_mutex{ },
+				m_blocks{ },
+				m_index( 64, index_slot{ empty_handle, 0 } ),
+				m_index_used{ 0 },
+				m_free{ },
+				m_next{ 1 },
+				m_live{ 0 },
+				m_heap_bytes{ 0 } {
+
+			for( auto & block: m_blocks ) {
+				block.store( nullptr, std::memory_order_relaxed );
+			}
+		}
+
+		string_pool::~string_pool( ) {
+			for( size_t n = 0; n < block_count; ++n ) {
+				auto const block = m_blocks[n].load( std::memory_order_relaxed );
+				if( block == nullptr ) {
+					continue;
+				}
+				auto const entries = first_block_size << n;
+				for( size_t pos = 0; pos < entries; ++pos ) {
+					if( block[pos].refs > 0 && block[pos].size > inline_capacity ) {
+						delete[] block[pos].heap;
+					}
+				}
+				delete[] block;
+			}
+		}
+
+		string_pool::entry & string_pool::entry_at( handle_t handle ) const noexcept {
+			auto const block = block_of( handle, first_block_bits );
+			auto const first = (static_cast<uint64_t>( 1 ) << block) - 1;
+			auto const offset = static_cast<size_t>( handle - (first << first_block_bits) );
+			return m_blocks[block].load( std::memory_order_acquire )[offset];
+		}
+
+		string_pool::handle_t string_pool::new_handle( ) {
+			if( !m_free.empty( ) ) {
+				auto const result = m_free.back( );
+				m_free.pop_back( );
+				return result;
+			}
+			if( m_next >= tombstone ) {
+				throw std::length_error{ "string_pool is out of handles" };
+			}
+			auto const block = block_of( m_next, first_block_bits );
+			if( m_blocks[block].load( std::memory_order_relaxed ) == nullptr ) {
+				m_blocks[block].store( new entry[first_block_size << block]( ), std::memory_order_release );
+			}
+			return static_cast<handle_t>( m_next++ );
+		}
+
+		void string_pool::grow_index( ) {
+			// Doubles when mostly live, otherwise rebuilds at the same size to drop tombstones
+			auto const capacity = m_live * 2 >= m_index.size( ) ? m_index.size( ) * 2 : m_index.size( );
+			std::vector<index_slot> index( capacity, index_slot{ empty_handle, 0 } );
+			auto const mask = capacity - 1;
+			for( auto const & item: m_index ) {
+				if( item.handle == empty_handle || item.handle == tombstone ) {
+					continue;
+				}
+				auto slot = static_cast<size_t>( entry_at( item.handle ).hash ) & mask;
+				while( index[slot].handle != empty_handle ) {
+					slot = (slot + 1) & mask;
+				}
+				index[slot] = item;
+			}
+			m_index.swap( index );
+			m_index_used = m_live;
+		}
+
+		uint64_t string_pool::checked_hash( boost::string_ref text ) {
+			if( text.size( ) > std::numeric_limits<uint32_t>::max( ) ) {
+				throw std::length_error{ "string_pool text exceeds 4GB" };
+			}
+			return hash_text( text );
+		}
+
+		string_pool::handle_t string_pool::intern( boost::string_ref text ) {
+			if( text.empty( ) ) {
+				return empty_handle;
+			}
+			auto const hash = checked_hash( text );
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			return intern_locked( text, hash, 1 );
+		}
+
+		string_pool::handle_t string_pool::intern_locked( boost::string_ref text, uint64_t hash, uint32_t refs ) {
+			if( (m_index_used + 1) * 2 > m_index.size( ) ) {
+				grow_index( );
+			}
+			auto const tag = static_cast<uint32_t>( hash >> 32 );
+			auto const mask = m_index.size( ) - 1;
+			auto slot = static_cast<size_t>( hash ) & mask;
+			auto insert_at = m_index.size( );
+			while( m_index[slot].handle != empty_handle ) {
+				auto const handle = m_index[slot].handle;
+				if( handle == tombstone ) {
+					insert_at = std::min( insert_at, slot );
+				} else if( m_index[slot].tag == tag ) {
+					auto & item = entry_at( handle );
+					if( item.hash == hash && this->text( handle ) == text ) {
+						item.refs += refs;
+						return handle;
+					}
+				}
+				slot = (slot + 1) & mask;
+			}
+			auto const handle = new_handle( );
+			auto & item = entry_at( handle );
+			item.size = static_cast<uint32_t>( text.size( ) );
+			item.refs = refs;
+			item.hash = hash;
+			if( text.size( ) <= inline_capacity ) {
+				std::memcpy( item.local, text.data( ), text.size( ) );
+			} else {
+				item.heap = new char[text.size( )];
+				std::memcpy( item.heap, text.data( ), text.size( ) );
+				m_heap_bytes += text.size( );
+			}
+			if( insert_at == m_index.size( ) ) {
+				insert_at = slot;
+				++m_index_used;
+			}
+			m_index[insert_at] = index_slot{ handle, tag };
+			++m_live;
+			return handle;
+		}
+
+		void string_pool::retain_locked( handle_t handle ) noexcept {
+			if( handle != empty_handle ) {
+				++entry_at( handle ).refs;
+			}
+		}
+
+		void string_pool::retain( handle_t handle ) {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			retain_locked( handle );
+		}
+
+		void string_pool::release_locked( handle_t handle ) noexcept {
+			if( handle == empty_handle ) {
+				return;
+			}
+			auto & item = entry_at( handle );
+			if( --item.refs > 0 ) {
+				return;
+			}
+			auto const mask = m_index.size( ) - 1;
+			auto slot = static_cast<size_t>( item.hash ) & mask;
+			while( m_index[slot].handle != handle ) {
+				slot = (slot + 1) & mask;
+			}
+			m_index[slot].handle = tombstone;
+			if( item.size > inline_capacity ) {
+				delete[] item.heap;
+				m_heap_bytes -= item.size;
+			}
+			item.size = 0;
+			m_free.push_back( handle );
+			--m_live;
+		}
+
+		void string_pool::release( handle_t handle ) noexcept {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			release_locked( handle );
+		}
+
+		boost::string_ref string_pool::text( handle_t handle ) const noexcept {
+			if( handle == empty_handle ) {
+				return boost::string_ref{ };
+			}
+			auto const & item = entry_at( handle );
+			return boost::string_ref{ item.size <= inline_capacity ? item.local : item.heap, item.size };
+		}
+
+		size_t string_pool::size( ) const {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			return m_live;
+		}
+
+		size_t string_pool::memory_usage( ) const {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			size_t blocks = 0;
+			for( size_t n = 0; n < block_count; ++n ) {
+				if( m_blocks[n].load( std::memory_order_relaxed ) != nullptr ) {
+					blocks += first_block_size << n;
+				}
+			}
+			return sizeof( *this ) + blocks * sizeof( entry ) + m_heap_bytes
+				+ m_index.capacity( ) * sizeof( index_slot ) + m_free.capacity( ) * sizeof( handle_t );
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
@@ -27,46 +27,57 @@
 #include <utility>
 
 #include <daw/daw_hash_table.h>
-#include <daw/json/daw_json_link.h>
 #include <daw/nodepp/base_event_emitter.h>
 
 #include "table_item.h"
 
 namespace daw {
 	namespace spreadsheet {
+		namespace {
+			constexpr table_item::id_t s_id_block_size = 1024;
+		}	// namespace anonymous
 
 		table_item::id_t table_item::get_next_id( ) noexcept {
-			static std::atomic <id_t> s_next_id{ 1 };
-			id_t result = s_next_id++;
-			return result;
+			// Each thread takes ids from the shared counter a block at a time, so threads
+			// building items do not contend on it.  Ids stay unique but are not ordered
+			// across threads
+			static std::atomic<id_t> s_next_block{ 1 };
+			static thread_local id_t s_next = 0;
+			static thread_local id_t s_end = 0;
+			if( s_next == s_end ) {
+				s_next = s_next_block.fetch_add( s_id_block_size, std::memory_order_relaxed );
+				s_end = s_next + s_id_block_size;
+			}
+			return s_next++;
 		}
 
 		table_item::~table_item( ) {
-			emit_closed( );
+			// A moved from item has no id
+			if( m_id == 0 || !m_events ) {
+				return;
+			}
+			try {
+				emit_closed( );
+			} catch( ... ) {
+				// Listeners cannot be reported to from a destructor
+			}
+			m_events->remove_all( m_id );
 		}
 
-		table_item::table_item( daw::nodepp::base::EventEmitter emitter ):
-				daw::json::JsonLink<table_item>{ },
-				daw::nodepp::base::StandardEvents<table_item>{ std::move( emitter ) } {
-
-			link_integral( "id", m_id );
-		}
+		table_item::table_item( daw::nodepp::base::EventEmitter emitter, std::shared_ptr<event_table> events ):
+				daw::nodepp::base::StandardEvents<table_item>{ std::move( emitter ) },
+				m_id{ get_next_id( ) },
+				m_events{ events ? std::move( events ) : create_event_table( ) } { }
 
 		table_item::table_item( table_item const & other ):
-				daw::json::JsonLink<table_item>{ other },
 				daw::nodepp::base::StandardEvents<table_item>{ other },
-				m_id{ get_next_id( ) } {
-
-			link_integral( "id", m_id );
-		}
+				m_id{ get_next_id( ) },
+				m_events{ other.m_events } { }
 
 		table_item::table_item( table_item && other ):
-				daw::json::JsonLink<table_item>{ std::move( other ) },
 				daw::nodepp::base::StandardEvents<table_item>{ std::move( other ) },
-				m_id{ std::move( other.m_id ) } {
-
-			link_integral( "id", m_id );
-		}
+				m_id{ std::exchange( other.m_id, 0 ) },
+				m_events{ std::move( other.m_events ) } { }
 
 		table_item & table_item::operator=( table_item const & rhs ) {
 			if( this != &rhs ) {
@@ -90,37 +101,43 @@ namespace daw {
 			return m_id;
 		}
 
+		std::shared_ptr<event_table> const & table_item::events( ) const {
+			return m_events;
+		}
+
 		void swap( table_item & lhs, table_item & rhs ) {
 			using std::swap;
-			swap( static_cast<daw::json::JsonLink<table_item> &>(lhs), static_cast<daw::json::JsonLink<table_item> &>( rhs ) );
 			swap( static_cast<daw::nodepp::base::StandardEvents<table_item> &>(lhs), static_cast<daw::nodepp::base::StandardEvents<table_item> &>( rhs ) );
 			swap( lhs.m_id, rhs.m_id );
+			lhs.m_events.swap( rhs.m_events );
 		}
 
-		void table_item::emit_closed( ) {
-			std::string msg = id( ) + "_closed";
-			emitter( )->emit( msg, id( ) );
+		std::string table_item::encode( ) const {
+			return to_json( *this );
+		}
+
+		void table_item::decode( boost::string_ref json_text ) {
+			from_json( json_text, *this );
+		}
 
+		void table_item::emit_closed( ) {
+			m_events->emit( id( ), item_event::closed );
 		}
 
 		void table_item::on_closed( std::function<void( id_t )> listener ) {
-			std::string msg = id( ) + "_closed";
-			emitter( )->on( msg, std::move( listener ) );
+			m_events->on( id( ), item_event::closed, std::move( listener ) );
 		}
 
 		void table_item::emit_updated( ) {
-			std::string msg = id( ) + "_updated";
-			emitter( )->emit( msg, id( ) );
+			m_events->emit( id( ), item_event::updated );
 		}
 
 		void table_item::on_next_updated( std::function<void( id_t )> listener ) {
-			std::string msg = id( ) + "_updated";
-			emitter( )->on_next( msg, std::move( listener ) );
+			m_events->on_next( id( ), item_event::updated, std::move( listener ) );
 		}
 
 		void table_item::on_updated( std::function<void( id_t )> listener ) {
-			std::string msg = id( ) + "_updated";
-			emitter( )->on( msg, std::move( listener ) );
+			m_events->on( id( ), item_event::updated, std::move( listener ) );
 		}
 
 		std::string to_string( table_item::table_item_type item_type ) {
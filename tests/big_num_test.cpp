@@ -0,0 +1,143 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE big_num
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+#include "big_num_t.h"
+
+namespace {
+	using daw::spreadsheet::number::big_num_t;
+	using value_t = big_num_t::value_t;
+
+	/// A value and the same value built directly as value_t
+	struct operand {
+		big_num_t number;
+		value_t reference;
+	};	// operand
+
+	/// Mostly inline values of every scale, some near the int64 limits so arithmetic
+	/// overflows, and some already promoted
+	operand random_operand( std::mt19937_64 & engine ) {
+		int64_t mantissa;
+		switch( engine( ) % 4 ) {
+		case 0: mantissa = static_cast<int64_t>( engine( ) % 2001 ) - 1000; break;
+		case 1: mantissa = static_cast<int64_t>( engine( ) % 2000000001 ) - 1000000000; break;
+		case 2: mantissa = static_cast<int64_t>( engine( ) ); break;
+		default: {
+				auto const big = value_t{ std::to_string( static_cast<int64_t>( engine( ) ) ) + std::to_string( engine( ) % 1000000 ) + "e-" + std::to_string( engine( ) % 30 ) };
+				return operand{ big_num_t{ big }, big };
+			}
+		}
+		auto const scale = static_cast<uint8_t>( engine( ) % (big_num_t::max_scale + 1) );
+		return operand{ big_num_t::from_scaled( mantissa, scale ), value_t{ std::to_string( mantissa ) + "e-" + std::to_string( scale ) } };
+	}
+
+	/// result holds expected, and prints as expected does when held as value_t
+	void check_result( char const * op, operand const & lhs, operand const & rhs, big_num_t const & result, value_t const & expected ) {
+		BOOST_REQUIRE_MESSAGE( result.big_value( ) == expected, to_string( lhs.number ) << ' ' << op << ' ' << to_string( rhs.number ) << " gave " << to_string( result ) );
+		BOOST_REQUIRE_EQUAL( to_string( result ), to_string( big_num_t{ expected } ) );
+	}
+
+	/// value_t rounds quotients that have a finite decimal expansion in its last guard
+	/// digits, where inline division is exact, so quotients agree to value_t's precision
+	void check_quotient( operand const & lhs, operand const & rhs, big_num_t const & result, value_t const & expected ) {
+		static value_t const s_epsilon{ "1e-48" };
+		value_t const error = abs( result.big_value( ) - expected );
+		BOOST_REQUIRE_MESSAGE( error <= abs( expected ) * s_epsilon, to_string( lhs.number ) << " / " << to_string( rhs.number ) << " gave " << to_string( result ) );
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( inline_values_agree_with_value_t ) {
+	std::mt19937_64 engine{ 2016 };
+	size_t inline_results = 0;
+	for( int n = 0; n < 200000; ++n ) {
+		auto const lhs = random_operand( engine );
+		auto const rhs = random_operand( engine );
+		BOOST_REQUIRE( lhs.number.big_value( ) == lhs.reference );
+
+		auto const sum = lhs.number + rhs.number;
+		check_result( "+", lhs, rhs, sum, lhs.reference + rhs.reference );
+		check_result( "-", lhs, rhs, lhs.number - rhs.number, lhs.reference - rhs.reference );
+		check_result( "*", lhs, rhs, lhs.number * rhs.number, lhs.reference * rhs.reference );
+		if( rhs.reference != 0 ) {
+			check_quotient( lhs, rhs, lhs.number / rhs.number, lhs.reference / rhs.reference );
+		}
+		BOOST_REQUIRE_EQUAL( lhs.number < rhs.number, lhs.reference < rhs.reference );
+		BOOST_REQUIRE_EQUAL( lhs.number == rhs.number, lhs.reference == rhs.reference );
+		if( sum.is_small( ) ) {
+			++inline_results;
+		}
+	}
+	// Both representations were exercised
+	BOOST_CHECK_GT( inline_results, 50000u );
+	BOOST_CHECK_LT( inline_results, 190000u );
+}
+
+BOOST_AUTO_TEST_CASE( overflow_promotes ) {
+	big_num_t const max_value{ std::numeric_limits<int64_t>::max( ) };
+	auto const sum = max_value + big_num_t{ 1 };
+	BOOST_CHECK( !sum.is_small( ) );
+	BOOST_CHECK_EQUAL( to_string( sum ), "9223372036854775808" );
+	BOOST_CHECK( (sum - big_num_t{ 1 }).is_small( ) );
+	BOOST_CHECK( (big_num_t{ 1 } / big_num_t{ 4 }).is_small( ) );
+	BOOST_CHECK( !(big_num_t{ 1 } / big_num_t{ 3 }).is_small( ) );
+}
+
+BOOST_AUTO_TEST_CASE( from_chars_round_trips ) {
+	std::mt19937_64 engine{ 7 };
+	for( int n = 0; n < 20000; ++n ) {
+		auto const value = random_operand( engine ).number;
+		auto const text = to_string( value );
+		big_num_t parsed;
+		auto const result = daw::spreadsheet::number::from_chars( text.data( ), text.data( ) + text.size( ), parsed );
+		BOOST_REQUIRE( result.ec == std::errc{ } && result.ptr == text.data( ) + text.size( ) );
+		BOOST_REQUIRE_MESSAGE( parsed == value, text );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( from_chars_rejects_out_of_range_exponents ) {
+	for( char const * text: { "1e99999999999999999999", "1e-9999999999", "1e999999999", "1e-99999999" } ) {
+		big_num_t value;
+		auto const result = daw::spreadsheet::number::from_chars( text, text + std::strlen( text ), value );
+		BOOST_CHECK_MESSAGE( result.ec == std::errc::result_out_of_range, text );
+	}
+	big_num_t zero{ 5 };
+	char const text[] = "0.000e99999999999";
+	auto const result = daw::spreadsheet::number::from_chars( text, text + std::strlen( text ), zero );
+	BOOST_CHECK( result.ec == std::errc{ } && zero == big_num_t{ } );
+}
+
+BOOST_AUTO_TEST_CASE( promoted_values_print_without_guard_digits ) {
+	BOOST_CHECK_EQUAL( to_string( big_num_t{ 1 } / big_num_t{ 3 } ), "0." + std::string( 50, '3' ) );
+	BOOST_CHECK_EQUAL( to_string( big_num_t{ 2 } / big_num_t{ 7 } * big_num_t{ 7 } ), "2" );
+	BOOST_CHECK_EQUAL( to_string( big_num_t{ 2 } / big_num_t{ 3 } ), "0." + std::string( 49, '6' ) + "7" );
+	BOOST_CHECK_EQUAL( to_string( big_num_t{ "1e-30" } / big_num_t{ 4 } ), "2.5e-31" );
+	// Text printed for a promoted value parses back to the same printed value
+	auto const third = big_num_t{ 1 } / big_num_t{ 3 };
+	BOOST_CHECK_EQUAL( to_string( big_num_t{ to_string( third ) } ), to_string( third ) );
+}
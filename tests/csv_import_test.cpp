@@ -0,0 +1,140 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE csv_import
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <string>
+
+#include "csv_import.h"
+#include "thread_pool.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+	using expected_value_t = impl::column_store::expected_value_t;
+
+	csv_table parse( std::string const & text, size_t chunk_size, thread_pool & pool ) {
+		csv_options options{ };
+		options.chunk_size = chunk_size;
+		return parse_csv( text, pool, options );
+	}
+
+	void check_same( csv_table const & expected, csv_table const & actual, size_t chunk_size ) {
+		BOOST_REQUIRE_MESSAGE( actual.row_count == expected.row_count, "chunk size " << chunk_size );
+		BOOST_REQUIRE_MESSAGE( actual.columns.size( ) == expected.columns.size( ), "chunk size " << chunk_size );
+		for( size_t column = 0; column < expected.columns.size( ); ++column ) {
+			auto const & lhs = expected.columns[column];
+			auto const & rhs = actual.columns[column];
+			BOOST_REQUIRE_EQUAL( lhs.size( ), rhs.size( ) );
+			for( size_t row = 0; row < lhs.size( ); ++row ) {
+				BOOST_REQUIRE_MESSAGE( lhs.value_type( row ) == rhs.value_type( row ) && lhs.string_value( row ) == rhs.string_value( row ),
+						"chunk size " << chunk_size << " row " << row << " column " << column << ": '" << rhs.string_value( row ) << "' expected '" << lhs.string_value( row ) << "'" );
+			}
+		}
+	}
+
+	/// Parses text at every chunk size from 1 to its length and compares each result with
+	/// a parse of the whole text as one chunk
+	void check_chunk_sizes( std::string const & text, thread_pool & pool ) {
+		auto const whole = parse( text, text.size( ) + 1, pool );
+		for( size_t chunk_size = 1; chunk_size <= text.size( ); ++chunk_size ) {
+			check_same( whole, parse( text, chunk_size, pool ), chunk_size );
+		}
+	}
+
+	/// Records of plain, quoted and empty fields, with doubled quotes, delimiters and LF
+	/// or CRLF inside the quotes and either line ending
+	std::string random_csv( std::mt19937 & engine ) {
+		static char const * const pieces[] = { "a", "42", "-1.5", " ", ",", "\"\"", "\n", "\r\n", "x y" };
+		std::string result;
+		auto const records = 1 + engine( ) % 8;
+		for( size_t record = 0; record < records; ++record ) {
+			auto const fields = 1 + engine( ) % 4;
+			for( size_t field = 0; field < fields; ++field ) {
+				if( field != 0 ) {
+					result += ',';
+				}
+				switch( engine( ) % 3 ) {
+				case 0:
+					result += engine( ) % 2 == 0 ? "plain" : "7";
+					break;
+				case 1: {
+						result += '"';
+						for( auto count = engine( ) % 5; count > 0; --count ) {
+							result += pieces[engine( ) % (sizeof( pieces ) / sizeof( pieces[0] ))];
+						}
+						result += '"';
+						break;
+					}
+				default:
+					break;
+				}
+			}
+			if( record + 1 < records || engine( ) % 2 == 0 ) {
+				result += engine( ) % 2 == 0 ? "\r\n" : "\n";
+			}
+		}
+		return result;
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( quoted_fields ) {
+	thread_pool pool{ 4 };
+	std::string const text = "id,name,notes\r\n"
+			"1,\"Smith, J\",\"line one\r\nline two\"\r\n"
+			"2,\"say \"\"hi\"\"\",plain\r\n"
+			"3,,\"\"\"\"\r\n"
+			"\"4\",\"a\nb\nc\",\"x,\"\"y\"\"\"\r\n"
+			"5,last,\"\"\n"
+			"6,\"\"\"\"\"\",end";
+	auto const table = parse( text, text.size( ) + 1, pool );
+	BOOST_REQUIRE_EQUAL( table.row_count, 7u );
+	BOOST_REQUIRE_EQUAL( table.columns.size( ), 3u );
+	auto const & names = table.columns[1];
+	auto const & notes = table.columns[2];
+	BOOST_CHECK_EQUAL( names.string_value( 1 ), "Smith, J" );
+	BOOST_CHECK_EQUAL( notes.string_value( 1 ), "line one\r\nline two" );
+	BOOST_CHECK_EQUAL( names.string_value( 2 ), "say \"hi\"" );
+	BOOST_CHECK( names.value_type( 3 ) == expected_value_t::General );
+	BOOST_CHECK_EQUAL( notes.string_value( 3 ), "\"" );
+	BOOST_CHECK_EQUAL( names.string_value( 4 ), "a\nb\nc" );
+	BOOST_CHECK_EQUAL( notes.string_value( 4 ), "x,\"y\"" );
+	BOOST_CHECK_EQUAL( notes.string_value( 5 ), "" );
+	BOOST_CHECK_EQUAL( names.string_value( 6 ), "\"\"" );
+	BOOST_CHECK_EQUAL( notes.string_value( 6 ), "end" );
+
+	check_chunk_sizes( text, pool );
+}
+
+BOOST_AUTO_TEST_CASE( crlf_and_trailing_delimiters ) {
+	thread_pool pool{ 3 };
+	check_chunk_sizes( "1,2,\r\n3,4,5\r\n,\r\n\"\r\n\",6\r\n", pool );
+	check_chunk_sizes( "\"\"\"\"\n\"\n\"\n\"\r\n\"\r\n", pool );
+}
+
+BOOST_AUTO_TEST_CASE( random_records_at_every_chunk_size ) {
+	thread_pool pool{ 4 };
+	std::mt19937 engine{ 18 };
+	for( int n = 0; n < 60; ++n ) {
+		check_chunk_sizes( random_csv( engine ), pool );
+	}
+}
@@ -0,0 +1,391 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE dependency_graph
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "dependency_graph.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+
+	cell_address at( cell_address::index_t row, cell_address::index_t column ) {
+		return cell_address{ row, column };
+	}
+
+	std::set<uint64_t> keys( std::vector<cell_address> const & cells ) {
+		std::set<uint64_t> result;
+		for( auto const & cell: cells ) {
+			result.insert( cell.key( ) );
+		}
+		return result;
+	}
+
+	/// Level of each cell in plan.order
+	std::map<uint64_t, size_t> levels( recalc_plan const & plan ) {
+		std::map<uint64_t, size_t> result;
+		for( size_t level = 0; level < plan.level_count( ); ++level ) {
+			for( auto n = plan.level_offsets[level]; n < plan.level_offsets[level + 1]; ++n ) {
+				result[plan.order[n].key( )] = level;
+			}
+		}
+		return result;
+	}
+
+	/// Every cell of the plan comes in a later level than the planned cells it reads
+	void check_levels( dependency_graph const & graph, recalc_plan const & plan ) {
+		BOOST_REQUIRE( plan.level_offsets.empty( ) || plan.level_offsets.back( ) == plan.order.size( ) );
+		auto const level_of = levels( plan );
+		BOOST_REQUIRE_EQUAL( level_of.size( ), plan.order.size( ) );
+		for( auto const & cell: plan.order ) {
+			auto const level = level_of.at( cell.key( ) );
+			for( auto const & precedent: graph.precedents( cell ) ) {
+				auto pos = level_of.find( precedent.key( ) );
+				BOOST_CHECK( pos == level_of.end( ) || pos->second < level );
+			}
+			for( auto const & range: graph.range_precedents( cell ) ) {
+				for( auto const & other: level_of ) {
+					if( range.contains( cell_address::from_key( other.first ) ) ) {
+						BOOST_CHECK( other.second < level );
+					}
+				}
+			}
+		}
+	}
+
+	/// Formulas add one to the sum of the cells and ranges they read.  Formulas in a
+	/// column only read columns to their left, so the sheet has no cycles
+	struct model {
+		struct formula_t {
+			std::vector<cell_address> cells;
+			std::vector<cell_range> ranges;
+		};	// formula_t
+
+		static constexpr cell_address::index_t rows = 24;
+		static constexpr cell_address::index_t columns = 6;
+		std::map<uint64_t, int64_t> values;	// Constants, and the last result of each formula
+		std::map<uint64_t, formula_t> formulas;
+		dependency_graph graph;
+		std::mt19937 engine;
+
+		model( ):
+				values{ },
+				formulas{ },
+				graph{ },
+				engine{ 7 } { }
+
+		cell_address::index_t random( cell_address::index_t count ) {
+			return static_cast<cell_address::index_t>( engine( ) % count );
+		}
+
+		int64_t sum( std::vector<cell_address> const & cells, std::vector<cell_range> const & ranges, std::map<uint64_t, int64_t> const & source ) const {
+			int64_t result = 1;
+			auto const value = [&source]( uint64_t key ) {
+				auto pos = source.find( key );
+				return pos == source.end( ) ? 0 : pos->second;
+			};
+			for( auto const & cell: cells ) {
+				result += value( cell.key( ) );
+			}
+			for( auto const & range: ranges ) {
+				for( auto row = range.first.row; row <= range.last.row; ++row ) {
+					for( auto column = range.first.column; column <= range.last.column; ++column ) {
+						result += value( at( row, column ).key( ) );
+					}
+				}
+			}
+			return result;
+		}
+
+		void evaluate( cell_address const & cell ) {
+			auto const & formula = formulas.at( cell.key( ) );
+			values[cell.key( )] = sum( formula.cells, formula.ranges, values );
+		}
+
+		/// Every formula recalculated from scratch, a column at a time
+		std::map<uint64_t, int64_t> full_recalculation( ) const {
+			auto result = values;
+			for( cell_address::index_t column = 0; column < columns; ++column ) {
+				for( auto const & formula: formulas ) {
+					auto const cell = cell_address::from_key( formula.first );
+					if( cell.column == column ) {
+						result[formula.first] = sum( formula.second.cells, formula.second.ranges, result );
+					}
+				}
+			}
+			return result;
+		}
+
+		void set_value( cell_address const & cell ) {
+			if( formulas.erase( cell.key( ) ) != 0 ) {
+				graph.remove_formula( cell );
+			}
+			values[cell.key( )] = static_cast<int64_t>( random( 100 ) );
+			graph.mark_dirty( cell );
+		}
+
+		void set_formula( cell_address const & cell ) {
+			formula_t formula;
+			auto const count = random( 3 );
+			for( cell_address::index_t n = 0; n < count; ++n ) {
+				formula.cells.push_back( at( random( rows ), random( cell.column ) ) );
+			}
+			if( random( 2 ) == 0 ) {
+				auto const first = at( random( rows ), random( cell.column ) );
+				auto const last = at( first.row + random( rows - first.row ), first.column + random( cell.column - first.column ) );
+				formula.ranges.push_back( cell_range{ first, last } );
+			}
+			graph.set_precedents( cell, formula.cells, formula.ranges );
+			formulas[cell.key( )] = formula;
+			graph.mark_dirty( cell );
+		}
+
+		void run( recalc_plan const & plan ) {
+			check_levels( graph, plan );
+			BOOST_CHECK( plan.cycle.empty( ) );
+			for( auto const & cell: plan.order ) {
+				evaluate( cell );
+			}
+		}
+
+		void edit( ) {
+			auto const cell = at( random( rows ), random( columns ) );
+			if( cell.column < 2 || random( 4 ) == 0 ) {
+				set_value( cell );
+			} else {
+				set_formula( cell );
+			}
+		}
+	};	// model
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( chain_recalculates_in_order ) {
+	dependency_graph graph;
+	// B1 = A1, C1 = B1, D1 = C1 + A1
+	graph.set_precedents( at( 0, 1 ), { at( 0, 0 ) } );
+	graph.set_precedents( at( 0, 2 ), { at( 0, 1 ) } );
+	graph.set_precedents( at( 0, 3 ), { at( 0, 2 ), at( 0, 0 ) } );
+	graph.set_precedents( at( 5, 5 ), { at( 4, 4 ) } );
+
+	graph.mark_dirty( at( 0, 0 ) );
+	BOOST_CHECK_EQUAL( graph.dirty_count( ), 3u );
+	BOOST_CHECK( !graph.is_dirty( at( 5, 5 ) ) );
+	auto const plan = graph.take_dirty( );
+	BOOST_REQUIRE_EQUAL( plan.order.size( ), 3u );
+	BOOST_REQUIRE_EQUAL( plan.level_count( ), 3u );
+	BOOST_CHECK( plan.order[0] == at( 0, 1 ) );
+	BOOST_CHECK( plan.order[1] == at( 0, 2 ) );
+	BOOST_CHECK( plan.order[2] == at( 0, 3 ) );
+	BOOST_CHECK( plan.cycle.empty( ) );
+	BOOST_CHECK_EQUAL( graph.dirty_count( ), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( independent_cells_share_a_level ) {
+	dependency_graph graph;
+	for( cell_address::index_t row = 0; row < 10; ++row ) {
+		graph.set_precedents( at( row, 1 ), { at( row, 0 ) } );
+	}
+	graph.set_precedents( at( 0, 2 ), { }, { cell_range{ at( 0, 1 ), at( 9, 1 ) } } );
+	std::vector<cell_address> changed;
+	for( cell_address::index_t row = 0; row < 10; ++row ) {
+		changed.push_back( at( row, 0 ) );
+	}
+	graph.mark_dirty( changed );
+	auto const plan = graph.take_dirty( );
+	BOOST_REQUIRE_EQUAL( plan.level_count( ), 2u );
+	BOOST_CHECK_EQUAL( plan.level_offsets[1], 10u );
+	BOOST_CHECK( plan.order.back( ) == at( 0, 2 ) );
+	check_levels( graph, plan );
+}
+
+BOOST_AUTO_TEST_CASE( cycles_are_listed_apart ) {
+	dependency_graph graph;
+	// A1 = B1, B1 = A1, C1 = A1 + D1, E1 = D1
+	graph.set_precedents( at( 0, 0 ), { at( 0, 1 ) } );
+	graph.set_precedents( at( 0, 1 ), { at( 0, 0 ) } );
+	graph.set_precedents( at( 0, 2 ), { at( 0, 0 ), at( 0, 3 ) } );
+	graph.set_precedents( at( 0, 4 ), { at( 0, 3 ) } );
+	graph.mark_dirty( std::vector<cell_address>{ at( 0, 0 ), at( 0, 3 ) } );
+
+	auto const plan = graph.take_dirty( );
+	BOOST_CHECK( keys( plan.order ) == keys( { at( 0, 4 ) } ) );
+	BOOST_CHECK( keys( plan.cycle ) == keys( { at( 0, 0 ), at( 0, 1 ), at( 0, 2 ) } ) );
+
+	// A self reference is a cycle too
+	graph.set_precedents( at( 3, 3 ), { at( 3, 3 ) } );
+	graph.mark_dirty( at( 3, 3 ) );
+	auto const self = graph.take_dirty( );
+	BOOST_CHECK( self.order.empty( ) );
+	BOOST_CHECK( keys( self.cycle ) == keys( { at( 3, 3 ) } ) );
+
+	// Breaking the cycle lets its cells be ordered
+	graph.remove_formula( at( 0, 1 ) );
+	graph.mark_dirty( at( 0, 1 ) );
+	auto const broken = graph.take_dirty( );
+	BOOST_CHECK( broken.cycle.empty( ) );
+	BOOST_REQUIRE_EQUAL( broken.order.size( ), 2u );
+	BOOST_CHECK( broken.order[0] == at( 0, 0 ) );
+	BOOST_CHECK( broken.order[1] == at( 0, 2 ) );
+}
+
+BOOST_AUTO_TEST_CASE( removed_formulas_stop_propagating ) {
+	dependency_graph graph;
+	graph.set_precedents( at( 0, 1 ), { at( 0, 0 ) } );
+	graph.set_precedents( at( 0, 2 ), { at( 0, 1 ) }, { cell_range{ at( 0, 0 ), at( 3, 0 ) } } );
+	graph.mark_dirty( at( 0, 0 ) );
+	graph.remove_formula( at( 0, 1 ) );
+	BOOST_CHECK( !graph.is_formula( at( 0, 1 ) ) );
+	BOOST_CHECK( !graph.is_dirty( at( 0, 1 ) ) );
+	BOOST_CHECK( graph.is_dirty( at( 0, 2 ) ) );
+	graph.take_dirty( );
+
+	// C1 still reads B1 and A1:A4
+	graph.mark_dirty( at( 0, 1 ) );
+	BOOST_CHECK( graph.is_dirty( at( 0, 2 ) ) );
+	graph.take_dirty( );
+	graph.remove_formula( at( 0, 2 ) );
+	graph.mark_dirty( std::vector<cell_address>{ at( 0, 0 ), at( 2, 0 ), at( 0, 1 ) } );
+	BOOST_CHECK_EQUAL( graph.dirty_count( ), 0u );
+	BOOST_CHECK( graph.dependents( at( 2, 0 ) ).empty( ) );
+}
+
+BOOST_AUTO_TEST_CASE( range_edges_match_brute_force ) {
+	// Spans over the whole row space exercise every level of the row_spans trie
+	auto const max_row = std::numeric_limits<cell_address::index_t>::max( );
+	std::mt19937 engine{ 11 };
+	auto const random_row = [&]( ) -> cell_address::index_t {
+		switch( engine( ) % 4 ) {
+		case 0: return static_cast<cell_address::index_t>( engine( ) % 64 );
+		case 1: return max_row - static_cast<cell_address::index_t>( engine( ) % 64 );
+		case 2: return (static_cast<cell_address::index_t>( 1 ) << (engine( ) % 32)) - static_cast<cell_address::index_t>( engine( ) % 2 );
+		default: return static_cast<cell_address::index_t>( engine( ) );
+		}
+	};
+
+	dependency_graph graph;
+	std::map<uint64_t, std::vector<cell_range>> formulas;
+	for( int step = 0; step < 400; ++step ) {
+		auto const cell = at( static_cast<cell_address::index_t>( engine( ) % 40 ), 10 );
+		if( engine( ) % 4 == 0 ) {
+			graph.remove_formula( cell );
+			formulas.erase( cell.key( ) );
+		} else {
+			std::vector<cell_range> ranges;
+			for( auto count = engine( ) % 3; count > 0; --count ) {
+				auto first = random_row( );
+				auto last = random_row( );
+				auto const column = static_cast<cell_address::index_t>( engine( ) % 3 );
+				ranges.push_back( cell_range{ at( std::min( first, last ), column ), at( std::max( first, last ), column + static_cast<cell_address::index_t>( engine( ) % 2 ) ) } );
+			}
+			graph.set_precedents( cell, { }, ranges );
+			formulas[cell.key( )] = ranges;
+		}
+
+		for( int probe = 0; probe < 20; ++probe ) {
+			auto const target = at( random_row( ), static_cast<cell_address::index_t>( engine( ) % 4 ) );
+			std::set<uint64_t> expected;
+			for( auto const & formula: formulas ) {
+				for( auto const & range: formula.second ) {
+					if( range.contains( target ) ) {
+						expected.insert( formula.first );
+					}
+				}
+			}
+			BOOST_REQUIRE( keys( graph.dependents( target ) ) == expected );
+		}
+	}
+	graph.mark_dirty( at( 0, 0 ) );
+	graph.mark_dirty( at( max_row, 1 ) );
+	graph.take_dirty( );
+	for( auto const & formula: formulas ) {
+		graph.remove_formula( cell_address::from_key( formula.first ) );
+	}
+	BOOST_CHECK( graph.dependents( at( 0, 0 ) ).empty( ) );
+	BOOST_CHECK( graph.dependents( at( max_row, 2 ) ).empty( ) );
+}
+
+BOOST_AUTO_TEST_CASE( incremental_matches_full_recalculation ) {
+	model sheet;
+	for( int n = 0; n < 300; ++n ) {
+		sheet.edit( );
+	}
+	sheet.run( sheet.graph.take_dirty( ) );
+	BOOST_REQUIRE( sheet.values == sheet.full_recalculation( ) );
+
+	for( int step = 0; step < 300; ++step ) {
+		for( auto count = sheet.random( 4 ) + 1; count > 0; --count ) {
+			sheet.edit( );
+		}
+		sheet.graph.recalculate( [&sheet]( cell_address const & cell ) {
+			sheet.evaluate( cell );
+		} );
+		BOOST_CHECK_EQUAL( sheet.graph.dirty_count( ), 0u );
+		BOOST_REQUIRE( sheet.values == sheet.full_recalculation( ) );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( lazy_take_dirty_brings_requested_cells_up_to_date ) {
+	model sheet;
+	for( int n = 0; n < 300; ++n ) {
+		sheet.edit( );
+	}
+	sheet.run( sheet.graph.take_dirty( ) );
+
+	for( int step = 0; step < 400; ++step ) {
+		for( auto count = sheet.random( 4 ) + 1; count > 0; --count ) {
+			sheet.edit( );
+		}
+		auto const expected = sheet.full_recalculation( );
+		std::vector<cell_address> requested;
+		if( sheet.random( 2 ) == 0 ) {
+			for( auto count = sheet.random( 3 ) + 1; count > 0; --count ) {
+				requested.push_back( at( sheet.random( model::rows ), sheet.random( model::columns ) ) );
+			}
+			sheet.run( sheet.graph.take_dirty( requested ) );
+		} else {
+			auto const first = at( sheet.random( model::rows ), sheet.random( model::columns ) );
+			auto const last = at( first.row + sheet.random( model::rows - first.row ), first.column + sheet.random( model::columns - first.column ) );
+			sheet.run( sheet.graph.take_dirty( cell_range{ first, last } ) );
+			for( auto row = first.row; row <= last.row; ++row ) {
+				for( auto column = first.column; column <= last.column; ++column ) {
+					requested.push_back( at( row, column ) );
+				}
+			}
+		}
+		for( auto const & cell: requested ) {
+			BOOST_CHECK( !sheet.graph.is_dirty( cell ) );
+			auto const pos = expected.find( cell.key( ) );
+			if( pos != expected.end( ) ) {
+				BOOST_REQUIRE_EQUAL( sheet.values[cell.key( )], pos->second );
+			}
+		}
+	}
+	sheet.run( sheet.graph.take_dirty( ) );
+	BOOST_CHECK( sheet.values == sheet.full_recalculation( ) );
+}
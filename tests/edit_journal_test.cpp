@@ -0,0 +1,252 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE edit_journal
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "edit_journal.h"
+#include "json_text.h"
+#include "sheet.h"
+#include "sheet_snapshot.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+	using expected_value_t = journal_record::expected_value_t;
+
+	sheet make_sheet( ) {
+		return sheet{ daw::nodepp::base::create_event_emitter( ) };
+	}
+
+	/// The JSON of a sheet without the ids, which differ between sheets
+	std::string to_json( sheet const & source ) {
+		std::ostringstream out;
+		{
+			json_writer writer{ out };
+			source.write( writer );
+		}
+		return std::regex_replace( out.str( ), std::regex{ "\"id\":[0-9]+" }, "\"id\":0" );
+	}
+
+	journal_options unsynced( ) {
+		journal_options result{ };
+		result.sync = false;
+		return result;
+	}
+
+	/// A directory for the journal and snapshot, removed when the test ends
+	struct temp_directory {
+		boost::filesystem::path path;
+
+		temp_directory( ):
+				path{ boost::filesystem::temp_directory_path( ) / boost::filesystem::unique_path( "edit_journal_test_%%%%%%%%" ) } {
+
+			boost::filesystem::create_directory( path );
+		}
+
+		~temp_directory( ) {
+			boost::system::error_code ec;
+			boost::filesystem::remove_all( path, ec );
+		}
+
+		std::string file( std::string const & name ) const {
+			return (path / name).string( );
+		}
+	};	// temp_directory
+
+	struct read_record {
+		uint64_t sequence;
+		cell_address cell;
+		std::string text;
+	};	// read_record
+
+	std::vector<read_record> read_all( std::string const & path ) {
+		std::vector<read_record> result;
+		read_journal( path, [&result]( journal_record const & record ) {
+			result.push_back( read_record{ record.sequence, record.cell, record.text.to_string( ) } );
+		} );
+		return result;
+	}
+
+	void overwrite( std::string const & path, size_t offset, char value ) {
+		std::fstream out{ path, std::ios::binary | std::ios::in | std::ios::out };
+		out.seekp( static_cast<std::streamoff>( offset ) );
+		out.put( value );
+		BOOST_REQUIRE( out.good( ) );
+	}
+
+	void fill( sheet & target, size_t first_row, size_t rows ) {
+		sheet::transaction tx{ target };
+		for( auto row = first_row; row < first_row + rows; ++row ) {
+			auto const index = static_cast<cell_address::index_t>( row );
+			target.set_value( cell_address{ index, 0 }, std::to_string( row ) );
+			target.set_value( cell_address{ index, 1 }, "text of row " + std::to_string( row ) );
+			target.set_value( cell_address{ index, 2 }, "=A" + std::to_string( row + 1 ) + "*2" );
+		}
+	}
+
+	void check_recovers( sheet const & source, std::string const & snapshot_path, std::string const & journal_path ) {
+		auto recovered = make_sheet( );
+		recover_sheet( recovered, snapshot_path, journal_path );
+		BOOST_CHECK_EQUAL( to_json( recovered ), to_json( source ) );
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( records_round_trip ) {
+	temp_directory const dir{ };
+	auto const path = dir.file( "sheet.journal" );
+	{
+		edit_journal journal{ path, unsynced( ) };
+		BOOST_CHECK_EQUAL( journal.append_set( cell_address{ 1, 2 }, expected_value_t::Text, "first" ), 1u );
+		BOOST_CHECK_EQUAL( journal.append_clear_column( 3 ), 2u );
+		BOOST_CHECK_EQUAL( journal.append_set( cell_address{ 4, 5 }, expected_value_t::General, "" ), 3u );
+		journal.flush( );
+	}
+	auto const records = read_all( path );
+	BOOST_REQUIRE_EQUAL( records.size( ), 3u );
+	BOOST_CHECK_EQUAL( records[0].sequence, 1u );
+	BOOST_CHECK( records[0].cell == ( cell_address{ 1, 2 } ) );
+	BOOST_CHECK_EQUAL( records[0].text, "first" );
+	BOOST_CHECK_EQUAL( records[1].cell.column, 3u );
+	BOOST_CHECK_EQUAL( records[2].sequence, 3u );
+	BOOST_CHECK( records[2].text.empty( ) );
+}
+
+BOOST_AUTO_TEST_CASE( torn_tail_is_cut_off ) {
+	temp_directory const dir{ };
+	auto const path = dir.file( "sheet.journal" );
+	{
+		edit_journal journal{ path, unsynced( ) };
+		journal.append_set( cell_address{ 0, 0 }, expected_value_t::General, "one" );
+		journal.append_set( cell_address{ 1, 0 }, expected_value_t::General, "two" );
+		journal.append_set( cell_address{ 2, 0 }, expected_value_t::General, "three" );
+	}
+	auto const whole_size = boost::filesystem::file_size( path );
+	// A crash mid write left only part of the last record
+	boost::filesystem::resize_file( path, whole_size - 4 );
+	BOOST_CHECK_EQUAL( read_all( path ).size( ), 2u );
+	{
+		edit_journal journal{ path, unsynced( ) };
+		BOOST_CHECK_EQUAL( journal.last_sequence( ), 2u );
+		// The torn record is gone, so the next one follows the last valid record
+		BOOST_CHECK_LT( boost::filesystem::file_size( path ), whole_size - 4 );
+		BOOST_CHECK_EQUAL( journal.append_set( cell_address{ 2, 0 }, expected_value_t::General, "again" ), 3u );
+	}
+	auto const records = read_all( path );
+	BOOST_REQUIRE_EQUAL( records.size( ), 3u );
+	BOOST_CHECK_EQUAL( records[1].text, "two" );
+	BOOST_CHECK_EQUAL( records[2].sequence, 3u );
+	BOOST_CHECK_EQUAL( records[2].text, "again" );
+}
+
+BOOST_AUTO_TEST_CASE( replay_stops_at_a_corrupt_record ) {
+	temp_directory const dir{ };
+	auto const path = dir.file( "sheet.journal" );
+	{
+		edit_journal journal{ path, unsynced( ) };
+		journal.append_set( cell_address{ 0, 0 }, expected_value_t::General, "1" );
+		journal.append_set( cell_address{ 1, 0 }, expected_value_t::General, "2" );
+		journal.append_set( cell_address{ 2, 0 }, expected_value_t::General, "corrupt me" );
+		journal.append_set( cell_address{ 3, 0 }, expected_value_t::General, "4" );
+	}
+	std::ifstream in{ path, std::ios::binary };
+	std::string const contents{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{ } };
+	auto const position = contents.find( "corrupt me" );
+	BOOST_REQUIRE( position != std::string::npos );
+	overwrite( path, position, 'C' );
+
+	BOOST_CHECK_EQUAL( read_all( path ).size( ), 2u );
+	auto target = make_sheet( );
+	BOOST_CHECK_EQUAL( replay_journal( path, target ), 2u );
+	BOOST_CHECK_EQUAL( target.string_value( cell_address{ 1, 0 } ), "2" );
+	BOOST_CHECK_EQUAL( target.row_count( ), 2u );
+	// Reopening drops the corrupt record and everything after it
+	edit_journal journal{ path, unsynced( ) };
+	BOOST_CHECK_EQUAL( journal.last_sequence( ), 2u );
+}
+
+BOOST_AUTO_TEST_CASE( compaction_recovers_the_sheet ) {
+	temp_directory const dir{ };
+	auto const journal_path = dir.file( "sheet.journal" );
+	auto const snapshot_path = dir.file( "sheet.snap" );
+	auto source = make_sheet( );
+	auto journal = std::make_shared<edit_journal>( journal_path, unsynced( ) );
+	source.attach_journal( journal );
+	fill( source, 0, 20 );
+	compact_journal( source, *journal, snapshot_path ).get( );
+	BOOST_CHECK( !boost::filesystem::exists( journal->rotated_path( ) ) );
+	BOOST_CHECK( boost::filesystem::exists( snapshot_path ) );
+	fill( source, 10, 20 );
+	source.set_value( cell_address{ 3, 1 }, "edited after the snapshot" );
+	journal->flush( );
+	check_recovers( source, snapshot_path, journal_path );
+	// Sequence numbers carry on across the rotation
+	BOOST_CHECK_GT( read_all( journal_path ).front( ).sequence, 60u );
+}
+
+BOOST_AUTO_TEST_CASE( crash_between_rotate_and_unlink_recovers ) {
+	temp_directory const dir{ };
+	auto const journal_path = dir.file( "sheet.journal" );
+	auto const snapshot_path = dir.file( "sheet.snap" );
+	auto source = make_sheet( );
+	auto journal = std::make_shared<edit_journal>( journal_path, unsynced( ) );
+	source.attach_journal( journal );
+	fill( source, 0, 20 );
+	compact_journal( source, *journal, snapshot_path ).get( );
+
+	// A second compaction rotates and writes its snapshot but crashes before removing
+	// the rotated journal, so both hold the same edits
+	fill( source, 20, 10 );
+	journal->rotate( );
+	write_snapshot( source, snapshot_path );
+	BOOST_CHECK( boost::filesystem::exists( journal->rotated_path( ) ) );
+	fill( source, 25, 10 );
+	journal->flush( );
+	check_recovers( source, snapshot_path, journal_path );
+	// The unfinished compaction blocks the next rotation
+	BOOST_CHECK_THROW( journal->rotate( ), std::logic_error );
+
+	// A crash before the snapshot was written leaves the older snapshot, the rotated
+	// journal holds everything since
+	auto const rotated_path = journal->rotated_path( );
+	boost::filesystem::remove( rotated_path );
+	fill( source, 30, 5 );
+	journal->rotate( );
+	fill( source, 0, 3 );
+	journal->flush( );
+	check_recovers( source, snapshot_path, journal_path );
+
+	// Reopening after the crash continues the sequence past the rotated journal
+	auto const last = journal->last_sequence( );
+	source.attach_journal( nullptr );
+	journal.reset( );
+	edit_journal reopened{ journal_path, unsynced( ) };
+	BOOST_CHECK_EQUAL( reopened.last_sequence( ), last );
+}
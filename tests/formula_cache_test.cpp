@@ -0,0 +1,176 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE formula_cache
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+#include "formula_cache.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+
+	cell_address at( cell_address::index_t row, cell_address::index_t column ) {
+		return cell_address{ row, column };
+	}
+
+	/// Every cell holds row * 100 + column
+	struct grid_resolver {
+		formula_value value( cell_address const & cell ) const {
+			return formula_value::from_number( number::big_num_t{ static_cast<int64_t>( cell.row ) * 100 + cell.column } );
+		}
+
+		template<typename Function>
+		void for_each_value( cell_range const & range, Function func ) const {
+			for( auto row = range.first.row; row <= range.last.row; ++row ) {
+				for( auto column = range.first.column; column <= range.last.column; ++column ) {
+					func( value( at( row, column ) ) );
+				}
+			}
+		}
+	};	// grid_resolver
+
+	std::string key_of( std::string const & formula, cell_address const & cell ) {
+		std::string result;
+		normalize_formula( formula, cell, result );
+		return result;
+	}
+
+	std::string moved( std::string const & formula, cell_address const & from, cell_address const & to, bool expected_result = true ) {
+		std::string result;
+		BOOST_CHECK_EQUAL( move_formula( formula, from, to, result ), expected_result );
+		return result;
+	}
+
+	std::string describe( formula_value const & value ) {
+		switch( value.kind ) {
+		case formula_value::kind_t::number: return to_string( value.number );
+		case formula_value::kind_t::error: return to_string( value.error );
+		default: return "kind " + std::to_string( static_cast<int>( value.kind ) );
+		}
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( relative_references_normalize_to_offsets ) {
+	// The same formula filled down or across has one key
+	BOOST_CHECK_EQUAL( key_of( "=A1*2", at( 0, 1 ) ), key_of( "=A2*2", at( 1, 1 ) ) );
+	BOOST_CHECK_EQUAL( key_of( "=A1*2", at( 0, 1 ) ), key_of( "=C8*2", at( 7, 3 ) ) );
+	BOOST_CHECK_EQUAL( key_of( "=SUM(A1:A3)", at( 3, 0 ) ), key_of( "=SUM(B11:B13)", at( 13, 1 ) ) );
+	BOOST_CHECK( key_of( "=A1*2", at( 0, 1 ) ) != key_of( "=A1*2", at( 1, 1 ) ) );
+	BOOST_CHECK( key_of( "=A1*2", at( 0, 1 ) ) != key_of( "=A1*3", at( 0, 1 ) ) );
+	// Spacing and the leading = do not matter
+	BOOST_CHECK_EQUAL( key_of( "=A1*2", at( 0, 1 ) ), key_of( " A1 * 2", at( 0, 1 ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( anchored_references_normalize_to_positions ) {
+	BOOST_CHECK_EQUAL( key_of( "=$A$1+B1", at( 0, 2 ) ), key_of( "=$A$1+B5", at( 4, 2 ) ) );
+	BOOST_CHECK( key_of( "=$A$1", at( 0, 2 ) ) != key_of( "=$A$2", at( 1, 2 ) ) );
+	// Only the anchored part stays put
+	BOOST_CHECK_EQUAL( key_of( "=A$1", at( 1, 1 ) ), key_of( "=B$1", at( 5, 2 ) ) );
+	BOOST_CHECK( key_of( "=A$1", at( 1, 1 ) ) != key_of( "=A$2", at( 2, 1 ) ) );
+	BOOST_CHECK_EQUAL( key_of( "=$A1", at( 0, 1 ) ), key_of( "=$A4", at( 3, 5 ) ) );
+	BOOST_CHECK( key_of( "=$A1", at( 0, 1 ) ) != key_of( "=A1", at( 0, 1 ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( names_are_folded ) {
+	BOOST_CHECK_EQUAL( key_of( "=sum(A1:A2)", at( 2, 0 ) ), key_of( "=SUM(A1:A2)", at( 2, 0 ) ) );
+	BOOST_CHECK_EQUAL( key_of( "=Max(A1,true)", at( 2, 0 ) ), key_of( "=MAX(A1,TRUE)", at( 2, 0 ) ) );
+	BOOST_CHECK( key_of( "=SUM(A1:A2)", at( 2, 0 ) ) != key_of( "=MAX(A1:A2)", at( 2, 0 ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( move_formula_moves_unanchored_parts ) {
+	BOOST_CHECK_EQUAL( moved( "=A1+$B$2+C$3+$D4", at( 0, 0 ), at( 2, 1 ) ), "=B3+$B$2+D$3+$D6" );
+	BOOST_CHECK_EQUAL( moved( "=SUM( A1:B2 ) * 2", at( 0, 0 ), at( 2, 2 ) ), "=SUM( C3:D4 ) * 2" );
+	// Moving back up and left
+	BOOST_CHECK_EQUAL( moved( "=C3", at( 4, 4 ), at( 2, 3 ) ), "=B1" );
+	BOOST_CHECK_EQUAL( moved( "=$A$1", at( 9, 9 ), at( 0, 0 ) ), "=$A$1" );
+}
+
+BOOST_AUTO_TEST_CASE( references_moved_off_the_sheet_are_ref_errors ) {
+	auto const ref = to_string( formula_error::ref );
+	BOOST_CHECK_EQUAL( moved( "=A1+B2", at( 1, 1 ), at( 0, 1 ), false ), "=" + ref + "+B1" );
+	BOOST_CHECK_EQUAL( moved( "=A1", at( 0, 1 ), at( 0, 0 ), false ), "=" + ref );
+	// The anchored part keeps the reference on the sheet
+	BOOST_CHECK_EQUAL( moved( "=$A1", at( 0, 1 ), at( 0, 0 ) ), "=$A1" );
+}
+
+BOOST_AUTO_TEST_CASE( filled_copies_share_one_compiled_formula ) {
+	formula_cache cache;
+	auto const first = cache.get( "=A1*2", at( 0, 1 ) );
+	auto const second = cache.get( "=A2*2", at( 1, 1 ) );
+	auto const other = cache.get( "=A1*3", at( 0, 1 ) );
+	BOOST_CHECK( first == second );
+	BOOST_CHECK( first != other );
+	BOOST_CHECK_EQUAL( cache.size( ), 2u );
+	BOOST_CHECK( first->origin( ) == at( 0, 1 ) );
+}
+
+BOOST_AUTO_TEST_CASE( evaluate_moves_references_to_the_cell ) {
+	formula_cache cache;
+	grid_resolver const grid{ };
+	auto const relative = cache.get( "=A1*2", at( 0, 1 ) );
+	BOOST_CHECK_EQUAL( describe( relative->evaluate( at( 0, 1 ), grid ) ), "0" );
+	BOOST_CHECK_EQUAL( describe( relative->evaluate( at( 5, 1 ), grid ) ), "1000" );
+	BOOST_CHECK_EQUAL( describe( relative->evaluate( at( 5, 3 ), grid ) ), "1004" );
+
+	auto const anchored = cache.get( "=$A$2+B1+C$1+$D1", at( 0, 4 ) );
+	// At F4: A2 + C4 + D1 + D4
+	BOOST_CHECK_EQUAL( describe( anchored->evaluate( at( 3, 5 ), grid ) ), std::to_string( 100 + 302 + 3 + 303 ) );
+
+	auto const range = cache.get( "=SUM(A1:A2)", at( 0, 1 ) );
+	BOOST_CHECK_EQUAL( describe( range->evaluate( at( 2, 1 ), grid ) ), "500" );
+
+	std::vector<cell_address> cells;
+	std::vector<cell_range> ranges;
+	anchored->references( at( 3, 5 ), cells, ranges );
+	BOOST_REQUIRE_EQUAL( cells.size( ), 4u );
+	BOOST_CHECK( cells[0] == at( 1, 0 ) );
+	BOOST_CHECK( cells[1] == at( 3, 2 ) );
+	BOOST_CHECK( cells[2] == at( 0, 3 ) );
+	BOOST_CHECK( cells[3] == at( 3, 3 ) );
+	range->references( at( 2, 1 ), cells, ranges );
+	BOOST_REQUIRE_EQUAL( ranges.size( ), 1u );
+	BOOST_CHECK( ranges[0] == cell_range( at( 2, 0 ), at( 3, 0 ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( unparsed_formulas_are_value_errors ) {
+	formula_cache cache;
+	auto const bad = cache.get( "=1+", at( 0, 0 ) );
+	BOOST_CHECK( !bad->parsed( ) );
+	BOOST_CHECK_EQUAL( describe( bad->evaluate( at( 0, 0 ), grid_resolver{ } ) ), to_string( formula_error::value ) );
+}
+
+BOOST_AUTO_TEST_CASE( prune_drops_unheld_formulas ) {
+	formula_cache cache;
+	auto held = cache.get( "=A1+1", at( 0, 1 ) );
+	cache.get( "=A1+2", at( 0, 1 ) );
+	cache.get( "=A1+3", at( 0, 1 ) );
+	BOOST_CHECK_EQUAL( cache.size( ), 3u );
+	BOOST_CHECK_EQUAL( cache.prune( ), 2u );
+	BOOST_CHECK_EQUAL( cache.size( ), 1u );
+	// The held formula is still shared
+	BOOST_CHECK( cache.get( "=A5+1", at( 4, 1 ) ) == held );
+	cache.clear( );
+	BOOST_CHECK_EQUAL( cache.size( ), 0u );
+	BOOST_CHECK( held->parsed( ) );
+}
@@ -0,0 +1,81 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#define BOOST_TEST_MODULE formula_vm
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+#include "formula_vm.h"
+#include "sheetrock_parser.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+
+	/// A sheet without any values
+	struct empty_resolver {
+		formula_value value( cell_address ) const {
+			return formula_value{ };
+		}
+
+		template<typename Function>
+		void for_each_value( cell_range, Function ) const { }
+	};	// empty_resolver
+
+	std::string describe( formula_value const & value ) {
+		switch( value.kind ) {
+		case formula_value::kind_t::number: return to_string( value.number );
+		case formula_value::kind_t::error: return to_string( value.error );
+		default: return "kind " + std::to_string( static_cast<int>( value.kind ) );
+		}
+	}
+
+	std::string run( std::string const & text ) {
+		daw::parser::sheetrock::flat_ast arena;
+		auto const parsed = daw::parser::sheetrock::parse_formula( text, arena );
+		BOOST_REQUIRE_MESSAGE( parsed, text << ": " << (parsed.error.message ? parsed.error.message : "") );
+		return describe( evaluate( compile_formula( arena, parsed.root ), empty_resolver{ } ) );
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( arithmetic ) {
+	BOOST_CHECK_EQUAL( run( "=1+2*3" ), "7" );
+	BOOST_CHECK_EQUAL( run( "=2^10" ), "1024" );
+	BOOST_CHECK_EQUAL( run( "=7%3" ), "1" );
+	BOOST_CHECK_EQUAL( run( "=9^0.5" ), "3" );
+}
+
+BOOST_AUTO_TEST_CASE( division_by_zero ) {
+	BOOST_CHECK_EQUAL( run( "=1/0" ), "#DIV/0!" );
+	BOOST_CHECK_EQUAL( run( "=5%0" ), "#DIV/0!" );
+	BOOST_CHECK_EQUAL( run( "=0^-1" ), "#DIV/0!" );
+	BOOST_CHECK_EQUAL( run( "=0^(0-2.5)" ), "#DIV/0!" );
+	BOOST_CHECK_EQUAL( run( "=0^0" ), "1" );
+}
+
+BOOST_AUTO_TEST_CASE( non_finite_results_are_num_errors ) {
+	BOOST_CHECK_EQUAL( run( "=(-8)^(1/3)" ), "#NUM!" );
+	BOOST_CHECK_EQUAL( run( "=10^1000000000" ), "#NUM!" );
+	BOOST_CHECK_EQUAL( run( "=(10^1000000000)+1" ), "#NUM!" );
+	BOOST_CHECK_EQUAL( run( "=(-2)^3" ), "-8" );
+}
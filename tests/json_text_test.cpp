@@ -0,0 +1,191 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE json_text
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "json_text.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+	using token = json_pull_reader::token;
+	using token_list = std::vector<std::pair<token, std::string>>;
+
+	/// The minimum buffer json_pull_reader uses, enough for a surrogate pair escape
+	size_t const min_buffer_size = 12;
+
+	/// Walks a value with json_reader, which holds the whole text, as the tokens
+	/// json_pull_reader should return
+	void reference_value( json_reader & in, token_list & out ) {
+		switch( in.peek( ) ) {
+		case '{':
+			in.expect( '{' );
+			out.emplace_back( token::begin_object, std::string{ } );
+			for( bool first = true; in.more( '}', first ); ) {
+				out.emplace_back( token::key, in.read_string( ) );
+				in.expect( ':' );
+				reference_value( in, out );
+			}
+			out.emplace_back( token::end_object, std::string{ } );
+			return;
+		case '[':
+			in.expect( '[' );
+			out.emplace_back( token::begin_array, std::string{ } );
+			for( bool first = true; in.more( ']', first ); ) {
+				reference_value( in, out );
+			}
+			out.emplace_back( token::end_array, std::string{ } );
+			return;
+		case '"':
+			out.emplace_back( token::string, in.read_string( ) );
+			return;
+		default:
+			out.emplace_back( token::number, std::to_string( in.read_unsigned( ) ) );
+			return;
+		}
+	}
+
+	token_list reference_tokens( std::string const & text ) {
+		json_reader in{ text };
+		token_list result;
+		reference_value( in, result );
+		BOOST_REQUIRE( in.at_end( ) );
+		return result;
+	}
+
+	token_list pull_tokens( json_pull_reader & in ) {
+		token_list result;
+		for( auto tok = in.next( ); tok != token::end; tok = in.next( ) ) {
+			auto const has_text = tok == token::key || tok == token::string || tok == token::number || tok == token::literal;
+			result.emplace_back( tok, has_text ? in.text( ) : std::string{ } );
+		}
+		return result;
+	}
+
+	/// A file descriptor reading text, closed when the test ends
+	struct text_file {
+		std::FILE * file;
+
+		explicit text_file( std::string const & text ):
+				file{ std::tmpfile( ) } {
+
+			BOOST_REQUIRE( file != nullptr );
+			BOOST_REQUIRE_EQUAL( std::fwrite( text.data( ), 1, text.size( ), file ), text.size( ) );
+			BOOST_REQUIRE_EQUAL( std::fflush( file ), 0 );
+			BOOST_REQUIRE_EQUAL( ::lseek( fd( ), 0, SEEK_SET ), 0 );
+		}
+
+		~text_file( ) {
+			std::fclose( file );
+		}
+
+		text_file( text_file const & ) = delete;
+		text_file & operator=( text_file const & ) = delete;
+
+		int fd( ) const {
+			return ::fileno( file );
+		}
+	};	// text_file
+
+	/// Reads text with every buffer size from the minimum to past its length, from a
+	/// stream and from a file descriptor, so each escape is cut by a refill somewhere
+	void check_every_buffer_size( std::string const & text ) {
+		auto const expected = reference_tokens( text );
+		for( auto buffer_size = min_buffer_size - 4; buffer_size <= text.size( ) + 2; ++buffer_size ) {
+			std::istringstream stream{ text };
+			json_pull_reader from_stream{ stream, buffer_size };
+			BOOST_REQUIRE_MESSAGE( pull_tokens( from_stream ) == expected, "stream, buffer_size " << buffer_size << ": " << text );
+
+			text_file const file{ text };
+			json_pull_reader from_fd{ file.fd( ), buffer_size };
+			BOOST_REQUIRE_MESSAGE( pull_tokens( from_fd ) == expected, "fd, buffer_size " << buffer_size << ": " << text );
+		}
+	}
+
+	std::string random_string( std::mt19937_64 & rng ) {
+		static char const * const s_pieces[] = { "a", "text", " ", "\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t", "\\u00e9", "\\u20AC", "\\uD83D\\uDE00", "\\ud834\\udd1e", "\xc3\xa9" };
+		std::string result = "\"";
+		for( auto count = rng( ) % 8; count > 0; --count ) {
+			result += s_pieces[rng( ) % (sizeof( s_pieces ) / sizeof( s_pieces[0] ))];
+		}
+		return result + "\"";
+	}
+
+	std::string random_value( std::mt19937_64 & rng, int depth ) {
+		auto const pick = depth > 3 ? rng( ) % 2 : rng( ) % 4;
+		switch( pick ) {
+		case 0: return random_string( rng );
+		case 1: return std::to_string( rng( ) % 100000 );
+		case 2: {
+				std::string result = "{";
+				for( auto count = rng( ) % 4; count > 0; --count ) {
+					result += random_string( rng ) + (rng( ) % 2 == 0 ? ":" : " : ") + random_value( rng, depth + 1 ) + (count > 1 ? "," : "");
+				}
+				return result + "}";
+			}
+		default: {
+				std::string result = "[ ";
+				for( auto count = rng( ) % 4; count > 0; --count ) {
+					result += random_value( rng, depth + 1 ) + (count > 1 ? ", " : "");
+				}
+				return result + " ]";
+			}
+		}
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( escapes_cross_refills ) {
+	check_every_buffer_size( R"({"name":"quote \" backslash \\ slash \/ controls \b\f\n\r\t end","accent":"caf\u00e9","euro":"\u20AC","emoji":"\uD83D\uDE00","clef":"x\ud834\udd1ey"})" );
+	// Escapes back to back, and a pair at the very end of a string
+	check_every_buffer_size( R"(["\uD83D\uDE00\uD83D\uDE00\n\u00e9\\","\"","\uD83D\uDE00"])" );
+}
+
+BOOST_AUTO_TEST_CASE( nested_objects_cross_refills ) {
+	check_every_buffer_size( R"({"a":{"b":{"c":[1,2,{"d":"e"},[]],"f":{}},"g":[[["deep"]]]},"h":12345678901234})" );
+	check_every_buffer_size( "{ \"spaced\" :\n\t[ 1 ,\r\n 2 ] , \"key\" : \"value\" }" );
+}
+
+BOOST_AUTO_TEST_CASE( random_documents_match_json_reader ) {
+	std::mt19937_64 rng{ 7 };
+	for( int n = 0; n < 60; ++n ) {
+		check_every_buffer_size( "{\"root\":" + random_value( rng, 0 ) + "}" );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( truncated_escapes_are_rejected ) {
+	for( std::string const text: { R"(["\u12)", R"(["\)", R"(["\uD83D\uDE)", R"(["unterminated)" } ) {
+		for( auto buffer_size = min_buffer_size; buffer_size <= text.size( ) + 2; ++buffer_size ) {
+			std::istringstream stream{ text };
+			json_pull_reader in{ stream, buffer_size };
+			BOOST_CHECK( in.next( ) == token::begin_array );
+			BOOST_CHECK_THROW( in.next( ), std::invalid_argument );
+		}
+	}
+}
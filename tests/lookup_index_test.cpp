@@ -0,0 +1,147 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE lookup_index
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lookup_index.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+
+	/// A column of a sheet, rows holding formulas are read through value_of like the others
+	struct column_model {
+		std::vector<formula_value> values;
+		std::vector<bool> formulas;
+
+		explicit column_model( size_t rows ):
+				values( rows ),
+				formulas( rows, false ) { }
+
+		formula_value value( cell_address const & cell ) const {
+			return values[cell.row];
+		}
+	};	// column_model
+
+	/// Few distinct values so that rows share them, with text differing only in case
+	formula_value random_value( std::mt19937_64 & rng ) {
+		switch( rng( ) % 8 ) {
+		case 0: return formula_value{ };
+		case 1: return formula_value::from_boolean( rng( ) % 2 == 0 );
+		case 2:
+		case 3: return formula_value::from_string( std::string{ "key" } + (rng( ) % 2 == 0 ? "a" : "A") + std::to_string( rng( ) % 6 ) );
+		default: return formula_value::from_number( number::big_num_t{ static_cast<int64_t>( rng( ) % 12 ) - 4 } );
+		}
+	}
+
+	void set_row( lookup_index & index, column_model & column, lookup_index::row_t row, formula_value value, bool is_formula ) {
+		if( column.formulas[row] ) {
+			index.remove_formula( row );
+		} else {
+			index.remove( row, column.values[row] );
+		}
+		column.values[row] = std::move( value );
+		column.formulas[row] = is_formula;
+		if( is_formula ) {
+			index.add_formula( row );
+		} else {
+			index.add( row, column.values[row] );
+		}
+	}
+
+	void check_match( lookup_index const & index, column_model const & column, formula_value const & key, int match_type, lookup_index::row_t first, lookup_index::row_t last ) {
+		size_t reads = 0;
+		auto const found = index.match( key, match_type, first, last, [&]( lookup_index::row_t row ) {
+			++reads;
+			return column.values[row];
+		} );
+		auto const expected = impl::linear_match( column, cell_range{ cell_address{ first, 0 }, cell_address{ last, 0 } }, key, match_type );
+		BOOST_REQUIRE_MESSAGE( found == expected, "match_type " << match_type << " rows " << first << " to " << last << ": " << found << " != " << expected );
+		// The index never reads more rows than a scan of the range
+		BOOST_REQUIRE_LE( reads, static_cast<size_t>( last - first ) + 1 );
+	}
+
+	void check_random_edits( std::vector<lookup_index_kind> const & kinds, uint64_t seed ) {
+		std::mt19937_64 rng{ seed };
+		size_t const rows = 300;
+		lookup_index index;
+		for( auto kind: kinds ) {
+			index.enable( kind );
+		}
+		column_model column{ rows };
+		for( size_t step = 0; step < 4000; ++step ) {
+			auto const row = static_cast<lookup_index::row_t>( rng( ) % rows );
+			if( column.formulas[row] && rng( ) % 2 == 0 ) {
+				// A recalculation changes the result without touching the index
+				column.values[row] = random_value( rng );
+			} else {
+				set_row( index, column, row, random_value( rng ), rng( ) % 10 == 0 );
+			}
+			for( size_t query = 0; query < 4; ++query ) {
+				auto first = static_cast<lookup_index::row_t>( rng( ) % rows );
+				auto const length = rng( ) % 3 == 0 ? rng( ) % 4 : rng( ) % rows;
+				auto const last = static_cast<lookup_index::row_t>( std::min<size_t>( first + length, rows - 1 ) );
+				auto const key = random_value( rng );
+				for( int match_type = -1; match_type <= 1; ++match_type ) {
+					if( index.can_match( match_type ) ) {
+						check_match( index, column, key, match_type, first, last );
+					}
+				}
+			}
+		}
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( hash_index_matches_linear_match ) {
+	check_random_edits( { lookup_index_kind::hash }, 1 );
+}
+
+BOOST_AUTO_TEST_CASE( sorted_index_matches_linear_match ) {
+	check_random_edits( { lookup_index_kind::sorted }, 2 );
+}
+
+BOOST_AUTO_TEST_CASE( both_indexes_match_linear_match ) {
+	check_random_edits( { lookup_index_kind::hash, lookup_index_kind::sorted }, 3 );
+}
+
+BOOST_AUTO_TEST_CASE( small_range_of_a_large_index ) {
+	// Every row but the range holds the key, so the sorted walks pass the whole index
+	// before reaching the range unless they give up and scan it
+	size_t const rows = 20000;
+	lookup_index index;
+	index.enable( lookup_index_kind::sorted );
+	column_model column{ rows };
+	for( size_t row = 0; row < rows; ++row ) {
+		auto const in_range = row >= 10000 && row < 10010;
+		set_row( index, column, static_cast<lookup_index::row_t>( row ), formula_value::from_number( number::big_num_t{ in_range ? static_cast<int64_t>( row % 3 ) : 1 } ), false );
+	}
+	for( int match_type = -1; match_type <= 1; ++match_type ) {
+		for( int64_t key = -1; key <= 3; ++key ) {
+			check_match( index, column, formula_value::from_number( number::big_num_t{ key } ), match_type, 10000, 10009 );
+		}
+	}
+}
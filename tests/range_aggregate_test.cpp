@@ -0,0 +1,182 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#define BOOST_TEST_MODULE range_aggregate
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "column_store.h"
+#include "range_aggregate.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+	using expected_value_t = impl::column_store::expected_value_t;
+
+	formula_function const all_functions[] = { formula_function::sum, formula_function::average, formula_function::min, formula_function::max, formula_function::count };
+
+	std::vector<simd_level> available_levels( ) {
+		std::vector<simd_level> result;
+		for( auto level: { simd_level::scalar, simd_level::sse42, simd_level::avx2 } ) {
+			if( level <= supported_simd_level( ) ) {
+				result.push_back( level );
+			}
+		}
+		return result;
+	}
+
+	/// Restores the supported kernel set when a test case ends
+	struct level_guard {
+		~level_guard( ) {
+			set_simd_level( supported_simd_level( ) );
+		}
+	};	// level_guard
+
+	std::string describe( formula_value const & value ) {
+		switch( value.kind ) {
+		case formula_value::kind_t::number: return to_string( value.number );
+		case formula_value::kind_t::error: return "error " + to_string( value.error );
+		default: return "kind " + std::to_string( static_cast<int>( value.kind ) );
+		}
+	}
+
+	/// The aggregate of the valid numbers in the range, computed row by row
+	formula_value reference( impl::column_store const & store, formula_function function, size_t first_row, size_t row_count ) {
+		number::big_num_t total{ };
+		number::big_num_t selected{ };
+		size_t count = 0;
+		store.for_each_number( [&]( size_t row, number::big_num_t const & value ) {
+			if( row < first_row || row - first_row >= row_count ) {
+				return;
+			}
+			total += value;
+			if( count == 0 || (function == formula_function::min ? value < selected : selected < value) ) {
+				selected = value;
+			}
+			++count;
+		} );
+		switch( function ) {
+		case formula_function::sum: return formula_value::from_number( total );
+		case formula_function::count: return formula_value::from_number( number::big_num_t{ count } );
+		case formula_function::average:
+			if( count == 0 ) {
+				return formula_value::from_error( formula_error::div_zero );
+			}
+			return formula_value::from_number( total / number::big_num_t{ count } );
+		default: return formula_value::from_number( selected );
+		}
+	}
+
+	/// Integers, decimals, numbers too big or too precise for the lane, text and gaps
+	impl::column_store mixed_column( size_t rows ) {
+		std::mt19937 engine{ 12345 };
+		impl::column_store result;
+		for( size_t row = 0; row < rows; ++row ) {
+			auto const value = static_cast<int64_t>( engine( ) % 2000001 ) - 1000000;
+			switch( engine( ) % 8 ) {
+			case 0: result.push_back( expected_value_t::Number, std::to_string( value ) ); break;
+			case 1: result.push_back( expected_value_t::Number, std::to_string( value ) + ".25" ); break;
+			case 2: result.push_back( expected_value_t::Number, std::to_string( value ) + ".000001" ); break;
+			case 3: result.push_back( expected_value_t::Number, std::to_string( value ) + ".123456789" ); break;
+			case 4: result.push_back( expected_value_t::Number, std::to_string( value ) + "000000000000000000000" ); break;
+			case 5: result.push_back( expected_value_t::Number, "not a number" ); break;
+			case 6: result.push_back( expected_value_t::Text, std::to_string( value ) ); break;
+			default: result.push_back( expected_value_t::General, "" ); break;
+			}
+		}
+		return result;
+	}
+
+	void check_levels_agree( impl::column_store const & store, size_t first_row, size_t row_count ) {
+		level_guard const guard{ };
+		for( auto function: all_functions ) {
+			auto const expected = describe( reference( store, function, first_row, row_count ) );
+			for( auto level: available_levels( ) ) {
+				set_simd_level( level );
+				BOOST_TEST_CONTEXT( "function " << static_cast<int>( function ) << " level " << static_cast<int>( level ) << " rows [" << first_row << ", +" << row_count << ")" ) {
+					BOOST_CHECK_EQUAL( describe( aggregate_value( store, function, first_row, row_count ) ), expected );
+				}
+			}
+		}
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( levels_agree_on_masked_partial_blocks ) {
+	auto const store = mixed_column( 1000 );
+	for( size_t first_row: { 0, 1, 3, 63, 64, 65, 127, 500 } ) {
+		for( size_t row_count: { 0, 1, 2, 7, 63, 64, 65, 129, 200, 1000 } ) {
+			check_levels_agree( store, first_row, row_count );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( levels_agree_past_the_end ) {
+	// 1000 rows ends part way through a block, ranges running past it are clipped
+	auto const store = mixed_column( 1000 );
+	check_levels_agree( store, 960, 1000 );
+	check_levels_agree( store, 999, 5 );
+	check_levels_agree( store, 1000, 5 );
+	check_levels_agree( store, 5000, 5 );
+}
+
+BOOST_AUTO_TEST_CASE( lane_sum_overflows_into_big_num ) {
+	impl::column_store store;
+	for( size_t row = 0; row < 300; ++row ) {
+		store.push_back( expected_value_t::Number, row % 3 == 2 ? "-4000000000000000000" : "4000000000000000000" );
+	}
+	check_levels_agree( store, 0, 300 );
+	check_levels_agree( store, 1, 100 );
+	level_guard const guard{ };
+	for( auto level: available_levels( ) ) {
+		set_simd_level( level );
+		BOOST_CHECK_EQUAL( describe( aggregate_value( store, formula_function::sum, 0, 300 ) ), "400000000000000000000" );
+		BOOST_CHECK_EQUAL( describe( aggregate_value( store, formula_function::sum, 0, 2 ) ), "8000000000000000000" );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( average_of_nothing_is_div_zero ) {
+	impl::column_store store;
+	store.push_back( expected_value_t::Text, "1" );
+	store.push_back( expected_value_t::General, "" );
+	store.push_back( expected_value_t::Number, "one" );
+	store.push_back( expected_value_t::Number, "2" );
+	level_guard const guard{ };
+	for( auto level: available_levels( ) ) {
+		set_simd_level( level );
+		BOOST_CHECK_EQUAL( describe( aggregate_value( store, formula_function::average, 0, 3 ) ), describe( formula_value::from_error( formula_error::div_zero ) ) );
+		BOOST_CHECK_EQUAL( describe( aggregate_value( store, formula_function::average, 0, 0 ) ), describe( formula_value::from_error( formula_error::div_zero ) ) );
+		BOOST_CHECK_EQUAL( describe( aggregate_value( impl::column_store{ }, formula_function::average, 0, 10 ) ), describe( formula_value::from_error( formula_error::div_zero ) ) );
+		BOOST_CHECK_EQUAL( describe( aggregate_value( store, formula_function::average, 0, 4 ) ), "2" );
+		BOOST_CHECK_EQUAL( describe( aggregate_value( store, formula_function::count, 0, 3 ) ), "0" );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( set_simd_level_is_capped ) {
+	level_guard const guard{ };
+	set_simd_level( simd_level::avx2 );
+	BOOST_CHECK( active_simd_level( ) == supported_simd_level( ) );
+	set_simd_level( simd_level::scalar );
+	BOOST_CHECK( active_simd_level( ) == simd_level::scalar );
+}
@@ -0,0 +1,256 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE row_view
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "row_view.h"
+#include "sheet.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+
+	sheet make_sheet( recalc_options options = recalc_options{ } ) {
+		return sheet{ daw::nodepp::base::create_event_emitter( ), options };
+	}
+
+	cell_address at( size_t row, size_t column ) {
+		return cell_address{ static_cast<cell_address::index_t>( row ), static_cast<cell_address::index_t>( column ) };
+	}
+
+	/// Numbers with and without an exact double, text sharing long prefixes and differing
+	/// in case, booleans and empty cells
+	std::string random_text( std::mt19937_64 & rng ) {
+		static char const * const s_texts[] = { "apple", "Apple", "APPLESAUCE jar", "applesauce Jar", "applesauce jars", "banana", "b", "zebra crossing", "Zebra crossing!" };
+		static char const * const s_numbers[] = { "12345678901234567.25", "12345678901234567.5", "1e30", "-1e30", "0.1", "-0.1", "0" };
+		switch( rng( ) % 10 ) {
+		case 0: return std::string{ };
+		case 1: return rng( ) % 2 == 0 ? "true" : "FALSE";
+		case 2:
+		case 3: return s_texts[rng( ) % (sizeof( s_texts ) / sizeof( s_texts[0] ))];
+		case 4: return s_numbers[rng( ) % (sizeof( s_numbers ) / sizeof( s_numbers[0] ))];
+		case 5: return std::to_string( static_cast<int64_t>( rng( ) % 2001 ) - 1000 ) + "." + std::to_string( rng( ) % 100 );
+		default: return std::to_string( static_cast<int64_t>( rng( ) % 41 ) - 20 );
+		}
+	}
+
+	/// Column 0 and 1 hold random cells, column 2 formulas over column 0 giving numbers,
+	/// errors for text and booleans, column 3 more random cells
+	sheet random_sheet( size_t rows, bool exact_numbers, uint64_t seed ) {
+		std::mt19937_64 rng{ seed };
+		recalc_options options{ };
+		options.lazy = true;
+		auto result = make_sheet( options );
+		result.begin_transaction( );
+		for( size_t row = 0; row < rows; ++row ) {
+			for( size_t column: { 0, 1, 3 } ) {
+				auto text = random_text( rng );
+				if( exact_numbers && text.find( "12345678901234567" ) != std::string::npos ) {
+					text = "7";
+				}
+				if( !text.empty( ) ) {
+					result.set_value( at( row, column ), text );
+				}
+			}
+			switch( rng( ) % 4 ) {
+			case 0: break;
+			case 1: result.set_value( at( row, 2 ), "=1/0" ); break;
+			default: result.set_value( at( row, 2 ), "=A" + std::to_string( row + 1 ) + "*2" ); break;
+			}
+		}
+		result.commit( );
+		return result;
+	}
+
+	int rank( formula_value const & value ) {
+		switch( value.kind ) {
+		case formula_value::kind_t::number: return 0;
+		case formula_value::kind_t::string: return 3;
+		case formula_value::kind_t::boolean: return 4;
+		case formula_value::kind_t::error: return 5;
+		default: return 6;
+		}
+	}
+
+	int compare_folded( std::string const & lhs, std::string const & rhs ) {
+		auto const fold = []( char c ) {
+			return c >= 'A' && c <= 'Z' ? static_cast<char>( c - 'A' + 'a' ) : c;
+		};
+		for( size_t n = 0; n < lhs.size( ) && n < rhs.size( ); ++n ) {
+			auto const l = static_cast<unsigned char>( fold( lhs[n] ) );
+			auto const r = static_cast<unsigned char>( fold( rhs[n] ) );
+			if( l != r ) {
+				return l < r ? -1 : 1;
+			}
+		}
+		return lhs.size( ) == rhs.size( ) ? 0 : (lhs.size( ) < rhs.size( ) ? -1 : 1);
+	}
+
+	/// The order sort_rows documents, written plainly over the values of the cells
+	int compare_values( formula_value const & lhs, formula_value const & rhs ) {
+		if( rank( lhs ) != rank( rhs ) ) {
+			return rank( lhs ) < rank( rhs ) ? -1 : 1;
+		}
+		switch( lhs.kind ) {
+		case formula_value::kind_t::number: {
+				auto const order = lhs.number.compare( rhs.number );
+				return order < 0 ? -1 : (order > 0 ? 1 : 0);
+			}
+		case formula_value::kind_t::string: return compare_folded( lhs.text, rhs.text );
+		case formula_value::kind_t::boolean: return static_cast<int>( lhs.boolean ) - static_cast<int>( rhs.boolean );
+		case formula_value::kind_t::error: return static_cast<int>( lhs.error ) - static_cast<int>( rhs.error );
+		default: return 0;
+		}
+	}
+
+	std::vector<cell_address::index_t> reference_sort( sheet & source, std::vector<cell_address::index_t> rows, std::vector<sort_key> const & keys ) {
+		source.evaluate( cell_range{ at( 0, 0 ), at( source.row_count( ) - 1, source.column_count( ) - 1 ) } );
+		std::stable_sort( rows.begin( ), rows.end( ), [&]( cell_address::index_t lhs, cell_address::index_t rhs ) {
+			for( auto const & key: keys ) {
+				auto const l = source.value( at( lhs, key.column ) );
+				auto const r = source.value( at( rhs, key.column ) );
+				auto const l_empty = l.kind == formula_value::kind_t::empty;
+				auto const r_empty = r.kind == formula_value::kind_t::empty;
+				if( l_empty || r_empty ) {
+					if( l_empty != r_empty ) {
+						return r_empty;
+					}
+					continue;
+				}
+				auto const order = compare_values( l, r );
+				if( order != 0 ) {
+					return key.ascending ? order < 0 : order > 0;
+				}
+			}
+			return false;
+		} );
+		return rows;
+	}
+
+	void check_sort( size_t rows, bool exact_numbers, std::vector<sort_key> const & keys, bool sub_view, uint64_t seed ) {
+		for( size_t threads: { 1, 4 } ) {
+			thread_pool pool{ threads };
+			auto source = random_sheet( rows, exact_numbers, seed );
+			row_view view{ source.row_count( ) };
+			if( sub_view ) {
+				std::mt19937_64 rng{ seed };
+				auto order = view.rows( );
+				std::shuffle( order.begin( ), order.end( ), rng );
+				order.resize( order.size( ) / 2 );
+				view = row_view{ order, source.row_count( ) };
+			}
+			auto const sorted = sort_rows( source, view, keys, pool );
+			auto const expected = reference_sort( source, view.rows( ), keys );
+			BOOST_REQUIRE_EQUAL( sorted.source_rows( ), source.row_count( ) );
+			BOOST_REQUIRE( sorted.rows( ) == expected );
+		}
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( ascending_sort_matches_stable_sort ) {
+	check_sort( 500, true, { sort_key{ 0 } }, false, 1 );
+	check_sort( 500, false, { sort_key{ 0 } }, false, 2 );
+}
+
+BOOST_AUTO_TEST_CASE( descending_sort_matches_stable_sort ) {
+	check_sort( 500, true, { sort_key{ 1, false } }, false, 3 );
+	check_sort( 500, false, { sort_key{ 0, false } }, true, 4 );
+}
+
+BOOST_AUTO_TEST_CASE( multiple_keys_match_stable_sort ) {
+	check_sort( 500, false, { sort_key{ 1 }, sort_key{ 0, false }, sort_key{ 3 } }, false, 5 );
+	check_sort( 500, true, { sort_key{ 3, false }, sort_key{ 1 } }, true, 6 );
+}
+
+BOOST_AUTO_TEST_CASE( formula_keys_match_stable_sort ) {
+	check_sort( 500, true, { sort_key{ 2 } }, false, 7 );
+	check_sort( 500, false, { sort_key{ 2, false }, sort_key{ 1 } }, true, 8 );
+}
+
+BOOST_AUTO_TEST_CASE( large_sort_merges_runs ) {
+	// Past the run length of a block, so the parallel merge passes run
+	check_sort( 9000, false, { sort_key{ 0 }, sort_key{ 1, false } }, false, 9 );
+	check_sort( 9000, true, { sort_key{ 2, false } }, true, 10 );
+}
+
+BOOST_AUTO_TEST_CASE( filter_rows_keeps_view_order ) {
+	thread_pool pool{ 4 };
+	auto source = random_sheet( 9000, false, 11 );
+	row_view const view{ source.row_count( ) };
+	auto const positive = []( formula_value const & value ) {
+		return value.kind == formula_value::kind_t::number && number::big_num_t{ } < value.number;
+	};
+	auto const kept = filter_rows( source, view, 2, positive, pool );
+	std::vector<cell_address::index_t> expected;
+	for( auto const row: view.rows( ) ) {
+		if( positive( source.value( at( row, 2 ) ) ) ) {
+			expected.push_back( row );
+		}
+	}
+	BOOST_CHECK( kept.rows( ) == expected );
+}
+
+BOOST_AUTO_TEST_CASE( reorder_rows_moves_cells_and_formulas ) {
+	auto source = make_sheet( );
+	size_t const rows = 50;
+	for( size_t row = 0; row < rows; ++row ) {
+		source.set_value( at( row, 0 ), std::to_string( (row * 37) % rows ) );
+		source.set_value( at( row, 1 ), "=A" + std::to_string( row + 1 ) + "*2" );
+		source.set_value( at( row, 2 ), "=$A$1" );
+	}
+	std::vector<std::string> before;
+	for( size_t row = 0; row < rows; ++row ) {
+		before.push_back( source.string_value( at( row, 0 ) ).to_string( ) );
+	}
+	thread_pool pool{ 4 };
+	auto const view = sort_rows( source, { sort_key{ 0, false } }, pool );
+	source.reorder_rows( view );
+
+	for( size_t row = 0; row < rows; ++row ) {
+		auto const & moved = before[view.source_row( row )];
+		BOOST_CHECK_EQUAL( source.string_value( at( row, 0 ) ), moved );
+		// Relative references moved with their row, anchored ones stayed on A1
+		BOOST_CHECK_EQUAL( source.string_value( at( row, 1 ) ), "=A" + std::to_string( row + 1 ) + "*2" );
+		BOOST_CHECK( source.value( at( row, 1 ) ).number == number::big_num_t{ moved } * number::big_num_t{ 2 } );
+		BOOST_CHECK_EQUAL( source.string_value( at( row, 2 ) ), "=$A$1" );
+		BOOST_CHECK( source.value( at( row, 2 ) ).number == number::big_num_t{ before[view.source_row( 0 )] } );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( reorder_rows_rejects_bad_views ) {
+	auto source = make_sheet( );
+	for( size_t row = 0; row < 4; ++row ) {
+		source.set_value( at( row, 0 ), std::to_string( row ) );
+	}
+	BOOST_CHECK_THROW( source.reorder_rows( row_view{ { 1, 0, 1 }, 4 } ), std::invalid_argument );
+	BOOST_CHECK_THROW( source.reorder_rows( row_view{ 3 } ), std::invalid_argument );
+	// Nothing moved
+	for( size_t row = 0; row < 4; ++row ) {
+		BOOST_CHECK_EQUAL( source.string_value( at( row, 0 ) ), std::to_string( row ) );
+	}
+}
@@ -0,0 +1,189 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#define BOOST_TEST_MODULE sheet_snapshot
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "json_text.h"
+#include "sheet.h"
+#include "sheet_snapshot.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+
+	sheet make_sheet( ) {
+		return sheet{ daw::nodepp::base::create_event_emitter( ) };
+	}
+
+	/// The JSON of a sheet without the ids, which differ between sheets
+	std::string to_json( sheet const & source ) {
+		std::ostringstream out;
+		{
+			json_writer writer{ out };
+			source.write( writer );
+		}
+		return std::regex_replace( out.str( ), std::regex{ "\"id\":[0-9]+" }, "\"id\":0" );
+	}
+
+	/// A snapshot path removed when the test ends
+	struct temp_file {
+		std::string path;
+
+		temp_file( ):
+				path{ (boost::filesystem::temp_directory_path( ) / boost::filesystem::unique_path( "sheet_snapshot_test_%%%%%%%%.snap" )).string( ) } { }
+
+		~temp_file( ) {
+			boost::system::error_code ec;
+			boost::filesystem::remove( path, ec );
+		}
+
+		std::string contents( ) const {
+			std::ifstream in{ path, std::ios::binary };
+			return std::string{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{ } };
+		}
+
+		void overwrite( size_t offset, char value ) const {
+			std::fstream out{ path, std::ios::binary | std::ios::in | std::ios::out };
+			out.seekp( static_cast<std::streamoff>( offset ) );
+			out.put( value );
+			BOOST_REQUIRE( out.good( ) );
+		}
+	};	// temp_file
+
+	sheet sample_sheet( ) {
+		auto result = make_sheet( );
+		result.set_value( cell_address{ 0, 0 }, "1" );
+		result.set_value( cell_address{ 1, 0 }, "2.5" );
+		result.set_value( cell_address{ 4, 0 }, "-7" );
+		result.set_value( cell_address{ 0, 1 }, "=SUM(A1:A5)" );
+		result.set_value( cell_address{ 1, 1 }, "quote \" unicode \xc3\xa9 control \x01 end" );
+		result.set_value( cell_address{ 2, 1 }, "a piece of text long enough to live in the string pool" );
+		result.set_value( cell_address{ 0, 2 }, "true" );
+		result.set_value( cell_address{ 2, 2 }, "20160101T101010" );
+		result.set_value( cell_address{ 3, 2 }, impl::cell_value::expected_value_t::Text, "42" );
+		result.resize( 4 );
+		return result;
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( snapshot_round_trips_through_json ) {
+	auto const source = sample_sheet( );
+	temp_file const file{ };
+	write_snapshot( source, file.path );
+
+	sheet_snapshot const snapshot{ file.path };
+	BOOST_CHECK( snapshot.verify( ) );
+	BOOST_REQUIRE_EQUAL( snapshot.column_count( ), source.column_count( ) );
+	for( size_t column = 0; column < source.column_count( ); ++column ) {
+		auto const & store = source.column( column ).store( );
+		BOOST_REQUIRE_EQUAL( snapshot.row_count( column ), store.size( ) );
+		for( size_t row = 0; row < store.size( ); ++row ) {
+			cell_address const cell{ static_cast<cell_address::index_t>( row ), static_cast<cell_address::index_t>( column ) };
+			BOOST_CHECK_EQUAL( snapshot.string_value( cell ), store.string_value( row ) );
+			BOOST_CHECK( snapshot.value_type( cell ) == store.value_type( row ) );
+		}
+	}
+
+	auto loaded = make_sheet( );
+	snapshot.load( loaded );
+	BOOST_CHECK_EQUAL( to_json( loaded ), to_json( source ) );
+	BOOST_CHECK_EQUAL( to_string( loaded.value( cell_address{ 0, 1 } ).number ), "-3.5" );
+
+	// The JSON read back agrees with the snapshot
+	std::istringstream json{ to_json( source ) };
+	auto from_json = make_sheet( );
+	{
+		json_pull_reader reader{ json };
+		from_json.read( reader );
+	}
+	BOOST_CHECK_EQUAL( to_json( from_json ), to_json( loaded ) );
+}
+
+BOOST_AUTO_TEST_CASE( empty_sheet_round_trips ) {
+	auto const source = make_sheet( );
+	temp_file const file{ };
+	write_snapshot( source, file.path );
+	sheet_snapshot const snapshot{ file.path };
+	BOOST_CHECK_EQUAL( snapshot.column_count( ), 0u );
+	auto loaded = make_sheet( );
+	snapshot.load( loaded );
+	BOOST_CHECK_EQUAL( to_json( loaded ), to_json( source ) );
+}
+
+BOOST_AUTO_TEST_CASE( many_columns_round_trip ) {
+	// The header and directory padded before the first column span far more than one
+	// section alignment
+	auto source = make_sheet( );
+	size_t const column_count = 5000;
+	source.resize( column_count );
+	for( size_t column = 0; column < column_count; column += 7 ) {
+		source.set_value( cell_address{ static_cast<cell_address::index_t>( column % 3 ), static_cast<cell_address::index_t>( column ) }, std::to_string( column ) );
+	}
+	temp_file const file{ };
+	write_snapshot( source, file.path );
+
+	sheet_snapshot const snapshot{ file.path };
+	BOOST_CHECK( snapshot.verify( ) );
+	BOOST_REQUIRE_EQUAL( snapshot.column_count( ), column_count );
+	for( size_t column = 0; column < column_count; column += 7 ) {
+		BOOST_CHECK_EQUAL( snapshot.string_value( cell_address{ static_cast<cell_address::index_t>( column % 3 ), static_cast<cell_address::index_t>( column ) } ), std::to_string( column ) );
+	}
+	auto loaded = make_sheet( );
+	snapshot.load( loaded );
+	BOOST_CHECK_EQUAL( to_json( loaded ), to_json( source ) );
+}
+
+BOOST_AUTO_TEST_CASE( corrupt_section_is_rejected ) {
+	temp_file const file{ };
+	write_snapshot( sample_sheet( ), file.path );
+	// Flip a character in the string heap of the second column
+	auto const position = file.contents( ).find( "long enough" );
+	BOOST_REQUIRE( position != std::string::npos );
+	file.overwrite( position, 'L' );
+
+	sheet_snapshot const snapshot{ file.path };
+	BOOST_CHECK( !snapshot.verify( ) );
+	BOOST_CHECK_EQUAL( snapshot.string_value( cell_address{ 0, 0 } ), "1" );
+	BOOST_CHECK_THROW( snapshot.string_value( cell_address{ 2, 1 } ), std::runtime_error );
+	auto target = make_sheet( );
+	BOOST_CHECK_THROW( snapshot.load( target ), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( bad_magic_is_rejected ) {
+	temp_file const file{ };
+	write_snapshot( sample_sheet( ), file.path );
+	file.overwrite( 0, 'X' );
+	BOOST_CHECK_THROW( sheet_snapshot{ file.path }, std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( missing_file_is_rejected ) {
+	temp_file const file{ };
+	BOOST_CHECK_THROW( sheet_snapshot{ file.path }, std::runtime_error );
+}
@@ -0,0 +1,152 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define BOOST_TEST_MODULE string_pool
+#include <boost/test/unit_test.hpp>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "column_store.h"
+#include "string_pool.h"
+
+namespace {
+	using namespace daw::spreadsheet;
+	using expected_value_t = impl::column_store::expected_value_t;
+
+	/// Long texts are pooled, short ones are held inline in their row
+	std::vector<std::string> const s_texts = { "shipped to customer", "awaiting payment", "SHIPPED TO CUSTOMER", "NZ", "ok", "United Kingdom", "=$F$1*1.15+$G$1" };
+
+	impl::column_store make_store( std::shared_ptr<string_pool> pool, size_t rows, size_t offset ) {
+		impl::column_store result{ std::move( pool ) };
+		for( size_t row = 0; row < rows; ++row ) {
+			result.push_back( expected_value_t::Text, s_texts[(row + offset) % s_texts.size( )] );
+		}
+		return result;
+	}
+
+	size_t long_text_count( ) {
+		size_t result = 0;
+		for( auto const & text: s_texts ) {
+			if( !impl::column_store::is_inline( text ) ) {
+				++result;
+			}
+		}
+		return result;
+	}
+}	// namespace anonymous
+
+BOOST_AUTO_TEST_CASE( equal_texts_share_a_handle ) {
+	string_pool pool;
+	auto const first = pool.intern( "a status code long enough" );
+	auto const second = pool.intern( std::string{ "a status code long enough" } );
+	auto const other = pool.intern( "another status code" );
+	BOOST_CHECK_EQUAL( first, second );
+	BOOST_CHECK_NE( first, other );
+	BOOST_CHECK_EQUAL( pool.size( ), 2u );
+	BOOST_CHECK_EQUAL( pool.text( first ), "a status code long enough" );
+	BOOST_CHECK_EQUAL( pool.intern( "" ), string_pool::empty_handle );
+
+	// The text lives until its last reference is dropped
+	pool.release( first );
+	BOOST_CHECK_EQUAL( pool.size( ), 2u );
+	BOOST_CHECK_EQUAL( pool.text( second ), "a status code long enough" );
+	pool.release( second );
+	pool.release( other );
+	BOOST_CHECK_EQUAL( pool.size( ), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( range_intern_counts_references ) {
+	string_pool pool;
+	std::vector<std::pair<std::string, size_t>> const items = { { "country one", 3 }, { "country two", 1 }, { "country one", 2 }, { "", 4 } };
+	std::vector<string_pool::handle_t> handles;
+	pool.intern( items.begin( ), items.end( ), []( std::pair<std::string, size_t> const & item ) {
+		return boost::string_ref{ item.first };
+	}, []( std::pair<std::string, size_t> const & item ) {
+		return item.second;
+	}, std::back_inserter( handles ) );
+	BOOST_REQUIRE_EQUAL( handles.size( ), 4u );
+	BOOST_CHECK_EQUAL( handles[0], handles[2] );
+	BOOST_CHECK_EQUAL( handles[3], string_pool::empty_handle );
+	BOOST_CHECK_EQUAL( pool.size( ), 2u );
+	for( int n = 0; n < 4; ++n ) {
+		pool.release( handles[0] );
+	}
+	BOOST_CHECK_EQUAL( pool.size( ), 2u );
+	pool.release( handles[0] );
+	pool.release( handles[1] );
+	BOOST_CHECK_EQUAL( pool.size( ), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( columns_share_one_copy_of_each_text ) {
+	auto const pool = std::make_shared<string_pool>( );
+	auto const first = make_store( pool, 1000, 0 );
+	auto const second = make_store( pool, 1000, 3 );
+	BOOST_CHECK_EQUAL( pool->size( ), long_text_count( ) );
+	auto const copy = first;
+	BOOST_CHECK_EQUAL( pool->size( ), long_text_count( ) );
+
+	// Every row holding a long text points at the pool's one copy of it
+	for( size_t row = 0; row < first.size( ); ++row ) {
+		auto const text = first.string_value( row );
+		BOOST_REQUIRE_EQUAL( text, s_texts[row % s_texts.size( )] );
+		BOOST_CHECK( copy.string_value( row ).data( ) == text.data( ) || impl::column_store::is_inline( text ) );
+		if( !impl::column_store::is_inline( text ) ) {
+			auto const handle = pool->intern( text );
+			BOOST_CHECK( pool->text( handle ).data( ) == text.data( ) );
+			pool->release( handle );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( same_text_agrees_with_comparing_text ) {
+	auto const pool = std::make_shared<string_pool>( );
+	auto const first = make_store( pool, 50, 0 );
+	auto const second = make_store( pool, 50, 4 );
+	// Equal text in another pool can only be compared by reading it
+	auto const other_pool = make_store( std::make_shared<string_pool>( ), 50, 2 );
+	for( size_t row = 0; row < first.size( ); ++row ) {
+		for( size_t other_row = 0; other_row < second.size( ); ++other_row ) {
+			BOOST_REQUIRE_EQUAL( first.same_text( row, second, other_row ), first.string_value( row ) == second.string_value( other_row ) );
+			BOOST_REQUIRE_EQUAL( first.same_text( row, other_pool, other_row ), first.string_value( row ) == other_pool.string_value( other_row ) );
+		}
+	}
+	// Text differing only in case is different text
+	BOOST_CHECK( !first.same_text( 0, first, 2 ) );
+}
+
+BOOST_AUTO_TEST_CASE( overwritten_rows_release_their_text ) {
+	auto const pool = std::make_shared<string_pool>( );
+	{
+		auto store = make_store( pool, 100, 0 );
+		for( size_t row = 0; row < store.size( ); ++row ) {
+			if( row % 7 != 0 ) {
+				store.set( row, expected_value_t::Text, "short" );
+			}
+		}
+		// Row 0 of every 7 still holds the first text
+		BOOST_CHECK_EQUAL( pool->size( ), 1u );
+	}
+	BOOST_CHECK_EQUAL( pool->size( ), 0u );
+}
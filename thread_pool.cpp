@@ -0,0 +1,162 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <utility>
+
+#include "thread_pool.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			// Index of the queue owned by the current thread, npos for threads outside of any pool
+			constexpr size_t npos = static_cast<size_t>( -1 );
+			thread_local thread_pool const * t_current_pool = nullptr;
+			thread_local size_t t_current_queue = npos;
+		}	// namespace anonymous
+
+		thread_pool::thread_pool( size_t thread_count ):
+				m_queues{ },
+				m_threads{ },
+				m_sleep_mutex{ },
+				m_sleep_cv{ },
+				m_queued{ 0 },
+				m_next_queue{ 0 },
+				m_stop{ false } {
+
+			if( thread_count == 0 ) {
+				thread_count = std::max<size_t>( std::thread::hardware_concurrency( ), 1 );
+			}
+			// The caller of parallel_for takes part in the work, so one less worker is needed
+			auto const worker_count = thread_count - 1;
+			m_queues.reserve( worker_count );
+			for( size_t n = 0; n < worker_count; ++n ) {
+				m_queues.push_back( std::make_unique<worker_queue>( ) );
+			}
+			m_threads.reserve( worker_count );
+			for( size_t n = 0; n < worker_count; ++n ) {
+				m_threads.emplace_back( [this, n]( ) {
+					worker( n );
+				} );
+			}
+		}
+
+		thread_pool::~thread_pool( ) {
+			{
+				std::lock_guard<std::mutex> lock{ m_sleep_mutex };
+				m_stop = true;
+			}
+			m_sleep_cv.notify_all( );
+			for( auto & thread: m_threads ) {
+				thread.join( );
+			}
+		}
+
+		size_t thread_pool::size( ) const noexcept {
+			return m_threads.size( ) + 1;
+		}
+
+		void thread_pool::add_task( task_t task ) {
+			if( m_queues.empty( ) ) {
+				task( );
+				return;
+			}
+			auto index = t_current_pool == this ? t_current_queue : m_next_queue++ % m_queues.size( );
+			{
+				std::lock_guard<std::mutex> lock{ m_queues[index]->mutex };
+				m_queues[index]->tasks.push_back( std::move( task ) );
+			}
+			{
+				std::lock_guard<std::mutex> lock{ m_sleep_mutex };
+				++m_queued;
+			}
+			m_sleep_cv.notify_one( );
+		}
+
+		bool thread_pool::try_pop( size_t queue_index, task_t & task ) {
+			auto & queue = *m_queues[queue_index];
+			std::lock_guard<std::mutex> lock{ queue.mutex };
+			if( queue.tasks.empty( ) ) {
+				return false;
+			}
+			task = std::move( queue.tasks.back( ) );
+			queue.tasks.pop_back( );
+			--m_queued;
+			return true;
+		}
+
+		bool thread_pool::try_steal( size_t thief_index, task_t & task ) {
+			auto const count = m_queues.size( );
+			for( size_t n = 1; n <= count; ++n ) {
+				auto const victim = (thief_index + n) % count;
+				if( victim == thief_index ) {
+					continue;
+				}
+				auto & queue = *m_queues[victim];
+				std::lock_guard<std::mutex> lock{ queue.mutex };
+				if( !queue.tasks.empty( ) ) {
+					task = std::move( queue.tasks.front( ) );
+					queue.tasks.pop_front( );
+					--m_queued;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool thread_pool::try_run_one( ) {
+			if( m_queues.empty( ) ) {
+				return false;
+			}
+			task_t task;
+			auto const index = t_current_pool == this ? t_current_queue : 0;
+			if( try_pop( index, task ) || try_steal( index, task ) ) {
+				task( );
+				return true;
+			}
+			return false;
+		}
+
+		void thread_pool::worker( size_t index ) {
+			t_current_pool = this;
+			t_current_queue = index;
+			while( true ) {
+				task_t task;
+				if( try_pop( index, task ) || try_steal( index, task ) ) {
+					task( );
+					continue;
+				}
+				std::unique_lock<std::mutex> lock{ m_sleep_mutex };
+				m_sleep_cv.wait( lock, [this]( ) {
+					return m_stop || m_queued != 0;
+				} );
+				if( m_stop ) {
+					return;
+				}
+			}
+		}
+
+		std::shared_ptr<thread_pool> shared_thread_pool( ) {
+			static auto const s_pool = std::make_shared<thread_pool>( );
+			return s_pool;
+		}
+	}	// namespace spreadsheet
+}	// namespace daw
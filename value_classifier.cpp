@@ -0,0 +1,323 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2016 Darrell Wright
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <cassert>
+
+#include "value_classifier.h"
+
+namespace daw {
+	namespace spreadsheet {
+		namespace {
+			using expected_value_t = classified_value::expected_value_t;
+
+			constexpr int64_t seconds_per_day = 86400;
+
+			bool is_space( char c ) noexcept {
+				return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+			}
+
+			bool is_digit( char c ) noexcept {
+				return c >= '0' && c <= '9';
+			}
+
+			boost::string_ref trim( boost::string_ref text ) noexcept {
+				while( !text.empty( ) && is_space( text.front( ) ) ) {
+					text.remove_prefix( 1 );
+				}
+				while( !text.empty( ) && is_space( text.back( ) ) ) {
+					text.remove_suffix( 1 );
+				}
+				return text;
+			}
+
+			bool equal_nc( boost::string_ref lhs, boost::string_ref rhs ) noexcept {
+				return lhs.size( ) == rhs.size( ) && std::equal( lhs.begin( ), lhs.end( ), rhs.begin( ), []( char a, char b ) {
+					return (a | 0b00100000) == (b | 0b00100000);
+				} );
+			}
+
+			/// Value of the count digits starting at pos.  The caller has checked they are digits
+			int64_t digits_value( boost::string_ref text, size_t pos, size_t count ) noexcept {
+				int64_t result = 0;
+				for( auto n = pos; n < pos + count; ++n ) {
+					result = result * 10 + (text[n] - '0');
+				}
+				return result;
+			}
+
+			size_t count_digits( boost::string_ref text, size_t pos ) noexcept {
+				auto const start = pos;
+				while( pos < text.size( ) && is_digit( text[pos] ) ) {
+					++pos;
+				}
+				return pos - start;
+			}
+
+			int64_t ticks_per_second( ) noexcept {
+				return static_cast<int64_t>( boost::posix_time::time_duration::ticks_per_second( ) );
+			}
+
+			/// Fractional seconds from the digits at pos, truncated to the tick resolution
+			int64_t fraction_ticks( boost::string_ref text, size_t pos, size_t count ) noexcept {
+				int64_t result = 0;
+				int64_t scale = ticks_per_second( );
+				for( auto n = pos; n < pos + count && scale > 1; ++n ) {
+					scale /= 10;
+					result += (text[n] - '0') * scale;
+				}
+				return result;
+			}
+
+			bool is_leap_year( int64_t year ) noexcept {
+				return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+			}
+
+			int64_t days_in_month( int64_t year, int64_t month ) noexcept {
+				static constexpr int64_t const s_days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+				return month == 2 && is_leap_year( year ) ? 29 : s_days[month - 1];
+			}
+
+			/// Days between 1970-01-01 and the given civil date
+			int64_t days_from_civil( int64_t year, int64_t month, int64_t day ) noexcept {
+				year -= month <= 2 ? 1 : 0;
+				auto const era = (year >= 0 ? year : year - 399) / 400;
+				auto const year_of_era = year - era * 400;
+				auto const day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+				auto const day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+				return era * 146097 + day_of_era - 719468;
+			}
+
+			/// YYYYMMDDTHHMMSS[.,]f*, the format of boost::posix_time::from_iso_string.  The
+			/// first 8 digits have been scanned
+			bool scan_timestamp( boost::string_ref text, classified_value & result ) noexcept {
+				if( text.size( ) < 15 || count_digits( text, 9 ) != 6 ) {
+					return false;
+				}
+				size_t fraction_digits = 0;
+				if( text.size( ) > 15 ) {
+					if( text[15] != '.' && text[15] != ',' ) {
+						return false;
+					}
+					fraction_digits = count_digits( text, 16 );
+					if( fraction_digits == 0 || 16 + fraction_digits != text.size( ) ) {
+						return false;
+					}
+				}
+				auto const year = digits_value( text, 0, 4 );
+				auto const month = digits_value( text, 4, 2 );
+				auto const day = digits_value( text, 6, 2 );
+				auto const hour = digits_value( text, 9, 2 );
+				auto const minute = digits_value( text, 11, 2 );
+				auto const second = digits_value( text, 13, 2 );
+				// Year range is that of boost::gregorian::date
+				if( year < 1400 || month < 1 || month > 12 || day < 1 || day > days_in_month( year, month ) || hour > 23 || minute > 59 || second > 59 ) {
+					return false;
+				}
+				auto const seconds = days_from_civil( year, month, day ) * seconds_per_day + hour * 3600 + minute * 60 + second;
+				result.type = expected_value_t::Timestamp;
+				result.ticks = seconds * ticks_per_second( ) + fraction_ticks( text, 16, fraction_digits );
+				return true;
+			}
+
+			/// [-]H+:MM[:SS[.f*]], the hour digits start at pos and number hour_digits
+			bool scan_time( boost::string_ref text, size_t pos, size_t hour_digits, bool negative, classified_value & result ) noexcept {
+				// Hours are limited so the tick count cannot overflow
+				if( hour_digits > 6 ) {
+					return false;
+				}
+				auto const hours = digits_value( text, pos, hour_digits );
+				pos += hour_digits + 1;	// :
+				if( count_digits( text, pos ) != 2 ) {
+					return false;
+				}
+				auto const minutes = digits_value( text, pos, 2 );
+				pos += 2;
+				int64_t seconds = 0;
+				int64_t fraction = 0;
+				if( pos < text.size( ) ) {
+					if( text[pos] != ':' || count_digits( text, pos + 1 ) != 2 ) {
+						return false;
+					}
+					seconds = digits_value( text, pos + 1, 2 );
+					pos += 3;
+					if( pos < text.size( ) ) {
+						auto const fraction_digits = text[pos] == '.' ? count_digits( text, pos + 1 ) : 0;
+						if( fraction_digits == 0 || pos + 1 + fraction_digits != text.size( ) ) {
+							return false;
+						}
+						fraction = fraction_ticks( text, pos + 1, fraction_digits );
+					}
+				}
+				if( minutes > 59 || seconds > 59 ) {
+					return false;
+				}
+				auto const ticks = (hours * 3600 + minutes * 60 + seconds) * ticks_per_second( ) + fraction;
+				result.type = expected_value_t::Time;
+				result.ticks = negative ? -ticks : ticks;
+				return true;
+			}
+
+			/// [+-]( D+[.D*] | .D+ )([eE][+-]?D+), pos is after the integer digits.  Long
+			/// exponents can be out of number_t's range, those are checked by parsing the text
+			bool scan_number( boost::string_ref text, size_t pos, size_t integer_digits ) noexcept {
+				size_t fraction_digits = 0;
+				if( pos < text.size( ) && text[pos] == '.' ) {
+					fraction_digits = count_digits( text, pos + 1 );
+					pos += 1 + fraction_digits;
+				}
+				if( integer_digits + fraction_digits == 0 ) {
+					return false;
+				}
+				if( pos < text.size( ) && (text[pos] == 'e' || text[pos] == 'E') ) {
+					++pos;
+					if( pos < text.size( ) && (text[pos] == '+' || text[pos] == '-') ) {
+						++pos;
+					}
+					auto const exponent_digits = count_digits( text, pos );
+					if( exponent_digits == 0 ) {
+						return false;
+					}
+					auto const leading_zeros = static_cast<size_t>( std::find_if( text.begin( ) + pos, text.begin( ) + pos + exponent_digits, []( char c ) {
+						return c != '0';
+					} ) - (text.begin( ) + pos) );
+					pos += exponent_digits;
+					if( pos == text.size( ) && exponent_digits - leading_zeros > 4 ) {
+						impl::cell_value::number_t value{ };
+						auto const result = number::from_chars( text.begin( ), text.end( ), value );
+						return result.ec == std::errc{ } && result.ptr == text.end( );
+					}
+				}
+				return pos == text.size( );
+			}
+		}	// namespace anonymous
+
+		classified_value::classified_value( ) noexcept:
+				type{ expected_value_t::General },
+				text{ },
+				ticks{ 0 },
+				boolean{ false } { }
+
+		classified_value::classified_value( expected_value_t value_type, boost::string_ref value_text ) noexcept:
+				type{ value_type },
+				text{ value_text },
+				ticks{ 0 },
+				boolean{ false } { }
+
+		classified_value classify_value( boost::string_ref text ) noexcept {
+			text = trim( text );
+			if( text.empty( ) ) {
+				return classified_value{ expected_value_t::General, text };
+			}
+			classified_value result{ expected_value_t::Text, text };
+			switch( text.front( ) ) {
+			case 't':
+			case 'T':
+				if( equal_nc( text, "true" ) ) {
+					result.type = expected_value_t::Boolean;
+					result.boolean = true;
+				}
+				return result;
+			case 'f':
+			case 'F':
+				if( equal_nc( text, "false" ) ) {
+					result.type = expected_value_t::Boolean;
+				}
+				return result;
+			default:
+				break;
+			}
+			// Everything else that is not text starts with an optional sign and a digit run
+			size_t pos = 0;
+			bool const negative = text.front( ) == '-';
+			if( negative || text.front( ) == '+' ) {
+				++pos;
+			}
+			auto const integer_digits = count_digits( text, pos );
+			auto const next = pos + integer_digits < text.size( ) ? text[pos + integer_digits] : '\0';
+			if( next == 'T' && pos == 0 && integer_digits == 8 ) {
+				scan_timestamp( text, result );
+			} else if( next == ':' && integer_digits > 0 ) {
+				scan_time( text, pos, integer_digits, negative, result );
+			} else if( scan_number( text, pos + integer_digits, integer_digits ) ) {
+				result.type = expected_value_t::Number;
+			}
+			return result;
+		}
+
+		void classify_values( boost::string_ref const * first, boost::string_ref const * last, classified_value * out ) noexcept {
+			for( ; first != last; ++first, ++out ) {
+				*out = classify_value( *first );
+			}
+		}
+
+		std::vector<classified_value> classify_values( std::vector<boost::string_ref> const & values ) {
+			std::vector<classified_value> result( values.size( ) );
+			classify_values( values.data( ), values.data( ) + values.size( ), result.data( ) );
+			return result;
+		}
+
+		size_t classify_column( boost::string_ref buffer, char delimiter, std::vector<classified_value> & out ) {
+			auto const start_size = out.size( );
+			out.reserve( start_size + static_cast<size_t>( std::count( buffer.begin( ), buffer.end( ), delimiter ) ) + 1 );
+			while( !buffer.empty( ) ) {
+				auto const pos = std::min( buffer.find( delimiter ), buffer.size( ) );
+				out.push_back( classify_value( buffer.substr( 0, pos ) ) );
+				buffer.remove_prefix( std::min( pos + 1, buffer.size( ) ) );
+			}
+			return out.size( ) - start_size;
+		}
+
+		impl::cell_value::number_t to_number( classified_value const & value ) {
+			// The classifier only accepts text that from_chars parses completely
+			impl::cell_value::number_t result{ };
+			auto const parsed = number::from_chars( value.text.begin( ), value.text.end( ), result );
+			assert( parsed.ec == std::errc{ } && parsed.ptr == value.text.end( ) );
+			static_cast<void>( parsed );
+			return result;
+		}
+
+		impl::cell_value::timestamp_t to_timestamp( classified_value const & value ) {
+			static boost::posix_time::ptime const s_epoch{ boost::gregorian::date{ 1970, 1, 1 } };
+			return s_epoch + boost::posix_time::time_duration{ 0, 0, 0, value.ticks };
+		}
+
+		impl::cell_value::duration_t to_duration( classified_value const & value ) {
+			return boost::posix_time::time_duration{ 0, 0, 0, value.ticks };
+		}
+
+		impl::cell_value::cell_variant_t to_variant( classified_value const & value ) {
+			using cell_variant_t = impl::cell_value::cell_variant_t;
+			switch( value.type ) {
+			case expected_value_t::Number: return cell_variant_t{ }.store( to_number( value ) );
+			case expected_value_t::Timestamp: return cell_variant_t{ }.store( to_timestamp( value ) );
+			case expected_value_t::Time: return cell_variant_t{ }.store( to_duration( value ) );
+			case expected_value_t::Boolean: return cell_variant_t{ }.store( value.boolean );
+			case expected_value_t::General:
+			case expected_value_t::Text:
+			case expected_value_t::Error:
+			default: return cell_variant_t{ }.store( value.text.to_string( ) );
+			}
+		}
+	}	// namespace spreadsheet
+}	// namespace daw